@@ -0,0 +1,240 @@
+// TestArena.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/TestGroup.h"
+
+#include "Core/Mem/Arena.h"
+#include "Core/Strings/AArenaString.h"
+
+// TestArena
+//------------------------------------------------------------------------------
+class TestArena : public TestGroup
+{
+private:
+    DECLARE_TESTS
+
+    void TestUnused() const;
+    void TestAllocs() const;
+    void TestRewind() const;
+    void TestLargeAllocs() const;
+    void TestTrim() const;
+    void TestArenaString() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestArena )
+    REGISTER_TEST( TestUnused )
+    REGISTER_TEST( TestAllocs )
+    REGISTER_TEST( TestRewind )
+    REGISTER_TEST( TestLargeAllocs )
+    REGISTER_TEST( TestTrim )
+    REGISTER_TEST( TestArenaString )
+REGISTER_TESTS_END
+
+// TestUnused
+//------------------------------------------------------------------------------
+void TestArena::TestUnused() const
+{
+    // Create an Arena but don't do anything with it
+    Arena arena;
+    TEST_ASSERT( arena.GetNumBytesReserved() == 0 );
+}
+
+// TestAllocs
+//------------------------------------------------------------------------------
+void TestArena::TestAllocs() const
+{
+    Arena arena( 1024 );
+
+    // Allocations are aligned and don't overlap
+    char * a = static_cast< char * >( arena.Alloc( 3, 1 ) );
+    char * b = static_cast< char * >( arena.Alloc( 8, 8 ) );
+    char * c = static_cast< char * >( arena.Alloc( 5, 64 ) );
+    TEST_ASSERT( a && b && c );
+    TEST_ASSERT( ( (size_t)b % 8 ) == 0 );
+    TEST_ASSERT( ( (size_t)c % 64 ) == 0 );
+    TEST_ASSERT( b >= ( a + 3 ) );
+    TEST_ASSERT( c >= ( b + 8 ) );
+
+    // Allocations spill into additional blocks
+    for ( size_t i = 0; i < 100; ++i )
+    {
+        char * mem = static_cast< char * >( arena.Alloc( 100 ) );
+        mem[ 0 ] = 'x';
+        mem[ 99 ] = 'x';
+    }
+    TEST_ASSERT( arena.GetNumBytesReserved() > 1024 );
+}
+
+// TestRewind
+//------------------------------------------------------------------------------
+void TestArena::TestRewind() const
+{
+    Arena arena( 1024 );
+
+    char * kept = static_cast< char * >( arena.Alloc( 16 ) );
+    const Arena::Marker marker = arena.GetMarker();
+
+    // Rewinding to the marker makes memory after it available again
+    void * first = arena.Alloc( 16 );
+    arena.Rewind( marker );
+    TEST_ASSERT( arena.Alloc( 16 ) == first );
+    arena.Rewind( marker );
+
+    // Blocks used after the marker are re-used rather than allocated again
+    for ( size_t i = 0; i < 100; ++i )
+    {
+        TEST_ASSERT( arena.Alloc( 100 ) );
+    }
+    const size_t reserved = arena.GetNumBytesReserved();
+    for ( size_t repeat = 0; repeat < 10; ++repeat )
+    {
+        arena.Rewind( marker );
+        for ( size_t i = 0; i < 100; ++i )
+        {
+            TEST_ASSERT( arena.Alloc( 100 ) );
+        }
+    }
+    TEST_ASSERT( arena.GetNumBytesReserved() == reserved );
+
+    // Memory before the marker is untouched
+    arena.Rewind( marker );
+    TEST_ASSERT( arena.Alloc( 16 ) == first );
+    TEST_ASSERT( kept < first );
+
+    // Scopes rewind automatically
+    const Arena::Marker before = arena.GetMarker();
+    {
+        const ArenaScope scope( &arena );
+        TEST_ASSERT( arena.Alloc( 2048 ) );
+    }
+    TEST_ASSERT( arena.GetMarker().m_Pos == before.m_Pos );
+
+    // Scopes without an Arena do nothing
+    {
+        const ArenaScope scope( nullptr );
+    }
+}
+
+// TestLargeAllocs
+//------------------------------------------------------------------------------
+void TestArena::TestLargeAllocs() const
+{
+    Arena arena( 1024 );
+    const Arena::Marker marker = arena.GetMarker();
+
+    // Allocations larger than the block size get their own block
+    char * large = static_cast< char * >( arena.Alloc( 64 * 1024 ) );
+    large[ 0 ] = 'x';
+    large[ 64 * 1024 - 1 ] = 'x';
+    TEST_ASSERT( arena.GetNumBytesReserved() >= ( 64 * 1024 ) );
+
+    // Large blocks are re-used for later large allocations, even when
+    // smaller allocations are made first
+    const size_t reserved = arena.GetNumBytesReserved();
+    for ( size_t repeat = 0; repeat < 10; ++repeat )
+    {
+        arena.Rewind( marker );
+        TEST_ASSERT( arena.Alloc( 16 ) );
+        TEST_ASSERT( arena.Alloc( 64 * 1024 ) );
+    }
+    TEST_ASSERT( arena.GetNumBytesReserved() <= ( reserved + 1024 ) );
+}
+
+// TestTrim
+//------------------------------------------------------------------------------
+void TestArena::TestTrim() const
+{
+    Arena arena( 1024 );
+
+    // Blocks in use are never freed
+    const Arena::Marker marker = arena.GetMarker();
+    TEST_ASSERT( arena.Alloc( 16 ) );
+    const size_t smallReserved = arena.GetNumBytesReserved();
+    arena.Trim( 0 );
+    TEST_ASSERT( arena.GetNumBytesReserved() == smallReserved );
+
+    // Large unused blocks are freed first
+    const Arena::Marker afterSmall = arena.GetMarker();
+    TEST_ASSERT( arena.Alloc( 64 * 1024 ) );
+    arena.Rewind( afterSmall );
+    TEST_ASSERT( arena.GetNumBytesReserved() >= ( smallReserved + ( 64 * 1024 ) ) );
+    arena.Trim( 4 * 1024 );
+    TEST_ASSERT( arena.GetNumBytesReserved() == smallReserved );
+
+    // Nothing is freed when under the limit
+    arena.Rewind( marker );
+    arena.Trim( 4 * 1024 );
+    TEST_ASSERT( arena.GetNumBytesReserved() == smallReserved );
+
+    // Everything unused can be freed, and the Arena remains usable
+    arena.Trim( 0 );
+    TEST_ASSERT( arena.GetNumBytesReserved() == 0 );
+    TEST_ASSERT( arena.Alloc( 16 ) );
+    arena.Rewind( marker );
+
+    // Scopes can trim when they rewind
+    {
+        const ArenaScope scope( &arena, 4 * 1024 );
+        TEST_ASSERT( arena.Alloc( 64 * 1024 ) );
+    }
+    TEST_ASSERT( arena.GetNumBytesReserved() <= ( 4 * 1024 ) );
+}
+
+// TestArenaString
+//------------------------------------------------------------------------------
+void TestArena::TestArenaString() const
+{
+    Arena arena;
+
+    // Initial capacity comes from the Arena
+    {
+        const ArenaScope scope( &arena );
+        AArenaString str( &arena, 64 );
+        TEST_ASSERT( str.IsEmpty() );
+        TEST_ASSERT( str.GetReserved() >= 64 );
+        TEST_ASSERT( str.MemoryMustBeFreed() == false );
+        str = "Hello";
+        TEST_ASSERT( str == "Hello" );
+
+        // Growing beyond that uses the heap
+        for ( size_t i = 0; i < 20; ++i )
+        {
+            str += " World";
+        }
+        TEST_ASSERT( str.MemoryMustBeFreed() );
+        TEST_ASSERT( str.BeginsWith( "Hello World World" ) );
+
+        // Strings moved from it are safe to use after the scope
+        AArenaString other( &arena, 64 );
+        other = "Transient";
+        AString moved( Move( other ) );
+        TEST_ASSERT( moved.MemoryMustBeFreed() );
+        TEST_ASSERT( moved == "Transient" );
+    }
+
+    // Strings can be destroyed while still using memory from the Arena
+    {
+        const ArenaScope scope( &arena );
+        {
+            AArenaString str( &arena, 64 );
+            str = "Fits";
+            str += " in reserve";
+            TEST_ASSERT( str.MemoryMustBeFreed() == false );
+            TEST_ASSERT( str == "Fits in reserve" );
+        }
+        {
+            AArenaString str( &arena, 64 ); // Never used
+        }
+    }
+
+    // Without an Arena, it's a regular string
+    AArenaString str( nullptr, 64 );
+    str = "Hello";
+    TEST_ASSERT( str == "Hello" );
+}
+
+//------------------------------------------------------------------------------
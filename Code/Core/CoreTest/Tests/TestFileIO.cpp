@@ -11,12 +11,14 @@
 #endif
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MappedFile.h"
 #include "Core/Math/Random.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 
 // system
+#include <string.h>
 #if defined( __LINUX__ )
     #include <unistd.h>
 #endif
@@ -36,6 +38,7 @@ private:
     void ReadOnly() const;
     void FileTime() const;
     void LongPaths() const;
+    void MappedFileRead() const;
     #if defined( __WINDOWS__ )
         void NormalizeWindowsPathCasing() const;
     #endif
@@ -56,6 +59,7 @@ REGISTER_TESTS_BEGIN( TestFileIO )
     REGISTER_TEST( ReadOnly )
     REGISTER_TEST( FileTime )
     REGISTER_TEST( LongPaths )
+    REGISTER_TEST( MappedFileRead )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( NormalizeWindowsPathCasing )
     #endif
@@ -482,6 +486,52 @@ void TestFileIO::LongPaths() const
     TEST_ASSERT( FileIO::DirectoryDelete( tmpPath1 ) );
 }
 
+// MappedFileRead
+//------------------------------------------------------------------------------
+void TestFileIO::MappedFileRead() const
+{
+    // generate a process unique file path
+    AStackString<> path;
+    GenerateTempFileName( path );
+
+    // Missing file
+    {
+        MappedFile mf;
+        TEST_ASSERT( mf.Open( path.Get() ) == false );
+        TEST_ASSERT( mf.IsOpen() == false );
+    }
+
+    // Empty file
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+        f.Close();
+
+        MappedFile mf;
+        TEST_ASSERT( mf.Open( path.Get() ) == true );
+        TEST_ASSERT( mf.GetSize() == 0 );
+    }
+
+    // File with contents
+    {
+        const char data[] = "MappedFile test data";
+        FileStream f;
+        TEST_ASSERT( f.Open( path.Get(), FileStream::WRITE_ONLY ) == true );
+        TEST_ASSERT( f.WriteBuffer( data, sizeof( data ) ) == sizeof( data ) );
+        f.Close();
+
+        MappedFile mf;
+        TEST_ASSERT( mf.Open( path.Get() ) == true );
+        TEST_ASSERT( mf.GetSize() == sizeof( data ) );
+        TEST_ASSERT( memcmp( mf.GetData(), data, sizeof( data ) ) == 0 );
+        mf.Close();
+        TEST_ASSERT( mf.IsOpen() == false );
+    }
+
+    // cleanup
+    VERIFY( FileIO::FileDelete( path.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileIO::GenerateTempFileName( AString & tmpFileName ) const
@@ -20,6 +20,7 @@ private:
 
     void WriteOnly() const;
     void ReadOnly() const;
+    void Append() const;
 
     // Helpers
     mutable uint32_t m_TempFileId = 0;
@@ -31,6 +32,7 @@ private:
 REGISTER_TESTS_BEGIN( TestFileStream )
     REGISTER_TEST( WriteOnly )
     REGISTER_TEST( ReadOnly )
+    REGISTER_TEST( Append )
 REGISTER_TESTS_END
 
 // WriteOnly
@@ -111,6 +113,48 @@ void TestFileStream::ReadOnly() const
     TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
 }
 
+// Append
+//------------------------------------------------------------------------------
+void TestFileStream::Append() const
+{
+    AStackString<> fileName;
+    GenerateTempFileName( fileName );
+
+    const AStackString<> data1( "Some Data" );
+    const AStackString<> data2( " And Some More" );
+
+    // Appending to a file that doesn't exist creates it
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == true );
+        TEST_ASSERT( f.WriteBuffer( data1.Get(), data1.GetLength() ) == data1.GetLength() );
+    }
+
+    // Appending to an existing file keeps existing contents
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == true );
+        TEST_ASSERT( f.WriteBuffer( data2.Get(), data2.GetLength() ) == data2.GetLength() );
+    }
+
+    // Check contents
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::READ_ONLY ) == true );
+        AStackString<> expected( data1 );
+        expected += data2;
+        TEST_ASSERT( f.GetFileSize() == expected.GetLength() );
+
+        AStackString<> buffer;
+        buffer.SetLength( expected.GetLength() );
+        TEST_ASSERT( f.ReadBuffer( buffer.Get(), expected.GetLength() ) == expected.GetLength() );
+        TEST_ASSERT( expected == buffer );
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileStream::GenerateTempFileName( AString & outTempFileName ) const
@@ -25,6 +25,7 @@ private:
 
     void CompareHashTimes_Large() const;
     void CompareHashTimes_Small() const;
+    void xxHash3Accumulator_MatchesCalc64() const;
 };
 
 // Register Tests
@@ -32,6 +33,7 @@ private:
 REGISTER_TESTS_BEGIN( TestHash )
     REGISTER_TEST( CompareHashTimes_Large )
     REGISTER_TEST( CompareHashTimes_Small )
+    REGISTER_TEST( xxHash3Accumulator_MatchesCalc64 )
 REGISTER_TESTS_END
 
 // CompareHashTimes_Large
@@ -269,4 +271,36 @@ void TestHash::CompareHashTimes_Small() const
     }
 }
 
+// xxHash3Accumulator_MatchesCalc64
+//------------------------------------------------------------------------------
+void TestHash::xxHash3Accumulator_MatchesCalc64() const
+{
+    // use pseudo-random (but deterministic) data
+    Random r( 0xB1234567 );
+    const size_t dataSize( 1024 * 1024 + 7 );
+    UniquePtr< uint8_t, FreeDeletor > data( (uint8_t *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (uint8_t)r.GetRand();
+    }
+
+    // Hash in pieces of various sizes, including empty ones
+    const size_t pieceSizes[] = { 1, 13, 4096, 65537, dataSize };
+    for ( const size_t pieceSize : pieceSizes )
+    {
+        xxHash3Accumulator accumulator;
+        accumulator.AddData( data.Get(), 0 );
+        for ( size_t pos = 0; pos < dataSize; pos += pieceSize )
+        {
+            const size_t len = ( ( dataSize - pos ) < pieceSize ) ? ( dataSize - pos ) : pieceSize;
+            accumulator.AddData( data.Get() + pos, len );
+        }
+        TEST_ASSERT( accumulator.Finalize64() == xxHash3::Calc64( data.Get(), dataSize ) );
+    }
+
+    // Nothing
+    const xxHash3Accumulator empty;
+    TEST_ASSERT( empty.Finalize64() == xxHash3::Calc64( data.Get(), 0 ) );
+}
+
 //------------------------------------------------------------------------------
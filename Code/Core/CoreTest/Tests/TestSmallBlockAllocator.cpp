@@ -25,6 +25,7 @@ private:
 
     void SingleThreaded() const;
     void MultiThreaded() const;
+    void FreeOnOtherThread() const;
 
     // struct for managing threads
     class ThreadInfo
@@ -42,6 +43,7 @@ private:
     static float    AllocateFromSmallBlockAllocator( const Array< uint32_t > & allocSizes, const uint32_t repeatCount );
     static uint32_t ThreadFunction_System( void * userData );
     static uint32_t ThreadFunction_SmallBlock( void * userData );
+    static uint32_t ThreadFunction_Free( void * userData );
 };
 
 // Register Tests
@@ -49,6 +51,7 @@ private:
 REGISTER_TESTS_BEGIN( TestSmallBlockAllocator )
     REGISTER_TEST( SingleThreaded )
     REGISTER_TEST( MultiThreaded )
+    REGISTER_TEST( FreeOnOtherThread )
 REGISTER_TESTS_END
 
 // SingleThreaded
@@ -135,6 +138,37 @@ void TestSmallBlockAllocator::MultiThreaded() const
     OUTPUT( "SmallBlockAllocator    : %2.3fs - %u allocs @ %u allocs/sec\n", (double)time2, ( numAllocs * repeatCount ), (uint32_t)( float( numAllocs * repeatCount ) / time2 ) );
 }
 
+// FreeOnOtherThread
+//------------------------------------------------------------------------------
+void TestSmallBlockAllocator::FreeOnOtherThread() const
+{
+    // Return blocks cached by this thread so they aren't counted
+    #if defined( DEBUG ) && defined( SMALL_BLOCK_ALLOCATOR_ENABLED )
+        SmallBlockAllocator::ReleaseThreadCache();
+        const uint32_t numActiveBefore = SmallBlockAllocator::GetNumActiveAllocations();
+    #endif
+
+    // Allocate on this thread
+    Array< void * > allocs( 1000 );
+    for ( uint32_t i = 0; i < 1000; ++i )
+    {
+        uint32_t * mem = static_cast< uint32_t * >( ALLOC( ( i % 64 ) * 4 + 4 ) );
+        *mem = i;
+        allocs.Append( mem );
+    }
+
+    // Free on another thread, which caches them until it exits
+    Thread t;
+    t.Start( ThreadFunction_Free, "SmallBlock", &allocs );
+    TEST_ASSERT( t.Join() == 0 );
+
+    // Blocks cached by the other thread were returned to the buckets
+    #if defined( DEBUG ) && defined( SMALL_BLOCK_ALLOCATOR_ENABLED )
+        SmallBlockAllocator::ReleaseThreadCache();
+        TEST_ASSERT( SmallBlockAllocator::GetNumActiveAllocations() == numActiveBefore );
+    #endif
+}
+
 // GetRandomAllocSizes
 //------------------------------------------------------------------------------
 /*static*/ void TestSmallBlockAllocator::GetRandomAllocSizes( const uint32_t numAllocs, Array< uint32_t > & allocSizes )
@@ -236,4 +270,21 @@ void TestSmallBlockAllocator::MultiThreaded() const
     return 0;
 }
 
+// ThreadFunction_Free
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestSmallBlockAllocator::ThreadFunction_Free( void * userData )
+{
+    const Array< void * > & allocs = *( static_cast< const Array< void * > * >( userData ) );
+    for ( uint32_t i = 0; i < allocs.GetSize(); ++i )
+    {
+        uint32_t * mem = static_cast< uint32_t * >( allocs[ i ] );
+        if ( *mem != i )
+        {
+            return 1; // Corrupted
+        }
+        FREE( mem );
+    }
+    return 0;
+}
+
 //------------------------------------------------------------------------------
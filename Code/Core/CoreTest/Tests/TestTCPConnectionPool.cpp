@@ -52,6 +52,8 @@ private:
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
 
     void TestConnectionFailure() const;
+    void TestManyConnections() const;
+    void TestSendFromCallbackDoesNotBlock() const;
 };
 
 // Helper Macros
@@ -76,6 +78,8 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestDataTransfer )
     REGISTER_TEST( TestConnectionStuckDuringSend )
     REGISTER_TEST( TestConnectionFailure )
+    REGISTER_TEST( TestManyConnections )
+    REGISTER_TEST( TestSendFromCallbackDoesNotBlock )
 REGISTER_TESTS_END
 
 // TestOneServerMultipleClients
@@ -342,4 +346,144 @@ void TestTestTCPConnectionPool::TestConnectionFailure() const
     client.ShutdownAllConnections();
 }
 
+// TestManyConnections
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestManyConnections() const
+{
+    // a server which tracks callbacks, which must be ordered for each connection
+    class TestServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestServer() override { ShutdownAllConnections(); }
+        virtual void OnConnected( const ConnectionInfo * ci ) override
+        {
+            TEST_ASSERT( ci->GetUserData() == nullptr );
+            ci->SetUserData( (void *)1 );
+            AtomicInc( &m_NumConnected );
+        }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( ci->GetUserData() == (void *)1 );
+            TEST_ASSERT( size == sizeof( uint32_t ) );
+            AtomicAdd( &m_ReceivedTotal, (uint64_t)*(const uint32_t *)data );
+        }
+        virtual void OnDisconnected( const ConnectionInfo * ci ) override
+        {
+            TEST_ASSERT( ci->GetUserData() == (void *)1 );
+            AtomicInc( &m_NumDisconnected );
+        }
+        volatile uint32_t m_NumConnected = 0;
+        volatile uint32_t m_NumDisconnected = 0;
+        volatile uint64_t m_ReceivedTotal = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    TestServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // many more connections than there are threads servicing them
+    const uint32_t numConnections = 16;
+    const uint32_t numMessages = 100;
+    uint64_t expectedTotal = 0;
+    {
+        TCPConnectionPool client;
+        const ConnectionInfo * connections[ numConnections ];
+        for ( uint32_t i = 0; i < numConnections; ++i )
+        {
+            connections[ i ] = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+            TEST_ASSERT( connections[ i ] );
+        }
+        for ( uint32_t j = 0; j < numMessages; ++j )
+        {
+            for ( uint32_t i = 0; i < numConnections; ++i )
+            {
+                const uint32_t value = ( i * numMessages ) + j;
+                TEST_ASSERT( client.Send( connections[ i ], &value, sizeof( value ) ) );
+                expectedTotal += value;
+            }
+        }
+
+        WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_ReceivedTotal ) == expectedTotal );
+        TEST_ASSERT( AtomicLoadRelaxed( &server.m_NumConnected ) == numConnections );
+        client.ShutdownAllConnections();
+    }
+
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    TEST_ASSERT( AtomicLoadRelaxed( &server.m_NumDisconnected ) == numConnections );
+}
+
+// TestSendFromCallbackDoesNotBlock
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestSendFromCallbackDoesNotBlock() const
+{
+    // a server which replies to every message, with lots of data if requested
+    class TestServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( size == sizeof( uint32_t ) );
+            const uint32_t replySize = *(const uint32_t *)data;
+            TEST_ASSERT( Send( ci, m_ReplyData.Get(), replySize ) );
+            AtomicInc( &m_NumReplies );
+        }
+        UniquePtr< char, FreeDeletor > m_ReplyData;
+        volatile uint32_t m_NumReplies = 0;
+    };
+
+    // a client which doesn't read anything until released
+    class StalledClient : public TCPConnectionPool
+    {
+    public:
+        virtual void OnConnected( const ConnectionInfo * ) override { m_Release.Wait(); }
+        Semaphore m_Release;
+    };
+
+    // a client which waits for replies
+    class TestClient : public TCPConnectionPool
+    {
+    public:
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t, bool & ) override { m_ReplyReceived.Signal(); }
+        Semaphore m_ReplyReceived;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+    const uint32_t largeReplySize = ( 32 * MEGABYTE ); // more than the socket buffers can hold
+
+    TestServer server;
+    server.m_ReplyData = (char *)ALLOC( largeReplySize );
+    memset( server.m_ReplyData.Get(), 0, largeReplySize );
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // Request large replies for more connections than there are threads servicing
+    // them. The replies can't be sent until the client reads them, but the server
+    // must not wait for that in its callbacks.
+    const uint32_t numStalledConnections = 8;
+    StalledClient stalledClient;
+    for ( uint32_t i = 0; i < numStalledConnections; ++i )
+    {
+        const ConnectionInfo * ci = stalledClient.Connect( AStackString<>( "127.0.0.1" ), testPort );
+        TEST_ASSERT( ci );
+        TEST_ASSERT( stalledClient.Send( ci, &largeReplySize, sizeof( largeReplySize ) ) );
+        WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == ( i + 1 ) ); // avoid overflowing the listen backlog
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumReplies ) == numStalledConnections );
+
+    // Other connections are still serviced
+    {
+        TestClient client;
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+        TEST_ASSERT( ci );
+        const uint32_t smallReplySize = 16;
+        TEST_ASSERT( client.Send( ci, &smallReplySize, sizeof( smallReplySize ) ) );
+        TEST_ASSERT( client.m_ReplyReceived.Wait( 30 * 1000 ) );
+        client.ShutdownAllConnections();
+    }
+
+    stalledClient.m_Release.Signal( numStalledConnections );
+    stalledClient.ShutdownAllConnections();
+}
+
 //------------------------------------------------------------------------------
@@ -806,6 +806,23 @@
             return ( ( (uint64_t)st.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)st.st_mtimespec.tv_nsec );
         }
     #elif defined( __LINUX__ )
+        #if defined( STATX_MTIME )
+            // Request only the modification time, which some file systems
+            // (network, overlay) can provide more cheaply than a full stat
+            struct statx stx;
+            if ( statx( AT_FDCWD, fileName.Get(), AT_SYMLINK_NOFOLLOW, STATX_MTIME, &stx ) == 0 )
+            {
+                if ( stx.stx_mask & STATX_MTIME )
+                {
+                    return ( ( (uint64_t)stx.stx_mtime.tv_sec * 1000000000ULL ) + (uint64_t)stx.stx_mtime.tv_nsec );
+                }
+            }
+            else if ( errno != ENOSYS )
+            {
+                return 0; // File is missing or inaccessible
+            }
+            // Fall back to lstat if statx is unavailable
+        #endif
         struct stat st;
         if ( lstat( fileName.Get(), &st ) == 0 )
         {
@@ -74,7 +74,8 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
         {
             desiredAccess       |= GENERIC_WRITE;
             shareMode           |= FILE_SHARE_READ; // allow other readers
-            creationDisposition |= CREATE_ALWAYS; // overwrite existing
+            creationDisposition |= ( ( fileMode & APPEND ) != 0 ) ? OPEN_ALWAYS     // keep existing
+                                                                  : CREATE_ALWAYS;  // overwrite existing
         }
         else
         {
@@ -103,6 +104,14 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
             {
                 // file opened ok
                 m_Handle = (void *)h;
+
+                // writes should go to the end of existing contents
+                if ( ( fileMode & APPEND ) != 0 )
+                {
+                    LARGE_INTEGER zeroDist;
+                    zeroDist.QuadPart = 0;
+                    VERIFY( SetFilePointerEx( h, zeroDist, nullptr, FILE_END ) );
+                }
                 return true;
             }
 
@@ -134,7 +143,8 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
         }
         else if ( ( fileMode & WRITE_ONLY ) != 0 )
         {
-            flags |= ( O_WRONLY | O_CREAT | O_TRUNC );
+            flags |= ( ( fileMode & APPEND ) != 0 ) ? ( O_WRONLY | O_CREAT | O_APPEND )
+                                                    : ( O_WRONLY | O_CREAT | O_TRUNC );
         }
         else
         {
@@ -346,6 +356,36 @@ bool FileStream::IsOpen() const
     #endif
 }
 
+// GetLastWriteTime
+//------------------------------------------------------------------------------
+uint64_t FileStream::GetLastWriteTime() const
+{
+    ASSERT( IsOpen() );
+
+    #if defined( __WINDOWS__ )
+        FILETIME ftWrite;
+        if ( GetFileTime( (HANDLE)m_Handle, nullptr, nullptr, &ftWrite ) ) // create, access, write
+        {
+            return ( (uint64_t)ftWrite.dwLowDateTime | ( (uint64_t)ftWrite.dwHighDateTime << 32 ) );
+        }
+    #elif defined( __APPLE__ )
+        struct stat s;
+        if ( fstat( m_Handle, &s ) == 0 )
+        {
+            return ( ( (uint64_t)s.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)s.st_mtimespec.tv_nsec );
+        }
+    #elif defined( __LINUX__ )
+        struct stat s;
+        if ( fstat( m_Handle, &s ) == 0 )
+        {
+            return ( ( (uint64_t)s.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)s.st_mtim.tv_nsec );
+        }
+    #else
+        #error Unknown platform
+    #endif
+    return 0;
+}
+
 // SetLastWriteTime
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ )
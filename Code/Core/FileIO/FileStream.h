@@ -18,6 +18,7 @@ public:
         READ_ONLY                     = 0x1,
         WRITE_ONLY                    = 0x2,
         TEMP                          = 0x4,
+        APPEND                        = 0x8,  // With WRITE_ONLY: keep existing contents and write to the end
         NO_RETRY_ON_SHARING_VIOLATION = 0x80,
     };
 
@@ -37,6 +38,7 @@ public:
     virtual uint64_t GetFileSize() const override;
 
     // file specific
+    uint64_t GetLastWriteTime() const; // Same units as FileIO::GetFileLastWriteTime
     #if defined( __WINDOWS__ )
         // Set on already open file via handle (Windows only)
         bool SetLastWriteTime( uint64_t lastWriteTime );
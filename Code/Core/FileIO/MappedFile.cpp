@@ -0,0 +1,156 @@
+// MappedFile.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MappedFile.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MappedFile::MappedFile()
+    : m_Memory( nullptr )
+    , m_Size( 0 )
+    , m_IsOpen( false )
+    #if defined( __WINDOWS__ )
+        , m_FileHandle( INVALID_HANDLE_VALUE )
+        , m_MappingHandle( nullptr )
+    #endif
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MappedFile::Open( const char * fileName )
+{
+    ASSERT( !IsOpen() );
+
+    #if defined( __WINDOWS__ )
+        HANDLE h = CreateFile( fileName,                // _In_     LPCTSTR lpFileName,
+                               GENERIC_READ,            // _In_     DWORD dwDesiredAccess,
+                               FILE_SHARE_READ,         // _In_     DWORD dwShareMode,
+                               nullptr,                 // _In_opt_ LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+                               OPEN_EXISTING,           // _In_     DWORD dwCreationDisposition,
+                               FILE_ATTRIBUTE_NORMAL,   // _In_     DWORD dwFlagsAndAttributes,
+                               nullptr );               // _In_opt_ HANDLE hTemplateFile
+        if ( h == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+        m_FileHandle = h;
+
+        LARGE_INTEGER size;
+        if ( !GetFileSizeEx( h, &size ) )
+        {
+            Close();
+            return false;
+        }
+        m_Size = (size_t)size.QuadPart;
+
+        // Empty files can't be mapped, but are valid to open
+        if ( m_Size > 0 )
+        {
+            m_MappingHandle = CreateFileMappingA( h, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if ( m_MappingHandle == nullptr )
+            {
+                Close();
+                return false;
+            }
+            m_Memory = MapViewOfFile( m_MappingHandle, FILE_MAP_READ, 0, 0, 0 );
+            if ( m_Memory == nullptr )
+            {
+                Close();
+                return false;
+            }
+        }
+    #elif defined( __APPLE__ ) || defined( __LINUX__ )
+        const int fd = open( fileName, O_RDONLY | O_CLOEXEC );
+        if ( fd == -1 )
+        {
+            return false;
+        }
+
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 )
+        {
+            close( fd );
+            return false;
+        }
+        m_Size = (size_t)st.st_size;
+
+        // Empty files can't be mapped, but are valid to open
+        if ( m_Size > 0 )
+        {
+            void * memory = mmap( nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( memory == MAP_FAILED )
+            {
+                close( fd );
+                m_Size = 0;
+                return false;
+            }
+            m_Memory = memory;
+        }
+
+        // The mapping remains valid after the descriptor is closed
+        close( fd );
+    #else
+        #error Unknown Platform
+    #endif
+
+    m_IsOpen = true;
+    return true;
+}
+
+// Close
+//------------------------------------------------------------------------------
+void MappedFile::Close()
+{
+    #if defined( __WINDOWS__ )
+        if ( m_Memory )
+        {
+            VERIFY( UnmapViewOfFile( m_Memory ) );
+        }
+        if ( m_MappingHandle )
+        {
+            VERIFY( CloseHandle( m_MappingHandle ) );
+            m_MappingHandle = nullptr;
+        }
+        if ( m_FileHandle != INVALID_HANDLE_VALUE )
+        {
+            VERIFY( CloseHandle( m_FileHandle ) );
+            m_FileHandle = INVALID_HANDLE_VALUE;
+        }
+    #elif defined( __APPLE__ ) || defined( __LINUX__ )
+        if ( m_Memory )
+        {
+            VERIFY( munmap( const_cast< void * >( m_Memory ), m_Size ) == 0 );
+        }
+    #else
+        #error Unknown Platform
+    #endif
+
+    m_Memory = nullptr;
+    m_Size = 0;
+    m_IsOpen = false;
+}
+
+//------------------------------------------------------------------------------
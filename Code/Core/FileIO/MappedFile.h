@@ -0,0 +1,34 @@
+// MappedFile - read only memory mapped view of a file
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// MappedFile
+//------------------------------------------------------------------------------
+class MappedFile
+{
+public:
+    explicit MappedFile();
+    ~MappedFile();
+
+    bool Open( const char * fileName );
+    void Close();
+
+    inline bool         IsOpen() const  { return m_IsOpen; }
+    inline const void * GetData() const { return m_Memory; }
+    inline size_t       GetSize() const { return m_Size; }
+
+private:
+    const void *    m_Memory;
+    size_t          m_Size;
+    bool            m_IsOpen;
+    #if defined( __WINDOWS__ )
+        void *      m_FileHandle;
+        void *      m_MappingHandle;
+    #endif
+};
+
+//------------------------------------------------------------------------------
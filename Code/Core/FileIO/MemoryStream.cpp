@@ -119,8 +119,7 @@ void MemoryStream::Flush()
 //------------------------------------------------------------------------------
 uint64_t MemoryStream::Tell() const
 {
-    ASSERT( false ); // Not implemented - implement if required
-    return 0;
+    return (uint64_t)( m_End - m_Begin );
 }
 
 // Seek
@@ -16,6 +16,11 @@ extern "C"
 
     // xxhash3
     unsigned long long xxHashLib_XXH3_64bits( const void * input, size_t length );
+    void * xxHashLib_XXH3_createState( void );
+    int xxHashLib_XXH3_freeState( void * state );
+    int xxHashLib_XXH3_64bits_reset( void * state );
+    int xxHashLib_XXH3_64bits_update( void * state, const void * input, size_t length );
+    unsigned long long xxHashLib_XXH3_64bits_digest( const void * state );
 };
 
 // xxHash
@@ -42,6 +47,25 @@ public:
     inline static uint64_t  Calc64( const AString & string ) { return Calc64( string.Get(), string.GetLength() ); }
 };
 
+// xxHash3Accumulator
+//------------------------------------------------------------------------------
+// Calculates the same hash as xxHash3::Calc64 for data provided in pieces
+class xxHash3Accumulator
+{
+public:
+    inline xxHash3Accumulator() : m_State( xxHashLib_XXH3_createState() ) { xxHashLib_XXH3_64bits_reset( m_State ); }
+    inline ~xxHash3Accumulator() { xxHashLib_XXH3_freeState( m_State ); }
+
+    inline void     AddData( const void * buffer, size_t len ) { xxHashLib_XXH3_64bits_update( m_State, buffer, len ); }
+    inline uint64_t Finalize64() const { return xxHashLib_XXH3_64bits_digest( m_State ); }
+
+    xxHash3Accumulator( const xxHash3Accumulator & ) = delete;
+    xxHash3Accumulator & operator = ( const xxHash3Accumulator & ) = delete;
+
+private:
+    void * m_State;
+};
+
 // Calc32
 //------------------------------------------------------------------------------
 /*static*/ uint32_t xxHash::Calc32( const void * buffer, size_t len )
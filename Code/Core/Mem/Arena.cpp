@@ -0,0 +1,194 @@
+// Arena - Monotonic allocator for short-lived allocations
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Arena.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Mem/MemDebug.h"
+
+// Arena::Block
+//------------------------------------------------------------------------------
+struct Arena::Block
+{
+    Block *     m_Prev;     // Previous block (in use, or free)
+    size_t      m_Size;     // Usable size, following this header
+    char *      m_UsedEnd;  // End of allocations, once no longer the current block
+
+    char *      GetBegin()  { return reinterpret_cast< char * >( this + 1 ); }
+    char *      GetEnd()    { return ( GetBegin() + m_Size ); }
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+Arena::Arena( size_t blockSize )
+    : m_BlockSize( blockSize )
+    , m_CurrentBlock( nullptr )
+    , m_FreeBlocks( nullptr )
+    , m_Pos( nullptr )
+    , m_End( nullptr )
+    , m_NumBytesReserved( 0 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+Arena::~Arena()
+{
+    Rewind( Marker{ nullptr, nullptr } );
+    while ( m_FreeBlocks )
+    {
+        Block * block = m_FreeBlocks;
+        m_FreeBlocks = block->m_Prev;
+        FREE( block );
+    }
+}
+
+// Alloc
+//------------------------------------------------------------------------------
+void * Arena::Alloc( size_t size, size_t alignment )
+{
+    ASSERT( Math::IsPowerOf2( alignment ) );
+
+    char * pos = reinterpret_cast< char * >( Math::RoundUp( reinterpret_cast< size_t >( m_Pos ), alignment ) );
+    if ( ( m_CurrentBlock == nullptr ) || ( size > static_cast< size_t >( m_End - pos ) ) )
+    {
+        NextBlock( size + alignment );
+        pos = reinterpret_cast< char * >( Math::RoundUp( reinterpret_cast< size_t >( m_Pos ), alignment ) );
+    }
+
+    m_Pos = ( pos + size );
+    ASSERT( m_Pos <= m_End );
+
+    #if defined( MEM_FILL_NEW_ALLOCATIONS )
+        if ( ( size > 0 ) && ( ( reinterpret_cast< size_t >( pos ) % sizeof( uint64_t ) ) == 0 ) )
+        {
+            MemDebug::FillMem( pos, size, MemDebug::MEM_FILL_NEW_ALLOCATION_PATTERN );
+        }
+    #endif
+
+    return pos;
+}
+
+// GetMarker
+//------------------------------------------------------------------------------
+Arena::Marker Arena::GetMarker() const
+{
+    return Marker{ m_CurrentBlock, m_Pos };
+}
+
+// Rewind
+//------------------------------------------------------------------------------
+void Arena::Rewind( const Marker & marker )
+{
+    // Release blocks used since the marker
+    while ( m_CurrentBlock != marker.m_Block )
+    {
+        ASSERT( m_CurrentBlock ); // Marker is not from this Arena, or was already rewound past
+
+        Block * block = m_CurrentBlock;
+        m_CurrentBlock = block->m_Prev;
+
+        #if defined( MEM_FILL_FREED_ALLOCATIONS )
+            MemDebug::FillMem( block->GetBegin(), static_cast< size_t >( m_Pos - block->GetBegin() ), MemDebug::MEM_FILL_FREED_ALLOCATION_PATTERN );
+        #endif
+
+        block->m_Prev = m_FreeBlocks;
+        m_FreeBlocks = block;
+        m_Pos = m_CurrentBlock ? m_CurrentBlock->m_UsedEnd : nullptr;
+    }
+
+    // Release allocations since the marker within its block
+    if ( m_CurrentBlock )
+    {
+        ASSERT( ( marker.m_Pos >= m_CurrentBlock->GetBegin() ) && ( marker.m_Pos <= m_CurrentBlock->GetEnd() ) );
+        #if defined( MEM_FILL_FREED_ALLOCATIONS )
+            char * fillStart = reinterpret_cast< char * >( Math::RoundUp( reinterpret_cast< size_t >( marker.m_Pos ), sizeof( uint64_t ) ) );
+            if ( m_Pos > fillStart )
+            {
+                MemDebug::FillMem( fillStart, static_cast< size_t >( m_Pos - fillStart ), MemDebug::MEM_FILL_FREED_ALLOCATION_PATTERN );
+            }
+        #endif
+        m_Pos = marker.m_Pos;
+        m_End = m_CurrentBlock->GetEnd();
+    }
+    else
+    {
+        m_Pos = nullptr;
+        m_End = nullptr;
+    }
+}
+
+// Trim
+//------------------------------------------------------------------------------
+void Arena::Trim( size_t maxBytesReserved )
+{
+    // Only blocks released by rewinding can be freed. The largest go first,
+    // as they are the most costly to keep and the least likely to be re-used.
+    while ( m_FreeBlocks && ( m_NumBytesReserved > maxBytesReserved ) )
+    {
+        Block ** largestLink = &m_FreeBlocks;
+        for ( Block ** link = &m_FreeBlocks; *link; link = &( *link )->m_Prev )
+        {
+            if ( ( *link )->m_Size > ( *largestLink )->m_Size )
+            {
+                largestLink = link;
+            }
+        }
+        Block * block = *largestLink;
+        *largestLink = block->m_Prev;
+        m_NumBytesReserved -= block->m_Size;
+        FREE( block );
+    }
+}
+
+// NextBlock
+//------------------------------------------------------------------------------
+void Arena::NextBlock( size_t minSize )
+{
+    // Re-use the smallest free block which is big enough. Large blocks are
+    // kept for large allocations, so each is only allocated once.
+    const bool isLarge = ( minSize > m_BlockSize );
+    Block ** bestLink = nullptr;
+    for ( Block ** link = &m_FreeBlocks; *link; link = &( *link )->m_Prev )
+    {
+        const size_t size = ( *link )->m_Size;
+        if ( ( size >= minSize ) &&
+             ( isLarge || ( size == m_BlockSize ) ) &&
+             ( ( bestLink == nullptr ) || ( size < ( *bestLink )->m_Size ) ) )
+        {
+            bestLink = link;
+        }
+    }
+    Block * block = nullptr;
+    if ( bestLink )
+    {
+        block = *bestLink;
+        *bestLink = block->m_Prev;
+    }
+
+    // Otherwise, allocate a new one (oversized allocations get their own)
+    if ( block == nullptr )
+    {
+        const size_t size = Math::Max( m_BlockSize, minSize );
+        block = static_cast< Block * >( ALLOC( sizeof( Block ) + size ) );
+        block->m_Size = size;
+        m_NumBytesReserved += size;
+    }
+
+    // Any space left in the current block is not used again until rewound
+    if ( m_CurrentBlock )
+    {
+        m_CurrentBlock->m_UsedEnd = m_Pos;
+    }
+    block->m_Prev = m_CurrentBlock;
+    m_CurrentBlock = block;
+    m_Pos = block->GetBegin();
+    m_End = block->GetEnd();
+}
+
+//------------------------------------------------------------------------------
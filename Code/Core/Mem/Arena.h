@@ -0,0 +1,90 @@
+// Arena - Monotonic allocator for short-lived allocations
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// Arena
+//------------------------------------------------------------------------------
+// Allocations are made by advancing through large blocks, so are very cheap,
+// but can't be freed individually. Instead, everything allocated after a
+// Marker is released at once by rewinding to it. Blocks are kept for re-use
+// after rewinding, so an Arena which is rewound regularly stops allocating
+// once it has grown to its peak usage. Trim releases kept blocks, so a rare
+// large allocation doesn't stay reserved for the lifetime of the Arena.
+//
+// Arenas are not thread-safe.
+class Arena
+{
+    struct Block;
+public:
+    explicit Arena( size_t blockSize = DEFAULT_BLOCK_SIZE );
+    ~Arena();
+
+    [[nodiscard]] void *    Alloc( size_t size, size_t alignment = sizeof( void * ) );
+
+    struct Marker
+    {
+        Block *         m_Block;
+        char *          m_Pos;
+    };
+    [[nodiscard]] Marker    GetMarker() const;
+    void                    Rewind( const Marker & marker );
+    void                    Trim( size_t maxBytesReserved ); // Free unused blocks, largest first, down to the limit
+
+    [[nodiscard]] size_t    GetNumBytesReserved() const { return m_NumBytesReserved; }
+
+    enum : size_t { DEFAULT_BLOCK_SIZE = ( 1024 * 1024 ) };
+
+protected:
+    void                    NextBlock( size_t minSize );
+
+    Arena( const Arena & ) = delete;
+    Arena & operator = ( const Arena & ) = delete;
+
+    size_t          m_BlockSize;
+    Block *         m_CurrentBlock;     // Block being allocated from (with those before it linked from it)
+    Block *         m_FreeBlocks;       // Blocks released by rewinding, for re-use
+    char *          m_Pos;              // Next free byte in current block
+    char *          m_End;              // End of current block
+    size_t          m_NumBytesReserved; // Size of all blocks, used or not
+};
+
+// ArenaScope
+//------------------------------------------------------------------------------
+// Release allocations made from an Arena (if there is one) within a scope,
+// optionally trimming the Arena afterwards
+class ArenaScope
+{
+public:
+    explicit ArenaScope( Arena * arena, size_t maxBytesRetained = NO_TRIM )
+        : m_Arena( arena )
+        , m_Marker( arena ? arena->GetMarker() : Arena::Marker{ nullptr, nullptr } )
+        , m_MaxBytesRetained( maxBytesRetained )
+    {}
+    ~ArenaScope()
+    {
+        if ( m_Arena )
+        {
+            m_Arena->Rewind( m_Marker );
+            if ( m_MaxBytesRetained != NO_TRIM )
+            {
+                m_Arena->Trim( m_MaxBytesRetained );
+            }
+        }
+    }
+
+    enum : size_t { NO_TRIM = static_cast< size_t >( -1 ) };
+
+private:
+    ArenaScope( const ArenaScope & ) = delete;
+    ArenaScope & operator = ( const ArenaScope & ) = delete;
+
+    Arena *         m_Arena;
+    Arena::Marker   m_Marker;
+    size_t          m_MaxBytesRetained;
+};
+
+//------------------------------------------------------------------------------
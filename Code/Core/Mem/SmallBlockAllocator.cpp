@@ -37,6 +37,7 @@
 /*static*/ uint64_t                             SmallBlockAllocator::s_BucketMemBucketMemory[ BUCKET_NUM_BUCKETS * sizeof( MemBucket ) / sizeof (uint64_t) ];
 /*static*/ SmallBlockAllocator::MemBucket *     SmallBlockAllocator::s_Buckets( nullptr );
 /*static*/ uint8_t                              SmallBlockAllocator::s_BucketMappingTable[ BUCKET_MAPPING_TABLE_SIZE ] = { 0 };
+/*static*/ THREAD_LOCAL SmallBlockAllocator::ThreadCache SmallBlockAllocator::s_ThreadCaches[ BUCKET_NUM_BUCKETS ];
 
 // InitBuckets
 //------------------------------------------------------------------------------
@@ -86,6 +87,7 @@ NO_INLINE void SmallBlockAllocator::InitBuckets()
         // Print info for each bucket
         for ( uint32_t i = 0; i < BUCKET_NUM_BUCKETS; ++i )
         {
+            // NOTE: Blocks held in thread caches are counted as active
             const MemBucket & bucket = s_Buckets[ i ];
             const uint32_t numLive = bucket.m_NumActiveAllocations; //GetNumActiveAllocations();
             const uint32_t blockSize = bucket.m_BlockSize; //GetBlockSize();
@@ -108,6 +110,27 @@ NO_INLINE void SmallBlockAllocator::InitBuckets()
     }
 #endif
 
+// GetNumActiveAllocations
+//------------------------------------------------------------------------------
+#if defined( DEBUG )
+    /*static*/ uint32_t SmallBlockAllocator::GetNumActiveAllocations()
+    {
+        if ( s_BucketMemoryStart == MEM_BUCKETS_NOT_INITIALIZED )
+        {
+            return 0;
+        }
+
+        uint32_t numActive = 0;
+        for ( size_t i = 0; i < BUCKET_NUM_BUCKETS; ++i )
+        {
+            MemBucket & bucket = s_Buckets[ i ];
+            MutexHolder mh( bucket.m_Mutex );
+            numActive += bucket.m_NumActiveAllocations;
+        }
+        return numActive;
+    }
+#endif
+
 // Alloc
 //------------------------------------------------------------------------------
 void * SmallBlockAllocator::Alloc( size_t size, size_t align )
@@ -139,12 +162,17 @@ void * SmallBlockAllocator::Alloc( size_t size, size_t align )
         return nullptr; // Can't satisfy alignment
     }
 
-    void* ptr;
-
-    // Alloc
+    // Alloc from this thread's cache, or refill it from the bucket
+    ThreadCache & cache = s_ThreadCaches[ bucketIndex ];
+    void * ptr = cache.m_Blocks;
+    if ( ptr )
+    {
+        cache.m_Blocks = cache.m_Blocks->m_Next;
+        --cache.m_NumBlocks;
+    }
+    else
     {
-        MutexHolder mh( bucket.m_Mutex );
-        ptr = bucket.Alloc();
+        ptr = RefillThreadCache( bucket, cache );
     }
 
     // Debug fill
@@ -181,15 +209,79 @@ bool SmallBlockAllocator::Free( void * ptr )
         MemDebug::FillMem( ptr, bucket.m_BlockSize, MemDebug::MEM_FILL_FREED_ALLOCATION_PATTERN );
     #endif
 
-    // Free it
+    // Free it into this thread's cache, returning some to the bucket if the
+    // cache is full (threads which free more than they allocate would
+    // otherwise accumulate blocks)
+    ThreadCache & cache = s_ThreadCaches[ bucketIndex ];
+    ThreadCache::CachedBlock * block = static_cast< ThreadCache::CachedBlock * >( ptr );
+    block->m_Next = cache.m_Blocks;
+    cache.m_Blocks = block;
+    if ( ++cache.m_NumBlocks > THREAD_CACHE_MAX_SIZE )
     {
-        MutexHolder mh( bucket.m_Mutex );
-        bucket.Free( ptr );
+        FlushThreadCache( bucket, cache, THREAD_CACHE_BATCH_SIZE );
     }
 
     return true;
 }
 
+// ReleaseThreadCache
+//------------------------------------------------------------------------------
+/*static*/ void SmallBlockAllocator::ReleaseThreadCache()
+{
+    for ( size_t i = 0; i < BUCKET_NUM_BUCKETS; ++i )
+    {
+        ThreadCache & cache = s_ThreadCaches[ i ];
+        if ( cache.m_NumBlocks > 0 )
+        {
+            FlushThreadCache( s_Buckets[ i ], cache, cache.m_NumBlocks );
+        }
+    }
+}
+
+// RefillThreadCache
+//------------------------------------------------------------------------------
+/*static*/ void * SmallBlockAllocator::RefillThreadCache( MemBucket & bucket, ThreadCache & cache )
+{
+    ASSERT( cache.m_NumBlocks == 0 );
+
+    MutexHolder mh( bucket.m_Mutex );
+
+    // Take one block to return and a batch for the cache
+    void * ptr = bucket.Alloc();
+    if ( ptr == nullptr )
+    {
+        return nullptr; // Address space exhausted
+    }
+    for ( uint32_t i = 0; i < THREAD_CACHE_BATCH_SIZE; ++i )
+    {
+        ThreadCache::CachedBlock * block = static_cast< ThreadCache::CachedBlock * >( bucket.Alloc() );
+        if ( block == nullptr )
+        {
+            break;
+        }
+        block->m_Next = cache.m_Blocks;
+        cache.m_Blocks = block;
+        ++cache.m_NumBlocks;
+    }
+    return ptr;
+}
+
+// FlushThreadCache
+//------------------------------------------------------------------------------
+/*static*/ void SmallBlockAllocator::FlushThreadCache( MemBucket & bucket, ThreadCache & cache, uint32_t numBlocks )
+{
+    ASSERT( numBlocks <= cache.m_NumBlocks );
+
+    MutexHolder mh( bucket.m_Mutex );
+    for ( uint32_t i = 0; i < numBlocks; ++i )
+    {
+        ThreadCache::CachedBlock * block = cache.m_Blocks;
+        cache.m_Blocks = block->m_Next;
+        bucket.Free( block );
+    }
+    cache.m_NumBlocks -= numBlocks;
+}
+
 // AllocateMemoryForPage
 //------------------------------------------------------------------------------
 /*virtual*/ void * SmallBlockAllocator::MemBucket::AllocateMemoryForPage()
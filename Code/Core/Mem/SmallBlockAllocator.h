@@ -19,6 +19,7 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
 #include "Core/Mem/MemPoolBlock.h"
 #include "Core/Process/Mutex.h"
 
@@ -33,8 +34,13 @@
         // Attempt to free. Returns false if not a bucket owned allocation
         static bool     Free( void * ptr );
 
+        // Return blocks cached by the calling thread to the shared buckets.
+        // Called automatically on exit by threads started with Thread.
+        static void     ReleaseThreadCache();
+
         #if defined( DEBUG )
             static void DumpStats();
+            static uint32_t GetNumActiveAllocations(); // Including blocks held in thread caches
         #endif
 
     protected:
@@ -53,6 +59,23 @@
         static const size_t BUCKET_NUM_PAGES = ( BUCKET_ADDRESSSPACE_SIZE / MemPoolBlock::MEMPOOLBLOCK_PAGE_SIZE );
         static const size_t BUCKET_MAPPING_TABLE_SIZE  = BUCKET_NUM_PAGES;
 
+        // Each thread caches free blocks for each bucket, so most allocations
+        // don't need to lock the bucket. Blocks move between a thread's cache
+        // and the bucket in batches.
+        static const uint32_t THREAD_CACHE_BATCH_SIZE = 32;
+        static const uint32_t THREAD_CACHE_MAX_SIZE = ( THREAD_CACHE_BATCH_SIZE * 2 );
+        struct ThreadCache
+        {
+            struct CachedBlock
+            {
+                CachedBlock *   m_Next;
+            };
+
+            // in-place linked list of free blocks
+            CachedBlock *   m_Blocks;
+            uint32_t        m_NumBlocks;
+        };
+
         class MemBucket : public MemPoolBlock
         {
         public:
@@ -65,6 +88,9 @@
             Mutex           m_Mutex;
         };
 
+        static void *       RefillThreadCache( MemBucket & bucket, ThreadCache & cache );
+        static void         FlushThreadCache( MemBucket & bucket, ThreadCache & cache, uint32_t numBlocks );
+
         // Address space used by allocators
         static void *       s_BucketMemoryStart;
         static uint32_t     s_BucketNextFreePageIndex; // Next free memory page to commit
@@ -75,6 +101,9 @@
 
         // A table to allow 0(1) conversion of any address to the bucket that owns it
         static uint8_t      s_BucketMappingTable[ BUCKET_MAPPING_TABLE_SIZE ];
+
+        // Free blocks cached by each thread, for each bucket
+        static THREAD_LOCAL ThreadCache s_ThreadCaches[ BUCKET_NUM_BUCKETS ];
     };
 
 //------------------------------------------------------------------------------
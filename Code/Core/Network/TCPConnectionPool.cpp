@@ -7,7 +7,9 @@
 #include "TCPConnectionPool.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -31,6 +33,10 @@
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( __LINUX__ )
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -49,6 +55,12 @@
     #define TCPDEBUG( ... ) (void)0
 #endif
 
+// Static Data
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    static THREAD_LOCAL bool s_IsIOThread = false; // Sends from callbacks must never wait
+#endif
+
 // TCPConnectionPoolProfileHelper
 //------------------------------------------------------------------------------
 #if defined( PROFILING_ENABLED )
@@ -136,6 +148,16 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
     , m_ThreadQuitNotification( false )
     , m_TCPConnectionPool( ownerPool )
     , m_UserData( nullptr )
+    #if defined( __LINUX__ )
+        , m_IsListenConnection( false )
+        , m_OnConnectedDone( false )
+        , m_ReadSizeBytes( 0 )
+        , m_ReadSize( 0 )
+        , m_ReadBytes( 0 )
+        , m_ReadBuffer( nullptr )
+        , m_PendingSendBytes( 0 )
+        , m_SendTimeoutMS( 0 )
+    #endif
     #ifdef DEBUG
         , m_SendSocketInUseThreadId( INVALID_THREAD_ID )
     #endif
@@ -149,6 +171,12 @@ TCPConnectionPool::TCPConnectionPool()
     : m_ListenConnection( nullptr )
     , m_Connections( 8 )
     , m_ShuttingDown( false )
+    #if defined( __LINUX__ )
+        , m_EpollFD( -1 )
+        , m_WakeFD( -1 )
+        , m_NumIOThreads( 0 )
+        , m_SendEpollFD( -1 )
+    #endif
 {
 }
 
@@ -197,6 +225,11 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+    #if defined( __LINUX__ )
+        // All sockets are closed, so the I/O threads are idle
+        StopIOThreads();
+    #endif
 }
 
 // GetAddressAsString
@@ -252,9 +285,17 @@ bool TCPConnectionPool::Listen( uint16_t port )
         return false;
     }
 
+    #if defined( __LINUX__ )
+        SetNonBlocking( sockfd );   // Connections are accepted until none are pending
+    #endif
+
     // spawn the handler thread
     const uint32_t loopback = 127 & ( 1 << 24 ); // 127.0.0.1
-    CreateListenThread( sockfd, loopback, port );
+    if ( CreateListenThread( sockfd, loopback, port ) == false )
+    {
+        CloseSocket( sockfd );
+        return false;
+    }
 
     // everything is ok - we are now listening, managing connections on the other thread
     return true;
@@ -456,16 +497,16 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     // ensure the connection thread isn't busy destroying itself
     MutexHolder mh( m_ConnectionsMutex );
 
-    if ( ci == m_ListenConnection )
+    if ( ( ci == m_ListenConnection ) ||
+         ( m_Connections.Find( ci ) != nullptr ) )
     {
         ci->m_ThreadQuitNotification.Store( true );
-        return;
-    }
 
-    const ConnectionInfo * const * iter = m_Connections.Find( ci );
-    if ( iter != nullptr )
-    {
-        ci->m_ThreadQuitNotification.Store( true );
+        #if defined( __LINUX__ )
+            // Make the socket readable so an I/O thread wakes to close it. The socket
+            // is only closed with m_ConnectionsMutex held, so it's still valid here.
+            shutdown( ci->m_Socket, SHUT_RD );
+        #endif
         return;
     }
 
@@ -533,6 +574,128 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     return SendInternal( connection, buffers, 4, timeoutMS );
 }
 
+#if defined( __LINUX__ )
+// SendInternal
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( connection );
+
+    // closing connection, possibly from a previous failure
+    if ( connection->m_ThreadQuitNotification.Load() || AtomicLoadRelaxed( &m_ShuttingDown ) )
+    {
+        return false;
+    }
+
+    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    ASSERT( connection->m_Socket != INVALID_SOCKET );
+
+    // Calculate total to send
+    uint32_t totalBytes( 0 );
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        totalBytes += buffers[ i ].size;
+    }
+
+    TCPDEBUG( "Send: %i (%x)\n", totalBytes, (uint32_t)( connection->m_Socket ) );
+
+    // Other threads wait if too much data is pending, so it can't grow without bound
+    if ( s_IsIOThread == false )
+    {
+        const Timer timer;
+        for ( ;; )
+        {
+            {
+                MutexHolder mh( connection->m_SendMutex );
+                if ( connection->m_PendingSendBytes < kMaxPendingSendBytes )
+                {
+                    break;
+                }
+            }
+
+            if ( connection->m_ThreadQuitNotification.Load() || AtomicLoadRelaxed( &m_ShuttingDown ) )
+            {
+                return false;
+            }
+
+            if ( timer.GetElapsedMS() > (float)timeoutMS )
+            {
+                Disconnect( connection );
+                return false;
+            }
+
+            Thread::Sleep( 1 );
+        }
+    }
+
+    bool sendOK = true;
+    {
+        // Sends are often issued from I/O threads (in callbacks), so they must never
+        // wait for the socket. Whatever can't be sent now is flushed by the send thread.
+        MutexHolder mh( connection->m_SendMutex );
+
+        // Send as much as possible immediately, unless earlier data is still pending
+        uint32_t bytesSent = 0;
+        if ( connection->m_PendingSends.IsEmpty() )
+        {
+            struct iovec sendBuffers[ 4 ];
+            for ( uint32_t i = 0; i < numBuffers; ++i )
+            {
+                sendBuffers[ i ].iov_len = buffers[ i ].size;
+                sendBuffers[ i ].iov_base = const_cast< void * >( buffers[ i ].data );
+            }
+            const ssize_t sent = writev( connection->m_Socket, sendBuffers, static_cast<int32_t>( numBuffers ) );
+            if ( sent >= 0 )
+            {
+                bytesSent = (uint32_t)sent;
+            }
+            else if ( WouldBlock() == false )
+            {
+                TCPDEBUG( "send() failed (A). Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( connection->m_Socket ) );
+                sendOK = false;
+            }
+        }
+
+        // Queue the remainder
+        if ( sendOK && ( bytesSent < totalBytes ) )
+        {
+            ConnectionInfo::PendingSend pending;
+            pending.m_Size = ( totalBytes - bytesSent );
+            pending.m_Sent = 0;
+            pending.m_Data = (char *)ALLOC( pending.m_Size );
+            char * dest = pending.m_Data;
+            uint32_t offset = 0;
+            for ( uint32_t i = 0; i < numBuffers; ++i )
+            {
+                const uint32_t overlap = bytesSent > offset ? Math::Min( bytesSent - offset, buffers[ i ].size ) : 0;
+                memcpy( dest, (const char *)buffers[ i ].data + overlap, buffers[ i ].size - overlap );
+                dest += ( buffers[ i ].size - overlap );
+                offset += buffers[ i ].size;
+            }
+            ASSERT( dest == ( pending.m_Data + pending.m_Size ) ); // sanity check
+
+            // The send thread waits for writability only while data is pending
+            const bool wasEmpty = connection->m_PendingSends.IsEmpty();
+            connection->m_PendingSends.Append( pending );
+            connection->m_PendingSendBytes += pending.m_Size;
+            connection->m_SendTimeoutMS = timeoutMS;
+            if ( wasEmpty )
+            {
+                connection->m_SendProgressTimer.Start();
+                sendOK = ArmSendSocket( connection, EPOLL_CTL_MOD );
+            }
+        }
+    }
+
+    if ( sendOK == false )
+    {
+        Disconnect( connection );
+    }
+    return sendOK;
+}
+#else
 // SendInternal
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
@@ -644,6 +807,7 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
     #endif
     return sendOK;
 }
+#endif
 
 // Broadcast
 //------------------------------------------------------------------------------
@@ -674,6 +838,79 @@ bool TCPConnectionPool::Broadcast( const void * data, size_t size )
     FREE( data );
 }
 
+#if defined( __LINUX__ )
+// HandleReadNonBlocking
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleReadNonBlocking( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Read until no more data is available, resuming any partially received message
+    while ( ci->m_ThreadQuitNotification.Load() == false )
+    {
+        // work out how many bytes there are
+        if ( ci->m_ReadSizeBytes < sizeof( uint32_t ) )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket, ( (char *)&ci->m_ReadSize ) + ci->m_ReadSizeBytes, sizeof( uint32_t ) - ci->m_ReadSizeBytes, 0 );
+            if ( numBytes <= 0 )
+            {
+                // Wait for more data unless the connection was lost
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true;
+                }
+                TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReadSizeBytes += (uint32_t)numBytes;
+            if ( ci->m_ReadSizeBytes < sizeof( uint32_t ) )
+            {
+                continue;
+            }
+
+            TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReadSize, (uint32_t)( ci->m_Socket ) );
+
+            // get output location
+            ci->m_ReadBuffer = AllocBuffer( ci->m_ReadSize );
+            ASSERT( ci->m_ReadBuffer );
+            ci->m_ReadBytes = 0;
+        }
+
+        // read data into the user supplied buffer
+        while ( ci->m_ReadBytes < ci->m_ReadSize )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket, (char *)ci->m_ReadBuffer + ci->m_ReadBytes, ci->m_ReadSize - ci->m_ReadBytes, 0 );
+            if ( numBytes <= 0 )
+            {
+                // Wait for more data unless the connection was lost
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true;
+                }
+                TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReadBytes += (uint32_t)numBytes;
+        }
+
+        // take ownership of the complete message
+        void * buffer = ci->m_ReadBuffer;
+        const uint32_t size = ci->m_ReadSize;
+        ci->m_ReadBuffer = nullptr;
+        ci->m_ReadSizeBytes = 0;
+
+        // tell user the data is in their buffer
+        bool keepMemory = false;
+        OnReceive( ci, buffer, size, keepMemory );
+        if ( !keepMemory )
+        {
+            FreeBuffer( buffer );
+        }
+    }
+
+    return false;
+}
+#else
 // HandleRead
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
@@ -755,6 +992,7 @@ bool TCPConnectionPool::HandleRead( ConnectionInfo * ci )
 
     return true;
 }
+#endif
 
 // GetLastNetworkError
 //------------------------------------------------------------------------------
@@ -914,22 +1152,42 @@ void TCPConnectionPool::FDSet( TCPSocket fd, void * set ) const
 
 // CreateListenThread
 //------------------------------------------------------------------------------
-void TCPConnectionPool::CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port )
+bool TCPConnectionPool::CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port )
 {
     MutexHolder mh( m_ConnectionsMutex );
 
+    #if defined( __LINUX__ )
+        if ( StartIOThreads() == false )
+        {
+            return false;
+        }
+    #endif
+
     m_ListenConnection = FNEW( ConnectionInfo( this ) );
     m_ListenConnection->m_Socket = socket;
     m_ListenConnection->m_RemoteAddress = host;
     m_ListenConnection->m_RemotePort = port;
     m_ListenConnection->m_ThreadQuitNotification.Store( false );
 
-    // Spawn thread to handle socket
-    Thread thread;
-    thread.Start( &ListenThreadWrapperFunction, "TCPListen", m_ListenConnection, ( 32 * KILOBYTE ) );
-    thread.Detach(); // TODO: Remove use of this unsafe API
+    #if defined( __LINUX__ )
+        // I/O threads accept connections when the socket becomes readable
+        m_ListenConnection->m_IsListenConnection = true;
+        if ( ArmSocket( m_ListenConnection, EPOLL_CTL_ADD, EPOLLIN ) == false )
+        {
+            FDELETE m_ListenConnection;
+            m_ListenConnection = nullptr;
+            return false;
+        }
+    #else
+        // Spawn thread to handle socket
+        Thread thread;
+        thread.Start( &ListenThreadWrapperFunction, "TCPListen", m_ListenConnection, ( 32 * KILOBYTE ) );
+        thread.Detach(); // TODO: Remove use of this unsafe API
+    #endif
+    return true;
 }
 
+#if !defined( __LINUX__ )
 // ThreadWrapperFunction
 //------------------------------------------------------------------------------
 /*static*/ uint32_t TCPConnectionPool::ListenThreadWrapperFunction( void * data )
@@ -1024,12 +1282,22 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
     TCPDEBUG( "Listen thread exited\n" );
 }
 
+#endif
+
 // CreateConnectionThread
 //------------------------------------------------------------------------------
 ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
 {
     MutexHolder mh( m_ConnectionsMutex );
 
+    #if defined( __LINUX__ )
+        if ( StartIOThreads() == false )
+        {
+            CloseSocket( socket );
+            return nullptr;
+        }
+    #endif
+
     ConnectionInfo * ci = FNEW( ConnectionInfo( this ) );
     ci->m_Socket = socket;
     ci->m_RemoteAddress = host;
@@ -1043,16 +1311,503 @@ ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, ui
         TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
     #endif
 
-    // Spawn thread to handle socket
-    Thread thread;
-    thread.Start( &ConnectionThreadWrapperFunction, "TCPConnection", ci );
-    thread.Detach(); // TODO:B Remove use of this unsafe API
+    #if defined( __LINUX__ )
+        // A new socket is writable, so an I/O thread picks it up immediately
+        // to issue the OnConnected callback
+        // (the send thread also sees it once, with nothing to send yet)
+        if ( ( ArmSendSocket( ci, EPOLL_CTL_ADD ) == false ) ||
+             ( ArmSocket( ci, EPOLL_CTL_ADD, EPOLLIN | EPOLLOUT ) == false ) )
+        {
+            CloseSocket( socket );
+            FDELETE ci;
+            return nullptr;
+        }
+        {
+            MutexHolder sendMH( m_SendConnectionsMutex );
+            m_SendConnections.Append( ci );
+        }
+    #else
+        // Spawn thread to handle socket
+        Thread thread;
+        thread.Start( &ConnectionThreadWrapperFunction, "TCPConnection", ci );
+        thread.Detach(); // TODO:B Remove use of this unsafe API
+    #endif
 
     m_Connections.Append( ci );
 
     return ci;
 }
 
+#if defined( __LINUX__ )
+// StartIOThreads
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::StartIOThreads()
+{
+    // Caller must hold m_ConnectionsMutex
+    if ( m_EpollFD != -1 )
+    {
+        return true; // Already started
+    }
+
+    m_EpollFD = epoll_create1( EPOLL_CLOEXEC );
+    if ( m_EpollFD == -1 )
+    {
+        TCPDEBUG( "epoll_create1() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+        return false;
+    }
+
+    // Sockets with pending sends are watched separately, by a single send thread
+    m_SendEpollFD = epoll_create1( EPOLL_CLOEXEC );
+
+    // Threads are stopped by signalling an eventfd, which remains readable so every thread wakes
+    m_WakeFD = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if ( ( m_SendEpollFD == -1 ) ||
+         ( m_WakeFD == -1 ) ||
+         ( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) != 0 ) ||
+         ( epoll_ctl( m_SendEpollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) != 0 ) )
+    {
+        TCPDEBUG( "eventfd() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+        if ( m_WakeFD != -1 )
+        {
+            close( m_WakeFD );
+            m_WakeFD = -1;
+        }
+        if ( m_SendEpollFD != -1 )
+        {
+            close( m_SendEpollFD );
+            m_SendEpollFD = -1;
+        }
+        close( m_EpollFD );
+        m_EpollFD = -1;
+        return false;
+    }
+
+    // Callbacks can block doing work (but never on Send), so use a few threads
+    m_NumIOThreads = Math::Clamp( Env::GetNumProcessors() / 2, 2u, (uint32_t)kMaxIOThreads );
+    for ( uint32_t i = 0; i < m_NumIOThreads; ++i )
+    {
+        m_IOThreads[ i ].Start( &IOThreadWrapperFunction, "TCPIO", this );
+    }
+    m_SendThread.Start( &SendThreadWrapperFunction, "TCPSend", this );
+    return true;
+}
+
+// StopIOThreads
+//------------------------------------------------------------------------------
+void TCPConnectionPool::StopIOThreads()
+{
+    {
+        MutexHolder mh( m_ConnectionsMutex );
+        if ( m_EpollFD == -1 )
+        {
+            return; // Never started, or already stopped
+        }
+    }
+
+    const uint64_t value = 1;
+    VERIFY( write( m_WakeFD, &value, sizeof( value ) ) == sizeof( value ) );
+    for ( uint32_t i = 0; i < m_NumIOThreads; ++i )
+    {
+        m_IOThreads[ i ].Join();
+    }
+    m_NumIOThreads = 0;
+    m_SendThread.Join();
+
+    MutexHolder mh( m_ConnectionsMutex );
+    close( m_WakeFD );
+    m_WakeFD = -1;
+    close( m_SendEpollFD );
+    m_SendEpollFD = -1;
+    close( m_EpollFD );
+    m_EpollFD = -1;
+}
+
+// ArmSocket
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::ArmSocket( ConnectionInfo * ci, int op, uint32_t events ) const
+{
+    // Each socket is reported to only one thread at a time (EPOLLONESHOT), so
+    // callbacks for a connection are serialized. The thread processing an event
+    // re-arms the socket once it has read all available data (EPOLLET).
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = ( events | EPOLLRDHUP | EPOLLET | EPOLLONESHOT );
+    event.data.ptr = ci;
+    if ( epoll_ctl( m_EpollFD, op, ci->m_Socket, &event ) != 0 )
+    {
+        TCPDEBUG( "epoll_ctl() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( ci->m_Socket ) );
+        return false;
+    }
+    return true;
+}
+
+// ArmSendSocket
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::ArmSendSocket( const ConnectionInfo * ci, int op ) const
+{
+    // The send thread is told once when the socket becomes writable, and re-arms
+    // the socket if it can't send all the pending data
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = ( EPOLLOUT | EPOLLET | EPOLLONESHOT );
+    event.data.ptr = const_cast< ConnectionInfo * >( ci );
+    if ( epoll_ctl( m_SendEpollFD, op, ci->m_Socket, &event ) != 0 )
+    {
+        TCPDEBUG( "epoll_ctl() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( ci->m_Socket ) );
+        return false;
+    }
+    return true;
+}
+
+// IOThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::IOThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    s_IsIOThread = true;
+
+    TCPConnectionPool * pool = static_cast< TCPConnectionPool * >( data );
+    pool->IOThreadFunction();
+    return 0;
+}
+
+// IOThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::IOThreadFunction()
+{
+    for ( ;; )
+    {
+        // Take one event at a time so busy connections are spread across threads
+        struct epoll_event event;
+        const int num = epoll_wait( m_EpollFD, &event, 1, -1 );
+        if ( num < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            TCPDEBUG( "epoll_wait() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            break;
+        }
+        if ( num == 0 )
+        {
+            continue;
+        }
+
+        ConnectionInfo * ci = static_cast< ConnectionInfo * >( event.data.ptr );
+        if ( ci == nullptr )
+        {
+            break; // StopIOThreads
+        }
+
+        if ( ci->m_IsListenConnection )
+        {
+            ProcessListenEvent( ci );
+        }
+        else
+        {
+            ProcessConnectionEvent( ci );
+        }
+    }
+
+    // thread exit
+    TCPDEBUG( "I/O thread exited\n" );
+}
+
+// SendThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::SendThreadWrapperFunction( void * data )
+{
+    PROFILE_SET_THREAD_NAME( "TCPSend" );
+    PROFILE_FUNCTION;
+
+    TCPConnectionPool * pool = static_cast< TCPConnectionPool * >( data );
+    pool->SendThreadFunction();
+    return 0;
+}
+
+// SendThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::SendThreadFunction()
+{
+    const uint32_t kTimeoutCheckIntervalMS = 100;
+    Timer timeoutCheckTimer;
+    for ( ;; )
+    {
+        struct epoll_event events[ 16 ];
+        const int num = epoll_wait( m_SendEpollFD, events, 16, (int)kTimeoutCheckIntervalMS );
+        if ( num < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            TCPDEBUG( "epoll_wait() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            break;
+        }
+
+        bool quit = false;
+        StackArray< const ConnectionInfo * > failedConnections;
+        {
+            // The ConnectionInfo is only valid while it is still in our list,
+            // which can't change while we flush
+            MutexHolder mh( m_SendConnectionsMutex );
+            for ( int i = 0; i < num; ++i )
+            {
+                const ConnectionInfo * ci = static_cast< const ConnectionInfo * >( events[ i ].data.ptr );
+                if ( ci == nullptr )
+                {
+                    quit = true; // StopIOThreads
+                    continue;
+                }
+                if ( m_SendConnections.Find( ci ) == nullptr )
+                {
+                    continue; // closed since the event was reported
+                }
+                if ( FlushPendingSends( ci ) == false )
+                {
+                    failedConnections.Append( ci );
+                }
+            }
+
+            if ( timeoutCheckTimer.GetElapsedMS() >= (float)kTimeoutCheckIntervalMS )
+            {
+                CheckSendTimeouts( failedConnections );
+                timeoutCheckTimer.Start();
+            }
+        }
+
+        // Disconnect handles connections which were closed in the meantime
+        for ( const ConnectionInfo * ci : failedConnections )
+        {
+            Disconnect( ci );
+        }
+
+        if ( quit )
+        {
+            break;
+        }
+    }
+
+    // thread exit
+    TCPDEBUG( "Send thread exited\n" );
+}
+
+// FlushPendingSends
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::FlushPendingSends( const ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( ci->m_SendMutex );
+
+    Array< ConnectionInfo::PendingSend > & pendingSends = ci->m_PendingSends;
+    while ( pendingSends.IsEmpty() == false )
+    {
+        // Send as many pending buffers as possible at once
+        struct iovec sendBuffers[ 16 ];
+        const size_t numSendBuffers = Math::Min( pendingSends.GetSize(), (size_t)16 );
+        for ( size_t i = 0; i < numSendBuffers; ++i )
+        {
+            const ConnectionInfo::PendingSend & pending = pendingSends[ i ];
+            sendBuffers[ i ].iov_len = ( pending.m_Size - pending.m_Sent );
+            sendBuffers[ i ].iov_base = ( pending.m_Data + pending.m_Sent );
+        }
+        const ssize_t sent = writev( ci->m_Socket, sendBuffers, static_cast<int32_t>( numSendBuffers ) );
+        if ( sent < 0 )
+        {
+            if ( WouldBlock() )
+            {
+                // Wait to be writable again
+                return ArmSendSocket( ci, EPOLL_CTL_MOD );
+            }
+            TCPDEBUG( "send() failed (B). Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( ci->m_Socket ) );
+            return false;
+        }
+        ci->m_SendProgressTimer.Start();
+        ci->m_PendingSendBytes -= (uint64_t)sent;
+
+        // Free everything which was sent completely
+        uint32_t bytesSent = (uint32_t)sent;
+        size_t numCompleted = 0;
+        for ( ; numCompleted < numSendBuffers; ++numCompleted )
+        {
+            ConnectionInfo::PendingSend & pending = pendingSends[ numCompleted ];
+            const uint32_t remaining = ( pending.m_Size - pending.m_Sent );
+            if ( bytesSent < remaining )
+            {
+                pending.m_Sent += bytesSent;
+                break;
+            }
+            bytesSent -= remaining;
+            FREE( pending.m_Data );
+        }
+        if ( numCompleted > 0 )
+        {
+            const size_t numRemaining = ( pendingSends.GetSize() - numCompleted );
+            memmove( pendingSends.Begin(), pendingSends.Begin() + numCompleted, numRemaining * sizeof( ConnectionInfo::PendingSend ) );
+            pendingSends.SetSize( numRemaining );
+        }
+    }
+    return true;
+}
+
+// CheckSendTimeouts
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CheckSendTimeouts( Array< const ConnectionInfo * > & timedOutConnections ) const
+{
+    // Caller must hold m_SendConnectionsMutex
+    for ( const ConnectionInfo * ci : m_SendConnections )
+    {
+        MutexHolder mh( ci->m_SendMutex );
+        if ( ( ci->m_PendingSends.IsEmpty() == false ) &&
+             ( ci->m_SendProgressTimer.GetElapsedMS() > (float)ci->m_SendTimeoutMS ) )
+        {
+            TCPDEBUG( "Send timed out (Socket: %x)\n", (uint32_t)( ci->m_Socket ) );
+            timedOutConnections.Append( ci );
+        }
+    }
+}
+
+// ProcessListenEvent
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ProcessListenEvent( ConnectionInfo * ci )
+{
+    ASSERT( ci->m_Socket != INVALID_SOCKET );
+
+    while ( ci->m_ThreadQuitNotification.Load() == false )
+    {
+        // get a socket for the new connection
+        struct sockaddr_in remoteAddrInfo;
+        int remoteAddrInfoSize = sizeof( remoteAddrInfo );
+        const TCPSocket newSocket = Accept( ci->m_Socket, (struct sockaddr *)&remoteAddrInfo, &remoteAddrInfoSize );
+
+        // handle errors or socket shutdown
+        if ( newSocket == INVALID_SOCKET )
+        {
+            // No more pending connections?
+            if ( WouldBlock() && ArmSocket( ci, EPOLL_CTL_MOD, EPOLLIN ) )
+            {
+                return; // keep listening for more connections
+            }
+            break;
+        }
+
+        #ifdef TCPCONNECTION_DEBUG
+            AStackString<32> addr;
+            GetAddressAsString( remoteAddrInfo.sin_addr.s_addr, addr );
+            TCPDEBUG( "Connection accepted from %s : %i (%x)\n", addr.Get(), ntohs( remoteAddrInfo.sin_port ), (uint32_t)newSocket );
+        #endif
+
+        // Configure socket
+        DisableSigPipe( newSocket );        // Prevent socket inheritence by child processes
+        DisableNagle( newSocket );          // Disable Nagle's algorithm
+        SetLargeBufferSizes( newSocket );   // Set send/recv buffer sizes
+        SetNonBlocking( newSocket );        // Set non-blocking
+
+        // keep the new connected socket
+        CreateConnectionThread( newSocket,
+                                remoteAddrInfo.sin_addr.s_addr,
+                                ntohs( remoteAddrInfo.sin_port ) );
+    }
+
+    CloseListenConnection( ci );
+}
+
+// ProcessConnectionEvent
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ProcessConnectionEvent( ConnectionInfo * ci )
+{
+    ASSERT( ci->m_Socket != INVALID_SOCKET );
+
+    // First event for a connection
+    if ( ci->m_OnConnectedDone == false )
+    {
+        ci->m_OnConnectedDone = true;
+        OnConnected( ci ); // Do callback
+    }
+
+    // Read available data, then wait for more
+    if ( HandleReadNonBlocking( ci ) &&
+         ArmSocket( ci, EPOLL_CTL_MOD, EPOLLIN ) )
+    {
+        return; // NOTE: ci may now be in use by another thread
+    }
+
+    CloseConnection( ci );
+}
+
+// CloseListenConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseListenConnection( ConnectionInfo * ci )
+{
+    MutexHolder mh( m_ConnectionsMutex );
+
+    // close the socket (also removing it from epoll)
+    CloseSocket( ci->m_Socket );
+    ci->m_Socket = INVALID_SOCKET;
+
+    ASSERT( m_ListenConnection == ci );
+    m_ListenConnection = nullptr;
+    FDELETE ci;
+    m_ShutdownSemaphore.Signal(); // Wake main thread which may be waiting on shutdown
+
+    TCPDEBUG( "Listen socket closed\n" );
+}
+
+// CloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseConnection( ConnectionInfo * ci )
+{
+    OnDisconnected( ci ); // Do callback
+
+    // free partially received message
+    if ( ci->m_ReadBuffer )
+    {
+        FreeBuffer( ci->m_ReadBuffer );
+        ci->m_ReadBuffer = nullptr;
+    }
+
+    // try to remove from connection list
+    // could validly be removed by another
+    // thread already due to simultaneously
+    // closing a connection while it is dropped
+    MutexHolder mh( m_ConnectionsMutex );
+    ConnectionInfo ** iter = m_Connections.Find( ci );
+    ASSERT( iter );
+    m_Connections.Erase( iter );
+
+    // stop the send thread accessing the connection and drop any data which couldn't be sent
+    {
+        MutexHolder sendMH( m_SendConnectionsMutex );
+        VERIFY( m_SendConnections.FindAndErase( ci ) );
+    }
+    for ( ConnectionInfo::PendingSend & pending : ci->m_PendingSends )
+    {
+        FREE( pending.m_Data );
+    }
+    ci->m_PendingSends.Clear();
+    ci->m_PendingSendBytes = 0;
+
+    // close the socket (also removing it from epoll)
+    CloseSocket( ci->m_Socket );
+    ci->m_Socket = INVALID_SOCKET;
+
+    FDELETE ci;
+    if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+    {
+        m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+    }
+
+    TCPDEBUG( "Connection closed\n" );
+}
+#else
 // ConnectionThreadWrapperFunction
 //------------------------------------------------------------------------------
 /*static*/ uint32_t TCPConnectionPool::ConnectionThreadWrapperFunction( void * data )
@@ -1143,6 +1898,8 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
     TCPDEBUG( "connection thread exited\n" );
 }
 
+#endif
+
 // AllowSocketReuse
 //------------------------------------------------------------------------------
 void TCPConnectionPool::AllowSocketReuse( TCPSocket socket ) const
@@ -13,6 +13,7 @@
 #include "Core/Process/Semaphore.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -57,6 +58,29 @@ private:
     TCPConnectionPool *     m_TCPConnectionPool; // back pointer to parent pool
     mutable void *          m_UserData;
 
+#if defined( __LINUX__ )
+    // state of partially received message (connections are serviced by I/O threads)
+    bool                    m_IsListenConnection;
+    bool                    m_OnConnectedDone;
+    uint32_t                m_ReadSizeBytes;
+    uint32_t                m_ReadSize;
+    uint32_t                m_ReadBytes;
+    void *                  m_ReadBuffer;
+
+    // data which couldn't be sent immediately, waiting for the socket to be writable
+    struct PendingSend
+    {
+        char *              m_Data;
+        uint32_t            m_Size;
+        uint32_t            m_Sent;
+    };
+    mutable Mutex                   m_SendMutex;        // serializes sends and protects pending data
+    mutable Array< PendingSend >    m_PendingSends;
+    mutable uint64_t                m_PendingSendBytes;
+    mutable Timer                   m_SendProgressTimer;
+    mutable uint32_t                m_SendTimeoutMS;
+#endif
+
 #ifdef DEBUG
     mutable Thread::ThreadId m_SendSocketInUseThreadId; // sanity check we aren't sending from multiple threads unsafely
 #endif
@@ -90,7 +114,9 @@ public:
     // query connection state
     size_t GetNumConnections() const;
 
-    // transmit data
+    // transmit data - on Linux, data the socket can't accept immediately is queued
+    // rather than waiting, and the connection is lost if it makes no progress in timeoutMS.
+    // Only sends from outside of callbacks wait, if too much data is already queued.
     bool Send( const ConnectionInfo * connection,
                const void * data,
                size_t size,
@@ -117,7 +143,11 @@ protected:
 
 private:
     // helper functions
-    bool        HandleRead( ConnectionInfo * ci );
+    #if defined( __LINUX__ )
+        bool    HandleReadNonBlocking( ConnectionInfo * ci );
+    #else
+        bool    HandleRead( ConnectionInfo * ci );
+    #endif
 
     // platform specific abstraction
     int         GetLastNetworkError() const;
@@ -142,12 +172,30 @@ private:
     bool        SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
 
     // thread management
-    void                CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
-    static uint32_t     ListenThreadWrapperFunction( void * data );
-    void                ListenThreadFunction( ConnectionInfo * ci );
+    bool                CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
     ConnectionInfo *    CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
-    static uint32_t     ConnectionThreadWrapperFunction( void * data );
-    void                ConnectionThreadFunction( ConnectionInfo * ci );
+    #if defined( __LINUX__ )
+        // On Linux, sockets are serviced by a small fixed set of I/O threads using epoll
+        bool            StartIOThreads();
+        void            StopIOThreads();
+        bool            ArmSocket( ConnectionInfo * ci, int op, uint32_t events ) const;
+        static uint32_t IOThreadWrapperFunction( void * data );
+        void            IOThreadFunction();
+        void            ProcessListenEvent( ConnectionInfo * ci );
+        void            ProcessConnectionEvent( ConnectionInfo * ci );
+        void            CloseListenConnection( ConnectionInfo * ci );
+        void            CloseConnection( ConnectionInfo * ci );
+        bool            ArmSendSocket( const ConnectionInfo * ci, int op ) const;
+        static uint32_t SendThreadWrapperFunction( void * data );
+        void            SendThreadFunction();
+        bool            FlushPendingSends( const ConnectionInfo * ci );
+        void            CheckSendTimeouts( Array< const ConnectionInfo * > & timedOutConnections ) const;
+    #else
+        static uint32_t ListenThreadWrapperFunction( void * data );
+        void            ListenThreadFunction( ConnectionInfo * ci );
+        static uint32_t ConnectionThreadWrapperFunction( void * data );
+        void            ConnectionThreadFunction( ConnectionInfo * ci );
+    #endif
 
     // internal helpers
     void                AllowSocketReuse( TCPSocket socket ) const;
@@ -166,6 +214,19 @@ private:
     bool                        m_ShuttingDown;
     Semaphore                   m_ShutdownSemaphore;
 
+    #if defined( __LINUX__ )
+        enum : uint32_t { kMaxIOThreads = 8 };
+        enum : uint64_t { kMaxPendingSendBytes = ( 64 * 1024 * 1024 ) };
+        int                     m_EpollFD;
+        int                     m_WakeFD;           // eventfd signalled to stop I/O threads
+        uint32_t                m_NumIOThreads;
+        Thread                  m_IOThreads[ kMaxIOThreads ];
+        int                     m_SendEpollFD;      // sockets with pending sends, waiting to be writable
+        Thread                  m_SendThread;
+        Mutex                   m_SendConnectionsMutex; // not m_ConnectionsMutex, which can be held while sending
+        Array< const ConnectionInfo * > m_SendConnections; // connections the send thread can access
+    #endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
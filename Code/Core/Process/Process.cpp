@@ -24,12 +24,28 @@
 #if defined( __LINUX__ ) || defined( __APPLE__ )
     #include <errno.h>
     #include <fcntl.h>
+    #include <poll.h>
     #include <signal.h>
+    #include <pthread.h>
+    #include <spawn.h>
     #include <stdio.h>
     #include <stdlib.h>
     #include <string.h>
     #include <sys/wait.h>
     #include <unistd.h>
+
+    extern char ** environ;
+#endif
+#if defined( __LINUX__ )
+    #include <sys/syscall.h>
+#endif
+
+// posix_spawn can't change the working dir of the child without
+// posix_spawn_file_actions_addchdir_np, so fork is used where that's missing
+#if defined( __LINUX__ ) && defined( __GLIBC__ )
+    #if __GLIBC_PREREQ( 2, 29 )
+        #define PROCESS_USE_POSIX_SPAWN
+    #endif
 #endif
 
 // Static Data
@@ -40,6 +56,7 @@
 Process::Process( const volatile bool * mainAbortFlag,
                   const volatile bool * abortFlag )
     : m_Started( false )
+    , m_StdInPipe( false )
 #if defined( __WINDOWS__ )
     , m_SharingHandles( false )
     , m_RedirectHandles( true )
@@ -50,6 +67,7 @@ Process::Process( const volatile bool * mainAbortFlag,
 #if defined( __LINUX__ ) || defined( __APPLE__ )
     , m_ChildPID( -1 )
     , m_HasAlreadyWaitTerminated( false )
+    , m_StdInWrite( -1 )
 #endif
     , m_MainAbortFlag( mainAbortFlag )
     , m_AbortFlag( abortFlag )
@@ -287,8 +305,26 @@ bool Process::Spawn( const char * executable,
         // create StdOut and StdErr pipes to capture output of spawned process
         int stdOutPipeFDs[ 2 ];
         int stdErrPipeFDs[ 2 ];
-        VERIFY( pipe( stdOutPipeFDs ) == 0 );
-        VERIFY( pipe( stdErrPipeFDs ) == 0 );
+        #if defined( __LINUX__ )
+            // Pipes are not inherited by processes spawned concurrently from
+            // other threads, which would keep them open until those exit
+            VERIFY( pipe2( stdOutPipeFDs, O_CLOEXEC ) == 0 );
+            VERIFY( pipe2( stdErrPipeFDs, O_CLOEXEC ) == 0 );
+        #else
+            VERIFY( pipe( stdOutPipeFDs ) == 0 );
+            VERIFY( pipe( stdErrPipeFDs ) == 0 );
+        #endif
+
+        int stdInPipeFDs[ 2 ] = { -1, -1 };
+        if ( m_StdInPipe )
+        {
+            #if defined( __LINUX__ )
+                VERIFY( pipe2( stdInPipeFDs, O_CLOEXEC ) == 0 );
+            #else
+                VERIFY( pipe( stdInPipeFDs ) == 0 );
+                VERIFY( fcntl( stdInPipeFDs[ 1 ], F_SETNOSIGPIPE, 1 ) == 0 ); // See WriteStdIn
+            #endif
+        }
 
         // Increase buffer sizes to reduce stalls
         #if defined( __LINUX__ )
@@ -335,75 +371,153 @@ bool Process::Spawn( const char * executable,
         }
         envVector.Append( nullptr ); // env must be terminated with a nullptr
 
-        // fork the process
-        const pid_t childProcessPid = fork();
+        // spawn the process
+        char * const * argV = (char * const *)argVector.Begin();
+        char * const * envV = environment ? (char * const *)envVector.Begin() : nullptr;
+        const int childProcessPid = SpawnChild( executable, argV, envV, workingDir, stdOutPipeFDs, stdErrPipeFDs, m_StdInPipe ? stdInPipeFDs : nullptr );
+
+        // close the child's ends of the pipes
+        VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+        VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+        if ( m_StdInPipe )
+        {
+            VERIFY( close( stdInPipeFDs[ 0 ] ) == 0 );
+        }
+
         if ( childProcessPid == -1 )
         {
             // cleanup pipes
             VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
             VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
-
-            ASSERT( false ); // fork failed - should not happen in normal operation
+            if ( m_StdInPipe )
+            {
+                VERIFY( close( stdInPipeFDs[ 1 ] ) == 0 );
+            }
             return false;
         }
 
-        const bool isChild = ( childProcessPid == 0 );
-        if ( isChild )
-        {
-            // Put child process into its own process group.
-            // This will allow as to send signals to the whole group which we use to implement KillProcessTree.
-            // The new process group will have ID equal to the PID of the child process.
-            VERIFY( setpgid( 0, 0 ) == 0 );
+        // keep pipes for communicating with child process
+        m_StdOutRead = stdOutPipeFDs[ 0 ];
+        m_StdErrRead = stdErrPipeFDs[ 0 ];
+        m_StdInWrite = stdInPipeFDs[ 1 ];
+        m_ChildPID = childProcessPid;
 
-            VERIFY( dup2( stdOutPipeFDs[ 1 ], STDOUT_FILENO ) != -1 );
-            VERIFY( dup2( stdErrPipeFDs[ 1 ], STDERR_FILENO ) != -1 );
+        m_Started = true;
+        m_HasAlreadyWaitTerminated = false;
+        return true;
+    #else
+        #error Unknown platform
+    #endif
+}
 
-            VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+// SpawnChild
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __APPLE__ )
+    /*static*/ int Process::SpawnChild( const char * executable,
+                                        char * const * argV,
+                                        char * const * envV,
+                                        const char * workingDir,
+                                        const int stdOutPipeFDs[ 2 ],
+                                        const int stdErrPipeFDs[ 2 ],
+                                        const int * stdInPipeFDs )
+    {
+        #if defined( PROCESS_USE_POSIX_SPAWN )
+            // posix_spawn shares the address space with the child until it calls
+            // exec (like vfork), so the cost doesn't depend on the size of this
+            // process, unlike fork which must copy the page tables. Failures to
+            // exec are also reported, instead of the child exiting.
+            // (The pipes are closed on exec, except for the redirected ends)
+            posix_spawn_file_actions_t fileActions;
+            if ( posix_spawn_file_actions_init( &fileActions ) != 0 )
+            {
+                return -1;
+            }
+            posix_spawnattr_t attributes;
+            if ( posix_spawnattr_init( &attributes ) != 0 )
+            {
+                VERIFY( posix_spawn_file_actions_destroy( &fileActions ) == 0 );
+                return -1;
+            }
 
+            // Put child process into its own process group (for KillProcessTree)
+            bool ok = ( posix_spawnattr_setflags( &attributes, POSIX_SPAWN_SETPGROUP ) == 0 ) &&
+                      ( posix_spawnattr_setpgroup( &attributes, 0 ) == 0 );
+
+            ok = ok && ( posix_spawn_file_actions_adddup2( &fileActions, stdOutPipeFDs[ 1 ], STDOUT_FILENO ) == 0 );
+            ok = ok && ( posix_spawn_file_actions_adddup2( &fileActions, stdErrPipeFDs[ 1 ], STDERR_FILENO ) == 0 );
+            if ( stdInPipeFDs )
+            {
+                ok = ok && ( posix_spawn_file_actions_adddup2( &fileActions, stdInPipeFDs[ 0 ], STDIN_FILENO ) == 0 );
+            }
             if ( workingDir )
             {
-                VERIFY( chdir( workingDir ) == 0 );
+                ok = ok && ( posix_spawn_file_actions_addchdir_np( &fileActions, workingDir ) == 0 );
             }
 
-            // transfer execution to new executable
-            char * const * argV = (char * const *)argVector.Begin();
-            if ( environment )
+            pid_t childProcessPid = -1;
+            if ( ok && ( posix_spawn( &childProcessPid, executable, &fileActions, &attributes, argV, envV ? envV : environ ) != 0 ) )
             {
-                char * const * envV = (char * const *)envVector.Begin();
-                execve( executable, argV, envV );
+                childProcessPid = -1;
             }
-            else
+
+            VERIFY( posix_spawnattr_destroy( &attributes ) == 0 );
+            VERIFY( posix_spawn_file_actions_destroy( &fileActions ) == 0 );
+            return (int)childProcessPid;
+        #else
+            // fork the process
+            const pid_t childProcessPid = fork();
+            if ( childProcessPid == -1 )
             {
-                execv( executable, argV );
+                ASSERT( false ); // fork failed - should not happen in normal operation
+                return -1;
             }
 
-            exit( -1 ); // only get here if execv fails
-        }
-        else
-        {
-            // close write pipes (we never write anything)
-            VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
-            VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+            const bool isChild = ( childProcessPid == 0 );
+            if ( isChild )
+            {
+                // Put child process into its own process group.
+                // This will allow as to send signals to the whole group which we use to implement KillProcessTree.
+                // The new process group will have ID equal to the PID of the child process.
+                VERIFY( setpgid( 0, 0 ) == 0 );
 
-            // keep pipes for reading child process
-            m_StdOutRead = stdOutPipeFDs[ 0 ];
-            m_StdErrRead = stdErrPipeFDs[ 0 ];
-            m_ChildPID = (int)childProcessPid;
+                VERIFY( dup2( stdOutPipeFDs[ 1 ], STDOUT_FILENO ) != -1 );
+                VERIFY( dup2( stdErrPipeFDs[ 1 ], STDERR_FILENO ) != -1 );
+
+                VERIFY( close( stdOutPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdOutPipeFDs[ 1 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 0 ] ) == 0 );
+                VERIFY( close( stdErrPipeFDs[ 1 ] ) == 0 );
+
+                if ( stdInPipeFDs )
+                {
+                    VERIFY( dup2( stdInPipeFDs[ 0 ], STDIN_FILENO ) != -1 );
+                    VERIFY( close( stdInPipeFDs[ 0 ] ) == 0 );
+                    VERIFY( close( stdInPipeFDs[ 1 ] ) == 0 );
+                }
+
+                if ( workingDir )
+                {
+                    VERIFY( chdir( workingDir ) == 0 );
+                }
+
+                // transfer execution to new executable
+                if ( envV )
+                {
+                    execve( executable, argV, envV );
+                }
+                else
+                {
+                    execv( executable, argV );
+                }
+
+                exit( -1 ); // only get here if execv fails
+            }
 
             // TODO: How can we tell if child spawn failed?
-            m_Started = true;
-            m_HasAlreadyWaitTerminated = false;
-            return true;
-        }
-    #else
-        #error Unknown platform
-    #endif
-}
+            return (int)childProcessPid;
+        #endif
+    }
+#endif
 
 // IsRunning
 //----------------------------------------------------------
@@ -487,7 +601,7 @@ int32_t Process::WaitForExit()
         // cleanup
         VERIFY( ::CloseHandle( m_StdOutRead ) );
         VERIFY( ::CloseHandle( m_StdErrRead ) );
-        VERIFY( ::CloseHandle( m_StdInWrite ) );
+        if ( m_StdInWrite != INVALID_HANDLE_VALUE ) { VERIFY( ::CloseHandle( m_StdInWrite ) ); }
         VERIFY( ::CloseHandle( GetProcessInfo().hProcess ) );
         VERIFY( ::CloseHandle( GetProcessInfo().hThread ) );
 
@@ -495,6 +609,7 @@ int32_t Process::WaitForExit()
     #elif defined( __LINUX__ ) || defined( __APPLE__ )
         VERIFY( close( m_StdOutRead ) == 0 );
         VERIFY( close( m_StdErrRead ) == 0 );
+        CloseStdIn();
         if ( m_HasAlreadyWaitTerminated == false )
         {
             int status;
@@ -568,13 +683,29 @@ bool Process::ReadAllData( AString & outMem,
     const Timer t;
 
     #if defined( __LINUX__ )
-        // Start with a short sleep interval to allow rapid termination of
-        // short-lived processes. The timeout increases during periods of
+        // Wait for output and for the process to exit, instead of sleeping.
+        // Exit is signalled by a pidfd where the kernel supports it (5.3+).
+        // (The pid can only be reused once the process has been waited on)
+        int exitFD = -1;
+        #if defined( SYS_pidfd_open )
+            if ( m_HasAlreadyWaitTerminated == false )
+            {
+                exitFD = (int)syscall( SYS_pidfd_open, m_ChildPID, 0 );
+            }
+        #endif
+        bool stdOutOpen = true;
+        bool stdErrOpen = true;
+
+        // Without a pidfd, exit is only noticed if the process closes its
+        // output, so wait with a short interval to allow rapid termination of
+        // short-lived processes. The interval increases during periods of
         // no output and reset when receiving output to balance responsiveness
         // with overhead.
         uint32_t sleepIntervalMS = 1;
     #endif
 
+    bool timedOut = false;
+
     bool processExited = false;
     for ( ;; )
     {
@@ -626,10 +757,12 @@ bool Process::ReadAllData( AString & outMem,
             if ( IsRunning() )
             {
                 // Check if timeout is hit
-                if ( ( timeOutMS > 0 ) && ( t.GetElapsedMS() >= static_cast<float>( timeOutMS ) ) )
+                const float elapsedMS = t.GetElapsedMS();
+                if ( ( timeOutMS > 0 ) && ( elapsedMS >= static_cast<float>( timeOutMS ) ) )
                 {
                     Terminate();
-                    return false; // Timed out
+                    timedOut = true;
+                    break;
                 }
 
                 // no data available, but process is still going, so wait
@@ -639,9 +772,14 @@ bool Process::ReadAllData( AString & outMem,
                     // writer being blocked.
                     Thread::Sleep( 2 );
                 #else
-                    // TODO:C Investigate waiting on an event when process terminates
-                    // to reduce overall process spawn time
-                    Thread::Sleep( sleepIntervalMS );
+                    // Wake periodically regardless, as aborting is not signalled
+                    uint32_t maxWaitMS = ( exitFD != -1 ) ? 50 : sleepIntervalMS;
+                    if ( timeOutMS > 0 )
+                    {
+                        const uint32_t remainingMS = ( timeOutMS - static_cast<uint32_t>( elapsedMS ) );
+                        maxWaitMS = Math::Clamp<uint32_t>( remainingMS, 1, maxWaitMS );
+                    }
+                    WaitForOutput( exitFD, stdOutOpen, stdErrOpen, maxWaitMS );
 
                     // Increase sleep interval upto limit
                     sleepIntervalMS = Math::Min<uint32_t>( sleepIntervalMS * 2, 8 );
@@ -660,9 +798,192 @@ bool Process::ReadAllData( AString & outMem,
         break; // all done
     }
 
+    #if defined( __LINUX__ )
+        if ( exitFD != -1 )
+        {
+            VERIFY( close( exitFD ) == 0 );
+        }
+    #endif
+
+    return ( timedOut == false );
+}
+
+// WriteStdIn
+//------------------------------------------------------------------------------
+bool Process::WriteStdIn( const void * data, size_t dataSize )
+{
+    ASSERT( m_Started );
+
+    #if defined( __WINDOWS__ )
+        if ( m_StdInWrite == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+        const char * pos = static_cast< const char * >( data );
+        const char * const end = ( pos + dataSize );
+        while ( pos < end )
+        {
+            const DWORD toWrite = static_cast< DWORD >( Math::Min< size_t >( (size_t)( end - pos ), MEGABYTE ) );
+            DWORD written = 0;
+            if ( !::WriteFile( m_StdInWrite, pos, toWrite, &written, nullptr ) )
+            {
+                return false; // Process has closed stdin or exited
+            }
+            pos += written;
+        }
+        return true;
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        if ( m_StdInWrite == -1 )
+        {
+            return false;
+        }
+
+        #if defined( __LINUX__ )
+            // Writing to a pipe the process has closed raises SIGPIPE, which would
+            // terminate this process, so it's blocked on this thread while writing
+            // (on OSX the pipe is created with F_SETNOSIGPIPE instead)
+            sigset_t sigPipe;
+            sigset_t oldMask;
+            sigset_t pending;
+            sigemptyset( &sigPipe );
+            sigaddset( &sigPipe, SIGPIPE );
+            VERIFY( pthread_sigmask( SIG_BLOCK, &sigPipe, &oldMask ) == 0 );
+            sigemptyset( &pending );
+            sigpending( &pending );
+            const bool wasPending = ( sigismember( &pending, SIGPIPE ) == 1 );
+        #endif
+
+        bool ok = true;
+        const char * pos = static_cast< const char * >( data );
+        const char * const end = ( pos + dataSize );
+        while ( pos < end )
+        {
+            const ssize_t written = write( m_StdInWrite, pos, (size_t)( end - pos ) );
+            if ( written == -1 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue; // Try again
+                }
+                ok = false; // Process has closed stdin or exited
+                break;
+            }
+            pos += written;
+        }
+
+        #if defined( __LINUX__ )
+            if ( ( ok == false ) && ( errno == EPIPE ) && ( wasPending == false ) )
+            {
+                // Discard the signal raised by this write
+                const timespec noWait = { 0, 0 };
+                sigtimedwait( &sigPipe, nullptr, &noWait );
+            }
+            VERIFY( pthread_sigmask( SIG_SETMASK, &oldMask, nullptr ) == 0 );
+        #endif
+
+        return ok;
+    #else
+        #error Unknown platform
+    #endif
+}
+
+// CloseStdIn
+//------------------------------------------------------------------------------
+void Process::CloseStdIn()
+{
+    #if defined( __WINDOWS__ )
+        if ( m_StdInWrite != INVALID_HANDLE_VALUE )
+        {
+            VERIFY( ::CloseHandle( m_StdInWrite ) );
+            m_StdInWrite = INVALID_HANDLE_VALUE;
+        }
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        if ( m_StdInWrite != -1 )
+        {
+            VERIFY( close( m_StdInWrite ) == 0 );
+            m_StdInWrite = -1;
+        }
+    #else
+        #error Unknown platform
+    #endif
+}
+
+// ReadAvailableData
+//------------------------------------------------------------------------------
+bool Process::ReadAvailableData( AString & outMem, AString & errMem, uint32_t waitMS )
+{
+    ASSERT( m_Started );
+
+    const uint32_t prevOutSize = outMem.GetLength();
+    const uint32_t prevErrSize = errMem.GetLength();
+    Read( m_StdOutRead, outMem );
+    Read( m_StdErrRead, errMem );
+    if ( ( prevOutSize != outMem.GetLength() ) || ( prevErrSize != errMem.GetLength() ) )
+    {
+        return true;
+    }
+
+    if ( IsRunning() == false )
+    {
+        // get remaining output
+        Read( m_StdOutRead, outMem );
+        Read( m_StdErrRead, errMem );
+        return ( ( prevOutSize != outMem.GetLength() ) || ( prevErrSize != errMem.GetLength() ) );
+    }
+
+    // nothing to read right now
+    #if defined( __LINUX__ )
+        bool stdOutOpen = true;
+        bool stdErrOpen = true;
+        WaitForOutput( -1, stdOutOpen, stdErrOpen, waitMS );
+        if ( ( stdOutOpen == false ) && ( stdErrOpen == false ) )
+        {
+            return false;
+        }
+    #else
+        // Anonymous pipes can't be waited on (Windows), and OSX must wake
+        // frequently anyway (see ReadAllData)
+        Thread::Sleep( Math::Min< uint32_t >( waitMS, 2 ) );
+    #endif
+
+    Read( m_StdOutRead, outMem );
+    Read( m_StdErrRead, errMem );
     return true;
 }
 
+// WaitForOutput
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    void Process::WaitForOutput( int exitFD, bool & stdOutOpen, bool & stdErrOpen, uint32_t maxWaitMS ) const
+    {
+        // Pipes closed by the process are always "ready", so are no longer
+        // waited on (poll ignores negative fds)
+        pollfd fds[ 3 ];
+        fds[ 0 ].fd = stdOutOpen ? m_StdOutRead : -1;
+        fds[ 1 ].fd = stdErrOpen ? m_StdErrRead : -1;
+        fds[ 2 ].fd = exitFD;
+        for ( pollfd & fd : fds )
+        {
+            fd.events = POLLIN;
+            fd.revents = 0;
+        }
+        if ( poll( fds, 3, static_cast< int >( maxWaitMS ) ) <= 0 )
+        {
+            return; // Timed out (or interrupted)
+        }
+
+        // Closed once there's nothing left to read
+        if ( ( fds[ 0 ].revents & ( POLLHUP | POLLERR ) ) && ( ( fds[ 0 ].revents & POLLIN ) == 0 ) )
+        {
+            stdOutOpen = false;
+        }
+        if ( ( fds[ 1 ].revents & ( POLLHUP | POLLERR ) ) && ( ( fds[ 1 ].revents & POLLIN ) == 0 ) )
+        {
+            stdErrOpen = false;
+        }
+    }
+#endif
+
 // Read
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ )
@@ -708,13 +1029,12 @@ bool Process::ReadAllData( AString & outMem,
     void Process::Read( int handle, AString & buffer )
     {
         // any data available?
-        timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 0;
-        fd_set fdSet;
-        FD_ZERO( &fdSet );
-        FD_SET( handle, &fdSet );
-        int ret = select( handle+1, &fdSet, nullptr, nullptr, &timeout );
+        // (poll is used as select can't handle fds >= FD_SETSIZE)
+        pollfd fd;
+        fd.fd = handle;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        const int ret = poll( &fd, 1, 0 );
         if ( ret == -1 )
         {
             ASSERT( false ); // usage error?
@@ -35,6 +35,18 @@ public:
                                              AString & errOut,
                                              uint32_t timeOutMS = 0 );
 
+    // Communicate with a long-lived process while it runs
+    // (on Windows stdin is always a pipe when handles are redirected)
+    void                        EnableStdInPipe() { m_StdInPipe = true; }
+    [[nodiscard]] bool          WriteStdIn( const void * data, size_t dataSize );
+    void                        CloseStdIn();
+
+    // Read any available output, waiting up to waitMS for some if there is none
+    // Returns false once the process has exited or closed its output
+    bool                        ReadAvailableData( AString & outMem,
+                                                   AString & errMem,
+                                                   uint32_t waitMS );
+
     #if defined( __WINDOWS__ )
         // Prevent handles being redirected
         void                    DisableHandleRedirection() { m_RedirectHandles = false; }
@@ -51,6 +63,16 @@ private:
         void                    Read( void * handle, AString & buffer );
     #else
         void                    Read( int handle, AString & buffer );
+        #if defined( __LINUX__ )
+            void                WaitForOutput( int exitFD, bool & stdOutOpen, bool & stdErrOpen, uint32_t maxWaitMS ) const;
+        #endif
+        [[nodiscard]] static int SpawnChild( const char * executable,
+                                             char * const * argV,
+                                             char * const * envV,
+                                             const char * workingDir,
+                                             const int stdOutPipeFDs[ 2 ],
+                                             const int stdErrPipeFDs[ 2 ],
+                                             const int * stdInPipeFDs );
     #endif
 
     void Terminate();
@@ -68,6 +90,7 @@ private:
     #endif
 
     bool m_Started;
+    bool m_StdInPipe;
     #if defined( __WINDOWS__ )
         bool m_SharingHandles;
         bool m_RedirectHandles;
@@ -85,6 +108,7 @@ private:
         mutable int m_ReturnStatus;
         int m_StdOutRead;
         int m_StdErrRead;
+        int m_StdInWrite;
     #endif
     const volatile bool * m_MainAbortFlag; // This member is set when we must cancel processes asap when the main process dies.
     const volatile bool * m_AbortFlag;
@@ -67,6 +67,7 @@ SharedMemory::SharedMemory()
     #elif defined(__LINUX__) || defined(__APPLE__)
         , m_MapFile( -1 )
         , m_Length( 0 )
+        , m_Owner( false )
     #else
         #error Unknown Platform
     #endif
@@ -87,7 +88,10 @@ SharedMemory::~SharedMemory()
         if ( m_MapFile != -1 )
         {
             close( m_MapFile );
-            shm_unlink( m_Name.Get() );
+            if ( m_Owner )
+            {
+                shm_unlink( m_Name.Get() );
+            }
         }
     #else
         #error Unknown Platform
@@ -118,6 +122,7 @@ void SharedMemory::Create( const char * name, unsigned int size )
     #elif defined( __APPLE__ ) || defined( __LINUX__ )
         PosixMapMemory(name, size, true, &m_MapFile, &m_Memory, m_Name);
         m_Length = size;
+        m_Owner = true;
     #else
         #error Unknown Platform
     #endif
@@ -33,6 +33,7 @@ private:
         int m_MapFile;
         size_t m_Length;
         AString m_Name;
+        bool m_Owner; // Created (rather than opened) so must be unlinked
     #else
         #error Unknown Platform
     #endif
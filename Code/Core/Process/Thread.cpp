@@ -6,6 +6,7 @@
 #include "Thread.h"
 #include "Core/Env/Assert.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Mem/SmallBlockAllocator.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 
@@ -86,10 +87,17 @@ public:
         FDELETE( originalInfo );
 
         // enter into real thread function
+        const uint32_t result = (*realFunction)( realUserData );
+
+        // Make blocks cached by this thread available to others
+        #if defined( SMALL_BLOCK_ALLOCATOR_ENABLED )
+            SmallBlockAllocator::ReleaseThreadCache();
+        #endif
+
         #if defined( __WINDOWS__ )
-            return (*realFunction)( realUserData );
+            return result;
         #else
-            return (void *)(size_t)( (*realFunction)( realUserData ) );
+            return (void *)(size_t)result;
         #endif
     }
 
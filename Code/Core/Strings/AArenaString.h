@@ -0,0 +1,61 @@
+// AArenaString.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "AString.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Arena.h"
+
+// AArenaString
+//------------------------------------------------------------------------------
+// A string with its initial capacity allocated from an Arena (if there is one),
+// for short-lived strings which can be large. If it grows beyond that, memory
+// is allocated as for any AString. The string must not be used after the Arena
+// is rewound past it (moving it to another string takes a copy).
+class AArenaString : public AString
+{
+public:
+    explicit AArenaString( Arena * arena, uint32_t reserve );
+    inline ~AArenaString();
+
+    AArenaString & operator = ( const char * string ) { Assign( string ); return *this; }
+    AArenaString & operator = ( const AString & string ) { Assign( string ); return *this; }
+    AArenaString & operator = ( AString && string ) { Assign( Move( string ) ); return *this; }
+
+private:
+    AArenaString( const AArenaString & ) = delete;
+    AArenaString & operator = ( const AArenaString & ) = delete;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+inline AArenaString::AArenaString( Arena * arena, uint32_t reserve )
+    : AString()
+{
+    if ( arena && ( reserve > 0 ) )
+    {
+        reserve = Math::RoundUp( reserve, (uint32_t)2 );
+        m_Contents = static_cast< char * >( arena->Alloc( reserve + 1, 1 ) );
+        m_Contents[ 0 ] = '\0';
+        SetReserved( reserve, false );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+inline AArenaString::~AArenaString()
+{
+    // Memory which isn't owned is the buffer from the Arena (the string has no
+    // internal storage), which is released by rewinding. Detach from it so the
+    // base class only has to deal with the states it knows about.
+    if ( ( MemoryMustBeFreed() == false ) && ( m_Contents != s_EmptyString ) )
+    {
+        m_Contents = const_cast< char * >( s_EmptyString );
+        m_Length = 0;
+        m_ReservedAndFlags = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CtrlCHandler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
 
 #include "Core/Process/Process.h"
 #include "Core/Process/SharedMemory.h"
@@ -36,6 +37,7 @@ enum ReturnCodes
     FBUILD_WRAPPER_CRASHED                  = -7,
     FBUILD_FAILED_TO_WSL_WRAPPER            = -8,
     FBUILD_FAILED_TO_WRITE_PROFILE_JSON     = -9,
+    FBUILD_FAILED_TO_START_FILE_WATCHER     = -10,
 };
 
 // Headers
@@ -43,6 +45,7 @@ enum ReturnCodes
 int WrapperMainProcess( const AString & args, const FBuildOptions & options, SystemMutex & finalProcess );
 int WrapperIntermediateProcess( const FBuildOptions & options );
 int32_t WrapperModeForWSL( const FBuildOptions & options );
+int FileWatcherMode( const FBuildOptions & options );
 int Main( int argc, char * argv[] );
 
 // Misc
@@ -110,6 +113,12 @@ int Main( int argc, char * argv[] )
     VERIFY( setvbuf( stdout, nullptr, _IONBF, 0 ) == 0 );
     VERIFY( setvbuf( stderr, nullptr, _IONBF, 0 ) == 0 );
 
+    // record file changes for other builds instead of building
+    if ( options.m_WatchMode )
+    {
+        return FileWatcherMode( options );
+    }
+
     // ensure only one FASTBuild instance is running at a time
     SystemMutex mainProcess( options.GetMainProcessMutexName().Get() );
 
@@ -349,4 +358,32 @@ int32_t WrapperModeForWSL( const FBuildOptions & options )
     return p.WaitForExit();
 }
 
+// FileWatcherMode
+//------------------------------------------------------------------------------
+int FileWatcherMode( const FBuildOptions & options )
+{
+    // only 1 watcher per dir
+    SystemMutex watcherMutex( options.GetFileWatcherMutexName().Get() );
+    if ( watcherMutex.TryLock() == false )
+    {
+        OUTPUT( "FBuild: Error: Another FASTBuild file watcher is already running in '%s'.\n", options.GetWorkingDir().Get() );
+        return FBUILD_ALREADY_RUNNING;
+    }
+
+    FileWatcher watcher;
+    if ( watcher.Start( options.GetWorkingDir(), options.GetFileWatcherSharedMemoryName().Get() ) == false )
+    {
+        return FBUILD_FAILED_TO_START_FILE_WATCHER; // Start will have emitted an error
+    }
+    OUTPUT( "FBuild: Watching %u directories in '%s' (Ctrl+C to stop).\n", watcher.GetNumWatchedDirs(), options.GetWorkingDir().Get() );
+
+    // Builds wait for pending changes to be recorded, so keep latency low
+    while ( FBuild::GetStopBuild() == false )
+    {
+        watcher.Update( 5 );
+    }
+
+    return FBUILD_OK;
+}
+
 //------------------------------------------------------------------------------
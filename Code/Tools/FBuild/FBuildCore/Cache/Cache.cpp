@@ -176,20 +176,49 @@ public:
     FREE( data );
 }
 
+// RetrieveStream
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize )
+{
+    outStream = nullptr;
+    outSize = 0;
+
+    AStackString<> fullPath;
+    GetFullPathForCacheEntry( cacheId, fullPath );
+
+    UniquePtr< FileStream > cacheFile( FNEW( FileStream ) );
+    if ( cacheFile->Open( fullPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    outSize = cacheFile->GetFileSize();
+    outStream = cacheFile.ReleaseOwnership();
+    return true;
+}
+
 // OutputInfo
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::OutputInfo( bool showProgress )
 {
-    // Count/Size per day
-    const uint32_t NUM_DAYS( 30 );
-    CacheStats perDay[ NUM_DAYS ];
-
     // Get all the files
     Array< FileIO::FileInfo > allFiles( 1000000 );
     uint64_t totalSize = 0;
     GetCacheFiles( showProgress, allFiles, totalSize );
 
+    OutputAgeSummary( allFiles );
+    return true;
+}
+
+// OutputAgeSummary
+//------------------------------------------------------------------------------
+/*static*/ void Cache::OutputAgeSummary( const Array< FileIO::FileInfo > & allFiles )
+{
+    // Count/Size per day
+    const uint32_t NUM_DAYS( 30 );
+    CacheStats perDay[ NUM_DAYS ];
+
     // Assign files into buckets
+    CacheStats total;
     const uint64_t currentTime = Time::GetCurrentFileTime(); // Compare filetimes to now
     for ( const FileIO::FileInfo & info : allFiles )
     {
@@ -207,11 +236,8 @@ public:
         }
         perDay[ ageInDays ].m_NumFiles++;
         perDay[ ageInDays ].m_NumBytes += info.m_Size;
+        total.m_NumBytes += info.m_Size;
     }
-
-    // Totals
-    CacheStats total;
-    total.m_NumBytes = totalSize;
     total.m_NumFiles = (uint32_t)allFiles.GetSize();
 
     // Generate cache info string
@@ -236,8 +262,6 @@ public:
     OUTPUT( "================================================================================\n" );
     OUTPUT( " Total      | %8u | %10" PRIu64 " |\n", total.m_NumFiles, total.m_NumBytes / MEGABYTE );
     OUTPUT( "================================================================================\n" );
-
-    return true;
 }
 
 // Trim
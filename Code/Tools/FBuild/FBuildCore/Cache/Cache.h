@@ -26,8 +26,12 @@ public:
     virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
     virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
     virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+
+    // Output count/size of entries per day of age
+    static void OutputAgeSummary( const Array< FileIO::FileInfo > & allFiles );
 private:
     void GetCacheFiles( bool showProgress, Array< FileIO::FileInfo > & outInfo, uint64_t & outTotalSize ) const;
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
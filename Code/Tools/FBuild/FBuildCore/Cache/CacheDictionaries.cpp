@@ -0,0 +1,331 @@
+// CacheDictionaries - Compression dictionaries for cache entries
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheDictionaries.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <string.h> // for memcpy
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheDictionaries::CacheDictionaries( ICache & cache )
+    : m_Cache( cache )
+    , m_Toolchains( 8 )
+    , m_Dictionaries( 8 )
+    , m_MissingDictionaries( 8 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ CacheDictionaries::~CacheDictionaries()
+{
+    for ( Toolchain * toolchain : m_Toolchains )
+    {
+        FDELETE toolchain;
+    }
+    for ( CompressionDictionary * dictionary : m_Dictionaries )
+    {
+        FDELETE dictionary;
+    }
+}
+
+// GetDictionary
+//------------------------------------------------------------------------------
+const CompressionDictionary * CacheDictionaries::GetDictionary( uint64_t toolId )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        Toolchain * toolchain = FindToolchain( toolId );
+        if ( toolchain == nullptr )
+        {
+            toolchain = FNEW( Toolchain );
+            toolchain->m_ToolId = toolId;
+            toolchain->m_Dictionary = nullptr;
+            toolchain->m_LoadAttempted = false;
+            toolchain->m_SamplingDone = false;
+            toolchain->m_Refreshed = false;
+            m_Toolchains.Append( toolchain );
+        }
+        if ( toolchain->m_LoadAttempted )
+        {
+            return toolchain->m_Dictionary;
+        }
+        toolchain->m_LoadAttempted = true;
+    }
+
+    // Use the dictionary already in the cache for this toolchain, if there is one
+    // (entries can be compressed without it while this is in progress)
+    AStackString<> cacheId;
+    GetToolchainDictionaryCacheId( toolId, cacheId );
+    const CompressionDictionary * dictionary = Load( cacheId, 0 );
+
+    MutexHolder mh( m_Mutex );
+    Toolchain * toolchain = FindToolchain( toolId );
+    if ( dictionary && ( toolchain->m_Dictionary == nullptr ) )
+    {
+        toolchain->m_Dictionary = dictionary;
+        FREE( toolchain->m_Samples.Release() );
+        toolchain->m_SampleSizes.Destruct();
+    }
+    return toolchain->m_Dictionary;
+}
+
+// AddSample
+//------------------------------------------------------------------------------
+void CacheDictionaries::AddSample( uint64_t toolId, const void * data, size_t dataSize )
+{
+    MemoryStream samples;
+    Array< uint32_t > sampleSizes;
+    {
+        MutexHolder mh( m_Mutex );
+        Toolchain * toolchain = FindToolchain( toolId );
+        if ( ( toolchain == nullptr ) || toolchain->m_Dictionary || toolchain->m_SamplingDone )
+        {
+            return; // Already have a dictionary (or have tried to make one)
+        }
+
+        // Large entries are mostly unique content, so only the beginning
+        // and end (where headers and tables tend to be) are sampled
+        if ( dataSize <= MAX_SAMPLE_SIZE )
+        {
+            toolchain->m_Samples.WriteBuffer( data, dataSize );
+            toolchain->m_SampleSizes.Append( static_cast< uint32_t >( dataSize ) );
+        }
+        else
+        {
+            const size_t halfSize = ( MAX_SAMPLE_SIZE / 2 );
+            toolchain->m_Samples.WriteBuffer( data, halfSize );
+            toolchain->m_Samples.WriteBuffer( static_cast< const char * >( data ) + dataSize - halfSize, halfSize );
+            toolchain->m_SampleSizes.Append( static_cast< uint32_t >( MAX_SAMPLE_SIZE ) );
+        }
+        if ( toolchain->m_SampleSizes.GetSize() < NUM_SAMPLES_TO_TRAIN )
+        {
+            return;
+        }
+
+        // Train (once) outside the lock
+        toolchain->m_SamplingDone = true;
+        const size_t samplesSize = toolchain->m_Samples.GetSize();
+        samples.Replace( toolchain->m_Samples.Release(), samplesSize );
+        sampleSizes.Swap( toolchain->m_SampleSizes );
+    }
+
+    PROFILE_SECTION( "TrainCacheDictionary" );
+
+    const CompressionDictionary * dictionary = nullptr;
+    MemoryStream dictionaryData;
+    if ( CompressionDictionary::Train( samples.GetData(), sampleSizes, CompressionDictionary::DEFAULT_MAX_SIZE, dictionaryData ) )
+    {
+        MutexHolder mh( m_Mutex );
+        dictionary = AddDictionary( dictionaryData.GetData(), dictionaryData.GetSize() );
+    }
+
+    // Entries can't be read without the dictionary, so it's only used once stored
+    if ( dictionary && ( Publish( toolId, *dictionary ) == false ) )
+    {
+        dictionary = nullptr;
+    }
+
+    // (if there is no dictionary, the samples were not useful or the cache is
+    // not writable, and entries are compressed without one)
+    MutexHolder mh( m_Mutex );
+    Toolchain * toolchain = FindToolchain( toolId );
+    if ( toolchain->m_Dictionary == nullptr )
+    {
+        toolchain->m_Dictionary = dictionary;
+        if ( dictionary )
+        {
+            toolchain->m_Refreshed = true; // Just stored
+            toolchain->m_RefreshTimer.Start();
+        }
+    }
+}
+
+// OnEntryStored
+//------------------------------------------------------------------------------
+void CacheDictionaries::OnEntryStored( uint64_t toolId, const CompressionDictionary & dictionary )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        Toolchain * toolchain = FindToolchain( toolId );
+        ASSERT( toolchain && ( toolchain->m_Dictionary == &dictionary ) );
+        if ( toolchain->m_Refreshed &&
+             ( toolchain->m_RefreshTimer.GetElapsed() < (float)REFRESH_INTERVAL_SECONDS ) )
+        {
+            return;
+        }
+        toolchain->m_Refreshed = true;
+        toolchain->m_RefreshTimer.Start();
+    }
+
+    // Storing the dictionary again makes it (almost) as new as the entries using
+    // it. This also replaces either copy if it was trimmed and the other was not.
+    Publish( toolId, dictionary );
+}
+
+// FindDictionary
+//------------------------------------------------------------------------------
+/*virtual*/ const CompressionDictionary * CacheDictionaries::FindDictionary( uint64_t dictionaryId )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        const CompressionDictionary * dictionary = FindLoadedDictionary( dictionaryId );
+        if ( dictionary || m_MissingDictionaries.Find( dictionaryId ) )
+        {
+            return dictionary;
+        }
+    }
+
+    AStackString<> cacheId;
+    GetDictionaryCacheId( dictionaryId, cacheId );
+    const CompressionDictionary * dictionary = Load( cacheId, dictionaryId );
+    if ( dictionary == nullptr )
+    {
+        // Don't look again for every entry which needs it
+        MutexHolder mh( m_Mutex );
+        if ( m_MissingDictionaries.Find( dictionaryId ) == nullptr )
+        {
+            m_MissingDictionaries.Append( dictionaryId );
+        }
+    }
+    return dictionary;
+}
+
+// GetDictionaryCacheId
+//------------------------------------------------------------------------------
+/*static*/ void CacheDictionaries::GetDictionaryCacheId( uint64_t dictionaryId, AString & outCacheId )
+{
+    ICache::GetCacheId( dictionaryId, DICTIONARY_KEY, 0, 0, outCacheId );
+}
+
+// GetToolchainDictionaryCacheId
+//------------------------------------------------------------------------------
+/*static*/ void CacheDictionaries::GetToolchainDictionaryCacheId( uint64_t toolId, AString & outCacheId )
+{
+    ICache::GetCacheId( 0, DICTIONARY_KEY, toolId, 0, outCacheId );
+}
+
+// FindToolchain
+//------------------------------------------------------------------------------
+CacheDictionaries::Toolchain * CacheDictionaries::FindToolchain( uint64_t toolId ) const
+{
+    // NOTE: m_Mutex must be held
+    for ( Toolchain * toolchain : m_Toolchains )
+    {
+        if ( toolchain->m_ToolId == toolId )
+        {
+            return toolchain;
+        }
+    }
+    return nullptr;
+}
+
+// FindLoadedDictionary
+//------------------------------------------------------------------------------
+const CompressionDictionary * CacheDictionaries::FindLoadedDictionary( uint64_t dictionaryId ) const
+{
+    // NOTE: m_Mutex must be held
+    for ( const CompressionDictionary * dictionary : m_Dictionaries )
+    {
+        if ( dictionary->GetId() == dictionaryId )
+        {
+            return dictionary;
+        }
+    }
+    return nullptr;
+}
+
+// AddDictionary
+//------------------------------------------------------------------------------
+const CompressionDictionary * CacheDictionaries::AddDictionary( const void * data, size_t dataSize )
+{
+    // NOTE: m_Mutex must be held
+
+    // Dictionaries are kept until the end of the build, as they can be in use
+    // by any thread
+    const CompressionDictionary * existing = FindLoadedDictionary( CompressionDictionary::CalcId( data, dataSize ) );
+    if ( existing )
+    {
+        return existing;
+    }
+    CompressionDictionary * dictionary = FNEW( CompressionDictionary( data, dataSize ) );
+    m_Dictionaries.Append( dictionary );
+    m_MissingDictionaries.FindAndErase( dictionary->GetId() );
+    return dictionary;
+}
+
+// Load
+//------------------------------------------------------------------------------
+const CompressionDictionary * CacheDictionaries::Load( const AString & cacheId, uint64_t expectedDictionaryId )
+{
+    PROFILE_FUNCTION;
+
+    void * data = nullptr;
+    size_t dataSize = 0;
+    if ( m_Cache.Retrieve( cacheId, data, dataSize ) == false )
+    {
+        return nullptr;
+    }
+
+    // Validate
+    const CompressionDictionary * dictionary = nullptr;
+    uint32_t version = 0;
+    if ( dataSize > sizeof( version ) )
+    {
+        memcpy( &version, data, sizeof( version ) );
+    }
+    const void * dictionaryData = ( static_cast< const char * >( data ) + sizeof( version ) );
+    const size_t dictionarySize = ( dataSize - sizeof( version ) );
+    if ( ( version == DICTIONARY_VERSION ) &&
+         ( ( expectedDictionaryId == 0 ) ||
+           ( CompressionDictionary::CalcId( dictionaryData, dictionarySize ) == expectedDictionaryId ) ) )
+    {
+        MutexHolder mh( m_Mutex );
+        dictionary = AddDictionary( dictionaryData, dictionarySize );
+    }
+    else
+    {
+        FLOG_WARN( "Cache returned invalid compression dictionary '%s'", cacheId.Get() );
+    }
+
+    m_Cache.FreeMemory( data, dataSize );
+    return dictionary;
+}
+
+// Publish
+//------------------------------------------------------------------------------
+bool CacheDictionaries::Publish( uint64_t toolId, const CompressionDictionary & dictionary )
+{
+    PROFILE_FUNCTION;
+
+    MemoryStream ms( sizeof( uint32_t ) + dictionary.GetDataSize() );
+    ms.Write( static_cast< uint32_t >( DICTIONARY_VERSION ) );
+    ms.WriteBuffer( dictionary.GetData(), dictionary.GetDataSize() );
+
+    // Entries refer to the dictionary by id, so it must be stored before any
+    // use it. The toolchain's dictionary is replaced, so later builds use this one.
+    AStackString<> cacheId;
+    GetDictionaryCacheId( dictionary.GetId(), cacheId );
+    if ( m_Cache.Publish( cacheId, ms.GetData(), ms.GetSize() ) == false )
+    {
+        return false;
+    }
+    GetToolchainDictionaryCacheId( toolId, cacheId );
+    m_Cache.Publish( cacheId, ms.GetData(), ms.GetSize() );
+    return true;
+}
+
+//------------------------------------------------------------------------------
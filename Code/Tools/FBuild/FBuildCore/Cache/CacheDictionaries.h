@@ -0,0 +1,88 @@
+// CacheDictionaries - Compression dictionaries for cache entries
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+class ICache;
+
+// CacheDictionaries
+//------------------------------------------------------------------------------
+// Cache entries for objects built by the same toolchain have a lot in common,
+// so each toolchain has a dictionary to compress them with.
+//
+// A dictionary is trained from the first entries stored by a build. It is then
+// stored in the cache so other builds (and other machines) sharing the cache can
+// use it to compress their entries, and to decompress entries compressed with it.
+//
+// Trimming the cache removes the oldest files first, so a dictionary is stored
+// again periodically while entries using it are stored. If it's removed anyway,
+// entries using it are misses (and are replaced when stored again).
+class CacheDictionaries : public ICompressionDictionaryProvider
+{
+public:
+    explicit CacheDictionaries( ICache & cache );
+    virtual ~CacheDictionaries() override;
+
+    // Dictionary to compress entries for a toolchain with (nullptr until there is one)
+    const CompressionDictionary * GetDictionary( uint64_t toolId );
+
+    // Provide an entry (uncompressed) to train the toolchain's dictionary
+    void AddSample( uint64_t toolId, const void * data, size_t dataSize );
+
+    // An entry compressed with the toolchain's dictionary has been stored
+    void OnEntryStored( uint64_t toolId, const CompressionDictionary & dictionary );
+
+    // ICompressionDictionaryProvider: find dictionaries used by entries being retrieved
+    virtual const CompressionDictionary * FindDictionary( uint64_t dictionaryId ) override;
+
+    enum : uint32_t { NUM_SAMPLES_TO_TRAIN = 32 };
+    enum : uint32_t { MAX_SAMPLE_SIZE = ( 64 * 1024 ) };
+    enum : uint32_t { REFRESH_INTERVAL_SECONDS = 60 };
+
+    static void GetDictionaryCacheId( uint64_t dictionaryId, AString & outCacheId );
+    static void GetToolchainDictionaryCacheId( uint64_t toolId, AString & outCacheId );
+
+private:
+    enum : uint32_t { DICTIONARY_VERSION = 1 };
+    enum : uint32_t { DICTIONARY_KEY = 0x44494354 }; // Distinguishes dictionaries from other entries
+
+    struct Toolchain
+    {
+        uint64_t                        m_ToolId;
+        const CompressionDictionary *   m_Dictionary;
+        bool                            m_LoadAttempted;
+        bool                            m_SamplingDone;
+        bool                            m_Refreshed;        // Stored (again) by this build
+        Timer                           m_RefreshTimer;
+        MemoryStream                    m_Samples;
+        Array< uint32_t >               m_SampleSizes;
+    };
+
+    Toolchain *                     FindToolchain( uint64_t toolId ) const;
+    const CompressionDictionary *   FindLoadedDictionary( uint64_t dictionaryId ) const;
+    const CompressionDictionary *   AddDictionary( const void * data, size_t dataSize );
+    const CompressionDictionary *   Load( const AString & cacheId, uint64_t expectedDictionaryId );
+    bool                            Publish( uint64_t toolId, const CompressionDictionary & dictionary );
+
+    ICache &                            m_Cache;
+    mutable Mutex                       m_Mutex;
+    Array< Toolchain * >                m_Toolchains;
+    Array< CompressionDictionary * >    m_Dictionaries;
+    Array< uint64_t >                   m_MissingDictionaries; // Ids not found in the cache
+};
+
+//------------------------------------------------------------------------------
@@ -5,8 +5,51 @@
 //------------------------------------------------------------------------------
 #include "ICache.h"
 
+#include <Core/FileIO/ConstMemoryStream.h>
+#include <Core/Mem/Mem.h>
 #include <Core/Strings/AString.h>
 
+// CacheMemoryStream - Stream over memory returned by Retrieve
+//------------------------------------------------------------------------------
+class CacheMemoryStream : public ConstMemoryStream
+{
+public:
+    CacheMemoryStream( ICache & cache, void * data, size_t dataSize )
+        : ConstMemoryStream( data, dataSize )
+        , m_Cache( cache )
+        , m_Data( data )
+        , m_DataSize( dataSize )
+    {
+    }
+    virtual ~CacheMemoryStream() override
+    {
+        m_Cache.FreeMemory( m_Data, m_DataSize );
+    }
+
+private:
+    ICache &    m_Cache;
+    void *      m_Data;
+    size_t      m_DataSize;
+};
+
+// RetrieveStream
+//------------------------------------------------------------------------------
+/*virtual*/ bool ICache::RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize )
+{
+    outStream = nullptr;
+    outSize = 0;
+
+    void * data;
+    size_t dataSize;
+    if ( Retrieve( cacheId, data, dataSize ) == false )
+    {
+        return false;
+    }
+    outStream = FNEW( CacheMemoryStream( *this, data, dataSize ) );
+    outSize = dataSize;
+    return true;
+}
+
 // GetCacheId
 //------------------------------------------------------------------------------
 /*static*/ void ICache::GetCacheId( const uint64_t preprocessedSourceKey,
@@ -16,7 +59,7 @@
                                     AString & outCacheId )
 {
     // cache version - bump if cache format is changed
-    const char cacheVersion( 'G' );
+    const char cacheVersion( 'H' );
 
     // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7
     outCacheId.Format( "%016" PRIX64 "_%08X_%016" PRIX64 "-%016" PRIX64 ".%c",
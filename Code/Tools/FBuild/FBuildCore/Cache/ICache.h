@@ -9,6 +9,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class IOStream;
 
 // Cache
 //------------------------------------------------------------------------------
@@ -31,6 +32,10 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // Retrieve an entry as a stream which the caller must FDELETE. Implementations
+    // which can read entries in place can avoid loading them into memory.
+    virtual bool RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize );
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
@@ -9,20 +9,28 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ProjectGeneratorBase.h"
+#include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
 // Core
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Mutex.h"
+#include "Core/Process/SystemMutex.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
 // System
 #include <stdarg.h> // for va_start
+#include <string.h> // for memcpy
 
 // Include Type
 //------------------------------------------------------------------------------
@@ -59,6 +67,9 @@ public:
     Array< Include >                m_Includes;
     Array< const IncludeDefine * >  m_IncludeDefines;
     Array< uint64_t >               m_NonIncludeDefines;
+    uint64_t                        m_LastWriteTime;    // Of the parsed file (0 if results can't be stored)
+    uint64_t                        m_FileSize;
+    bool                            m_InStore;          // Results were retrieved from (or saved to) the LightCacheStore
 
     inline bool operator == ( const AString & fileName ) const      { return ( m_FileName == fileName ); }
     inline bool operator == ( const IncludedFile & other ) const    { return ( ( m_FileNameHash == other.m_FileNameHash ) && ( m_FileName == other.m_FileName ) ); }
@@ -126,6 +137,18 @@ public:
         m_Elts = 0;
     }
 
+    // Get all items
+    void GetAll( Array< IncludedFile * > & outItems ) const
+    {
+        for ( IncludedFile * file : m_Buckets )
+        {
+            if ( file )
+            {
+                outItems.Append( file );
+            }
+        }
+    }
+
 private:
     IncludedFile ** InternalFind( const AString & fileName, uint64_t fileNameHash )
     {
@@ -244,12 +267,456 @@ PRAGMA_DISABLE_POP_MSVC // 4324
 #define LIGHTCACHE_HASH_TO_BUCKET(hash) ( (( hash ) >> ( 64ULL - LIGHTCACHE_NUM_BUCKET_BITS )) & LIGHTCACHE_BUCKET_MASK_BASE )
 static IncludedFileBucket g_AllIncludedFiles[ LIGHTCACHE_NUM_BUCKETS ];
 
+// LightCacheStore
+//------------------------------------------------------------------------------
+// Parse results from previous builds, persisted in a file shared by all builds
+// on the machine. Results for a file are reused while its path, last write time
+// and size are unchanged. Newly parsed files are appended when a build ends.
+#define LIGHTCACHE_STORE_FILE_NAME      "LightCache.fdb"
+#define LIGHTCACHE_STORE_MUTEX_NAME     "Global\\FASTBuild_LightCache"
+#define LIGHTCACHE_STORE_MAX_SIZE       ( 64 * 1024 * 1024 )
+class LightCacheStore
+{
+public:
+    LightCacheStore() = default;
+    LightCacheStore( const LightCacheStore & ) = delete;
+    LightCacheStore & operator = ( const LightCacheStore & ) = delete;
+
+    bool Retrieve( uint64_t lastWriteTime, uint64_t fileSize, IncludedFile & file );
+    void Save( bool hasNewFiles );
+    void Close();
+
+private:
+    void Load();
+    bool Write( const Array< IncludedFile * > & files, bool rewrite );
+    static void GetFileName( AString & outFileName );
+    static void Serialize( MemoryStream & stream, const IncludedFile & file );
+    static bool Deserialize( ConstMemoryStream & stream, IncludedFile & file );
+
+    // File header
+    class Header
+    {
+    public:
+        enum : uint32_t { MAGIC = 'F' | ( 'B' << 8 ) | ( 'L' << 16 ) | ( 'C' << 24 ) };
+        enum : uint32_t { VERSION = 1 };
+
+        uint32_t    m_Magic     = MAGIC;
+        uint32_t    m_Version   = VERSION;
+    };
+
+    // Each record is followed by the payload for one file
+    class Record
+    {
+    public:
+        uint64_t    m_FileNameHash;
+        uint64_t    m_Checksum;     // Hash of payload to detect incomplete writes
+        uint32_t    m_PayloadSize;  // Multiple of 8
+        uint32_t    m_Padding;
+    };
+
+    // Location of a record in the file
+    class Entry
+    {
+    public:
+        uint64_t    m_FileNameHash;
+        uint64_t    m_PayloadOffset;
+
+        // Sort by hash, with records appended later after earlier ones
+        bool operator < ( const Entry & other ) const
+        {
+            return ( m_FileNameHash != other.m_FileNameHash ) ? ( m_FileNameHash < other.m_FileNameHash )
+                                                              : ( m_PayloadOffset < other.m_PayloadOffset );
+        }
+    };
+
+    Mutex           m_Mutex;
+    volatile bool   m_Loaded        = false;
+    bool            m_NeedsRewrite  = false;    // File is damaged or from an older version
+    MappedFile      m_File;
+    Array< Entry >  m_Entries;                  // Sorted
+};
+static LightCacheStore g_LightCacheStore;
+static volatile bool g_LightCacheHasNewFiles = false;
+static AStackString<> g_LightCacheStorePathOverride;
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool LightCacheStore::Retrieve( uint64_t lastWriteTime, uint64_t fileSize, IncludedFile & file )
+{
+    if ( AtomicLoadAcquire( &m_Loaded ) == false )
+    {
+        Load();
+    }
+
+    // Find the first record for this file name hash
+    size_t low = 0;
+    size_t high = m_Entries.GetSize();
+    while ( low < high )
+    {
+        const size_t mid = ( low + ( ( high - low ) / 2 ) );
+        if ( m_Entries[ mid ].m_FileNameHash < file.m_FileNameHash )
+        {
+            low = ( mid + 1 );
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    // Check records from latest to earliest (hashes can collide and a file can
+    // be stored several times as it changes)
+    size_t end = low;
+    while ( ( end < m_Entries.GetSize() ) && ( m_Entries[ end ].m_FileNameHash == file.m_FileNameHash ) )
+    {
+        ++end;
+    }
+    const char * data = static_cast< const char * >( m_File.GetData() );
+    for ( size_t i = end; i > low; --i )
+    {
+        const Entry & entry = m_Entries[ i - 1 ];
+        const Record * record = reinterpret_cast< const Record * >( data + entry.m_PayloadOffset - sizeof( Record ) );
+        ConstMemoryStream stream( data + entry.m_PayloadOffset, record->m_PayloadSize );
+
+        AStackString<> fileName;
+        uint64_t storedLastWriteTime;
+        uint64_t storedFileSize;
+        if ( ( stream.Read( fileName ) == false ) ||
+             ( stream.Read( storedLastWriteTime ) == false ) ||
+             ( stream.Read( storedFileSize ) == false ) )
+        {
+            continue; // Can't happen unless written by a different version
+        }
+        if ( ( fileName != file.m_FileName ) ||
+             ( storedLastWriteTime != lastWriteTime ) ||
+             ( storedFileSize != fileSize ) )
+        {
+            continue;
+        }
+
+        if ( Deserialize( stream, file ) )
+        {
+            file.m_Exists = true;
+            file.m_LastWriteTime = lastWriteTime;
+            file.m_FileSize = fileSize;
+            file.m_InStore = true;
+            return true;
+        }
+
+        // Discard partially retrieved results
+        file.m_Includes.Clear();
+        for ( const IncludeDefine * define : file.m_IncludeDefines )
+        {
+            FDELETE define;
+        }
+        file.m_IncludeDefines.Clear();
+        file.m_NonIncludeDefines.Clear();
+        break;
+    }
+    return false;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void LightCacheStore::Save( bool hasNewFiles )
+{
+    PROFILE_FUNCTION;
+
+    // Release the store, which is loaded again on next use (it can't be
+    // replaced on some platforms while mapped)
+    const bool needsRewrite = m_NeedsRewrite;
+    Close();
+
+    if ( ( hasNewFiles == false ) && ( needsRewrite == false ) )
+    {
+        return; // Nothing to do
+    }
+
+    // Gather files with results that can be stored
+    Array< IncludedFile * > allFiles;
+    for ( const IncludedFileBucket & bucket : g_AllIncludedFiles )
+    {
+        bucket.m_HashSet.GetAll( allFiles );
+    }
+    Array< IncludedFile * > files( allFiles.GetSize() );
+    for ( IncludedFile * file : allFiles )
+    {
+        if ( file->m_LastWriteTime != 0 )
+        {
+            files.Append( file );
+        }
+    }
+
+    // Only one build can update the store at a time. Builds finishing at the
+    // same time wait briefly, but it's not worth delaying a build for long.
+    SystemMutex mutex( LIGHTCACHE_STORE_MUTEX_NAME );
+    uint32_t attempts = 0;
+    while ( mutex.TryLock() == false )
+    {
+        if ( ++attempts == 100 )
+        {
+            FLOG_VERBOSE( "LightCache store is locked by another build - results not stored" );
+            return;
+        }
+        Thread::Sleep( 10 );
+    }
+
+    // Append new files to the store, or replace it entirely if damaged or
+    // too large (keeping only files used by this build)
+    bool rewrite = needsRewrite;
+    if ( rewrite == false )
+    {
+        AStackString<> fileName;
+        GetFileName( fileName );
+        FileIO::FileInfo info;
+        if ( ( FileIO::GetFileInfo( fileName, info ) == false ) ||
+             ( info.m_Size > LIGHTCACHE_STORE_MAX_SIZE ) )
+        {
+            rewrite = true;
+        }
+    }
+    Write( files, rewrite );
+}
+
+// Close
+//------------------------------------------------------------------------------
+void LightCacheStore::Close()
+{
+    m_File.Close();
+    m_Entries.Destruct();
+    m_NeedsRewrite = false;
+    AtomicStoreRelease( &m_Loaded, false );
+}
+
+// Load
+//------------------------------------------------------------------------------
+void LightCacheStore::Load()
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+    if ( AtomicLoadAcquire( &m_Loaded ) )
+    {
+        return; // Another thread loaded it
+    }
+
+    AStackString<> fileName;
+    GetFileName( fileName );
+
+    // A missing store is created by the first build to save one
+    if ( m_File.Open( fileName.Get() ) )
+    {
+        const char * data = static_cast< const char * >( m_File.GetData() );
+        const size_t size = m_File.GetSize();
+
+        const Header * header = reinterpret_cast< const Header * >( data );
+        if ( ( size < sizeof( Header ) ) ||
+             ( header->m_Magic != Header::MAGIC ) ||
+             ( header->m_Version != Header::VERSION ) )
+        {
+            m_NeedsRewrite = true;
+        }
+        else
+        {
+            // Index the records. A build which was terminated while appending
+            // can leave an incomplete record, after which nothing can be used.
+            size_t pos = sizeof( Header );
+            while ( pos < size )
+            {
+                const Record * record = reinterpret_cast< const Record * >( data + pos );
+                const size_t payloadOffset = ( pos + sizeof( Record ) );
+                if ( ( payloadOffset > size ) ||
+                     ( record->m_PayloadSize > ( size - payloadOffset ) ) ||
+                     ( record->m_Checksum != xxHash3::Calc64( data + payloadOffset, record->m_PayloadSize ) ) )
+                {
+                    m_NeedsRewrite = true;
+                    break;
+                }
+                m_Entries.Append( Entry{ record->m_FileNameHash, payloadOffset } );
+                pos = ( payloadOffset + record->m_PayloadSize );
+            }
+            m_Entries.Sort();
+        }
+    }
+
+    AtomicStoreRelease( &m_Loaded, true );
+}
+
+// Write
+//------------------------------------------------------------------------------
+bool LightCacheStore::Write( const Array< IncludedFile * > & files, bool rewrite )
+{
+    MemoryStream stream;
+    if ( rewrite )
+    {
+        const Header header;
+        stream.Write( &header, sizeof( Header ) );
+    }
+    for ( const IncludedFile * file : files )
+    {
+        if ( ( rewrite == false ) && file->m_InStore )
+        {
+            continue;
+        }
+
+        // Write payload after space for the record
+        const size_t recordPos = stream.GetSize();
+        Record record;
+        stream.Write( &record, sizeof( Record ) );
+        Serialize( stream, *file );
+        stream.AlignWrite( sizeof( uint64_t ) );
+
+        // Complete the record
+        const char * payload = ( static_cast< const char * >( stream.GetData() ) + recordPos + sizeof( Record ) );
+        record.m_FileNameHash = file->m_FileNameHash;
+        record.m_PayloadSize = (uint32_t)( stream.GetSize() - recordPos - sizeof( Record ) );
+        record.m_Checksum = xxHash3::Calc64( payload, record.m_PayloadSize );
+        record.m_Padding = 0;
+        memcpy( static_cast< char * >( stream.GetDataMutable() ) + recordPos, &record, sizeof( Record ) );
+    }
+    if ( stream.GetSize() == 0 )
+    {
+        return true; // Nothing new
+    }
+
+    AStackString<> fileName;
+    GetFileName( fileName );
+    if ( FileIO::EnsurePathExistsForFile( fileName ) == false )
+    {
+        return false;
+    }
+
+    if ( rewrite )
+    {
+        // Replace the file, so builds which have the old one mapped are not affected
+        AStackString<> tmpFileName( fileName );
+        tmpFileName += ".tmp";
+        FileStream fs;
+        if ( ( fs.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+             ( fs.WriteBuffer( stream.GetData(), stream.GetSize() ) != stream.GetSize() ) )
+        {
+            return false;
+        }
+        fs.Close();
+        if ( FileIO::FileMove( tmpFileName, fileName ) == false )
+        {
+            FileIO::FileDelete( tmpFileName.Get() );
+            return false;
+        }
+    }
+    else
+    {
+        FileStream fs;
+        if ( ( fs.Open( fileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == false ) ||
+             ( fs.WriteBuffer( stream.GetData(), stream.GetSize() ) != stream.GetSize() ) )
+        {
+            return false;
+        }
+    }
+
+    // Don't store these again
+    for ( IncludedFile * file : files )
+    {
+        file->m_InStore = true;
+    }
+    return true;
+}
+
+// GetFileName
+//------------------------------------------------------------------------------
+/*static*/ void LightCacheStore::GetFileName( AString & outFileName )
+{
+    if ( g_LightCacheStorePathOverride.IsEmpty() == false )
+    {
+        outFileName = g_LightCacheStorePathOverride;
+    }
+    else
+    {
+        VERIFY( FBuild::GetTempDir( outFileName ) );
+        #if defined( __WINDOWS__ )
+            outFileName += ".fbuild.tmp\\";
+        #else
+            outFileName += "_fbuild.tmp/";
+        #endif
+    }
+    outFileName += LIGHTCACHE_STORE_FILE_NAME;
+}
+
+// Serialize
+//------------------------------------------------------------------------------
+/*static*/ void LightCacheStore::Serialize( MemoryStream & stream, const IncludedFile & file )
+{
+    stream.Write( file.m_FileName );
+    stream.Write( file.m_LastWriteTime );
+    stream.Write( file.m_FileSize );
+    stream.Write( file.m_ContentHash );
+    stream.Write( (uint32_t)file.m_Includes.GetSize() );
+    for ( const IncludedFile::Include & include : file.m_Includes )
+    {
+        stream.Write( include.m_Include );
+        stream.Write( (uint8_t)include.m_Type );
+    }
+    stream.Write( (uint32_t)file.m_IncludeDefines.GetSize() );
+    for ( const IncludeDefine * define : file.m_IncludeDefines )
+    {
+        stream.Write( define->m_Macro );
+        stream.Write( define->m_Include );
+        stream.Write( (uint8_t)define->m_Type );
+    }
+    stream.Write( file.m_NonIncludeDefines );
+}
+
+// Deserialize
+//------------------------------------------------------------------------------
+/*static*/ bool LightCacheStore::Deserialize( ConstMemoryStream & stream, IncludedFile & file )
+{
+    // File name, time and size have already been read
+    uint32_t numIncludes;
+    if ( ( stream.Read( file.m_ContentHash ) == false ) ||
+         ( stream.Read( numIncludes ) == false ) )
+    {
+        return false;
+    }
+    file.m_Includes.SetCapacity( numIncludes );
+    for ( uint32_t i = 0; i < numIncludes; ++i )
+    {
+        AString include;
+        uint8_t type;
+        if ( ( stream.Read( include ) == false ) ||
+             ( stream.Read( type ) == false ) )
+        {
+            return false;
+        }
+        file.m_Includes.EmplaceBack( Move( include ), (IncludeType)type );
+    }
+    uint32_t numIncludeDefines;
+    if ( stream.Read( numIncludeDefines ) == false )
+    {
+        return false;
+    }
+    for ( uint32_t i = 0; i < numIncludeDefines; ++i )
+    {
+        AStackString<> macro;
+        AStackString<> include;
+        uint8_t type;
+        if ( ( stream.Read( macro ) == false ) ||
+             ( stream.Read( include ) == false ) ||
+             ( stream.Read( type ) == false ) )
+        {
+            return false;
+        }
+        file.m_IncludeDefines.Append( FNEW( IncludeDefine( macro, include, (IncludeType)type ) ) );
+    }
+    return stream.Read( file.m_NonIncludeDefines );
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 LightCache::LightCache()
     : m_IncludePaths( 32 )
     , m_AllIncludedFiles( 2048 )
     , m_IncludeStack( 32 )
+    , m_NumFilesFromStore( 0 )
 {
 }
 
@@ -259,7 +726,7 @@ LightCache::~LightCache() = default;
 
 // Hash
 //------------------------------------------------------------------------------
-bool LightCache::Hash( ObjectNode * node,
+bool LightCache::Hash( const AString & rootFileName,
                        const AString & compilerArgs,
                        uint64_t & outSourceHash,
                        Array< AString > & outIncludes )
@@ -297,7 +764,6 @@ bool LightCache::Hash( ObjectNode * node,
         ProcessInclude( forceInclude, IncludeType::QUOTE );
     }
 
-    const AString & rootFileName = node->GetSourceFile()->GetName();
     ProcessInclude( rootFileName, IncludeType::QUOTE );
 
     // Handle missing root file
@@ -330,6 +796,15 @@ bool LightCache::Hash( ObjectNode * node,
     return true;
 }
 
+// SaveCachedFiles
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::SaveCachedFiles()
+{
+    const bool hasNewFiles = AtomicLoadRelaxed( &g_LightCacheHasNewFiles );
+    AtomicStoreRelaxed( &g_LightCacheHasNewFiles, false );
+    g_LightCacheStore.Save( hasNewFiles );
+}
+
 // ClearCachedFiles
 //------------------------------------------------------------------------------
 /*static*/ void LightCache::ClearCachedFiles()
@@ -338,6 +813,20 @@ bool LightCache::Hash( ObjectNode * node,
     {
         bucket.Destruct();
     }
+    g_LightCacheStore.Close();
+    AtomicStoreRelaxed( &g_LightCacheHasNewFiles, false );
+}
+
+// SetStorePathForTests
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::SetStorePathForTests( const AString & path )
+{
+    g_LightCacheStorePathOverride = path;
+    if ( ( g_LightCacheStorePathOverride.IsEmpty() == false ) &&
+         ( g_LightCacheStorePathOverride.EndsWith( NATIVE_SLASH ) == false ) )
+    {
+        g_LightCacheStorePathOverride += NATIVE_SLASH;
+    }
 }
 
 // Parse
@@ -887,6 +1376,9 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
     newFile->m_FileName = fileName;
     newFile->m_Exists = false;
     newFile->m_ContentHash = 0;
+    newFile->m_LastWriteTime = 0;
+    newFile->m_FileSize = 0;
+    newFile->m_InStore = false;
 
     // Try to open the new file
     FileStream f;
@@ -896,9 +1388,29 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
         return bucket.m_HashSet.Insert( newFile );
     }
 
-    // File exists - parse it
-    newFile->m_Exists = true;
-    Parse( newFile, f );
+    // Re-use results from a previous build if the file is unchanged
+    // (checked via the open handle to avoid another lookup by path)
+    const uint64_t lastWriteTime = f.GetLastWriteTime();
+    const uint64_t fileSize = f.GetFileSize();
+    if ( ( lastWriteTime != 0 ) && g_LightCacheStore.Retrieve( lastWriteTime, fileSize, *newFile ) )
+    {
+        ++m_NumFilesFromStore;
+    }
+    else
+    {
+        // File exists - parse it
+        newFile->m_Exists = true;
+        const uint32_t errorsLength = m_Errors.GetLength();
+        Parse( newFile, f );
+
+        // Results can be stored for future builds if the file was understood
+        if ( ( lastWriteTime != 0 ) && ( m_Errors.GetLength() == errorsLength ) )
+        {
+            newFile->m_LastWriteTime = lastWriteTime;
+            newFile->m_FileSize = fileSize;
+            AtomicStoreRelaxed( &g_LightCacheHasNewFiles, true );
+        }
+    }
 
     // Store to shared cache
     const IncludedFile * retval = bucket.m_HashSet.Insert( newFile );
@@ -17,7 +17,6 @@ class AString;
 class FileStream;
 class IncludedFile;
 class IncludeDefine;
-class ObjectNode;
 enum class IncludeType : uint8_t;
 
 // LightCache
@@ -28,7 +27,7 @@ public:
     LightCache();
     ~LightCache();
 
-    bool Hash( ObjectNode * node,                // Object to be compiled
+    bool Hash( const AString & rootFileName,     // Source file to be compiled
                const AString & compilerArgs,     // Args to extract include paths from
                uint64_t & outSourceHash,         // Resulting hash of source code
                Array< AString > & outIncludes ); // Discovered dependencies
@@ -36,7 +35,13 @@ public:
     // Get text description of problem(s) if Hash() fails
     const AString & GetErrors() const { return m_Errors; }
 
+    // Number of files whose parse results came from a previous build
+    uint32_t GetNumFilesFromStore() const { return m_NumFilesFromStore; }
+
+    // Store results of files parsed by this build for use by future builds
+    static void SaveCachedFiles();
     static void ClearCachedFiles();
+    static void SetStorePathForTests( const AString & path ); // Empty to restore the default
 
 protected:
     void                    Parse( IncludedFile * file, FileStream & f );
@@ -71,6 +76,7 @@ protected:
     Array< const IncludedFile * >   m_IncludeStack;             // Stack of includes, for file relative checks
     Array< const IncludeDefine * >  m_IncludeDefines;           // Macros describing files to include
     AString                         m_Errors;                   // Did we encounter some code we couldn't parse?
+    uint32_t                        m_NumFilesFromStore;        // Files not parsed due to results from a previous build
 };
 
 //------------------------------------------------------------------------------
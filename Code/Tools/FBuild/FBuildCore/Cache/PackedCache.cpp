@@ -0,0 +1,998 @@
+// PackedCache - Cache storing entries in shared pack files with an index
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "PackedCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/SystemMutex.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// Defines
+//------------------------------------------------------------------------------
+// Entries are spread over a number of shards, each with a pack file holding
+// the entries and an index file locating them. Files are only appended to,
+// except when trimming, which replaces them.
+#define PACKEDCACHE_DIR             "Packed"
+#define PACKEDCACHE_MUTEX_NAME      "Global\\FASTBuild_PackedCache_%08X_%02X"
+#define PACKEDCACHE_LOCK_TIMEOUT_MS ( 10 * 1000 )
+#define PACKEDCACHE_SHARD_MASK      ( PackedCache::NUM_SHARDS - 1 )
+
+// PackedCacheIndexHeader
+//------------------------------------------------------------------------------
+class PackedCacheIndexHeader
+{
+public:
+    enum : uint32_t { MAGIC = 'F' | ( 'B' << 8 ) | ( 'P' << 16 ) | ( 'I' << 24 ) };
+    enum : uint32_t { VERSION = 1 };
+
+    bool IsValid() const { return ( m_Magic == MAGIC ) && ( m_Version == VERSION ) && ( m_Generation != 0 ); }
+
+    uint32_t    m_Magic         = MAGIC;
+    uint32_t    m_Version       = VERSION;
+    uint64_t    m_Generation    = 0;    // Changes when the shard is replaced
+};
+
+// PackedCacheIndexRecord
+//------------------------------------------------------------------------------
+class PackedCacheIndexRecord
+{
+public:
+    enum : uint32_t
+    {
+        ENTRY   = 1,    // Entry was written to the pack
+        TOUCH   = 2,    // Entry was retrieved
+    };
+
+    void        UpdateChecksum()    { m_Checksum = CalcChecksum(); }
+    bool        IsValid() const     { return ( m_Checksum == CalcChecksum() ); }
+    uint64_t    CalcChecksum() const { return xxHash3::Calc64( this, sizeof( PackedCacheIndexRecord ) - sizeof( m_Checksum ) ); }
+
+    uint64_t    m_KeyHash   = 0;
+    uint64_t    m_Offset    = 0;    // ENTRY: Of the entry in the pack file
+    uint64_t    m_Size      = 0;    // ENTRY: Of the entry in the pack file (including header)
+    uint64_t    m_Time      = 0;    // ENTRY: When written, TOUCH: When retrieved
+    uint32_t    m_Type      = 0;
+    uint32_t    m_Padding   = 0;
+    uint64_t    m_Checksum  = 0;    // Of the above, to skip incomplete records
+};
+
+// PackedCacheEntryHeader
+//------------------------------------------------------------------------------
+// Each entry in a pack file is a header, followed by the cache id and the data
+class PackedCacheEntryHeader
+{
+public:
+    uint64_t    m_KeyHash       = 0;
+    uint64_t    m_DataSize      = 0;
+    uint64_t    m_DataChecksum  = 0;
+    uint32_t    m_CacheIdLength = 0;
+    uint32_t    m_Padding       = 0;
+};
+
+// PackedCacheEntry
+//------------------------------------------------------------------------------
+// Location of an entry in a pack file, held in a shard's hash table
+class PackedCacheEntry
+{
+public:
+    uint64_t    m_KeyHash       = 0;    // 0 for empty slots
+    uint64_t    m_Offset        = 0;
+    uint64_t    m_Size          = 0;
+    uint64_t    m_WriteTime     = 0;
+    uint64_t    m_AccessTime    = 0;
+};
+
+// OldestAccessTimeSorter
+//------------------------------------------------------------------------------
+class OldestAccessTimeSorter
+{
+public:
+    bool operator () ( const PackedCacheEntry & a, const PackedCacheEntry & b ) const
+    {
+        return ( a.m_AccessTime < b.m_AccessTime );
+    }
+};
+
+// ShardKeySorter
+//------------------------------------------------------------------------------
+class ShardKeySorter
+{
+public:
+    bool operator () ( uint64_t a, uint64_t b ) const
+    {
+        const uint64_t shardA = ( a & PACKEDCACHE_SHARD_MASK );
+        const uint64_t shardB = ( b & PACKEDCACHE_SHARD_MASK );
+        return ( shardA != shardB ) ? ( shardA < shardB ) : ( a < b );
+    }
+};
+
+// PackedCacheShard
+//------------------------------------------------------------------------------
+class PackedCacheShard
+{
+public:
+    void Init( const AString & cachePath, uint32_t index );
+
+    bool Publish( uint64_t keyHash, const AString & cacheId, const void * data, size_t dataSize );
+    bool Retrieve( uint64_t keyHash, const AString & cacheId, void * & data, size_t & dataSize );
+    bool RetrieveStream( uint64_t keyHash, const AString & cacheId, FileStream & outPack, uint64_t & outSize );
+    void SaveAccessTimes();
+    void GetEntries( Array< PackedCacheEntry > & outEntries );
+    bool Remove( const uint64_t * keysBegin, const uint64_t * keysEnd, uint64_t & outRemovedSize, uint32_t & outRemovedCount );
+
+private:
+    bool Lock( SystemMutex & mutex ) const;
+    bool OpenIndexForAppend( FileStream & outIndex, bool createIfInvalid ) const;
+    void UpdateIndex();
+    void ResetIndex();
+    const PackedCacheEntry * Find( uint64_t keyHash ) const;
+    void Insert( const PackedCacheIndexRecord & record );
+    bool FindEntry( uint64_t keyHash, PackedCacheEntry & outEntry );
+    bool FindReplacedEntry( uint64_t keyHash, PackedCacheEntry & inOutEntry );
+    bool OpenEntry( const PackedCacheEntry & entry, const AString & cacheId, FileStream & outPack, PackedCacheEntryHeader & outHeader ) const;
+    bool ReadEntry( const PackedCacheEntry & entry, const AString & cacheId, void * & data, size_t & dataSize ) const;
+    static bool ReplaceFile( const AString & tmpFileName, const AString & fileName );
+    static uint64_t NewGeneration();
+
+    Mutex                       m_Mutex;
+    AString                     m_PackFileName;
+    AString                     m_IndexFileName;
+    AString                     m_MutexName;        // Shared by all processes using the cache
+    uint64_t                    m_Generation = 0;   // Of the index file loaded
+    uint64_t                    m_IndexPos = 0;     // Bytes of the index file processed
+    Array< PackedCacheEntry >   m_Table;            // Open addressing hash table, with a power of 2 size
+    size_t                      m_NumEntries = 0;
+    Array< uint64_t >           m_Retrieved;        // Recorded as accessed at Shutdown
+};
+
+// Init
+//------------------------------------------------------------------------------
+void PackedCacheShard::Init( const AString & cachePath, uint32_t index )
+{
+    m_PackFileName.Format( "%s%02X.pack", cachePath.Get(), index );
+    m_IndexFileName.Format( "%s%02X.idx", cachePath.Get(), index );
+    m_MutexName.Format( PACKEDCACHE_MUTEX_NAME, xxHash::Calc32( cachePath ), index );
+}
+
+// Publish
+//------------------------------------------------------------------------------
+bool PackedCacheShard::Publish( uint64_t keyHash, const AString & cacheId, const void * data, size_t dataSize )
+{
+    // Publishing threads in this process take turns, then other processes
+    MutexHolder mh( m_Mutex );
+    SystemMutex mutex( m_MutexName.Get() );
+    if ( Lock( mutex ) == false )
+    {
+        return false;
+    }
+
+    FileStream index;
+    if ( OpenIndexForAppend( index, true ) == false )
+    {
+        return false;
+    }
+
+    // Append the entry to the pack
+    FileStream pack;
+    if ( pack.Open( m_PackFileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == false )
+    {
+        return false;
+    }
+    PackedCacheEntryHeader header;
+    header.m_KeyHash = keyHash;
+    header.m_DataSize = dataSize;
+    header.m_DataChecksum = xxHash3::Calc64( data, dataSize );
+    header.m_CacheIdLength = cacheId.GetLength();
+    const uint64_t offset = pack.GetFileSize();
+    if ( ( pack.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( pack.WriteBuffer( cacheId.Get(), cacheId.GetLength() ) != cacheId.GetLength() ) ||
+         ( pack.WriteBuffer( data, dataSize ) != dataSize ) )
+    {
+        return false; // Partially written entry is never indexed
+    }
+    pack.Close();
+
+    // Index it
+    PackedCacheIndexRecord record;
+    record.m_KeyHash = keyHash;
+    record.m_Offset = offset;
+    record.m_Size = ( sizeof( header ) + cacheId.GetLength() + dataSize );
+    record.m_Time = Time::GetCurrentFileTime();
+    record.m_Type = PackedCacheIndexRecord::ENTRY;
+    record.UpdateChecksum();
+    return ( index.WriteBuffer( &record, sizeof( record ) ) == sizeof( record ) );
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool PackedCacheShard::Retrieve( uint64_t keyHash, const AString & cacheId, void * & data, size_t & dataSize )
+{
+    PackedCacheEntry entry;
+    if ( FindEntry( keyHash, entry ) == false )
+    {
+        return false;
+    }
+    if ( ReadEntry( entry, cacheId, data, dataSize ) == false )
+    {
+        // Another process may have replaced the shard (trimmed the cache)
+        if ( ( FindReplacedEntry( keyHash, entry ) == false ) ||
+             ( ReadEntry( entry, cacheId, data, dataSize ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_Retrieved.Append( keyHash );
+    return true;
+}
+
+// RetrieveStream
+//------------------------------------------------------------------------------
+bool PackedCacheShard::RetrieveStream( uint64_t keyHash, const AString & cacheId, FileStream & outPack, uint64_t & outSize )
+{
+    PackedCacheEntry entry;
+    if ( FindEntry( keyHash, entry ) == false )
+    {
+        return false;
+    }
+    PackedCacheEntryHeader header;
+    if ( OpenEntry( entry, cacheId, outPack, header ) == false )
+    {
+        // Another process may have replaced the shard (trimmed the cache)
+        outPack.Close();
+        if ( ( FindReplacedEntry( keyHash, entry ) == false ) ||
+             ( OpenEntry( entry, cacheId, outPack, header ) == false ) )
+        {
+            return false;
+        }
+    }
+
+    // The data checksum is not verified here, as that would require reading the
+    // data twice. Callers reading a stream must validate what they read.
+    outSize = header.m_DataSize;
+
+    MutexHolder mh( m_Mutex );
+    m_Retrieved.Append( keyHash );
+    return true;
+}
+
+// SaveAccessTimes
+//------------------------------------------------------------------------------
+void PackedCacheShard::SaveAccessTimes()
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_Retrieved.IsEmpty() )
+    {
+        return;
+    }
+
+    // Access times only affect which entries are trimmed first, so they are
+    // not worth waiting long for or creating an index for
+    SystemMutex mutex( m_MutexName.Get() );
+    FileStream index;
+    if ( mutex.TryLock() && OpenIndexForAppend( index, false ) )
+    {
+        Array< PackedCacheIndexRecord > records( m_Retrieved.GetSize() );
+        const uint64_t now = Time::GetCurrentFileTime();
+        for ( const uint64_t keyHash : m_Retrieved )
+        {
+            PackedCacheIndexRecord & record = records.EmplaceBack();
+            record.m_KeyHash = keyHash;
+            record.m_Time = now;
+            record.m_Type = PackedCacheIndexRecord::TOUCH;
+            record.UpdateChecksum();
+        }
+        index.WriteBuffer( records.Begin(), records.GetSize() * sizeof( PackedCacheIndexRecord ) );
+    }
+    m_Retrieved.Clear();
+}
+
+// GetEntries
+//------------------------------------------------------------------------------
+void PackedCacheShard::GetEntries( Array< PackedCacheEntry > & outEntries )
+{
+    MutexHolder mh( m_Mutex );
+    UpdateIndex();
+    for ( const PackedCacheEntry & entry : m_Table )
+    {
+        if ( entry.m_KeyHash != 0 )
+        {
+            outEntries.Append( entry );
+        }
+    }
+}
+
+// Remove
+//------------------------------------------------------------------------------
+bool PackedCacheShard::Remove( const uint64_t * keysBegin,
+                               const uint64_t * keysEnd,
+                               uint64_t & outRemovedSize,
+                               uint32_t & outRemovedCount )
+{
+    outRemovedSize = 0;
+    outRemovedCount = 0;
+
+    MutexHolder mh( m_Mutex );
+    SystemMutex mutex( m_MutexName.Get() );
+    if ( Lock( mutex ) == false )
+    {
+        return false;
+    }
+
+    // Entries may have been added since they were listed, and those are kept
+    UpdateIndex();
+
+    // Write the remaining entries to new files, which also discards index
+    // records and pack data which are no longer needed
+    FileStream oldPack;
+    if ( oldPack.Open( m_PackFileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    AStackString<> packTmpFileName( m_PackFileName );
+    packTmpFileName += ".tmp";
+    AStackString<> indexTmpFileName( m_IndexFileName );
+    indexTmpFileName += ".tmp";
+    FileStream pack;
+    FileStream index;
+    if ( ( pack.Open( packTmpFileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( index.Open( indexTmpFileName.Get(), FileStream::WRITE_ONLY ) == false ) )
+    {
+        return false;
+    }
+    PackedCacheIndexHeader header;
+    header.m_Generation = NewGeneration();
+    bool ok = ( index.WriteBuffer( &header, sizeof( header ) ) == sizeof( header ) );
+
+    const ShardKeySorter sorter;
+    Array< PackedCacheIndexRecord > touches;
+    Array< char > buffer;
+    for ( const PackedCacheEntry & entry : m_Table )
+    {
+        if ( ( entry.m_KeyHash == 0 ) || ( ok == false ) )
+        {
+            continue;
+        }
+
+        // Removed?
+        const uint64_t * key = keysBegin;
+        size_t count = (size_t)( keysEnd - keysBegin );
+        while ( count > 0 )
+        {
+            const size_t step = ( count / 2 );
+            if ( sorter( key[ step ], entry.m_KeyHash ) )
+            {
+                key += ( step + 1 );
+                count -= ( step + 1 );
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        if ( ( key != keysEnd ) && ( *key == entry.m_KeyHash ) )
+        {
+            outRemovedSize += entry.m_Size;
+            ++outRemovedCount;
+            continue;
+        }
+
+        // Copy the entry, dropping it if it's damaged
+        buffer.SetSize( (size_t)entry.m_Size );
+        const PackedCacheEntryHeader * entryHeader = reinterpret_cast< const PackedCacheEntryHeader * >( buffer.Begin() );
+        if ( ( entry.m_Size < sizeof( PackedCacheEntryHeader ) ) ||
+             ( oldPack.Seek( entry.m_Offset ) == false ) ||
+             ( oldPack.ReadBuffer( buffer.Begin(), entry.m_Size ) != entry.m_Size ) ||
+             ( entryHeader->m_KeyHash != entry.m_KeyHash ) )
+        {
+            outRemovedSize += entry.m_Size;
+            ++outRemovedCount;
+            continue;
+        }
+        PackedCacheIndexRecord record;
+        record.m_KeyHash = entry.m_KeyHash;
+        record.m_Offset = pack.Tell();
+        record.m_Size = entry.m_Size;
+        record.m_Time = entry.m_WriteTime;
+        record.m_Type = PackedCacheIndexRecord::ENTRY;
+        record.UpdateChecksum();
+        ok = ( pack.WriteBuffer( buffer.Begin(), entry.m_Size ) == entry.m_Size ) &&
+             ( index.WriteBuffer( &record, sizeof( record ) ) == sizeof( record ) );
+
+        if ( entry.m_AccessTime > entry.m_WriteTime )
+        {
+            PackedCacheIndexRecord & touch = touches.EmplaceBack();
+            touch.m_KeyHash = entry.m_KeyHash;
+            touch.m_Time = entry.m_AccessTime;
+            touch.m_Type = PackedCacheIndexRecord::TOUCH;
+            touch.UpdateChecksum();
+        }
+    }
+    if ( touches.IsEmpty() == false )
+    {
+        const uint64_t touchesSize = ( touches.GetSize() * sizeof( PackedCacheIndexRecord ) );
+        ok = ok && ( index.WriteBuffer( touches.Begin(), touchesSize ) == touchesSize );
+    }
+    oldPack.Close();
+    pack.Close();
+    index.Close();
+
+    // Replace the pack, then the index. Retrieval from a pack which doesn't
+    // match the index fails the entry checks, so it's never incorrect.
+    if ( ( ok == false ) ||
+         ( ReplaceFile( packTmpFileName, m_PackFileName ) == false ) ||
+         ( ReplaceFile( indexTmpFileName, m_IndexFileName ) == false ) )
+    {
+        FileIO::FileDelete( packTmpFileName.Get() );
+        FileIO::FileDelete( indexTmpFileName.Get() );
+        ResetIndex();
+        return false;
+    }
+
+    ResetIndex();
+    return true;
+}
+
+// Lock
+//------------------------------------------------------------------------------
+bool PackedCacheShard::Lock( SystemMutex & mutex ) const
+{
+    const Timer timer;
+    while ( mutex.TryLock() == false )
+    {
+        if ( timer.GetElapsedMS() > PACKEDCACHE_LOCK_TIMEOUT_MS )
+        {
+            FLOG_WARN( "Timed out waiting for cache lock '%s'", m_MutexName.Get() );
+            return false;
+        }
+        Thread::Sleep( 1 );
+    }
+    return true;
+}
+
+// OpenIndexForAppend
+//------------------------------------------------------------------------------
+bool PackedCacheShard::OpenIndexForAppend( FileStream & outIndex, bool createIfInvalid ) const
+{
+    // Check the existing index
+    bool valid = false;
+    {
+        FileStream index;
+        PackedCacheIndexHeader header;
+        valid = index.Open( m_IndexFileName.Get(), FileStream::READ_ONLY ) &&
+                ( index.ReadBuffer( &header, sizeof( header ) ) == sizeof( header ) ) &&
+                header.IsValid();
+    }
+
+    if ( valid == false )
+    {
+        if ( createIfInvalid == false )
+        {
+            return false;
+        }
+
+        // Start a new shard, discarding anything in a damaged or old pack
+        if ( FileIO::EnsurePathExistsForFile( m_IndexFileName ) == false )
+        {
+            return false;
+        }
+        FileStream pack;
+        if ( pack.Open( m_PackFileName.Get(), FileStream::WRITE_ONLY ) == false )
+        {
+            return false;
+        }
+        pack.Close();
+        PackedCacheIndexHeader header;
+        header.m_Generation = NewGeneration();
+        return outIndex.Open( m_IndexFileName.Get(), FileStream::WRITE_ONLY ) &&
+               ( outIndex.WriteBuffer( &header, sizeof( header ) ) == sizeof( header ) );
+    }
+
+    if ( outIndex.Open( m_IndexFileName.Get(), FileStream::WRITE_ONLY | FileStream::APPEND ) == false )
+    {
+        return false;
+    }
+
+    // A process terminated while appending can leave a partial record.
+    // Completing it with padding (which fails the record checksum) keeps
+    // subsequent records aligned.
+    const uint64_t partial = ( ( outIndex.GetFileSize() - sizeof( PackedCacheIndexHeader ) ) % sizeof( PackedCacheIndexRecord ) );
+    if ( partial != 0 )
+    {
+        const PackedCacheIndexRecord padding;
+        const uint64_t paddingSize = ( sizeof( PackedCacheIndexRecord ) - partial );
+        if ( outIndex.WriteBuffer( &padding, paddingSize ) != paddingSize )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// UpdateIndex
+//------------------------------------------------------------------------------
+void PackedCacheShard::UpdateIndex()
+{
+    FileStream index;
+    PackedCacheIndexHeader header;
+    if ( ( index.Open( m_IndexFileName.Get(), FileStream::READ_ONLY ) == false ) ||
+         ( index.ReadBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) )
+    {
+        ResetIndex(); // Missing or invalid shards are empty
+        return;
+    }
+
+    // Has the shard been replaced?
+    const uint64_t size = index.GetFileSize();
+    if ( ( header.m_Generation != m_Generation ) || ( size < m_IndexPos ) )
+    {
+        ResetIndex();
+        m_Generation = header.m_Generation;
+        m_IndexPos = sizeof( header );
+    }
+
+    // Read whole records added since the last update
+    const size_t numRecords = (size_t)( ( size - m_IndexPos ) / sizeof( PackedCacheIndexRecord ) );
+    if ( numRecords == 0 )
+    {
+        return;
+    }
+    Array< PackedCacheIndexRecord > records;
+    records.SetSize( numRecords );
+    const uint64_t recordsSize = ( numRecords * sizeof( PackedCacheIndexRecord ) );
+    if ( ( index.Seek( m_IndexPos ) == false ) ||
+         ( index.ReadBuffer( records.Begin(), recordsSize ) != recordsSize ) )
+    {
+        return;
+    }
+    for ( const PackedCacheIndexRecord & record : records )
+    {
+        if ( record.IsValid() )
+        {
+            Insert( record );
+        }
+    }
+    m_IndexPos += recordsSize;
+}
+
+// ResetIndex
+//------------------------------------------------------------------------------
+void PackedCacheShard::ResetIndex()
+{
+    m_Generation = 0;
+    m_IndexPos = 0;
+    m_Table.Destruct();
+    m_NumEntries = 0;
+}
+
+// Find
+//------------------------------------------------------------------------------
+const PackedCacheEntry * PackedCacheShard::Find( uint64_t keyHash ) const
+{
+    if ( m_Table.IsEmpty() )
+    {
+        return nullptr;
+    }
+
+    // Low bits select the shard, so use the others for the slot
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    for ( size_t slot = (size_t)( keyHash >> 8 ) & mask; ; slot = ( slot + 1 ) & mask )
+    {
+        const PackedCacheEntry & entry = m_Table[ slot ];
+        if ( entry.m_KeyHash == keyHash )
+        {
+            return &entry;
+        }
+        if ( entry.m_KeyHash == 0 )
+        {
+            return nullptr;
+        }
+    }
+}
+
+// Insert
+//------------------------------------------------------------------------------
+void PackedCacheShard::Insert( const PackedCacheIndexRecord & record )
+{
+    // Grow to keep the table at most 3/4 full
+    if ( ( ( m_NumEntries + 1 ) * 4 ) > ( m_Table.GetSize() * 3 ) )
+    {
+        Array< PackedCacheEntry > oldTable( Move( m_Table ) );
+        m_Table.SetSize( oldTable.IsEmpty() ? 1024 : ( oldTable.GetSize() * 2 ) );
+        const size_t mask = ( m_Table.GetSize() - 1 );
+        for ( const PackedCacheEntry & entry : oldTable )
+        {
+            if ( entry.m_KeyHash != 0 )
+            {
+                size_t slot = (size_t)( entry.m_KeyHash >> 8 ) & mask;
+                while ( m_Table[ slot ].m_KeyHash != 0 )
+                {
+                    slot = ( slot + 1 ) & mask;
+                }
+                m_Table[ slot ] = entry;
+            }
+        }
+    }
+
+    const size_t mask = ( m_Table.GetSize() - 1 );
+    size_t slot = (size_t)( record.m_KeyHash >> 8 ) & mask;
+    while ( ( m_Table[ slot ].m_KeyHash != 0 ) && ( m_Table[ slot ].m_KeyHash != record.m_KeyHash ) )
+    {
+        slot = ( slot + 1 ) & mask;
+    }
+    PackedCacheEntry & entry = m_Table[ slot ];
+
+    if ( record.m_Type == PackedCacheIndexRecord::ENTRY )
+    {
+        // Entries written again replace earlier ones
+        if ( entry.m_KeyHash == 0 )
+        {
+            entry.m_KeyHash = record.m_KeyHash;
+            ++m_NumEntries;
+        }
+        entry.m_Offset = record.m_Offset;
+        entry.m_Size = record.m_Size;
+        entry.m_WriteTime = record.m_Time;
+        entry.m_AccessTime = record.m_Time;
+    }
+    else if ( ( record.m_Type == PackedCacheIndexRecord::TOUCH ) && ( entry.m_KeyHash != 0 ) )
+    {
+        entry.m_AccessTime = Math::Max( entry.m_AccessTime, record.m_Time );
+    }
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+bool PackedCacheShard::FindEntry( uint64_t keyHash, PackedCacheEntry & outEntry )
+{
+    // Read any index records added by other processes since the index was last
+    // read if the entry is not found
+    MutexHolder mh( m_Mutex );
+    const PackedCacheEntry * found = Find( keyHash );
+    if ( found == nullptr )
+    {
+        UpdateIndex();
+        found = Find( keyHash );
+        if ( found == nullptr )
+        {
+            return false;
+        }
+    }
+    outEntry = *found;
+    return true;
+}
+
+// FindReplacedEntry
+//------------------------------------------------------------------------------
+bool PackedCacheShard::FindReplacedEntry( uint64_t keyHash, PackedCacheEntry & inOutEntry )
+{
+    MutexHolder mh( m_Mutex );
+    UpdateIndex();
+    const PackedCacheEntry * found = Find( keyHash );
+    if ( ( found == nullptr ) || ( found->m_Offset == inOutEntry.m_Offset ) )
+    {
+        return false;
+    }
+    inOutEntry = *found;
+    return true;
+}
+
+// OpenEntry
+//------------------------------------------------------------------------------
+bool PackedCacheShard::OpenEntry( const PackedCacheEntry & entry, const AString & cacheId, FileStream & outPack, PackedCacheEntryHeader & outHeader ) const
+{
+    if ( ( outPack.Open( m_PackFileName.Get(), FileStream::READ_ONLY ) == false ) ||
+         ( outPack.Seek( entry.m_Offset ) == false ) ||
+         ( outPack.ReadBuffer( &outHeader, sizeof( outHeader ) ) != sizeof( outHeader ) ) )
+    {
+        return false;
+    }
+    if ( ( outHeader.m_KeyHash != entry.m_KeyHash ) ||
+         ( outHeader.m_CacheIdLength != cacheId.GetLength() ) ||
+         ( ( sizeof( outHeader ) + outHeader.m_CacheIdLength + outHeader.m_DataSize ) != entry.m_Size ) )
+    {
+        return false;
+    }
+
+    // Check the id in case of hash collisions
+    AStackString<> storedCacheId;
+    storedCacheId.SetLength( outHeader.m_CacheIdLength );
+    return ( outPack.ReadBuffer( storedCacheId.Get(), outHeader.m_CacheIdLength ) == outHeader.m_CacheIdLength ) &&
+           ( storedCacheId == cacheId );
+}
+
+// ReadEntry
+//------------------------------------------------------------------------------
+bool PackedCacheShard::ReadEntry( const PackedCacheEntry & entry, const AString & cacheId, void * & data, size_t & dataSize ) const
+{
+    FileStream pack;
+    PackedCacheEntryHeader header;
+    if ( OpenEntry( entry, cacheId, pack, header ) == false )
+    {
+        return false;
+    }
+
+    UniquePtr< char, FreeDeletor > mem( (char *)ALLOC( (size_t)header.m_DataSize ) );
+    if ( ( pack.ReadBuffer( mem.Get(), header.m_DataSize ) != header.m_DataSize ) ||
+         ( xxHash3::Calc64( mem.Get(), (size_t)header.m_DataSize ) != header.m_DataChecksum ) )
+    {
+        return false;
+    }
+    dataSize = (size_t)header.m_DataSize;
+    data = mem.ReleaseOwnership();
+    return true;
+}
+
+// ReplaceFile
+//------------------------------------------------------------------------------
+/*static*/ bool PackedCacheShard::ReplaceFile( const AString & tmpFileName, const AString & fileName )
+{
+    if ( FileIO::FileMove( tmpFileName, fileName ) )
+    {
+        return true;
+    }
+
+    // try to delete existing file and rename again
+    FileIO::FileDelete( fileName.Get() );
+    return FileIO::FileMove( tmpFileName, fileName );
+}
+
+// NewGeneration
+//------------------------------------------------------------------------------
+/*static*/ uint64_t PackedCacheShard::NewGeneration()
+{
+    const uint64_t values[] = { Time::GetCurrentFileTime(), (uint64_t)Timer::GetNow() };
+    const uint64_t generation = xxHash3::Calc64( values, sizeof( values ) );
+    return ( generation != 0 ) ? generation : 1;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+/*explicit*/ PackedCache::PackedCache()
+    : m_Shards( FNEW_ARRAY( PackedCacheShard[ NUM_SHARDS ] ) )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ PackedCache::~PackedCache()
+{
+    FDELETE_ARRAY m_Shards;
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Init( const AString & cachePath,
+                                    const AString & cachePathMountPoint,
+                                    bool /*cacheRead*/,
+                                    bool /*cacheWrite*/,
+                                    bool /*cacheVerbose*/,
+                                    const AString & /*pluginDLLConfig*/ )
+{
+    PROFILE_FUNCTION;
+
+    m_CachePath = cachePath;
+    PathUtils::EnsureTrailingSlash( m_CachePath );
+    m_CachePath += PACKEDCACHE_DIR;
+    PathUtils::EnsureTrailingSlash( m_CachePath );
+
+    // Check cache mount point if option is enabled
+    #if defined( __WINDOWS__ )
+        (void)cachePathMountPoint; // Not supported on Windows
+    #else
+        if ( cachePathMountPoint.IsEmpty() == false )
+        {
+            if ( FileIO::GetDirectoryIsMountPoint( cachePathMountPoint ) == false )
+            {
+                FLOG_WARN( "Caching disabled because '%s' is not a mount point", cachePathMountPoint.Get() );
+                return false;
+            }
+        }
+    #endif
+
+    if ( FileIO::EnsurePathExists( m_CachePath ) == false )
+    {
+        FLOG_WARN( "Cache inaccessible - Caching disabled (Path '%s')", m_CachePath.Get() );
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < NUM_SHARDS; ++i )
+    {
+        m_Shards[ i ].Init( m_CachePath, i );
+    }
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::Shutdown()
+{
+    PROFILE_FUNCTION;
+
+    // Record when retrieved entries were used, so they're trimmed last
+    for ( uint32_t i = 0; i < NUM_SHARDS; ++i )
+    {
+        m_Shards[ i ].SaveAccessTimes();
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    const uint64_t keyHash = xxHash3::Calc64( cacheId );
+    return GetShard( keyHash ).Publish( keyHash, cacheId, data, dataSize );
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+
+    const uint64_t keyHash = xxHash3::Calc64( cacheId );
+    return GetShard( keyHash ).Retrieve( keyHash, cacheId, data, dataSize );
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data );
+}
+
+// RetrieveStream
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize )
+{
+    outStream = nullptr;
+    outSize = 0;
+
+    const uint64_t keyHash = xxHash3::Calc64( cacheId );
+    UniquePtr< FileStream > pack( FNEW( FileStream ) );
+    if ( GetShard( keyHash ).RetrieveStream( keyHash, cacheId, *pack.Get(), outSize ) == false )
+    {
+        return false;
+    }
+    outStream = pack.ReleaseOwnership();
+    return true;
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::OutputInfo( bool /*showProgress*/ )
+{
+    Array< PackedCacheEntry > entries;
+    for ( uint32_t i = 0; i < NUM_SHARDS; ++i )
+    {
+        m_Shards[ i ].GetEntries( entries );
+    }
+
+    Array< FileIO::FileInfo > infos( entries.GetSize() );
+    for ( const PackedCacheEntry & entry : entries )
+    {
+        FileIO::FileInfo & info = infos.EmplaceBack();
+        info.m_LastWriteTime = entry.m_WriteTime;
+        info.m_Size = entry.m_Size;
+    }
+    Cache::OutputAgeSummary( infos );
+    return true;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    Array< PackedCacheEntry > entries;
+    for ( uint32_t i = 0; i < NUM_SHARDS; ++i )
+    {
+        m_Shards[ i ].GetEntries( entries );
+    }
+    uint64_t totalSize = 0;
+    for ( const PackedCacheEntry & entry : entries )
+    {
+        totalSize += entry.m_Size;
+    }
+    uint32_t numEntries = (uint32_t)entries.GetSize();
+    OUTPUT( " - Before: %u Entries @ %u MiB\n", numEntries, (uint32_t)( totalSize / MEGABYTE ) );
+
+    // Remove least recently used entries first
+    OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
+    const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
+    if ( limit < totalSize )
+    {
+        entries.Sort( OldestAccessTimeSorter() );
+        Array< uint64_t > keysToRemove;
+        uint64_t remainingSize = totalSize;
+        for ( const PackedCacheEntry & entry : entries )
+        {
+            if ( remainingSize <= limit )
+            {
+                break;
+            }
+            keysToRemove.Append( entry.m_KeyHash );
+            remainingSize -= entry.m_Size;
+        }
+        keysToRemove.Sort( ShardKeySorter() );
+
+        const Timer timer;
+        float lastProgressTime = 0.0f;
+        if ( showProgress )
+        {
+            FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+        }
+
+        // Rewrite each shard with entries to remove
+        const uint64_t * keysBegin = keysToRemove.Begin();
+        while ( keysBegin != keysToRemove.End() )
+        {
+            const uint64_t shard = ( *keysBegin & PACKEDCACHE_SHARD_MASK );
+            const uint64_t * keysEnd = keysBegin;
+            while ( ( keysEnd != keysToRemove.End() ) && ( ( *keysEnd & PACKEDCACHE_SHARD_MASK ) == shard ) )
+            {
+                ++keysEnd;
+            }
+
+            // Ok to fail if shard is in use
+            uint64_t removedSize = 0;
+            uint32_t removedCount = 0;
+            if ( m_Shards[ shard ].Remove( keysBegin, keysEnd, removedSize, removedCount ) )
+            {
+                totalSize -= Math::Min( removedSize, totalSize );
+                numEntries -= Math::Min( removedCount, numEntries );
+            }
+            keysBegin = keysEnd;
+
+            // Progress
+            if ( showProgress )
+            {
+                // Throttled to avoid perf impact
+                if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+                {
+                    const float perc = ( (float)( shard + 1 ) / (float)NUM_SHARDS ) * 100.0f;
+                    FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
+                    lastProgressTime = timer.GetElapsed();
+                }
+            }
+        }
+
+        if ( showProgress )
+        {
+            FLog::ClearProgress();
+        }
+    }
+
+    OUTPUT( " - After: %u Entries @ %u MiB\n", numEntries, (uint32_t)( totalSize / MEGABYTE ) );
+    return true;
+}
+
+// GetShard
+//------------------------------------------------------------------------------
+PackedCacheShard & PackedCache::GetShard( uint64_t keyHash ) const
+{
+    return m_Shards[ keyHash & PACKEDCACHE_SHARD_MASK ];
+}
+
+//------------------------------------------------------------------------------
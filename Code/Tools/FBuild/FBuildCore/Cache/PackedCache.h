@@ -0,0 +1,45 @@
+// PackedCache - Cache storing entries in shared pack files with an index
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ICache.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class PackedCacheShard;
+
+// PackedCache
+//------------------------------------------------------------------------------
+class PackedCache : public ICache
+{
+public:
+    explicit PackedCache();
+    virtual ~PackedCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool RetrieveStream( const AString & cacheId, IOStream * & outStream, uint64_t & outSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+
+    enum : uint32_t { NUM_SHARDS = 256 };
+
+private:
+    PackedCacheShard & GetShard( uint64_t keyHash ) const;
+
+    AString             m_CachePath;
+    PackedCacheShard *  m_Shards;
+};
+
+//------------------------------------------------------------------------------
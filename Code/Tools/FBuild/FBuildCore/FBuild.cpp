@@ -10,7 +10,9 @@
 #include "BFF/Functions/Function.h"
 #include "Cache/ICache.h"
 #include "Cache/Cache.h"
+#include "Cache/CacheDictionaries.h"
 #include "Cache/CachePlugin.h"
+#include "Cache/PackedCache.h"
 #include "Cache/LightCache.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
@@ -18,6 +20,7 @@
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/CompilerServers.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
 #include "WorkerPool/JobQueue.h"
@@ -60,6 +63,8 @@ FBuild::FBuild( const FBuildOptions & options )
     , m_JobQueue( nullptr )
     , m_Client( nullptr )
     , m_Cache( nullptr )
+    , m_CacheDictionaries( nullptr )
+    , m_CompilerServers( nullptr )
     , m_LastProgressOutputTime( 0.0f )
     , m_LastProgressCalcTime( 0.0f )
     , m_SmoothedProgressCurrent( 0.0f )
@@ -102,6 +107,8 @@ FBuild::FBuild( const FBuildOptions & options )
 
     Function::Create();
 
+    m_CompilerServers = FNEW( CompilerServers( &s_AbortBuild ) );
+
     NetworkStartupHelper::SetMainShutdownFlag( &s_AbortBuild );
 }
 
@@ -113,10 +120,12 @@ FBuild::~FBuild()
 
     Function::Destroy();
 
+    FDELETE m_CompilerServers;
     FDELETE m_DependencyGraph;
     FDELETE m_Client;
     FREE( m_EnvironmentString );
 
+    FDELETE m_CacheDictionaries;
     if ( m_Cache )
     {
         m_Cache->Shutdown();
@@ -130,6 +139,7 @@ FBuild::~FBuild()
         FLOG_ERROR( "Failed to restore working dir. Error: %s Dir: '%s'", LAST_ERROR_STR, m_OldWorkingDir.Get() );
     }
 
+    LightCache::SaveCachedFiles();
     LightCache::ClearCachedFiles();
 
     if ( BuildProfiler::IsValid() )
@@ -185,6 +195,12 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         }
     }
 
+    // Use changes recorded by a FileWatcher to avoid checking unchanged files
+    if ( m_FileWatcher.Connect( m_Options.GetFileWatcherSharedMemoryName().Get() ) )
+    {
+        FLOG_VERBOSE( "Using file changes recorded by FileWatcher" );
+    }
+
     m_DependencyGraph = NodeGraph::Initialize( bffFile, m_DependencyGraphFile.Get(), m_Options.m_ForceDBMigration_Debug );
 
     if ( m_DependencyGraph == nullptr )
@@ -201,6 +217,10 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         {
             m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
         }
+        else if ( settings->GetCachePacked() )
+        {
+            m_Cache = FNEW( PackedCache() );
+        }
         else
         {
             m_Cache = FNEW( Cache() );
@@ -218,6 +238,10 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
             FDELETE m_Cache;
             m_Cache = nullptr;
         }
+        else
+        {
+            m_CacheDictionaries = FNEW( CacheDictionaries( *m_Cache ) );
+        }
     }
 
     return true;
@@ -326,6 +350,18 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
 
     const Timer t;
 
+    // If the DB was loaded from (or already saved to) this file, just append
+    // what changed to its journal
+    if ( m_DependencyGraph->CanSaveJournal( nodeGraphDBFile ) )
+    {
+        if ( m_DependencyGraph->SaveJournal( nodeGraphDBFile ) )
+        {
+            FLOG_VERBOSE( "Saving DepGraph Journal Complete in %2.3fs", (double)t.GetElapsed() );
+            return true;
+        }
+        FLOG_VERBOSE( "Saving DepGraph Journal FAILED - Saving full DepGraph" );
+    }
+
     // serialize into memory first
     MemoryStream memoryStream( 32 * 1024 * 1024, 8 * 1024 * 1024 );
     m_DependencyGraph->Save( memoryStream, nodeGraphDBFile );
@@ -361,6 +397,15 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
     }
     fileStream.Close();
 
+    // Any previous journal is now obsolete and further changes can be journaled
+    AStackString<> journalFile;
+    NodeGraph::GetJournalFileName( nodeGraphDBFile, journalFile );
+    if ( FileIO::FileExists( journalFile.Get() ) )
+    {
+        FileIO::FileDelete( journalFile.Get() );
+    }
+    m_DependencyGraph->OnSaved( nodeGraphDBFile, memoryStream );
+
     FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
     return true;
 }
@@ -377,10 +422,15 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
 /*virtual*/ bool FBuild::Build( Node * nodeToBuild )
 {
     ASSERT( nodeToBuild );
+    ASSERT( m_DependencyGraph );
 
     AtomicStoreRelaxed( &s_StopBuild, false ); // allow multiple runs in same process
     AtomicStoreRelaxed( &s_AbortBuild, false ); // allow multiple runs in same process
 
+    // Retrieve input file timestamps in parallel up front
+    // (must be before JobQueue is created, as workers occupy the ThreadPool)
+    m_DependencyGraph->PrefetchFileStamps( nodeToBuild );
+
     // create worker threads
     m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads, m_ThreadPool ) );
 
@@ -429,6 +479,7 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
     }
 
     bool stopping( false );
+    float lastJournalTime = 0.0f;
 
     // keep doing build passes until completed/failed
     {
@@ -438,6 +489,19 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
             // process completed jobs
             m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
+            // journal completed work as we go, so it isn't lost if the build
+            // is interrupted (periodically, as each entry has a fixed cost)
+            if ( m_Options.m_SaveDBOnCompletion )
+            {
+                const float timeNow = m_Timer.GetElapsed();
+                if ( ( ( timeNow - lastJournalTime ) >= m_Options.m_DBJournalInterval ) &&
+                     m_DependencyGraph->CanSaveJournal( m_DependencyGraphFile.Get() ) )
+                {
+                    m_DependencyGraph->SaveJournalForCompletedNodes( m_DependencyGraphFile.Get() );
+                    lastJournalTime = timeNow;
+                }
+            }
+
             if ( !stopping )
             {
                 // do a sweep of the graph to create more jobs
@@ -506,6 +570,13 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         // wrap up/free any jobs that come from the last build pass
         m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
+        // If the build was stopped or failed, nodes can be left waiting on
+        // dependencies that will never complete
+        if ( nodeToBuild->GetState() != Node::UP_TO_DATE )
+        {
+            m_DependencyGraph->ClearPendingDependencies();
+        }
+
         FDELETE m_JobQueue;
         m_JobQueue = nullptr;
 
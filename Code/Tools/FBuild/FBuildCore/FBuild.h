@@ -10,6 +10,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageClient.h"
 #include "Helpers/FBuildStats.h"
+#include "Helpers/FileWatcher.h"
 
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Singleton.h"
@@ -19,7 +20,9 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CacheDictionaries;
 class Client;
+class CompilerServers;
 class Dependencies;
 class FileStream;
 class ICache;
@@ -52,6 +55,7 @@ public:
     void SaveDependencyGraph( MemoryStream & memorySteam, const char* nodeGraphDBFile ) const;
 
     const FBuildOptions & GetOptions() const { return m_Options; }
+    ThreadPool * GetThreadPool() const { return m_ThreadPool; }
 
     const AString & GetWorkingDir() const { return m_Options.GetWorkingDir(); }
 
@@ -92,6 +96,9 @@ public:
 
     BFFUserFunctions & GetUserFunctions() { return m_UserFunctions; }
 
+    // Changes recorded by a FileWatcher (if one is running for the working dir)
+    const FileWatcherClient & GetFileWatcher() const { return m_FileWatcher; }
+
     void GetLibEnvVar( AString & libEnvVar ) const;
 
     // stats - read access
@@ -106,6 +113,8 @@ public:
     static inline volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     inline ICache * GetCache() const { return m_Cache; }
+    inline CacheDictionaries * GetCacheDictionaries() const { return m_CacheDictionaries; }
+    inline CompilerServers * GetCompilerServers() const { return m_CompilerServers; }
 
     static bool GetTempDir( AString & outTempDir );
 
@@ -139,6 +148,8 @@ protected:
 
     AString m_DependencyGraphFile;
     ICache * m_Cache;
+    CacheDictionaries * m_CacheDictionaries;
+    CompilerServers * m_CompilerServers;
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -162,6 +173,7 @@ protected:
     Array< EnvironmentVarAndHash > m_ImportedEnvironmentVars;
     BFFFileExists m_FileExistsInfo;
     BFFUserFunctions m_UserFunctions;
+    FileWatcherClient m_FileWatcher;
 };
 
 //------------------------------------------------------------------------------
@@ -442,6 +442,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_WaitMode = true;
                 continue;
             }
+            else if ( thisArg == "-watch" )
+            {
+                m_WatchMode = true;
+                continue;
+            }
             else if ( thisArg == "-why" )
             {
                 m_ShowBuildReason = true;
@@ -611,6 +616,8 @@ void FBuildOptions::SetWorkingDir( const AString & path )
     m_ProcessMutexName.Format( "Global\\FASTBuild-0x%08x", m_WorkingDirHash );
     m_FinalProcessMutexName.Format( "Global\\FASTBuild_Final-0x%08x", m_WorkingDirHash );
     m_SharedMemoryName.Format( "FASTBuildSharedMemory_%08x", m_WorkingDirHash );
+    m_FileWatcherMutexName.Format( "Global\\FASTBuild_Watcher-0x%08x", m_WorkingDirHash );
+    m_FileWatcherSharedMemoryName.Format( "FASTBuildWatcher_%08x", m_WorkingDirHash );
 }
 
 // DisplayHelp
@@ -681,6 +688,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -vs               VisualStudio mode. Same as -ide.\n"
             " -wait             Wait for a previous build to complete before starting.\n"
             "                   (Slower than building both targets in one invocation).\n"
+            " -watch            (Linux) Run in the background, recording file changes so\n"
+            "                   builds in the same dir can skip checking unchanged files.\n"
             " -why              Show build reason for each item.\n"
             " -wrapper          (Windows) Spawn a sub-process to gracefully handle\n"
             "                   termination from Visual Studio.\n"
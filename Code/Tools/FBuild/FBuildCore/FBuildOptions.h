@@ -54,6 +54,7 @@ public:
     bool        m_StopOnFirstError                  = true;
     bool        m_FastCancel                        = true;
     bool        m_WaitMode                          = false;
+    bool        m_WatchMode                         = false;
     bool        m_DisplayTargetList                 = false;
     bool        m_ShowHiddenTargets                 = false;
     bool        m_DisplayDependencyDB               = false;
@@ -99,6 +100,7 @@ public:
     bool        m_FixupErrorPaths                   = false;
     bool        m_ForceDBMigration_Debug            = false; // Force migration even if bff has not changed (for tests)
     bool        m_ContinueAfterDBMove               = false;
+    float       m_DBJournalInterval                 = 1.0f; // Min seconds between journal entries during a build
     AString     m_DBFile;
 
     uint32_t    m_NumWorkerThreads                  = 0; // True default detected in constructor
@@ -108,6 +110,8 @@ public:
     inline const AString & GetMainProcessMutexName() const      { return m_ProcessMutexName; }
     inline const AString & GetFinalProcessMutexName( ) const    { return m_FinalProcessMutexName; }
     inline const AString & GetSharedMemoryName() const          { return m_SharedMemoryName; }
+    inline const AString & GetFileWatcherMutexName() const      { return m_FileWatcherMutexName; }
+    inline const AString & GetFileWatcherSharedMemoryName() const { return m_FileWatcherSharedMemoryName; }
 
 private:
     void DisplayHelp( const AString & programName ) const;
@@ -118,6 +122,8 @@ private:
     AString     m_ProcessMutexName;
     AString     m_FinalProcessMutexName;
     AString     m_SharedMemoryName;
+    AString     m_FileWatcherMutexName;
+    AString     m_FileWatcherSharedMemoryName;
 };
 
 //------------------------------------------------------------------------------
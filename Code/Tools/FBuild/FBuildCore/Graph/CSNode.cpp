@@ -12,10 +12,12 @@
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/Process/Process.h"
+#include "Core/Strings/AArenaString.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
@@ -201,8 +203,8 @@ CSNode::~CSNode() = default;
     }
 
     // capture all of the stdout and stderr
-    AString memOut;
-    AString memErr;
+    AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+    AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
     p.ReadAllData( memOut, memErr );
 
     // Get result
@@ -34,6 +34,7 @@ REFLECT_NODE_BEGIN( CompilerNode, Node, MetaNone() )
     REFLECT( m_UseLightCache,       "UseLightCache_Experimental", MetaOptional() )
     REFLECT( m_UseRelativePaths,    "UseRelativePaths_Experimental", MetaOptional() )
     REFLECT( m_SourceMapping,       "SourceMapping_Experimental", MetaOptional() )
+    REFLECT( m_CompilerServer,      "CompilerServer_Experimental", MetaOptional() + MetaFile() )
 
     // Internal
     REFLECT( m_CompilerFamilyEnum,  "CompilerFamilyEnum",   MetaHidden() )
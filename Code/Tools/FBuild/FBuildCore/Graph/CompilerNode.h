@@ -61,6 +61,7 @@ public:
     const AString & GetExecutable() const { return m_StaticDependencies[ 0 ].GetNode()->GetName(); }
     const char * GetEnvironmentString() const;
     const AString & GetSourceMapping() const { return m_SourceMapping; }
+    const AString & GetCompilerServer() const { return m_CompilerServer; }
 
 private:
     bool InitializeCompilerFamily( const BFFToken * iter, const Function * function );
@@ -88,6 +89,7 @@ private:
     ToolManifest            m_Manifest;
     Array< AString >        m_Environment;
     AString                 m_SourceMapping;
+    AString                 m_CompilerServer;
 
     // Internal state
     mutable const char *    m_EnvironmentString;
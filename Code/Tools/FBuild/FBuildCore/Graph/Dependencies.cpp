@@ -14,6 +14,17 @@
 #include "Core/FileIO/IOStream.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 
+// DependencyRecord
+//------------------------------------------------------------------------------
+// Fixed layout entry for each dependency in the DB, read in place when loading
+class DependencyRecord
+{
+public:
+    uint32_t    m_NodeIndex;    // Index of node we depend on
+    uint32_t    m_IsWeak;       // Weak flag
+    uint64_t    m_NodeStamp;    // Stamp of node we depend on
+};
+
 // Save
 //------------------------------------------------------------------------------
 void Dependencies::Save( IOStream & stream ) const
@@ -25,28 +36,23 @@ void Dependencies::Save( IOStream & stream ) const
         return;
     }
 
+    stream.AlignWrite( sizeof( uint64_t ) );
     const Dependency * deps = GetDependencies( m_DependencyList );
     for ( size_t i = 0; i < numDeps; ++i )
     {
         const Dependency & dep = deps[ i ];
 
-        // Save index of node we depend on
-        const uint32_t index = dep.GetNode()->GetBuildPassTag();
-        stream.Write( index );
-
-        // Save stamp
-        const uint64_t stamp = dep.GetNodeStamp();
-        stream.Write( stamp );
-
-        // Save weak flag
-        const bool isWeak = dep.IsWeak();
-        stream.Write( isWeak );
+        DependencyRecord record;
+        record.m_NodeIndex = dep.GetNode()->GetIndex();
+        record.m_IsWeak = dep.IsWeak() ? 1 : 0;
+        record.m_NodeStamp = dep.GetNodeStamp();
+        stream.Write( &record, sizeof( record ) );
     }
 }
 
 // Load
 //------------------------------------------------------------------------------
-void Dependencies::Load( NodeGraph & nodeGraph, ConstMemoryStream & stream )
+void Dependencies::Load( const NodeGraph & nodeGraph, ConstMemoryStream & stream )
 {
     ASSERT( IsEmpty() );
 
@@ -57,27 +63,23 @@ void Dependencies::Load( NodeGraph & nodeGraph, ConstMemoryStream & stream )
         return;
     }
 
+    // Access records in place
+    stream.AlignRead( sizeof( uint64_t ) );
+    const DependencyRecord * records = reinterpret_cast< const DependencyRecord * >( static_cast< const char * >( stream.GetData() ) + stream.Tell() );
+    ASSERT( ( (size_t)records % alignof( DependencyRecord ) ) == 0 );
+    VERIFY( stream.Seek( stream.Tell() + ( (uint64_t)numDeps * sizeof( DependencyRecord ) ) ) );
+
     SetCapacity( numDeps );
-    for ( uint32_t i=0; i<numDeps; ++i )
+    for ( uint32_t i = 0; i < numDeps; ++i )
     {
-        // Read node index
-        uint32_t index( INVALID_NODE_INDEX );
-        VERIFY( stream.Read( index ) );
+        const DependencyRecord & record = records[ i ];
 
         // Convert to Node *
-        Node * node = nodeGraph.GetNodeByIndex( index );
+        Node * node = nodeGraph.GetNodeByIndex( record.m_NodeIndex );
         ASSERT( node );
 
-        // Read Stamp
-        uint64_t stamp;
-        VERIFY( stream.Read( stamp ) );
-
-        // Read weak flag
-        bool isWeak( false );
-        VERIFY( stream.Read( isWeak ) );
-
         // Recombine dependency info
-        Add( node, stamp, isWeak );
+        Add( node, record.m_NodeStamp, ( record.m_IsWeak != 0 ) );
     }
 }
 
@@ -78,7 +78,7 @@ public:
     Dependencies &                      operator = ( const Dependencies & other );
 
     void Save( IOStream & stream ) const;
-    void Load( NodeGraph & nodeGraph, ConstMemoryStream & stream );
+    void Load( const NodeGraph & nodeGraph, ConstMemoryStream & stream );
 
 protected:
     // Extend to explicit capacity, or with amortized expansion if 0
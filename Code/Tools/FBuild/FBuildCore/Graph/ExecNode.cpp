@@ -10,11 +10,13 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Strings/AArenaString.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Process.h"
 
@@ -207,8 +209,8 @@ ExecNode::~ExecNode()
     }
 
     // capture all of the stdout and stderr
-    AString memOut;
-    AString memErr;
+    AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+    AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
     p.ReadAllData( memOut, memErr );
 
     // Get result
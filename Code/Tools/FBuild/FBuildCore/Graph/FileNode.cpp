@@ -50,6 +50,39 @@ FileNode::~FileNode() = default;
     return BuildResult::eOk;
 }
 
+// PrefetchStamp
+//------------------------------------------------------------------------------
+void FileNode::PrefetchStamp()
+{
+    m_PrefetchedStamp = FileIO::GetFileLastWriteTime( m_Name );
+    m_StampPrefetched = true;
+}
+
+// PrefetchStoredStamp
+//------------------------------------------------------------------------------
+void FileNode::PrefetchStoredStamp()
+{
+    // Stamp loaded from the DB is known to be current (see NodeGraph::UpdateStoredFileStamps)
+    ASSERT( m_Stamp != 0 );
+    m_PrefetchedStamp = m_Stamp;
+    m_StampPrefetched = true;
+}
+
+// UsePrefetchedStamp
+//------------------------------------------------------------------------------
+bool FileNode::UsePrefetchedStamp()
+{
+    if ( m_StampPrefetched == false )
+    {
+        return false; // Must be retrieved by building normally
+    }
+
+    // NOTE: As per DoBuild, a missing file results in a zero stamp
+    m_Stamp = m_PrefetchedStamp;
+    m_StampPrefetched = false;
+    return true;
+}
+
 // HandleWarningsMSVC
 //------------------------------------------------------------------------------
 void FileNode::HandleWarningsMSVC( Job * job, const AString & name, const AString & data )
@@ -22,6 +22,12 @@ public:
     static void HandleWarningsMSVC( Job * job, const AString & name, const AString & data );
     static void HandleWarningsClangCl( Job * job, const AString & name, const AString & data );
     static void HandleWarningsClangGCC( Job * job, const AString & name, const AString & data );
+
+    // Timestamp can be retrieved ahead of the build (see NodeGraph::PrefetchFileStamps)
+    void PrefetchStamp();
+    void PrefetchStoredStamp();
+    void ClearPrefetchedStamp() { m_StampPrefetched = false; }
+    bool UsePrefetchedStamp();
 protected:
     friend class ObjectNode;
     virtual BuildResult DoBuild( Job * job ) override;
@@ -30,6 +36,10 @@ protected:
     static void HandleWarnings( Job * job, const AString & name, const AString & data, const char * warningString );
 
     friend class Client;
+    friend class NodeGraph;
+
+    uint64_t    m_PrefetchedStamp = 0;
+    uint64_t    m_SavedStamp = 0;       // Stamp in the DB (only changed stamps are journaled)
 };
 
 //------------------------------------------------------------------------------
@@ -19,10 +19,12 @@
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 // Core
 #include "Core/Env/ErrorFormat.h"
 #include "Core/Process/Process.h"
+#include "Core/Strings/AArenaString.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
@@ -190,8 +192,8 @@ LibraryNode::~LibraryNode()
     }
 
     // capture all of the stdout and stderr
-    AString memOut;
-    AString memErr;
+    AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+    AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
     p.ReadAllData( memOut, memErr );
 
     // Get result
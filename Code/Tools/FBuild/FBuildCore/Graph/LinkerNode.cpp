@@ -20,12 +20,14 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Process/Process.h"
 #include "Core/Profile/Profile.h"
+#include "Core/Strings/AArenaString.h"
 #include "Core/Strings/AStackString.h"
 
 // Reflection
@@ -241,8 +243,8 @@ LinkerNode::~LinkerNode()
         }
 
         // capture all of the stdout and stderr
-        AString memOut;
-        AString memErr;
+        AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+        AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
         p.ReadAllData( memOut, memErr );
 
         // Get result
@@ -352,8 +354,8 @@ LinkerNode::~LinkerNode()
         }
 
         // capture all of the stdout and stderr
-        AString memOut;
-        AString memErr;
+        AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+        AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
         stampProcess.ReadAllData( memOut, memErr );
 
         // Get result
@@ -388,6 +390,16 @@ LinkerNode::~LinkerNode()
     return BuildResult::eOk;
 }
 
+// GetExtraOutputFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void LinkerNode::GetExtraOutputFiles( Array< AString > & outFileNames ) const
+{
+    if ( m_ImportLibName.IsEmpty() == false )
+    {
+        outFileNames.Append( m_ImportLibName );
+    }
+}
+
 // DoPreLinkCleanup
 //------------------------------------------------------------------------------
 bool LinkerNode::DoPreLinkCleanup() const
@@ -49,6 +49,7 @@ protected:
     friend class TestLinker;
 
     virtual BuildResult DoBuild( Job * job ) override;
+    virtual void GetExtraOutputFiles( Array< AString > & outFileNames ) const override;
 
     bool DoPreLinkCleanup() const;
 
@@ -141,6 +141,12 @@ Node::~Node() = default;
     return true;
 }
 
+// GetExtraOutputFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void Node::GetExtraOutputFiles( Array< AString > & /*outFileNames*/ ) const
+{
+}
+
 // DetermineNeedToBuildStatic
 //------------------------------------------------------------------------------
 /*virtual*/ bool Node::DetermineNeedToBuildStatic() const
@@ -324,29 +330,12 @@ void Node::SetLastBuildTime( uint32_t ms )
     AtomicStoreRelaxed( &m_LastBuildTimeMs, ms );
 }
 
-// Load
+// LoadProperties
 //------------------------------------------------------------------------------
-/*static*/ Node * Node::Load( NodeGraph & nodeGraph, ConstMemoryStream & stream )
+/*static*/ void Node::LoadProperties( Node * node, ConstMemoryStream & stream )
 {
-    // read type
-    uint8_t nodeType;
-    VERIFY( stream.Read( nodeType ) );
-
-    // Name of node
-    AString name;
-    VERIFY( stream.Read( name ) );
-    uint32_t nameHash;
-    VERIFY( stream.Read( nameHash ) );
-
-    // Create node
-    Node * n = nodeGraph.CreateNode( (Type)nodeType, Move( name ), nameHash );
-    ASSERT( n );
-
-    // Early out for FileNode
-    if ( nodeType == Node::FILE_NODE )
-    {
-        return n;
-    }
+    // FileNodes have nothing beyond their name and type (see SaveProperties)
+    ASSERT( node->GetType() != Node::FILE_NODE );
 
     // Read stamp
     uint64_t stamp;
@@ -355,19 +344,18 @@ void Node::SetLastBuildTime( uint32_t ms )
     // Build time
     uint32_t lastTimeToBuild;
     VERIFY( stream.Read( lastTimeToBuild ) );
-    n->SetLastBuildTime( lastTimeToBuild );
+    node->SetLastBuildTime( lastTimeToBuild );
 
     // Deserialize properties
-    Deserialize( stream, n, *n->GetReflectionInfoV() );
+    Deserialize( stream, node, *node->GetReflectionInfoV() );
 
     // set stamp
-    n->m_Stamp = stamp;
-    return n;
+    node->m_Stamp = stamp;
 }
 
 // LoadDependencies
 //------------------------------------------------------------------------------
-/*static*/ void Node::LoadDependencies( NodeGraph & nodeGraph, Node * node, ConstMemoryStream & stream )
+/*static*/ void Node::LoadDependencies( const NodeGraph & nodeGraph, Node * node, ConstMemoryStream & stream )
 {
     // Early out for FileNode
     if ( node->GetType() == Node::FILE_NODE )
@@ -387,28 +375,17 @@ void Node::SetLastBuildTime( uint32_t ms )
 {
 }
 
-// Save
+// SaveProperties
 //------------------------------------------------------------------------------
-/*static*/ void Node::Save( IOStream & stream, const Node * node )
+/*static*/ void Node::SaveProperties( IOStream & stream, const Node * node )
 {
     ASSERT( node );
 
-    // save type
-    const uint8_t nodeType = node->GetType();
-    stream.Write( nodeType );
-
-    // Save Name
-    stream.Write( node->m_Name );
-    stream.Write( node->m_NameHash );
-
-    // FileNodes don't need most things serialized:
+    // FileNodes don't need anything serialized beyond their name and type:
     // - their stamp is obtained every build, so doesn't need saving
     // - they take sub 1ms to check, so don't need their build time saved
     // - they have no reflected properties
-    if ( nodeType == Node::FILE_NODE )
-    {
-        return;
-    }
+    ASSERT( node->GetType() != Node::FILE_NODE );
 
     // Stamp
     const uint64_t stamp = node->GetStamp();
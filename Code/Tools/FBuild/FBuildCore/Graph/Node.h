@@ -149,9 +149,9 @@ public:
     inline uint32_t GetProgressAccumulator() const { return m_ProgressAccumulator; }
     inline void     SetProgressAccumulator( uint32_t p ) const { m_ProgressAccumulator = p; }
 
-    static Node *   Load( NodeGraph & nodeGraph, ConstMemoryStream & stream );
-    static void     LoadDependencies( NodeGraph & nodeGraph, Node * node, ConstMemoryStream & stream );
-    static void     Save( IOStream & stream, const Node * node );
+    static void     LoadProperties( Node * node, ConstMemoryStream & stream );
+    static void     LoadDependencies( const NodeGraph & nodeGraph, Node * node, ConstMemoryStream & stream );
+    static void     SaveProperties( IOStream & stream, const Node * node );
     static void     SaveDependencies( IOStream & stream, const Node * node );
     virtual void    PostLoad( NodeGraph & nodeGraph ); // TODO:C Eliminate the need for this function
 
@@ -170,6 +170,8 @@ public:
     inline void     SetBuildPassTag( uint32_t pass ) const { m_BuildPassTag = pass; }
     inline uint32_t GetBuildPassTag() const             { return m_BuildPassTag; }
 
+    inline uint32_t GetIndex() const                    { return m_Index; }
+
     const AString & GetName() const { return m_Name; }
 
     virtual const AString & GetPrettyName() const { return GetName(); }
@@ -196,6 +198,7 @@ protected:
     friend class VSProjectConfig; // TODO:C Remove this
     friend class WorkerThread;
     friend class CompilationDatabase;
+    friend class TestJobQueue;
 
     void SetName( AString && name, uint32_t nameHashHint = 0 );
 
@@ -215,6 +218,9 @@ protected:
     virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob );
     virtual bool Finalize( NodeGraph & nodeGraph );
 
+    // files written by a build, other than the node's own file
+    virtual void GetExtraOutputFiles( Array< AString > & outFileNames ) const;
+
     bool DetermineNeedToBuild( const Dependencies & deps ) const;
 
     void SetLastBuildTime( uint32_t ms );
@@ -254,14 +260,19 @@ protected:
     uint64_t            m_Stamp = 0;                // "Stamp" representing this node for dependency comparisons
     uint8_t             m_ControlFlags = FLAG_NONE; // Control build behavior special cases - Set by constructor
     bool                m_Hidden = false;           // Hidden from -showtargets?
-    // Note: Unused 2 bytes here
+    bool                m_UnsavedChanges = false;   // Modified by a build since the DB was last saved
+    bool                m_StampPrefetched = false;  // FileNode stamp retrieved ahead of the build (current build only)
     uint32_t            m_RecursiveCost = 0;        // Recursive cost used during task ordering
     Node *              m_Next = nullptr;           // Node map in-place linked list pointer
     uint32_t            m_NameHash;                 // Hash of mName
+    uint32_t            m_Index = 0;                // Index in the NodeGraph (used to serialize references to this node)
     uint32_t            m_LastBuildTimeMs = 0;      // Time it took to do last known full build of this node
     uint32_t            m_ProcessingTime = 0;       // Time spent on this node during this build
     uint32_t            m_CachingTime = 0;          // Time spent caching this node
     mutable uint32_t    m_ProgressAccumulator = 0;  // Used to estimate build progress percentage
+    uint32_t            m_NumPendingDependencies = 0; // Incomplete dependencies this node is waiting on (current build only)
+    uint32_t            m_PendingCost = 0;          // Recursive cost to reach this node, used when resuming after waiting
+    Array< Node * >     m_PendingDependents;        // Nodes waiting on this node to complete (current build only)
 
     Dependencies        m_PreBuildDependencies;
     Dependencies        m_StaticDependencies;
@@ -43,11 +43,14 @@
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MappedFile.h"
 #include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Process/Thread.h"
+#include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Reflection/ReflectedProperty.h"
 #include "Core/Strings/AStackString.h"
@@ -62,6 +65,7 @@
 // Static Data
 //------------------------------------------------------------------------------
 /*static*/ uint32_t NodeGraph::s_BuildPassTag( 0 );
+/*static*/ bool NodeGraph::s_UsePrefetchedFileStamps( false );
 
 // IsValid (NodeGraphHeader)
 //------------------------------------------------------------------------------
@@ -77,6 +81,49 @@ bool NodeGraphHeader::IsValid() const
     return true;
 }
 
+// DBChunk
+//------------------------------------------------------------------------------
+// A range of nodes whose properties and dependencies are serialized
+// independently of other ranges, allowing the DB to be loaded and saved in
+// parallel
+class NodeGraph::DBChunk
+{
+public:
+    NodeGraph *     m_NodeGraph             = nullptr;
+    uint32_t        m_FirstNode             = 0;
+    uint32_t        m_NumNodes              = 0;
+    const void *    m_Data                  = nullptr;  // Serialized chunk (when loading)
+    uint64_t        m_DataSize              = 0;
+    MemoryStream *  m_SaveStream            = nullptr;  // Serialized chunk (when saving)
+    Semaphore *     m_CompletedSemaphore    = nullptr;  // Signalled when processed on another thread
+};
+
+// FileStampChunk
+//------------------------------------------------------------------------------
+// A range of input files whose timestamps are retrieved together
+class NodeGraph::FileStampChunk
+{
+public:
+    FileNode **     m_FileNodes             = nullptr;
+    size_t          m_NumFileNodes          = 0;
+    Semaphore *     m_CompletedSemaphore    = nullptr;  // Signalled when processed on another thread
+};
+
+// IsValid (NodeGraphJournalHeader)
+//------------------------------------------------------------------------------
+bool NodeGraphJournalHeader::IsValid() const
+{
+    // Check header token and version are valid
+    if ( ( m_Identifier[ 0 ] != 'N' ) ||
+         ( m_Identifier[ 1 ] != 'G' ) ||
+         ( m_Identifier[ 2 ] != 'J' ) ||
+         ( m_Version != NodeGraphHeader::NODE_GRAPH_CURRENT_VERSION ) )
+    {
+        return false;
+    }
+    return true;
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 NodeGraph::NodeGraph( unsigned nodeMapHashBits )
@@ -84,6 +131,11 @@ NodeGraph::NodeGraph( unsigned nodeMapHashBits )
 , m_AllNodes( 1024 )
 , m_UsedFiles( 16 )
 , m_Settings( nullptr )
+, m_DBContentHash( 0 )
+, m_DBSize( 0 )
+, m_JournalSize( 0 )
+, m_NumNodesInDB( 0 )
+, m_TrustStoredFileStamps( false )
 {
     ASSERT( nodeMapHashBits > 0 && nodeMapHashBits < 32 );
     m_NodeMap = FNEW_ARRAY( Node * [ m_NodeMapMaxKey + 1 ] );
@@ -181,6 +233,9 @@ NodeGraph::~NodeGraph()
             }
 
             // Migrate old DB info to new DB
+            // - FileNodes are not migrated, so stored stamps must not prevent the
+            //   dependencies of other nodes from matching those of the new graph
+            oldNG->DiscardStoredFileStamps();
             newNG->Migrate( *oldNG );
             FDELETE( oldNG );
 
@@ -235,22 +290,19 @@ bool NodeGraph::ParseFromRoot( const char * bffFile )
 //------------------------------------------------------------------------------
 NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 {
-    // Open previously saved DB
-    FileStream fs;
-    if ( fs.Open( nodeGraphDBFile, FileStream::READ_ONLY ) == false )
+    // Map previously saved DB into memory. Fixed layout sections are then
+    // accessed in place and pages are only read as they are touched.
+    MappedFile mappedFile;
+    if ( mappedFile.Open( nodeGraphDBFile ) == false )
     {
+        if ( FileIO::FileExists( nodeGraphDBFile ) )
+        {
+            FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
+            return LoadResult::LOAD_ERROR;
+        }
         return LoadResult::MISSING_OR_INCOMPATIBLE;
     }
-
-    // Read it into memory to avoid lots of tiny disk accesses
-    const size_t fileSize = (size_t)fs.GetFileSize();
-    UniquePtr< char, FreeDeletor > memory( (char *)ALLOC( fileSize ) );
-    if ( fs.ReadBuffer( memory.Get(), fileSize ) != fileSize )
-    {
-        FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
-        return LoadResult::LOAD_ERROR;
-    }
-    ConstMemoryStream ms( memory.Get(), fileSize );
+    ConstMemoryStream ms( mappedFile.GetData(), mappedFile.GetSize() );
 
     // Load the Old DB
     const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile );
@@ -267,8 +319,9 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
 {
     bool compatibleDB;
     bool movedDB;
+    uint64_t contentHash;
     Array< UsedFile > usedFiles;
-    if ( ReadHeaderAndUsedFiles( stream, nodeGraphDBFile, usedFiles, compatibleDB, movedDB ) == false )
+    if ( ReadHeaderAndUsedFiles( stream, nodeGraphDBFile, usedFiles, m_FileWatcherSnapshot, compatibleDB, movedDB, contentHash ) == false )
     {
         return movedDB ? LoadResult::LOAD_ERROR_MOVED : LoadResult::LOAD_ERROR;
     }
@@ -282,11 +335,25 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
 
     // Take not of whether we need to reparse
     bool bffNeedsReparsing = false;
+    bool usedFilesUpdated = false;
+
+    // Files which a FileWatcher has seen no changes to since the DB was saved
+    // don't need checking
+    const FileWatcherClient & fileWatcher = FBuild::Get().GetFileWatcher();
+    FileWatcherChanges usedFileChanges;
+    const bool usedFileChangesKnown = ( m_FileWatcherSnapshot.IsValid() &&
+                                        fileWatcher.GetChangesSince( m_FileWatcherSnapshot, usedFileChanges ) );
 
     // check if any files used have changed
     for ( size_t i=0; i<usedFiles.GetSize(); ++i )
     {
         const AString & fileName = usedFiles[ i ].m_FileName;
+        if ( usedFileChangesKnown &&
+             fileWatcher.IsWatched( fileName ) &&
+             ( usedFileChanges.IsChanged( fileName ) == false ) )
+        {
+            continue;
+        }
         const uint64_t timeStamp = FileIO::GetFileLastWriteTime( fileName );
         if ( timeStamp == usedFiles[ i ].m_TimeStamp )
         {
@@ -316,6 +383,7 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
         {
             // file didn't change, update stored timestamp to save time on the next run
             usedFiles[ i ].m_TimeStamp = timeStamp;
+            usedFilesUpdated = true;
             continue;
         }
 
@@ -413,141 +481,916 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
     // Read nodes
     uint32_t numNodes;
     VERIFY( stream.Read( numNodes ) );
+
+    // Node names and types
     m_AllNodes.SetCapacity( numNodes );
+    if ( LoadNodeRecords( stream, numNodes ) == false )
+    {
+        return LoadResult::LOAD_ERROR;
+    }
+
+    // Chunks of node properties and dependencies
+    uint32_t numChunks;
+    VERIFY( stream.Read( numChunks ) );
+    Array< DBChunk > chunks;
+    chunks.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        DBChunk & chunk = chunks.EmplaceBack();
+        chunk.m_NodeGraph = this;
+        VERIFY( stream.Read( chunk.m_FirstNode ) );
+        VERIFY( stream.Read( chunk.m_NumNodes ) );
+        VERIFY( stream.Read( chunk.m_DataSize ) );
+        if ( ( (uint64_t)chunk.m_FirstNode + chunk.m_NumNodes ) > numNodes )
+        {
+            return LoadResult::LOAD_ERROR;
+        }
+    }
+    for ( DBChunk & chunk : chunks )
+    {
+        stream.AlignRead( sizeof( uint64_t ) );
+        chunk.m_Data = ( static_cast< const char * >( stream.GetData() ) + stream.Tell() );
+        if ( stream.Seek( stream.Tell() + chunk.m_DataSize ) == false )
+        {
+            return LoadResult::LOAD_ERROR;
+        }
+    }
+    ProcessChunks( chunks, LoadDBChunkJob );
+
+    // Apply changes journaled since the DB was saved
+    uint64_t journalSize = 0;
+    bool journalIntact = false;
+    if ( LoadJournal( nodeGraphDBFile, contentHash, journalSize, journalIntact ) == false )
+    {
+        return LoadResult::LOAD_ERROR;
+    }
+
+    // Discard stored FileNode stamps which may no longer be valid
+    const bool fileStampsIntact = UpdateStoredFileStamps();
+
+    for ( Node * node : m_AllNodes )
+    {
+        // Dispatch post-load callback
+        if ( node->GetType() != Node::FILE_NODE )
+        {
+            node->PostLoad( *this ); // TODO:C Eliminate the need for this
+        }
+    }
+
+    m_Settings = FindNode( AStackString<>( "$$Settings$$" ) )->CastTo< SettingsNode >();
+    ASSERT( m_Settings );
+
+    if ( bffNeedsReparsing )
+    {
+        return LoadResult::OK_BFF_NEEDS_REPARSING;
+    }
+
+    // Everything OK - propagate global settings
+    //------------------------------------------------
+
+    // file_exists files
+    FBuild::Get().GetFileExistsInfo() = fileExistsInfo;
+
+    // Environment
+    if ( envStringSize > 0 )
+    {
+        FBuild::Get().SetEnvironmentString( envString.Get(), envStringSize, libEnvVar );
+    }
+
+    // Further changes can be journaled, unless the DB needs to be saved in
+    // full anyway (to discard a damaged journal or record updated timestamps)
+    if ( journalIntact && !usedFilesUpdated && fileStampsIntact )
+    {
+        m_DBFile = nodeGraphDBFile;
+        m_DBContentHash = contentHash;
+        m_DBSize = stream.GetSize();
+        m_JournalSize = journalSize;
+        m_NumNodesInDB = (uint32_t)m_AllNodes.GetSize();
+    }
+
+    return LoadResult::OK;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void NodeGraph::Save( MemoryStream & stream, const char* nodeGraphDBFile ) const
+{
+    // write header and version
+    const NodeGraphHeader header;
+    stream.Write( (const void *)&header, sizeof( header ) );
+
+    AStackString<> nodeGraphDBFileClean( nodeGraphDBFile );
+    NodeGraph::CleanPath( nodeGraphDBFileClean );
+    stream.Write( nodeGraphDBFileClean );
+
+    // write used file
+    const uint32_t numUsedFiles = (uint32_t)m_UsedFiles.GetSize();
+    stream.Write( numUsedFiles );
+
+    for ( const NodeGraph::UsedFile & usedFile : m_UsedFiles )
+    {
+        stream.Write( usedFile.m_FileName );
+        stream.Write( usedFile.m_TimeStamp );
+        stream.Write( usedFile.m_DataHash );
+    }
+
+    // Stored timestamps are valid as of this point in the changes recorded by
+    // the FileWatcher (if any)
+    const FileWatcherSnapshot & fileWatcherSnapshot = FBuild::Get().GetFileWatcher().GetSnapshot();
+    stream.Write( fileWatcherSnapshot.m_InstanceId );
+    stream.Write( fileWatcherSnapshot.m_Sequence );
+
+    // TODO:C The serialization of these settings doesn't really belong here (not part of node graph)
+    {
+        // environment
+        const uint32_t envStringSize = FBuild::Get().GetEnvironmentStringSize();
+        stream.Write( envStringSize );
+        if ( envStringSize > 0 )
+        {
+            const char * envString = FBuild::Get().GetEnvironmentString();
+            stream.Write( envString, envStringSize );
+
+            AStackString<> libEnvVar;
+            FBuild::Get().GetLibEnvVar( libEnvVar );
+            stream.Write( libEnvVar );
+        }
+
+        // imported environment variables
+        const Array< FBuild::EnvironmentVarAndHash > & importedEnvironmentsVars = FBuild::Get().GetImportedEnvironmentVars();
+        const uint32_t importedEnvironmentsVarsSize = static_cast<uint32_t>( importedEnvironmentsVars.GetSize() );
+        ASSERT( importedEnvironmentsVarsSize == importedEnvironmentsVars.GetSize() );
+        stream.Write( importedEnvironmentsVarsSize );
+        for ( const FBuild::EnvironmentVarAndHash & varAndHash : importedEnvironmentsVars )
+        {
+            stream.Write( varAndHash.GetName() );
+            stream.Write( varAndHash.GetHash() );
+        }
+
+        // 'LIB' env var hash
+        const uint32_t libEnvVarHash = GetLibEnvVarHash();
+        stream.Write( libEnvVarHash );
+    }
+
+    // Write file_exists tracking info
+    FBuild::Get().GetFileExistsInfo().Save( stream );
+
+    // Write nodes
+    const size_t numNodes = m_AllNodes.GetSize();
+    stream.Write( (uint32_t)numNodes );
+
+    // Node names and types
+    SaveNodeRecords( stream, 0, numNodes );
+
+    // Serialize properties and dependencies in independent chunks
+    const uint32_t numChunks = (uint32_t)( ( numNodes + DB_CHUNK_NUM_NODES - 1 ) / DB_CHUNK_NUM_NODES );
+    Array< DBChunk > chunks;
+    chunks.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        DBChunk & chunk = chunks.EmplaceBack();
+        chunk.m_NodeGraph = const_cast< NodeGraph * >( this ); // Only read from when saving
+        chunk.m_FirstNode = ( i * DB_CHUNK_NUM_NODES );
+        chunk.m_NumNodes = Math::Min< uint32_t >( DB_CHUNK_NUM_NODES, (uint32_t)numNodes - chunk.m_FirstNode );
+    }
+    ProcessChunks( chunks, SaveDBChunkJob );
+
+    // Chunk table
+    stream.Write( numChunks );
+    for ( const DBChunk & chunk : chunks )
+    {
+        stream.Write( chunk.m_FirstNode );
+        stream.Write( chunk.m_NumNodes );
+        stream.Write( (uint64_t)chunk.m_SaveStream->GetSize() );
+    }
+
+    // Chunk data, aligned so fixed layout records within each can be read in place
+    for ( DBChunk & chunk : chunks )
+    {
+        stream.AlignWrite( sizeof( uint64_t ) );
+        stream.Write( chunk.m_SaveStream->GetData(), chunk.m_SaveStream->GetSize() );
+        FDELETE chunk.m_SaveStream;
+    }
+
+    // Calculate hash of stream excluding header
+    {
+        char * data = static_cast<char *>( stream.GetDataMutable() );
+        const char * content = ( data + sizeof(NodeGraphHeader) );
+        const size_t remainingSize = ( stream.GetSize() - sizeof(NodeGraphHeader) );
+        const uint64_t hash = xxHash3::Calc64( content, remainingSize );
+
+        // Update hash in header
+        NodeGraphHeader * headerToUpdate = reinterpret_cast<NodeGraphHeader *>( data );
+        ASSERT( headerToUpdate->GetContentHash() == 0 );
+        headerToUpdate->SetContentHash( hash );
+    }
+}
+
+// SaveNodeRecords
+//------------------------------------------------------------------------------
+void NodeGraph::SaveNodeRecords( IOStream & stream, size_t firstNode, size_t endNode ) const
+{
+    // Node names
+    uint32_t stringTableSize = 0;
+    for ( size_t i = firstNode; i < endNode; ++i )
+    {
+        stringTableSize += ( m_AllNodes[ i ]->GetName().GetLength() + 1 ); // Include null terminator
+    }
+    stream.Write( stringTableSize );
+    for ( size_t i = firstNode; i < endNode; ++i )
+    {
+        const AString & name = m_AllNodes[ i ]->GetName();
+        stream.Write( name.Get(), name.GetLength() + 1 );
+    }
+
+    // Node records
+    stream.AlignWrite( sizeof( uint64_t ) );
+    uint32_t nameOffset = 0;
+    for ( size_t i = firstNode; i < endNode; ++i )
+    {
+        const Node * node = m_AllNodes[ i ];
+
+        NodeGraphNodeRecord record;
+        record.m_NameOffset = nameOffset;
+        record.m_NameLength = node->GetName().GetLength();
+        record.m_NameHash = node->GetNameHash();
+        record.m_Type = (uint8_t)node->GetType();
+        record.m_Padding[ 0 ] = record.m_Padding[ 1 ] = record.m_Padding[ 2 ] = 0;
+        stream.Write( &record, sizeof( record ) );
+        nameOffset += ( record.m_NameLength + 1 );
+    }
+}
+
+// LoadNodeRecords
+//------------------------------------------------------------------------------
+bool NodeGraph::LoadNodeRecords( ConstMemoryStream & stream, uint32_t numNodes )
+{
+    // Node names
+    uint32_t stringTableSize;
+    VERIFY( stream.Read( stringTableSize ) );
+    const char * stringTable = static_cast< const char * >( stream.GetData() ) + stream.Tell();
+    if ( stream.Seek( stream.Tell() + stringTableSize ) == false )
+    {
+        return false;
+    }
+
+    // Node records (used in place)
+    stream.AlignRead( sizeof( uint64_t ) );
+    const NodeGraphNodeRecord * records = reinterpret_cast< const NodeGraphNodeRecord * >( static_cast< const char * >( stream.GetData() ) + stream.Tell() );
+    ASSERT( ( (size_t)records % alignof( NodeGraphNodeRecord ) ) == 0 );
+    if ( stream.Seek( stream.Tell() + ( (uint64_t)numNodes * sizeof( NodeGraphNodeRecord ) ) ) == false )
+    {
+        return false;
+    }
+
+    // Create each node
+    // NOTE: Nodes are created up front rather than lazily. Nodes own their
+    // names and reflected members, dependencies refer to Node pointers and
+    // every non-FileNode needs a PostLoad, so records can't be used in place.
     for ( uint32_t i = 0; i < numNodes; ++i )
     {
-        // Load each node
-        const Node * const n = Node::Load( *this, stream );
-        ASSERT( m_AllNodes[ i ] == n ); // Array is populated as loaded
+        const NodeGraphNodeRecord & record = records[ i ];
+        if ( ( (uint64_t)record.m_NameOffset + record.m_NameLength ) > stringTableSize )
+        {
+            return false;
+        }
+        const char * name = ( stringTable + record.m_NameOffset );
+        const size_t index = m_AllNodes.GetSize();
+        const Node * const n = CreateNode( (Node::Type)record.m_Type, AString( name, name + record.m_NameLength ), record.m_NameHash );
+        ASSERT( m_AllNodes[ index ] == n ); // Array is populated as loaded
+        (void)index;
         (void)n;
     }
+    return true;
+}
+
+// GetJournalFileName
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFile )
+{
+    outJournalFile = nodeGraphDBFile;
+    outJournalFile += ".journal";
+}
+
+// CanSaveJournal
+//------------------------------------------------------------------------------
+bool NodeGraph::CanSaveJournal( const char * nodeGraphDBFile ) const
+{
+    // Graph must match the DB we are saving to
+    if ( m_DBFile.IsEmpty() || ( m_DBFile != nodeGraphDBFile ) )
+    {
+        return false;
+    }
+
+    // Compact the journal into the DB once it becomes large enough to slow
+    // down loading
+    return ( m_JournalSize <= ( m_DBSize / 2 ) );
+}
+
+// SaveJournal
+//------------------------------------------------------------------------------
+bool NodeGraph::SaveJournal( const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( CanSaveJournal( nodeGraphDBFile ) );
+
+    // Nodes created since the DB was saved are always written. Other nodes
+    // are written if a build changed them.
+    const uint32_t numNodes = (uint32_t)m_AllNodes.GetSize();
+    // FileNodes only have a stamp, which is written if it differs from the
+    // one saved.
+    Array< Node * > changedNodes;
+    Array< FileNode * > changedFileNodes;
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        Node * node = m_AllNodes[ i ];
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            FileNode * fileNode = node->CastTo< FileNode >();
+            if ( ( i >= m_NumNodesInDB ) || ( fileNode->m_Stamp != fileNode->m_SavedStamp ) )
+            {
+                changedFileNodes.Append( fileNode );
+            }
+        }
+        else if ( ( i >= m_NumNodesInDB ) || node->m_UnsavedChanges )
+        {
+            changedNodes.Append( node );
+        }
+    }
+    m_CompletedNodesToJournal.Clear(); // Included above
+
+    // Stored stamps are now valid as of the latest changes seen by the FileWatcher
+    const FileWatcherSnapshot & fileWatcherSnapshot = FBuild::Get().GetFileWatcher().GetSnapshot();
+    if ( ( numNodes == m_NumNodesInDB ) &&
+         changedNodes.IsEmpty() &&
+         changedFileNodes.IsEmpty() &&
+         ( fileWatcherSnapshot == m_FileWatcherSnapshot ) )
+    {
+        return true; // Nothing to do
+    }
+
+    if ( AppendJournalEntry( nodeGraphDBFile, fileWatcherSnapshot, numNodes, changedNodes, changedFileNodes ) == false )
+    {
+        return false;
+    }
+
+    // Changes are now saved
+    for ( Node * node : changedNodes )
+    {
+        node->m_UnsavedChanges = false;
+    }
+    m_FileWatcherSnapshot = fileWatcherSnapshot;
+    return true;
+}
+
+// SaveJournalForCompletedNodes (Main Thread)
+//------------------------------------------------------------------------------
+void NodeGraph::SaveJournalForCompletedNodes( const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( Thread::IsMainThread() );
+    ASSERT( CanSaveJournal( nodeGraphDBFile ) );
+
+    // Nodes created since the last entry must be written in order. Stop before
+    // the first which is being built (so can be modified by a worker thread),
+    // at the last point where all the nodes written only depend on each other
+    // (or nodes written previously).
+    const uint32_t maxNumNodes = (uint32_t)m_AllNodes.GetSize();
+    uint32_t numNodes = m_NumNodesInDB;
+    uint32_t numNodesNeeded = 0; // By the nodes up to and including i
+    for ( uint32_t i = m_NumNodesInDB; i < maxNumNodes; ++i )
+    {
+        const Node * node = m_AllNodes[ i ];
+        if ( node->GetState() == Node::BUILDING )
+        {
+            break;
+        }
+        numNodesNeeded = Math::Max( numNodesNeeded, GetNumNodesToJournalFirst( node ) );
+        if ( numNodesNeeded <= ( i + 1 ) )
+        {
+            numNodes = ( i + 1 );
+        }
+    }
+
+    Array< Node * > changedNodes;
+    Array< FileNode * > changedFileNodes;
+    for ( uint32_t i = m_NumNodesInDB; i < numNodes; ++i )
+    {
+        Node * node = m_AllNodes[ i ];
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            changedFileNodes.Append( node->CastTo< FileNode >() );
+        }
+        else
+        {
+            changedNodes.Append( node );
+        }
+    }
+
+    // Completed nodes already in the journal, unless they depend on nodes which
+    // aren't yet (these wait for a later entry)
+    Array< Node * > deferredNodes;
+    for ( Node * node : m_CompletedNodesToJournal )
+    {
+        if ( node->GetIndex() >= m_NumNodesInDB )
+        {
+            if ( node->GetIndex() >= numNodes )
+            {
+                deferredNodes.Append( node );
+            }
+            continue; // New nodes are written above
+        }
+        if ( GetNumNodesToJournalFirst( node ) > numNodes )
+        {
+            deferredNodes.Append( node );
+        }
+        else if ( node->GetType() == Node::FILE_NODE )
+        {
+            changedFileNodes.Append( node->CastTo< FileNode >() );
+        }
+        else
+        {
+            changedNodes.Append( node );
+        }
+    }
+
+    if ( ( numNodes == m_NumNodesInDB ) && changedNodes.IsEmpty() && changedFileNodes.IsEmpty() )
+    {
+        return; // Nothing to do
+    }
+
+    // Stored FileNode stamps remain valid as of the point already recorded, as
+    // the build hasn't checked every file since then
+    if ( AppendJournalEntry( nodeGraphDBFile, m_FileWatcherSnapshot, numNodes, changedNodes, changedFileNodes ) == false )
+    {
+        return; // The full DB will be saved when the build completes
+    }
+
+    // Changes to completed nodes are now saved (new nodes which are incomplete
+    // will be written again)
+    for ( Node * node : changedNodes )
+    {
+        if ( ( node->GetState() == Node::UP_TO_DATE ) || ( node->GetState() == Node::FAILED ) )
+        {
+            node->m_UnsavedChanges = false;
+        }
+    }
+    m_CompletedNodesToJournal.Swap( deferredNodes );
+}
+
+// GetNumNodesToJournalFirst
+//------------------------------------------------------------------------------
+/*static*/ uint32_t NodeGraph::GetNumNodesToJournalFirst( const Node * node )
+{
+    // A node can only be written once all its dependencies have been, so the
+    // nodes up to and including the last of them must be written first
+    uint32_t numNodes = 0;
+    const Dependencies * depsList[] = { &node->m_PreBuildDependencies,
+                                        &node->m_StaticDependencies,
+                                        &node->m_DynamicDependencies };
+    for ( const Dependencies * deps : depsList )
+    {
+        for ( const Dependency & dep : *deps )
+        {
+            numNodes = Math::Max( numNodes, dep.GetNode()->GetIndex() + 1 );
+        }
+    }
+    return numNodes;
+}
+
+// AppendJournalEntry
+//------------------------------------------------------------------------------
+bool NodeGraph::AppendJournalEntry( const char * nodeGraphDBFile,
+                                    const FileWatcherSnapshot & fileWatcherSnapshot,
+                                    uint32_t numNodes,
+                                    const Array< Node * > & changedNodes,
+                                    const Array< FileNode * > & changedFileNodes )
+{
+    // Serialize changes
+    const uint32_t numNewNodes = ( numNodes - m_NumNodesInDB );
+    MemoryStream entry;
+    entry.Write( fileWatcherSnapshot.m_InstanceId );
+    entry.Write( fileWatcherSnapshot.m_Sequence );
+    entry.Write( numNodes );
+    entry.Write( numNewNodes );
+    SaveNodeRecords( entry, m_NumNodesInDB, numNodes );
+    entry.Write( (uint32_t)changedNodes.GetSize() );
+    for ( const Node * node : changedNodes )
+    {
+        entry.Write( node->GetIndex() );
+        Node::SaveProperties( entry, node );
+        Node::SaveDependencies( entry, node );
+    }
+    entry.Write( (uint32_t)changedFileNodes.GetSize() );
+    for ( const FileNode * fileNode : changedFileNodes )
+    {
+        entry.Write( fileNode->GetIndex() );
+        entry.Write( fileNode->m_Stamp );
+    }
+    entry.AlignWrite( sizeof( uint64_t ) );
+
+    // Append to journal (creating it if needed)
+    AStackString<> journalFile;
+    GetJournalFileName( nodeGraphDBFile, journalFile );
+    FileStream fs;
+    const uint32_t mode = ( m_JournalSize > 0 ) ? ( FileStream::WRITE_ONLY | FileStream::APPEND ) : FileStream::WRITE_ONLY;
+    if ( fs.Open( journalFile.Get(), mode ) == false )
+    {
+        return false;
+    }
+    uint64_t bytesWritten = 0;
+    if ( m_JournalSize == 0 )
+    {
+        const NodeGraphJournalHeader header( m_DBContentHash );
+        bytesWritten += fs.Write( &header, sizeof( header ) );
+    }
+    const uint32_t entrySize = (uint32_t)entry.GetSize();
+    const uint32_t padding = 0;
+    const uint64_t entryHash = xxHash3::Calc64( entry.GetData(), entry.GetSize() );
+    bytesWritten += fs.Write( entrySize ) ? sizeof( entrySize ) : 0;
+    bytesWritten += fs.Write( padding ) ? sizeof( padding ) : 0;
+    bytesWritten += fs.Write( entryHash ) ? sizeof( entryHash ) : 0;
+    bytesWritten += fs.Write( entry.GetData(), entry.GetSize() );
+    const uint64_t expectedSize = ( ( m_JournalSize == 0 ) ? sizeof( NodeGraphJournalHeader ) : 0 ) +
+                                  sizeof( entrySize ) + sizeof( padding ) + sizeof( entryHash ) + entry.GetSize();
+    if ( bytesWritten != expectedSize )
+    {
+        // A partially written entry will be ignored when loading, but we
+        // can't append to it
+        m_DBFile.Clear();
+        return false;
+    }
+
+    // Stamps of written FileNodes are now saved
+    for ( FileNode * fileNode : changedFileNodes )
+    {
+        fileNode->m_SavedStamp = fileNode->m_Stamp;
+    }
+    m_JournalSize += bytesWritten;
+    m_NumNodesInDB = numNodes;
+    return true;
+}
+
+// OnSaved
+//------------------------------------------------------------------------------
+void NodeGraph::OnSaved( const char * nodeGraphDBFile, const MemoryStream & stream )
+{
+    // The saved DB contains all changes
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_UnsavedChanges = false;
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            FileNode * fileNode = node->CastTo< FileNode >();
+            fileNode->m_SavedStamp = fileNode->m_Stamp;
+        }
+    }
+    m_CompletedNodesToJournal.Clear();
+    m_FileWatcherSnapshot = FBuild::Get().GetFileWatcher().GetSnapshot();
+
+    // Further changes can be journaled
+    const NodeGraphHeader * header = static_cast< const NodeGraphHeader * >( stream.GetData() );
+    m_DBFile = nodeGraphDBFile;
+    m_DBContentHash = header->GetContentHash();
+    m_DBSize = stream.GetSize();
+    m_JournalSize = 0;
+    m_NumNodesInDB = (uint32_t)m_AllNodes.GetSize();
+}
+
+// LoadJournal
+//------------------------------------------------------------------------------
+bool NodeGraph::LoadJournal( const char * nodeGraphDBFile, uint64_t dbContentHash, uint64_t & outJournalSize, bool & outJournalIntact )
+{
+    PROFILE_FUNCTION;
+
+    outJournalSize = 0;
+    outJournalIntact = true;
+
+    AStackString<> journalFile;
+    GetJournalFileName( nodeGraphDBFile, journalFile );
+    if ( FileIO::FileExists( journalFile.Get() ) == false )
+    {
+        return true; // No changes since DB was saved
+    }
+
+    // A journal we can't use will be discarded by the next save
+    outJournalIntact = false;
+
+    MappedFile mappedFile;
+    if ( mappedFile.Open( journalFile.Get() ) == false )
+    {
+        FLOG_WARN( "Could not read Database journal. Error: %s File: '%s'", LAST_ERROR_STR, journalFile.Get() );
+        return true;
+    }
+    ConstMemoryStream stream( mappedFile.GetData(), mappedFile.GetSize() );
+
+    // Journal must be for this DB (it could be left over from an older one)
+    NodeGraphJournalHeader header;
+    if ( ( stream.Read( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) ||
+         ( header.GetDBContentHash() != dbContentHash ) )
+    {
+        return true;
+    }
+
+    // Apply each complete entry. An incomplete entry at the end (from an
+    // interrupted save) is ignored.
+    for ( ;; )
+    {
+        uint32_t entrySize;
+        uint32_t padding;
+        uint64_t entryHash;
+        if ( ( stream.Read( entrySize ) == false ) ||
+             ( stream.Read( padding ) == false ) ||
+             ( stream.Read( entryHash ) == false ) ||
+             ( ( stream.Tell() + entrySize ) > stream.GetSize() ) )
+        {
+            break;
+        }
+        const char * entryData = ( static_cast< const char * >( stream.GetData() ) + stream.Tell() );
+        if ( xxHash3::Calc64( entryData, entrySize ) != entryHash )
+        {
+            break;
+        }
+
+        ConstMemoryStream entry( entryData, entrySize );
+        if ( LoadJournalEntry( entry ) == false )
+        {
+            return false; // Entry was saved intact, so the DB doesn't match it
+        }
+
+        stream.Seek( stream.Tell() + entrySize );
+        outJournalSize = stream.Tell();
+    }
+
+    outJournalIntact = ( outJournalSize == stream.GetSize() );
+    return true;
+}
+
+// LoadJournalEntry
+//------------------------------------------------------------------------------
+bool NodeGraph::LoadJournalEntry( ConstMemoryStream & stream )
+{
+    // Point at which stored FileNode stamps were valid
+    VERIFY( stream.Read( m_FileWatcherSnapshot.m_InstanceId ) );
+    VERIFY( stream.Read( m_FileWatcherSnapshot.m_Sequence ) );
+
+    // Nodes created since the last entry
+    uint32_t numNodes;
+    uint32_t numNewNodes;
+    VERIFY( stream.Read( numNodes ) );
+    VERIFY( stream.Read( numNewNodes ) );
+    if ( ( m_AllNodes.GetSize() + numNewNodes ) != numNodes )
+    {
+        return false;
+    }
+    if ( LoadNodeRecords( stream, numNewNodes ) == false )
+    {
+        return false;
+    }
+
+    // Nodes changed since the last entry (including new ones)
+    uint32_t numChangedNodes;
+    VERIFY( stream.Read( numChangedNodes ) );
+    for ( uint32_t i = 0; i < numChangedNodes; ++i )
+    {
+        uint32_t index;
+        VERIFY( stream.Read( index ) );
+        if ( ( index >= numNodes ) || ( m_AllNodes[ index ]->GetType() == Node::FILE_NODE ) )
+        {
+            return false;
+        }
+
+        // Replace previously loaded state
+        Node * node = m_AllNodes[ index ];
+        node->m_PreBuildDependencies.Clear();
+        node->m_StaticDependencies.Clear();
+        node->m_DynamicDependencies.Clear();
+        Node::LoadProperties( node, stream );
+        Node::LoadDependencies( *this, node, stream );
+    }
+
+    // FileNode stamps changed since the last entry
+    uint32_t numChangedFileNodes;
+    VERIFY( stream.Read( numChangedFileNodes ) );
+    for ( uint32_t i = 0; i < numChangedFileNodes; ++i )
+    {
+        uint32_t index;
+        VERIFY( stream.Read( index ) );
+        if ( ( index >= numNodes ) || ( m_AllNodes[ index ]->GetType() != Node::FILE_NODE ) )
+        {
+            return false;
+        }
+        FileNode * fileNode = m_AllNodes[ index ]->CastTo< FileNode >();
+        VERIFY( stream.Read( fileNode->m_Stamp ) );
+        fileNode->m_SavedStamp = fileNode->m_Stamp;
+    }
+    return true;
+}
+
+// UpdateStoredFileStamps
+//------------------------------------------------------------------------------
+bool NodeGraph::UpdateStoredFileStamps()
+{
+    PROFILE_FUNCTION;
+
+    m_TrustStoredFileStamps = false;
+
+    // If a FileWatcher has recorded all changes since the stamps were saved,
+    // only those of changed files need to be discarded
+    const FileWatcherClient & fileWatcher = FBuild::Get().GetFileWatcher();
+    FileWatcherChanges changes;
+    if ( m_FileWatcherSnapshot.IsValid() &&
+         fileWatcher.GetChangesSince( m_FileWatcherSnapshot, changes ) )
+    {
+        if ( changes.GetDirs().IsEmpty() )
+        {
+            for ( const AString & fileName : changes.GetFiles() )
+            {
+                Node * node = FindNodeExact( fileName );
+                if ( node && ( node->GetType() == Node::FILE_NODE ) )
+                {
+                    node->m_Stamp = 0;
+                }
+            }
+        }
+        else
+        {
+            for ( Node * node : m_AllNodes )
+            {
+                if ( ( node->GetType() == Node::FILE_NODE ) && changes.IsChanged( node->GetName() ) )
+                {
+                    node->m_Stamp = 0;
+                }
+            }
+        }
+        m_TrustStoredFileStamps = true;
+        return true;
+    }
+
+    // Without a FileWatcher, stamps are retrieved by the build as usual and
+    // stored ones are only used to avoid saving unchanged stamps again
+    if ( fileWatcher.GetSnapshot().IsValid() == false )
+    {
+        return true;
+    }
+
+    // Changes since the stamps were saved are unknown, so they must all be
+    // discarded and the DB saved in full for the next build to use them
+    DiscardStoredFileStamps();
+    return false;
+}
+
+// DiscardStoredFileStamps
+//------------------------------------------------------------------------------
+void NodeGraph::DiscardStoredFileStamps()
+{
     for ( Node * node : m_AllNodes )
     {
-        // Load dependencies, but not for FileNodes which have none
-        if ( node->GetType() != Node::FILE_NODE )
+        if ( node->GetType() == Node::FILE_NODE )
         {
-            Node::LoadDependencies( *this, node, stream );
+            node->m_Stamp = 0;
         }
     }
-    for ( Node * node : m_AllNodes )
+}
+
+// ProcessChunks
+//------------------------------------------------------------------------------
+template < class T >
+/*static*/ void NodeGraph::ProcessChunks( Array< T > & chunks, void (*func)( void * ) )
+{
+    PROFILE_FUNCTION;
+
+    // Use the ThreadPool if available (it is idle outside of the build itself)
+    ThreadPool * threadPool = FBuild::IsValid() ? FBuild::Get().GetThreadPool() : nullptr;
+    if ( ( threadPool == nullptr ) || ( chunks.GetSize() < 2 ) )
     {
-        // Dispatch post-load callback
-        if ( node->GetType() != Node::FILE_NODE )
+        for ( T & chunk : chunks )
         {
-            node->PostLoad( *this ); // TODO:C Eliminate the need for this
+            func( &chunk );
         }
+        return;
     }
 
-    m_Settings = FindNode( AStackString<>( "$$Settings$$" ) )->CastTo< SettingsNode >();
-    ASSERT( m_Settings );
-
-    if ( bffNeedsReparsing )
+    // Process the first chunk on this thread while the others are processed in parallel
+    Semaphore chunksCompleted;
+    for ( size_t i = 1; i < chunks.GetSize(); ++i )
     {
-        return LoadResult::OK_BFF_NEEDS_REPARSING;
+        chunks[ i ].m_CompletedSemaphore = &chunksCompleted;
+        threadPool->EnqueueJob( func, &chunks[ i ] );
     }
+    func( &chunks[ 0 ] );
 
-    // Everything OK - propagate global settings
-    //------------------------------------------------
-
-    // file_exists files
-    FBuild::Get().GetFileExistsInfo() = fileExistsInfo;
-
-    // Environment
-    if ( envStringSize > 0 )
+    // Wait for other chunks
+    for ( size_t i = 1; i < chunks.GetSize(); ++i )
     {
-        FBuild::Get().SetEnvironmentString( envString.Get(), envStringSize, libEnvVar );
+        chunksCompleted.Wait();
     }
-
-    return LoadResult::OK;
 }
 
-// Save
+// SaveDBChunkJob
 //------------------------------------------------------------------------------
-void NodeGraph::Save( MemoryStream & stream, const char* nodeGraphDBFile ) const
+/*static*/ void NodeGraph::SaveDBChunkJob( void * userData )
 {
-    // write header and version
-    const NodeGraphHeader header;
-    stream.Write( (const void *)&header, sizeof( header ) );
-
-    AStackString<> nodeGraphDBFileClean( nodeGraphDBFile );
-    NodeGraph::CleanPath( nodeGraphDBFileClean );
-    stream.Write( nodeGraphDBFileClean );
+    PROFILE_FUNCTION;
 
-    // write used file
-    const uint32_t numUsedFiles = (uint32_t)m_UsedFiles.GetSize();
-    stream.Write( numUsedFiles );
+    DBChunk & chunk = *static_cast< DBChunk * >( userData );
+    chunk.m_SaveStream = FNEW( MemoryStream( chunk.m_NumNodes * 256, 64 * 1024 ) );
+    MemoryStream & stream = *chunk.m_SaveStream;
 
-    for ( const NodeGraph::UsedFile & usedFile : m_UsedFiles )
-    {
-        stream.Write( usedFile.m_FileName );
-        stream.Write( usedFile.m_TimeStamp );
-        stream.Write( usedFile.m_DataHash );
-    }
+    const uint32_t endNode = ( chunk.m_FirstNode + chunk.m_NumNodes );
 
-    // TODO:C The serialization of these settings doesn't really belong here (not part of node graph)
+    // Properties, but FileNodes have none (only a stamp)
+    for ( uint32_t i = chunk.m_FirstNode; i < endNode; ++i )
     {
-        // environment
-        const uint32_t envStringSize = FBuild::Get().GetEnvironmentStringSize();
-        stream.Write( envStringSize );
-        if ( envStringSize > 0 )
+        const Node * node = chunk.m_NodeGraph->m_AllNodes[ i ];
+        if ( node->GetType() != Node::FILE_NODE )
         {
-            const char * envString = FBuild::Get().GetEnvironmentString();
-            stream.Write( envString, envStringSize );
-
-            AStackString<> libEnvVar;
-            FBuild::Get().GetLibEnvVar( libEnvVar );
-            stream.Write( libEnvVar );
+            Node::SaveProperties( stream, node );
+        }
+        else
+        {
+            stream.Write( node->m_Stamp );
         }
+    }
 
-        // imported environment variables
-        const Array< FBuild::EnvironmentVarAndHash > & importedEnvironmentsVars = FBuild::Get().GetImportedEnvironmentVars();
-        const uint32_t importedEnvironmentsVarsSize = static_cast<uint32_t>( importedEnvironmentsVars.GetSize() );
-        ASSERT( importedEnvironmentsVarsSize == importedEnvironmentsVars.GetSize() );
-        stream.Write( importedEnvironmentsVarsSize );
-        for ( const FBuild::EnvironmentVarAndHash & varAndHash : importedEnvironmentsVars )
+    // Dependencies, but not for FileNodes which have none
+    for ( uint32_t i = chunk.m_FirstNode; i < endNode; ++i )
+    {
+        const Node * node = chunk.m_NodeGraph->m_AllNodes[ i ];
+        if ( node->GetType() != Node::FILE_NODE )
         {
-            stream.Write( varAndHash.GetName() );
-            stream.Write( varAndHash.GetHash() );
+            Node::SaveDependencies( stream, node );
         }
+    }
 
-        // 'LIB' env var hash
-        const uint32_t libEnvVarHash = GetLibEnvVarHash();
-        stream.Write( libEnvVarHash );
+    if ( chunk.m_CompletedSemaphore )
+    {
+        chunk.m_CompletedSemaphore->Signal();
     }
+}
 
-    // Write file_exists tracking info
-    FBuild::Get().GetFileExistsInfo().Save( stream );
+// LoadDBChunkJob
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::LoadDBChunkJob( void * userData )
+{
+    PROFILE_FUNCTION;
 
-    // Write nodes
-    const size_t numNodes = m_AllNodes.GetSize();
-    stream.Write( (uint32_t)numNodes );
-    uint32_t index = 0;
-    for ( const Node * node : m_AllNodes )
+    DBChunk & chunk = *static_cast< DBChunk * >( userData );
+    ConstMemoryStream stream( chunk.m_Data, (size_t)chunk.m_DataSize );
+
+    const uint32_t endNode = ( chunk.m_FirstNode + chunk.m_NumNodes );
+
+    // Properties, but FileNodes have none (only a stamp)
+    for ( uint32_t i = chunk.m_FirstNode; i < endNode; ++i )
     {
-        // Save each node
-        Node::Save( stream, node );
-        node->SetBuildPassTag( index++ ); // Save index for dependency serialization
+        Node * node = chunk.m_NodeGraph->m_AllNodes[ i ];
+        if ( node->GetType() != Node::FILE_NODE )
+        {
+            Node::LoadProperties( node, stream );
+        }
+        else
+        {
+            FileNode * fileNode = node->CastTo< FileNode >();
+            VERIFY( stream.Read( fileNode->m_Stamp ) );
+            fileNode->m_SavedStamp = fileNode->m_Stamp;
+        }
     }
-    for ( const Node * node : m_AllNodes )
+
+    // Dependencies, but not for FileNodes which have none. All nodes were
+    // created before any chunk was loaded, so they can be resolved directly.
+    for ( uint32_t i = chunk.m_FirstNode; i < endNode; ++i )
     {
-        // Save dependencies, but not for FileNodes which have none
+        Node * node = chunk.m_NodeGraph->m_AllNodes[ i ];
         if ( node->GetType() != Node::FILE_NODE )
         {
-            Node::SaveDependencies( stream, node );
+            Node::LoadDependencies( *chunk.m_NodeGraph, node, stream );
         }
     }
+    ASSERT( stream.Tell() == chunk.m_DataSize );
 
-    // Calculate hash of stream excluding header
+    if ( chunk.m_CompletedSemaphore )
     {
-        char * data = static_cast<char *>( stream.GetDataMutable() );
-        const char * content = ( data + sizeof(NodeGraphHeader) );
-        const size_t remainingSize = ( stream.GetSize() - sizeof(NodeGraphHeader) );
-        const uint64_t hash = xxHash3::Calc64( content, remainingSize );
+        chunk.m_CompletedSemaphore->Signal();
+    }
+}
 
-        // Update hash in header
-        NodeGraphHeader * headerToUpdate = reinterpret_cast<NodeGraphHeader *>( data );
-        ASSERT( headerToUpdate->GetContentHash() == 0 );
-        headerToUpdate->SetContentHash( hash );
+// FileStampChunkJob
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::FileStampChunkJob( void * userData )
+{
+    PROFILE_FUNCTION;
+
+    FileStampChunk & chunk = *static_cast< FileStampChunk * >( userData );
+    for ( size_t i = 0; i < chunk.m_NumFileNodes; ++i )
+    {
+        chunk.m_FileNodes[ i ]->PrefetchStamp();
+    }
+
+    if ( chunk.m_CompletedSemaphore )
+    {
+        chunk.m_CompletedSemaphore->Signal();
     }
 }
 
@@ -927,9 +1770,127 @@ void NodeGraph::AddNode( Node * node )
     m_NodeMap[ key ] = node;
 
     // add to list
+    node->m_Index = (uint32_t)m_AllNodes.GetSize();
     m_AllNodes.Append( node );
 }
 
+// PrefetchFileStamps
+//------------------------------------------------------------------------------
+void NodeGraph::PrefetchFileStamps( Node * nodeToBuild )
+{
+    PROFILE_FUNCTION;
+
+    // Stamps loaded from the DB can be used for files the FileWatcher has
+    // seen no changes to, but only until the build modifies anything
+    const FileWatcherClient * fileWatcher = m_TrustStoredFileStamps ? &FBuild::Get().GetFileWatcher() : nullptr;
+    m_TrustStoredFileStamps = false;
+
+    // Discard anything left over from a previous build
+    s_UsePrefetchedFileStamps = false;
+    for ( FileNode * fileNode : m_PrefetchedFileNodes )
+    {
+        fileNode->ClearPrefetchedStamp();
+    }
+    m_PrefetchedFileNodes.Clear();
+
+    // Find all input files which could be needed to build the target(s). Nodes
+    // completed by a previous build don't need to be visited again.
+    s_BuildPassTag++;
+    Array< FileNode * > fileNodesToStat;
+    Array< Node * > nodesToVisit;
+    // (nodeToBuild isn't tagged, as it can be a temporary ProxyNode outside of
+    // m_AllNodes, whose tag would then not be reset before gathering stats)
+    nodesToVisit.Append( nodeToBuild );
+    while ( nodesToVisit.IsEmpty() == false )
+    {
+        Node * node = nodesToVisit.Top();
+        nodesToVisit.Pop();
+
+        if ( node->GetState() != Node::NOT_PROCESSED )
+        {
+            continue;
+        }
+
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            FileNode * fileNode = node->CastTo< FileNode >();
+            m_PrefetchedFileNodes.Append( fileNode );
+            if ( fileWatcher && ( fileNode->m_Stamp != 0 ) && fileWatcher->IsWatched( fileNode->GetName() ) )
+            {
+                fileNode->PrefetchStoredStamp();
+            }
+            else
+            {
+                fileNodesToStat.Append( fileNode );
+            }
+            continue;
+        }
+
+        // Dynamic dependencies from the previous build are usually still valid,
+        // and are the bulk of the input files (e.g. included headers)
+        const Dependencies * allDeps[ 3 ] = { &node->GetPreBuildDependencies(),
+                                              &node->GetStaticDependencies(),
+                                              &node->GetDynamicDependencies() };
+
+        // PreBuildDependencies can write files they don't declare (code
+        // generation etc), so the stamps of inputs behind them are retrieved
+        // once they are built, as usual
+        const size_t numDeps = node->GetPreBuildDependencies().IsEmpty() ? 3 : 1;
+        for ( size_t i = 0; i < numDeps; ++i )
+        {
+            const Dependencies * deps = allDeps[ i ];
+            for ( const Dependency & dep : *deps )
+            {
+                Node * depNode = dep.GetNode();
+                if ( depNode->GetBuildPassTag() != s_BuildPassTag )
+                {
+                    depNode->SetBuildPassTag( s_BuildPassTag );
+                    nodesToVisit.Append( depNode );
+                }
+            }
+        }
+    }
+
+    // Retrieve timestamps in parallel, which is much faster than doing so one
+    // job at a time, particularly on network file systems
+    const size_t numFiles = fileNodesToStat.GetSize();
+    const size_t numChunks = ( ( numFiles + FILE_STAMP_CHUNK_NUM_FILES - 1 ) / FILE_STAMP_CHUNK_NUM_FILES );
+    Array< FileStampChunk > chunks;
+    chunks.SetSize( numChunks );
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        const size_t firstFile = ( i * FILE_STAMP_CHUNK_NUM_FILES );
+        chunks[ i ].m_FileNodes = &fileNodesToStat[ firstFile ];
+        chunks[ i ].m_NumFileNodes = Math::Min< size_t >( FILE_STAMP_CHUNK_NUM_FILES, numFiles - firstFile );
+    }
+    ProcessChunks( chunks, FileStampChunkJob );
+
+    s_UsePrefetchedFileStamps = true;
+}
+
+// InvalidatePrefetchedFileStamps
+//------------------------------------------------------------------------------
+void NodeGraph::InvalidatePrefetchedFileStamps( const Node * nodeToBuild )
+{
+    if ( s_UsePrefetchedFileStamps == false )
+    {
+        return;
+    }
+
+    // A node's own file can't also be a FileNode, so only its other outputs
+    // (unity files, import libs etc) need checking
+    Array< AString > outputFiles;
+    nodeToBuild->GetExtraOutputFiles( outputFiles );
+    for ( const AString & outputFile : outputFiles )
+    {
+        Node * node = FindNode( outputFile );
+        if ( node && ( node->GetType() == Node::FILE_NODE ) )
+        {
+            node->CastTo< FileNode >()->ClearPrefetchedStamp();
+        }
+    }
+}
+
 // Build
 //------------------------------------------------------------------------------
 void NodeGraph::DoBuildPass( Node * nodeToBuild )
@@ -938,20 +1899,41 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
 
     s_BuildPassTag++;
 
+    // Start (or continue) the build of the requested target(s). Nodes waiting
+    // on dependencies are not revisited here.
     if ( nodeToBuild->GetType() == Node::PROXY_NODE )
     {
-        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
-        size_t failedCount = 0;
-        size_t upToDateCount = 0;
         for ( const Dependency & dep : nodeToBuild->GetStaticDependencies() )
         {
             Node * n = dep.GetNode();
-            if ( n->GetState() < Node::BUILDING )
+            if ( ( n->GetState() < Node::BUILDING ) && ( n->m_NumPendingDependencies == 0 ) )
             {
                 BuildRecurse( n, 0 );
             }
+        }
+    }
+    else
+    {
+        if ( ( nodeToBuild->GetState() < Node::BUILDING ) && ( nodeToBuild->m_NumPendingDependencies == 0 ) )
+        {
+            BuildRecurse( nodeToBuild, 0 );
+        }
+    }
+
+    // Progress nodes whose dependencies have completed since they were last
+    // checked. Each completion only visits its direct dependents, so the cost
+    // of a pass is proportional to the completed work, not the size of the graph.
+    ProcessReadyNodes();
 
-            // check result of recursion (which may or may not be complete)
+    if ( nodeToBuild->GetType() == Node::PROXY_NODE )
+    {
+        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
+        size_t failedCount = 0;
+        size_t upToDateCount = 0;
+        for ( const Dependency & dep : nodeToBuild->GetStaticDependencies() )
+        {
+            // check result of build (which may or may not be complete)
+            const Node * n = dep.GetNode();
             if ( n->GetState() == Node::UP_TO_DATE )
             {
                 upToDateCount++;
@@ -969,13 +1951,6 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
             nodeToBuild->SetState( failedCount ? Node::FAILED : Node::UP_TO_DATE );
         }
     }
-    else
-    {
-        if ( nodeToBuild->GetState() < Node::BUILDING )
-        {
-            BuildRecurse( nodeToBuild, 0 );
-        }
-    }
 
     // Check for cyclic dependencies discoverable only at runtime
     if ( CheckForCyclicDependencies( nodeToBuild ) )
@@ -987,11 +1962,107 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
     JobQueue::Get().FlushJobBatch();
 }
 
+// OnNodeCompleted
+//------------------------------------------------------------------------------
+void NodeGraph::OnNodeCompleted( Node * node )
+{
+    ASSERT( Thread::IsMainThread() );
+    ASSERT( ( node->GetState() == Node::UP_TO_DATE ) || ( node->GetState() == Node::FAILED ) );
+
+    // A node can fail while still waiting on other dependencies
+    node->m_NumPendingDependencies = 0;
+
+    // Track changes which can be journaled during the build
+    if ( m_DBFile.IsEmpty() == false )
+    {
+        const bool changed = ( node->GetType() == Node::FILE_NODE ) ? ( node->m_Stamp != node->CastTo< FileNode >()->m_SavedStamp )
+                                                                     : node->m_UnsavedChanges;
+        if ( changed )
+        {
+            m_CompletedNodesToJournal.Append( node );
+        }
+    }
+
+    if ( node->m_PendingDependents.IsEmpty() )
+    {
+        return; // Nothing is waiting on this node
+    }
+
+    const bool failed = ( node->GetState() == Node::FAILED );
+    const bool stopOnFirstError = FBuild::Get().GetOptions().m_StopOnFirstError;
+
+    for ( Node * dependent : node->m_PendingDependents )
+    {
+        // Dependent may have already been woken up (and failed) due to
+        // the failure of another dependency
+        if ( dependent->m_NumPendingDependencies == 0 )
+        {
+            continue;
+        }
+        ASSERT( dependent->GetState() < Node::BUILDING );
+
+        --dependent->m_NumPendingDependencies;
+
+        // Dependent can progress once everything it was waiting on is complete.
+        // When stopping on the first error, a failure propagates immediately.
+        if ( ( dependent->m_NumPendingDependencies == 0 ) || ( failed && stopOnFirstError ) )
+        {
+            dependent->m_NumPendingDependencies = 0;
+            JobQueue::Get().AddReadyNode( dependent );
+        }
+    }
+
+    // Free memory as the list is no longer needed
+    node->m_PendingDependents.Destruct();
+}
+
+// ClearPendingDependencies
+//------------------------------------------------------------------------------
+void NodeGraph::ClearPendingDependencies()
+{
+    PROFILE_FUNCTION;
+
+    // An interrupted build can leave nodes waiting on dependencies which will
+    // never complete. Reset them so subsequent builds start from a clean state.
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_NumPendingDependencies = 0;
+        node->m_PendingDependents.Destruct();
+    }
+}
+
+// ProcessReadyNodes
+//------------------------------------------------------------------------------
+void NodeGraph::ProcessReadyNodes()
+{
+    PROFILE_FUNCTION;
+
+    // Progressing a node can complete it immediately, in turn making other
+    // nodes ready, so keep going until no more nodes become ready
+    Array< Node * > readyNodes;
+    while ( JobQueue::Get().GetReadyNodes( readyNodes ) )
+    {
+        for ( Node * node : readyNodes )
+        {
+            // Node may have been progressed via another path already
+            if ( ( node->GetState() < Node::BUILDING ) && ( node->m_NumPendingDependencies == 0 ) )
+            {
+                BuildRecurse( node, node->m_PendingCost );
+            }
+        }
+        readyNodes.Clear();
+    }
+}
+
 // BuildRecurse
 //------------------------------------------------------------------------------
 void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
 {
     ASSERT( nodeToBuild );
+    ASSERT( nodeToBuild->m_NumPendingDependencies == 0 );
+
+    // record cost so build can resume from here if node needs to wait
+    nodeToBuild->m_PendingCost = cost;
 
     // accumulate recursive cost
     cost += nodeToBuild->GetLastBuildTime();
@@ -1037,12 +2108,14 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
                     nodeToBuild->SetStatFlag( Node::STATS_FIRST_BUILD );
                 }
                 nodeToBuild->m_Stamp = 0;
+                nodeToBuild->m_UnsavedChanges = true;
 
                 // Regenerate dynamic dependencies
                 nodeToBuild->m_DynamicDependencies.Clear();
                 if ( nodeToBuild->DoDynamicDependencies( *this ) == false )
                 {
                     nodeToBuild->SetState( Node::FAILED );
+                    OnNodeCompleted( nodeToBuild );
                     return;
                 }
 
@@ -1069,6 +2142,21 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
             if ( ( nodeToBuild->GetStamp() == 0 ) || // Avoid redundant work in DetermineNeedToBuild
                  nodeToBuild->DetermineNeedToBuildDynamic() )
             {
+                // Input files with prefetched timestamps don't need a job
+                if ( s_UsePrefetchedFileStamps &&
+                     nodeToBuild->m_StampPrefetched &&
+                     nodeToBuild->CastTo< FileNode >()->UsePrefetchedStamp() )
+                {
+                    nodeToBuild->SetStatFlag( Node::STATS_BUILT );
+                    nodeToBuild->SetState( Node::UP_TO_DATE );
+                    OnNodeCompleted( nodeToBuild );
+                    return;
+                }
+
+                // Stamps retrieved before the build are stale for any files
+                // this job will write
+                InvalidatePrefetchedFileStamps( nodeToBuild );
+
                 nodeToBuild->m_RecursiveCost = cost;
                 JobQueue::Get().AddJobToBatch( nodeToBuild );
             }
@@ -1079,6 +2167,7 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
                     FLOG_BUILD_REASON( "Up-To-Date '%s'\n", nodeToBuild->GetName().Get() );
                 }
                 nodeToBuild->SetState( Node::UP_TO_DATE );
+                OnNodeCompleted( nodeToBuild );
             }
             break;
         }
@@ -1117,7 +2206,8 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
         Node::State state = n->GetState();
 
         // recurse into nodes which have not been processed yet
-        if ( state < Node::BUILDING )
+        // (nodes waiting on their own dependencies will resume when those complete)
+        if ( ( state < Node::BUILDING ) && ( n->m_NumPendingDependencies == 0 ) )
         {
             // early out if already seen
             if ( n->GetBuildPassTag() != passTag )
@@ -1156,10 +2246,16 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             {
                 // propagate failure state to this node
                 nodeToBuild->SetState( Node::FAILED );
-                break;
+                OnNodeCompleted( nodeToBuild );
+                return false;
             }
+            continue;
         }
 
+        // wait for dependency to complete before re-checking this node
+        n->m_PendingDependents.Append( nodeToBuild );
+        ++nodeToBuild->m_NumPendingDependencies;
+
         // keep trying to progress other nodes...
     }
 
@@ -1170,6 +2266,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             if ( numberNodesFailed > 0 )
             {
                 nodeToBuild->SetState( Node::FAILED );
+                OnNodeCompleted( nodeToBuild );
             }
         }
     }
@@ -1669,11 +2766,12 @@ void NodeGraph::FindNearestNodesInternal( const AString & fullPath, Array< NodeW
 
 // ReadHeaderAndUsedFiles
 //------------------------------------------------------------------------------
-bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, const char* nodeGraphDBFile, Array< UsedFile > & files, bool & compatibleDB, bool & movedDB ) const
+bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, const char* nodeGraphDBFile, Array< UsedFile > & files, FileWatcherSnapshot & fileWatcherSnapshot, bool & compatibleDB, bool & movedDB, uint64_t & contentHash ) const
 {
     // Assume good DB by default (cases below will change flags if needed)
     compatibleDB = true;
     movedDB = false;
+    contentHash = 0;
 
     // check for a valid header
     NodeGraphHeader ngh;
@@ -1701,6 +2799,7 @@ bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, con
         {
             return false; // DB is corrupt
         }
+        contentHash = hash;
     }
 
     // Read location where .fdb was originally saved
@@ -1757,6 +2856,12 @@ bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, con
         files.EmplaceBack( fileName, timeStamp, dataHash );
     }
 
+    if ( !nodeGraphStream.Read( fileWatcherSnapshot.m_InstanceId ) ||
+         !nodeGraphStream.Read( fileWatcherSnapshot.m_Sequence ) )
+    {
+        return false;
+    }
+
     return true;
 }
 
@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Tools/FBuild/FBuildCore/BFF/BFFFileExists.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
 #include "Tools/FBuild/FBuildCore/Helpers/SLNGenerator.h"
 #include "Tools/FBuild/FBuildCore/Helpers/VSProjectGenerator.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
@@ -64,7 +65,7 @@ public:
     }
     inline ~NodeGraphHeader() = default;
 
-    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 175 };
+    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 180 };
 
     bool IsValid() const;
     bool IsCompatibleVersion() const { return m_Version == NODE_GRAPH_CURRENT_VERSION; }
@@ -78,6 +79,48 @@ private:
     uint64_t    m_ContentHash;      // Hash of data excluding this header
 };
 
+// NodeGraphJournalHeader
+//------------------------------------------------------------------------------
+// Header of the journal of changes appended alongside a DB since it was last
+// saved in full. Only valid for the DB with the matching content hash.
+class NodeGraphJournalHeader
+{
+public:
+    inline explicit NodeGraphJournalHeader( uint64_t dbContentHash = 0 )
+    {
+        m_Identifier[ 0 ] = 'N';
+        m_Identifier[ 1 ] = 'G';
+        m_Identifier[ 2 ] = 'J';
+        m_Version = NodeGraphHeader::NODE_GRAPH_CURRENT_VERSION;
+        m_Padding = 0;
+        m_DBContentHash = dbContentHash;
+    }
+    inline ~NodeGraphJournalHeader() = default;
+
+    bool IsValid() const;
+
+    uint64_t    GetDBContentHash() const        { return m_DBContentHash; }
+private:
+    char        m_Identifier[ 3 ];
+    uint8_t     m_Version;
+    uint32_t    m_Padding;          // Unused
+    uint64_t    m_DBContentHash;    // Hash of DB content this journal applies to
+};
+
+// NodeGraphNodeRecord
+//------------------------------------------------------------------------------
+// Fixed layout entry for each node in the DB, read in place when loading.
+// Names are stored in a separate string table.
+class NodeGraphNodeRecord
+{
+public:
+    uint32_t    m_NameOffset;       // Offset of name in string table
+    uint32_t    m_NameLength;       // Length of name (excluding null terminator)
+    uint32_t    m_NameHash;
+    uint8_t     m_Type;
+    uint8_t     m_Padding[ 3 ];     // Unused
+};
+
 // NodeGraph
 //------------------------------------------------------------------------------
 class NodeGraph
@@ -101,6 +144,14 @@ public:
     LoadResult Load( ConstMemoryStream & stream, const char * nodeGraphDBFile );
     void Save( MemoryStream & stream, const char * nodeGraphDBFile ) const;
     void SerializeToText( const Dependencies & dependencies, AString & outBuffer ) const;
+
+    // Changes made by builds since the DB was last saved in full can be
+    // appended to a journal instead of saving the entire DB again
+    bool CanSaveJournal( const char * nodeGraphDBFile ) const;
+    bool SaveJournal( const char * nodeGraphDBFile );
+    void SaveJournalForCompletedNodes( const char * nodeGraphDBFile ); // During a build
+    void OnSaved( const char * nodeGraphDBFile, const MemoryStream & stream );
+    static void GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFile );
     void SerializeToDotFormat( const Dependencies & deps, const bool fullGraph, AString & outBuffer ) const;
 
     // access existing nodes
@@ -126,7 +177,10 @@ public:
         return CreateNode( T::GetTypeS(), name, sourceToken )->template CastTo<T>();
     }
 
+    void PrefetchFileStamps( Node * nodeToBuild );
     void DoBuildPass( Node * nodeToBuild );
+    void OnNodeCompleted( Node * node );
+    void ClearPendingDependencies();
 
     // Non-build operations that use the BuildPassTag can set it to a known value
     void SetBuildPassTagForAllNodes( uint32_t value ) const;
@@ -149,8 +203,10 @@ private:
 
     void AddNode( Node * node );
 
+    void ProcessReadyNodes();
     void BuildRecurse( Node * nodeToBuild, uint32_t cost );
     bool CheckDependencies( Node * nodeToBuild, const Dependencies & dependencies, uint32_t cost );
+    void InvalidatePrefetchedFileStamps( const Node * nodeToBuild );
     static void UpdateBuildStatusRecurse( const Node * node,
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
@@ -178,10 +234,37 @@ private:
     bool ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream,
                                  const char* nodeGraphDBFile,
                                  Array< UsedFile > & files,
+                                 FileWatcherSnapshot & fileWatcherSnapshot,
                                  bool & compatibleDB,
-                                 bool & movedDB ) const;
+                                 bool & movedDB,
+                                 uint64_t & contentHash ) const;
+    void SaveNodeRecords( IOStream & stream, size_t firstNode, size_t endNode ) const;
+    bool LoadNodeRecords( ConstMemoryStream & stream, uint32_t numNodes );
+    bool LoadJournal( const char * nodeGraphDBFile, uint64_t dbContentHash, uint64_t & outJournalSize, bool & outJournalIntact );
+    bool LoadJournalEntry( ConstMemoryStream & stream );
+    bool AppendJournalEntry( const char * nodeGraphDBFile,
+                             const FileWatcherSnapshot & fileWatcherSnapshot,
+                             uint32_t numNodes,
+                             const Array< Node * > & changedNodes,
+                             const Array< FileNode * > & changedFileNodes );
+    static uint32_t GetNumNodesToJournalFirst( const Node * node );
+    bool UpdateStoredFileStamps();
+    void DiscardStoredFileStamps();
     uint32_t GetLibEnvVarHash() const;
 
+    // Node properties and dependencies are serialized in chunks, in parallel
+    enum : uint32_t { DB_CHUNK_NUM_NODES = 1024 };
+    class DBChunk;
+    template < class T >
+    static void ProcessChunks( Array< T > & chunks, void (*func)( void * ) );
+    static void SaveDBChunkJob( void * userData );
+    static void LoadDBChunkJob( void * userData );
+
+    // Input file timestamps are retrieved in chunks, in parallel
+    enum : uint32_t { FILE_STAMP_CHUNK_NUM_FILES = 256 };
+    class FileStampChunk;
+    static void FileStampChunkJob( void * userData );
+
     void RegisterSourceToken( const Node * node, const BFFToken * sourceToken );
 
     // load/save helpers
@@ -229,7 +312,23 @@ private:
 
     const SettingsNode * m_Settings;
 
+    // DB journal tracking (only valid if m_DBFile is set)
+    AString         m_DBFile;               // DB this graph matches (loaded from or saved to)
+    uint64_t        m_DBContentHash;        // Content hash of that DB
+    uint64_t        m_DBSize;               // Size of that DB
+    uint64_t        m_JournalSize;          // Size of journal appended to that DB
+    uint32_t        m_NumNodesInDB;         // Nodes saved in the DB and journal (later nodes are new)
+    Array< Node * > m_CompletedNodesToJournal; // Nodes changed by the current build, not yet journaled
+
+    Array< FileNode * > m_PrefetchedFileNodes; // FileNodes with stamps retrieved before the current build
+
+    // Stored FileNode stamps are valid as of this point in the changes recorded
+    // by a FileWatcher, so only changed files need checking
+    FileWatcherSnapshot m_FileWatcherSnapshot;
+    bool            m_TrustStoredFileStamps;
+
     static uint32_t s_BuildPassTag;
+    static bool     s_UsePrefetchedFileStamps;  // Prefetched stamps are available for the current build
 };
 
 //------------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 #include "ObjectNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriverBase.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriver_CL.h"
@@ -28,6 +29,7 @@
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompilerServers.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
@@ -318,6 +320,16 @@ ObjectNode::~ObjectNode()
     return true;
 }
 
+// GetExtraOutputFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void ObjectNode::GetExtraOutputFiles( Array< AString > & outFileNames ) const
+{
+    if ( m_PCHObjectFileName.IsEmpty() == false )
+    {
+        outFileNames.Append( m_PCHObjectFileName );
+    }
+}
+
 // Migrate
 //------------------------------------------------------------------------------
 /*virtual*/ void ObjectNode::Migrate( const Node & oldNode )
@@ -424,7 +436,7 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     if ( useCache && GetCompiler()->GetUseLightCache() )
     {
         LightCache lc;
-        if ( lc.Hash( this, fullArgs.GetRawArgs(), m_LightCacheKey, m_Includes ) == false )
+        if ( lc.Hash( GetSourceFile()->GetName(), fullArgs.GetRawArgs(), m_LightCacheKey, m_Includes ) == false )
         {
             // Light cache could not be used (can't parse includes)
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -1397,6 +1409,63 @@ const AString & ObjectNode::GetCacheName( Job * job ) const
     return job->GetCacheName();
 }
 
+// GetRemoteCacheName
+//------------------------------------------------------------------------------
+bool ObjectNode::GetRemoteCacheName( const Job * job, AString & outCacheName ) const
+{
+    ASSERT( job->IsLocal() == false );
+    ASSERT( job->IsDataCompressed() == false ); // Must hash the preprocessed source itself
+
+    // Only cache what the client would
+    if ( ( IsCacheable() == false ) || ( job->GetToolManifest() == nullptr ) )
+    {
+        return false;
+    }
+
+    // The precompiled header is only known to the client
+    if ( IsUsingPCH() && IsMSVC() )
+    {
+        return false;
+    }
+
+    PROFILE_FUNCTION;
+
+    // The worker doesn't have the client's full args, so the key is built from
+    // the equivalent parts of the job as sent
+    const uint64_t preprocessedSourceKey = xxHash3::Calc64( job->GetData(), job->GetDataSize() );
+
+    // Args as sent, along with anything else which affects the remote compile
+    // (the source file name is the same as on the client, and can appear in the output)
+    AStackString< 4096 > environment( m_CompilerOptions );
+    environment.AppendFormat( "|%08X|", m_CompilerFlags.m_Flags );
+    environment += job->GetRemoteSourceRoot();
+    environment += '|';
+    const char * lastSlash = job->GetRemoteName().FindLast( NATIVE_SLASH );
+    environment += lastSlash ? ( lastSlash + 1 ) : job->GetRemoteName().Get();
+    const uint32_t commandLineKey = xxHash::Calc32( environment );
+
+    const uint64_t toolChainKey = job->GetToolManifest()->GetToolId();
+
+    ICache::GetCacheId( preprocessedSourceKey, commandLineKey, toolChainKey, 0, outCacheName );
+    return true;
+}
+
+// SetRemoteOutputName
+//------------------------------------------------------------------------------
+bool ObjectNode::SetRemoteOutputName( const Job * job )
+{
+    ASSERT( job->IsLocal() == false );
+
+    // file name should be the same as on host
+    const char * fileName = ( job->GetRemoteName().FindLast( NATIVE_SLASH ) + 1 );
+
+    AStackString<> tmpFileName;
+    WorkerThread::CreateTempFilePath( fileName, tmpFileName );
+    ReplaceDummyName( tmpFileName );
+
+    return FileIO::EnsurePathExistsForFile( tmpFileName );
+}
+
 // RetrieveFromCache
 //------------------------------------------------------------------------------
 bool ObjectNode::RetrieveFromCache( Job * job )
@@ -1415,66 +1484,71 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     ICache * cache = FBuild::Get().GetCache();
     ASSERT( cache );
 
-    void * cacheData( nullptr );
-    size_t cacheDataSize( 0 );
-    if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+    IOStream * cacheStream( nullptr );
+    uint64_t cacheDataSize( 0 );
+    if ( cache->RetrieveStream( cacheFileName, cacheStream, cacheDataSize ) )
     {
+        const UniquePtr< IOStream > cacheStreamDeleter( cacheStream );
         const uint32_t retrieveTime = uint32_t( t.GetElapsedMS() );
 
-        // Hash the PCH result if we will need it later
-        uint64_t pchKey = 0;
+        // Hash the PCH result as it's read if we will need it later
+        UniquePtr< xxHash3Accumulator > pchKeyAccumulator;
         if ( IsCreatingPCH() && IsMSVC() )
         {
-            pchKey = xxHash3::Calc64( cacheData, cacheDataSize );
-        }
-
-        const uint32_t startDecompress = uint32_t( t.GetElapsedMS() );
-
-        MultiBuffer buffer( cacheData, cacheDataSize );
-
-        // do decompression
-        if ( buffer.Decompress() == false )
-        {
-            FLOG_WARN( "Cache returned invalid data\n"
-                       " - File: '%s'\n"
-                       " - Key : %s\n",
-                       m_Name.Get(), cacheFileName.Get() );
-            cache->FreeMemory( cacheData, cacheDataSize );
-            return false;
+            pchKeyAccumulator = FNEW( xxHash3Accumulator );
         }
-        const size_t uncompressedDataSize = buffer.GetDataSize();
-        const uint32_t stopDecompress = uint32_t( t.GetElapsedMS() );
 
         Array< AString > fileNames( 4 );
         fileNames.Append( m_Name );
 
         GetExtraCacheFilePaths( job, fileNames );
 
-        // Extract the files
-        const size_t numFiles = fileNames.GetSize();
-        for ( size_t i=0; i<numFiles; ++i )
+        // Decompress the files directly to disk
+        DecompressionStream stream( *cacheStream, cacheDataSize, pchKeyAccumulator.Get(), FBuild::Get().GetCacheDictionaries() );
+        const bool streamOpened = stream.Open();
+        if ( ( streamOpened == false ) && stream.IsDictionaryMissing() )
         {
-            if ( !buffer.ExtractFile( i, fileNames[ i ] ) )
+            // The dictionary the entry was compressed with has been trimmed from the
+            // cache, so this is a miss (and storing the result replaces the entry)
+            if ( FBuild::Get().GetOptions().m_CacheVerbose )
             {
-                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ i ].Get() );
-                cache->FreeMemory( cacheData, cacheDataSize );
-                return false;
+                FLOG_OUTPUT( "Obj: %s\n"
+                             " - Cache Miss (compression dictionary missing): %u ms '%s'\n",
+                             GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
             }
+            SetStatFlag( Node::STATS_CACHE_MISS );
+            return false;
+        }
+        size_t problemFileIndex = fileNames.GetSize();
+        if ( ( streamOpened == false ) ||
+             ( MultiBuffer::ExtractFiles( stream, fileNames, &problemFileIndex ) == false ) )
+        {
+            if ( problemFileIndex < fileNames.GetSize() )
+            {
+                FLOG_ERROR( "Failed to write local file during cache retrieval '%s'", fileNames[ problemFileIndex ].Get() );
+            }
+            else
+            {
+                FLOG_WARN( "Cache returned invalid data\n"
+                           " - File: '%s'\n"
+                           " - Key : %s\n",
+                           m_Name.Get(), cacheFileName.Get() );
+            }
+            return false;
+        }
+        const uint64_t uncompressedDataSize = stream.GetUncompressedSize();
+        const uint32_t extractTime = ( uint32_t( t.GetElapsedMS() ) - retrieveTime );
 
-            // Update file modification time
-            const bool timeSetOK = FileIO::SetFileLastWriteTimeToNow( fileNames[ i ] );
-
-            // set the time on the local file
-            if ( timeSetOK == false )
+        // Update file modification times
+        for ( const AString & fileName : fileNames )
+        {
+            if ( FileIO::SetFileLastWriteTimeToNow( fileName ) == false )
             {
-                FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileNames[ i ].Get() );
-                cache->FreeMemory( cacheData, cacheDataSize );
+                FLOG_ERROR( "Failed to set timestamp after cache hit. Error: %s Target: '%s'", LAST_ERROR_STR, fileName.Get() );
                 return false;
             }
         }
 
-        cache->FreeMemory( cacheData, cacheDataSize );
-
         FileIO::WorkAroundForWindowsFilePermissionProblem( m_Name );
 
         // record new file time (note that time may differ from what we set above due to
@@ -1489,7 +1563,7 @@ bool ObjectNode::RetrieveFromCache( Job * job )
             output.Format( "Obj: %s <CACHE>\n", GetName().Get() );
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
             {
-                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Decompress: %u ms) (Compressed: %zu - Uncompressed: %zu) '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, stopDecompress - startDecompress, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
+                output.AppendFormat( " - Cache Hit: %u ms (Retrieve: %u ms - Extract: %u ms) (Compressed: %" PRIu64 " - Uncompressed: %" PRIu64 ") '%s'\n", uint32_t( t.GetElapsedMS() ), retrieveTime, extractTime, cacheDataSize, uncompressedDataSize, cacheFileName.Get() );
             }
             FLOG_OUTPUT( output );
         }
@@ -1497,9 +1571,9 @@ bool ObjectNode::RetrieveFromCache( Job * job )
         SetStatFlag( Node::STATS_CACHE_HIT );
 
         // Dependent objects need to know the PCH key to be able to pull from the cache
-        if ( IsCreatingPCH() && IsMSVC() )
+        if ( pchKeyAccumulator.Get() )
         {
-            m_PCHCacheKey = pchKey;
+            m_PCHCacheKey = pchKeyAccumulator->Finalize64();
         }
 
         job->GetBuildProfilerScope()->SetStepName( "Cache Hit" );
@@ -1570,6 +1644,9 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
     const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
     Compressor c;
     const int16_t compressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
+    CacheDictionaries * dictionaries = FBuild::Get().GetCacheDictionaries();
+    const CompressionDictionary * dictionary = nullptr;
+    uint64_t toolId = 0;
     if (compressionLevel <= 0)
     {
         // Use LZ4 for low compression levels (level < 0)
@@ -1578,8 +1655,15 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
     }
     else
     {
-        // Use Ztd for higher compression levels (level > 0)
-        c.CompressZstd(uncompressedData, uncompressedDataSize, compressionLevel );
+        // Use Ztd for higher compression levels (level > 0), with the toolchain's
+        // dictionary once there is one (until then, entries train the dictionary)
+        toolId = GetCompiler()->CastTo< CompilerNode >()->GetManifest().GetToolId();
+        dictionary = dictionaries ? dictionaries->GetDictionary( toolId ) : nullptr;
+        c.CompressZstd(uncompressedData, uncompressedDataSize, compressionLevel, dictionary );
+        if ( dictionaries && ( dictionary == nullptr ) )
+        {
+            dictionaries->AddSample( toolId, uncompressedData, (size_t)uncompressedDataSize );
+        }
     }
     const uint32_t compressionTime = ( (uint32_t)t.GetElapsedMS() - startCompress );
 
@@ -1587,6 +1671,12 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
                                      c.GetResult(),
                                      static_cast<uint64_t>( c.GetResultSize() ),
                                      compressionTime );
+
+    // Keep the dictionary in the cache for as long as entries using it are
+    if ( dictionary )
+    {
+        dictionaries->OnEntryStored( toolId, *dictionary );
+    }
 }
 
 // WriteToCache_FromCompressedData
@@ -2075,14 +2165,11 @@ void ObjectNode::TransferPreprocessedData( const char * data, size_t dataSize, J
 
 // WriteTmpFile
 //------------------------------------------------------------------------------
-bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName ) const
+bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName )
 {
     ASSERT( job->GetData() && job->GetDataSize() );
 
     const Node * sourceFile = GetSourceFile();
-    const uint32_t sourceNameHash = xxHash::Calc32( sourceFile->GetName().Get(), sourceFile->GetName().GetLength() );
-
-    FileStream tmpFile;
     AStackString<> fileName( sourceFile->GetName().FindLast( NATIVE_SLASH ) + 1 );
     if ( IsGCC() )
     {
@@ -2157,16 +2244,67 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
         dataToWriteSize = c.GetResultSize();
     }
 
+    AStackString<> error;
+    if ( WriteTmpFileInternal( fileName.Get(), dataToWrite, dataToWriteSize, tmpDirectory, tmpFileName, error ) == false )
+    {
+        // The memory backed temp dir can fill up, so retry in the regular
+        // temp dir, moving the outputs there too
+        const bool retry = WorkerThread::IsUsingMemoryBackedTempDir();
+        if ( retry )
+        {
+            if ( tmpFileName.IsEmpty() == false )
+            {
+                FileIO::FileDelete( tmpFileName.Get() );
+                FileIO::DirectoryDelete( tmpDirectory );
+            }
+            WorkerThread::UseDiskTempDirForJob();
+        }
+        if ( ( retry == false ) ||
+             ( SetRemoteOutputName( job ) == false ) ||
+             ( WriteTmpFileInternal( fileName.Get(), dataToWrite, dataToWriteSize, tmpDirectory, tmpFileName, error ) == false ) )
+        {
+            job->ErrorPreformatted( error.Get() );
+            job->OnSystemError();
+            return false;
+        }
+    }
+
+    FileIO::WorkAroundForWindowsFilePermissionProblem( tmpFileName );
+
+    // On remote workers, free compressed buffer as we don't need it anymore
+    // This reduces memory consumed on the remote worker.
+    if ( job->IsLocal() == false )
+    {
+        job->OwnData( nullptr, 0, false ); // Free compressed buffer
+    }
+
+    return true;
+}
+
+// WriteTmpFileInternal
+//------------------------------------------------------------------------------
+bool ObjectNode::WriteTmpFileInternal( const char * fileName,
+                                       const void * data,
+                                       size_t dataSize,
+                                       AString & tmpDirectory,
+                                       AString & tmpFileName,
+                                       AString & outError ) const
+{
+    const Node * sourceFile = GetSourceFile();
+    const uint32_t sourceNameHash = xxHash::Calc32( sourceFile->GetName().Get(), sourceFile->GetName().GetLength() );
+
     WorkerThread::GetTempFileDirectory( tmpDirectory );
     tmpDirectory.AppendFormat( "%08X%c", sourceNameHash, NATIVE_SLASH );
+    tmpFileName.Clear();
     if ( FileIO::DirectoryCreate( tmpDirectory ) == false )
     {
-        job->Error( "Failed to create temp directory. Error: %s TmpDir: '%s' Target: '%s'", LAST_ERROR_STR, tmpDirectory.Get(), GetName().Get() );
-        job->OnSystemError();
+        outError.Format( "Failed to create temp directory. Error: %s TmpDir: '%s' Target: '%s'", LAST_ERROR_STR, tmpDirectory.Get(), GetName().Get() );
         return false;
     }
     tmpFileName = tmpDirectory;
     tmpFileName += fileName;
+
+    FileStream tmpFile;
     if ( WorkerThread::CreateTempFile( tmpFileName, tmpFile ) == false )
     {
         FileIO::WorkAroundForWindowsFilePermissionProblem( tmpFileName, FileStream::WRITE_ONLY, 10 ); // 10s max wait
@@ -2174,28 +2312,16 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
         // Try again
         if ( WorkerThread::CreateTempFile( tmpFileName, tmpFile ) == false )
         {
-            job->Error( "Failed to create temp file. Error: %s TmpFile: '%s' Target: '%s'", LAST_ERROR_STR, tmpFileName.Get(), GetName().Get() );
-            job->OnSystemError();
+            outError.Format( "Failed to create temp file. Error: %s TmpFile: '%s' Target: '%s'", LAST_ERROR_STR, tmpFileName.Get(), GetName().Get() );
             return false;
         }
     }
-    if ( tmpFile.Write( dataToWrite, dataToWriteSize ) != dataToWriteSize )
+    if ( tmpFile.Write( data, dataSize ) != dataSize )
     {
-        job->Error( "Failed to write to temp file. Error: %s TmpFile: '%s' Target: '%s'", LAST_ERROR_STR, tmpFileName.Get(), GetName().Get() );
-        job->OnSystemError();
+        outError.Format( "Failed to write to temp file. Error: %s TmpFile: '%s' Target: '%s'", LAST_ERROR_STR, tmpFileName.Get(), GetName().Get() );
         return false;
     }
     tmpFile.Close();
-
-    FileIO::WorkAroundForWindowsFilePermissionProblem( tmpFileName );
-
-    // On remote workers, free compressed buffer as we don't need it anymore
-    // This reduces memory consumed on the remote worker.
-    if ( job->IsLocal() == false )
-    {
-        job->OwnData( nullptr, 0, false ); // Free compressed buffer
-    }
-
     return true;
 }
 
@@ -2301,7 +2427,10 @@ Node::BuildResult ObjectNode::BuildFinalOutput( Job * job, const Args & fullArgs
 //------------------------------------------------------------------------------
 ObjectNode::CompileHelper::CompileHelper( bool handleOutput, const volatile bool * abortPointer )
     : m_HandleOutput( handleOutput )
+    , m_AbortFlag( abortPointer )
     , m_Process( FBuild::GetAbortBuildPointer(), abortPointer )
+    , m_Out( WorkerThread::GetArena(), 1 * MEGABYTE ) // Most compiler output fits (larger preprocessed output grows on the heap)
+    , m_Err( WorkerThread::GetArena(), 64 * KILOBYTE )
     , m_Result( 0 )
 {
 }
@@ -2329,30 +2458,53 @@ Node::BuildResult ObjectNode::CompileHelper::SpawnCompiler( Job * job,
         environmentString = compilerNode->GetEnvironmentString();
     }
 
-    // spawn the process
-    if ( false == m_Process.Spawn( compiler.Get(),
-                                   fullArgs.GetFinalArgs().Get(),
-                                   workingDir,
-                                   environmentString ) )
+    // use a long-lived compiler server if available
+    bool compiled = false;
+    if ( job->IsLocal() && ( compilerNode->GetCompilerServer().IsEmpty() == false ) )
     {
-        if ( m_Process.HasAborted() )
+        const CompilerServers::Result result = FBuild::Get().GetCompilerServers()->Compile( compilerNode,
+                                                                                            compiler,
+                                                                                            fullArgs.GetFinalArgs(),
+                                                                                            workingDir,
+                                                                                            job->GetNode()->GetLastBuildTime(),
+                                                                                            m_AbortFlag,
+                                                                                            m_Result,
+                                                                                            m_Out,
+                                                                                            m_Err );
+        if ( result == CompilerServers::Result::eAborted )
         {
             return BuildResult::eAborted;
         }
-
-        job->Error( "Failed to spawn process. Error: %s Target: '%s'\n", LAST_ERROR_STR, name.Get() );
-        job->OnSystemError();
-        return BuildResult::eFailed;
+        compiled = ( result == CompilerServers::Result::eOk );
     }
 
-    // capture all of the stdout and stderr
-    m_Process.ReadAllData( m_Out, m_Err );
-
-    // Get result
-    m_Result = m_Process.WaitForExit();
-    if ( m_Process.HasAborted() )
+    if ( compiled == false )
     {
-        return BuildResult::eAborted;
+        // spawn the process
+        if ( false == m_Process.Spawn( compiler.Get(),
+                                       fullArgs.GetFinalArgs().Get(),
+                                       workingDir,
+                                       environmentString ) )
+        {
+            if ( m_Process.HasAborted() )
+            {
+                return BuildResult::eAborted;
+            }
+
+            job->Error( "Failed to spawn process. Error: %s Target: '%s'\n", LAST_ERROR_STR, name.Get() );
+            job->OnSystemError();
+            return BuildResult::eFailed;
+        }
+
+        // capture all of the stdout and stderr
+        m_Process.ReadAllData( m_Out, m_Err );
+
+        // Get result
+        m_Result = m_Process.WaitForExit();
+        if ( m_Process.HasAborted() )
+        {
+            return BuildResult::eAborted;
+        }
     }
 
     // Handle special types of failures
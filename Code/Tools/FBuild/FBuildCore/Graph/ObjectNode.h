@@ -12,6 +12,7 @@
 #include "Core/Env/Assert.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Process.h"
+#include "Core/Strings/AArenaString.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -161,6 +162,12 @@ public:
     void GetNativeAnalysisXMLPath( AString& outXMLFileName ) const;
     void GetGCNOPath( AString & gcnoFileName ) const;
 
+    // Key for the worker-side result cache (false if the job can't be cached)
+    bool GetRemoteCacheName( const Job * job, AString & outCacheName ) const;
+
+    // Remote jobs output to the worker thread's temp dir (false if it can't be created)
+    bool SetRemoteOutputName( const Job * job );
+
     const char * GetObjExtension() const;
 
     const AString & GetPCHObjectName() const { return m_PCHObjectFileName; }
@@ -184,6 +191,7 @@ private:
     virtual BuildResult DoBuild( Job * job ) override;
     virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
     virtual bool Finalize( NodeGraph & nodeGraph ) override;
+    virtual void GetExtraOutputFiles( Array< AString > & outFileNames ) const override;
 
     virtual void Migrate( const Node & oldNode ) override;
 
@@ -226,7 +234,8 @@ private:
     BuildResult BuildPreprocessedOutput( const Args & fullArgs, Job * job, bool useDeoptimization ) const;
     bool LoadStaticSourceFileForDistribution( const Args & fullArgs, Job * job, bool useDeoptimization ) const;
     void TransferPreprocessedData( const char * data, size_t dataSize, Job * job ) const;
-    bool WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName ) const;
+    bool WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpFileName );
+    bool WriteTmpFileInternal( const char * fileName, const void * data, size_t dataSize, AString & tmpDirectory, AString & tmpFileName, AString & outError ) const;
     BuildResult BuildFinalOutput( Job * job, const Args & fullArgs ) const;
 
     static void HandleSystemFailures( Job * job, int result, const AString & stdOut, const AString & stdErr );
@@ -268,9 +277,10 @@ private:
 
     private:
         bool            m_HandleOutput;
+        const volatile bool * m_AbortFlag;
         Process         m_Process;
-        AString         m_Out;
-        AString         m_Err;
+        AArenaString    m_Out;
+        AArenaString    m_Err;
         int             m_Result;
     };
 
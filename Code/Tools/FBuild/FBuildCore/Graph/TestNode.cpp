@@ -10,11 +10,13 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/DirectoryListNode.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
 
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Strings/AArenaString.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Process/Process.h"
 
@@ -197,8 +199,8 @@ const char * TestNode::GetEnvironmentString() const
     }
 
     // capture all of the stdout and stderr
-    AString memOut;
-    AString memErr;
+    AArenaString memOut( WorkerThread::GetArena(), 64 * KILOBYTE );
+    AArenaString memErr( WorkerThread::GetArena(), 64 * KILOBYTE );
     const bool timedOut = !p.ReadAllData( memOut, memErr, m_TestTimeOut * 1000 );
 
     // Get result
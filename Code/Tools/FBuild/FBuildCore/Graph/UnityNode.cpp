@@ -606,6 +606,14 @@ UnityNode::~UnityNode()
     return BuildResult::eOk;
 }
 
+// GetExtraOutputFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void UnityNode::GetExtraOutputFiles( Array< AString > & outFileNames ) const
+{
+    // Names from the previous build, which can be inputs of existing ObjectNodes
+    outFileNames.Append( m_UnityFileNames );
+}
+
 // Migrate
 //------------------------------------------------------------------------------
 /*virtual*/ void UnityNode::Migrate( const Node & oldNode )
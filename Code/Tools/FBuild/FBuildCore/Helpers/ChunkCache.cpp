@@ -0,0 +1,519 @@
+// ChunkCache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ChunkCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <string.h> // for memcpy
+
+// Gear hash
+//------------------------------------------------------------------------------
+namespace
+{
+    // Random values for each byte, generated with SplitMix64. These must never
+    // change, as both sides of a connection must find the same chunk boundaries.
+    struct GearTable
+    {
+        constexpr GearTable()
+            : m_Values()
+        {
+            uint64_t state = 0x464153544255494CULL;
+            for ( uint64_t & value : m_Values )
+            {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+                z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+                value = z ^ ( z >> 31 );
+            }
+        }
+        uint64_t m_Values[ 256 ];
+    };
+    static constexpr GearTable s_GearTable;
+
+    // The top bits of the hash depend on the most recent 64 bytes. Testing 13 of
+    // them gives an average of 8KiB between boundaries (beyond the minimum size)
+    static constexpr uint64_t kBoundaryMask = 0xFFF8000000000000ULL;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ChunkCache::ChunkCache( bool storeData, uint64_t capacity )
+    : m_StoreData( storeData )
+    , m_AwaitingNewGeneration( false )
+    , m_Generation( 0 )
+    , m_Capacity( capacity )
+    , m_NumChunks( 0 )
+    , m_TotalSize( 0 )
+    , m_MostRecent( INVALID_INDEX )
+    , m_LeastRecent( INVALID_INDEX )
+    , m_FirstFree( INVALID_INDEX )
+{
+    m_Buckets.SetSize( NUM_BUCKETS );
+    for ( uint32_t & bucket : m_Buckets )
+    {
+        bucket = INVALID_INDEX;
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+ChunkCache::~ChunkCache()
+{
+    Reset();
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void ChunkCache::Clear()
+{
+    Reset();
+    ++m_Generation;
+}
+
+// Reset
+//------------------------------------------------------------------------------
+void ChunkCache::Reset()
+{
+    for ( Chunk & chunk : m_Chunks )
+    {
+        FREE( chunk.m_Data );
+    }
+    m_Chunks.Clear();
+    for ( uint32_t & bucket : m_Buckets )
+    {
+        bucket = INVALID_INDEX;
+    }
+    m_NumChunks = 0;
+    m_TotalSize = 0;
+    m_MostRecent = INVALID_INDEX;
+    m_LeastRecent = INVALID_INDEX;
+    m_FirstFree = INVALID_INDEX;
+}
+
+// Encode
+//------------------------------------------------------------------------------
+void ChunkCache::Encode( const void * data, size_t dataSize, int32_t compressionLevel, bool includeGeneration, MemoryStream & outStream )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( dataSize <= 0xFFFFFFFF ); // only 32bit data supported
+
+    Array< uint32_t > chunkSizes( ( dataSize / ( MIN_CHUNK_SIZE * 4 ) ) + 1 );
+    FindChunks( data, dataSize, chunkSizes );
+
+    // Write the list of chunks, noting those the receiver doesn't have yet
+    if ( includeGeneration )
+    {
+        outStream.Write( m_Generation );
+    }
+    outStream.Write( static_cast< uint32_t >( dataSize ) );
+    outStream.Write( static_cast< uint32_t >( chunkSizes.GetSize() ) );
+    MemoryStream newChunks;
+    const char * pos = static_cast< const char * >( data );
+    for ( const uint32_t chunkSize : chunkSizes )
+    {
+        const uint64_t hash = xxHash3::Calc64( pos, chunkSize );
+        uint32_t sizeAndFlags = chunkSize;
+        const uint32_t index = Find( hash );
+        if ( index != INVALID_INDEX )
+        {
+            Touch( index );
+        }
+        else
+        {
+            Insert( hash, pos, chunkSize );
+            newChunks.WriteBuffer( pos, chunkSize );
+            sizeAndFlags |= NEW_CHUNK_FLAG;
+        }
+        outStream.Write( hash );
+        outStream.Write( sizeAndFlags );
+        pos += chunkSize;
+    }
+
+    // Write the contents of the new chunks
+    if ( newChunks.GetSize() == 0 )
+    {
+        outStream.Write( static_cast< uint32_t >( 0 ) );
+        return;
+    }
+    Compressor c;
+    c.Compress( newChunks.GetData(), newChunks.GetSize(), compressionLevel );
+    outStream.Write( static_cast< uint32_t >( c.GetResultSize() ) );
+    outStream.WriteBuffer( c.GetResult(), c.GetResultSize() );
+}
+
+// Decode
+//------------------------------------------------------------------------------
+bool ChunkCache::Decode( const void * encodedData, size_t encodedDataSize, ChunkStore & store, bool includeGeneration, void * & outData, size_t & outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_StoreData == false ); // Contents are kept in the store
+
+    if ( DecodeInternal( encodedData, encodedDataSize, store, includeGeneration, outData, outDataSize ) )
+    {
+        return true;
+    }
+
+    // We no longer know which chunks the sender thinks we have, so reject
+    // everything until it starts again
+    Reset();
+    m_AwaitingNewGeneration = true;
+    return false;
+}
+
+// DecodeInternal
+//------------------------------------------------------------------------------
+bool ChunkCache::DecodeInternal( const void * encodedData, size_t encodedDataSize, ChunkStore & store, bool includeGeneration, void * & outData, size_t & outDataSize )
+{
+    ConstMemoryStream ms( encodedData, encodedDataSize );
+
+    // Follow the sender when it starts a new generation
+    if ( includeGeneration )
+    {
+        uint32_t generation;
+        if ( ms.Read( generation ) == false )
+        {
+            return false;
+        }
+        if ( generation != m_Generation )
+        {
+            if ( static_cast< int32_t >( generation - m_Generation ) < 0 )
+            {
+                return false; // Encoded before the sender last started again
+            }
+            Reset();
+            m_Generation = generation;
+            m_AwaitingNewGeneration = false;
+        }
+    }
+    if ( m_AwaitingNewGeneration )
+    {
+        return false;
+    }
+
+    uint32_t dataSize;
+    uint32_t numChunks;
+    if ( ( ms.Read( dataSize ) == false ) || ( ms.Read( numChunks ) == false ) )
+    {
+        return false;
+    }
+
+    // Find and decompress the contents of new chunks, which follow the list
+    const uint64_t listPos = ms.Tell();
+    const uint64_t listSize = ( static_cast< uint64_t >( numChunks ) * ( sizeof( uint64_t ) + sizeof( uint32_t ) ) );
+    uint32_t newChunksSize = 0;
+    if ( ( ( listPos + listSize ) > encodedDataSize ) ||
+         ( ms.Seek( listPos + listSize ) == false ) ||
+         ( ms.Read( newChunksSize ) == false ) ||
+         ( ( ms.Tell() + newChunksSize ) != encodedDataSize ) )
+    {
+        return false;
+    }
+    Compressor c;
+    const char * newChunks = nullptr;
+    size_t newChunksRemaining = 0;
+    if ( newChunksSize > 0 )
+    {
+        const void * compressed = ( static_cast< const char * >( encodedData ) + ms.Tell() );
+        if ( ( Compressor::IsValidData( compressed, newChunksSize ) == false ) ||
+             ( c.Decompress( compressed ) == false ) )
+        {
+            return false;
+        }
+        newChunks = static_cast< const char * >( c.GetResult() );
+        newChunksRemaining = c.GetResultSize();
+    }
+
+    // Rebuild the data, updating the cache in the same order as the sender
+    UniquePtr< char, FreeDeletor > data( static_cast< char * >( ALLOC( dataSize ) ) );
+    uint32_t dataWritten = 0;
+    VERIFY( ms.Seek( listPos ) );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        uint64_t hash;
+        uint32_t sizeAndFlags;
+        VERIFY( ms.Read( hash ) );
+        VERIFY( ms.Read( sizeAndFlags ) );
+        const uint32_t chunkSize = ( sizeAndFlags & ~NEW_CHUNK_FLAG );
+        if ( ( chunkSize == 0 ) || ( chunkSize > MAX_CHUNK_SIZE ) || ( chunkSize > ( dataSize - dataWritten ) ) )
+        {
+            return false;
+        }
+
+        if ( sizeAndFlags & NEW_CHUNK_FLAG )
+        {
+            if ( ( chunkSize > newChunksRemaining ) || ( Find( hash ) != INVALID_INDEX ) )
+            {
+                return false;
+            }
+            memcpy( data.Get() + dataWritten, newChunks, chunkSize );
+            Insert( hash, nullptr, chunkSize );
+            store.Store( hash, newChunks, chunkSize );
+            newChunks += chunkSize;
+            newChunksRemaining -= chunkSize;
+        }
+        else
+        {
+            const uint32_t index = Find( hash );
+            if ( ( index == INVALID_INDEX ) || ( m_Chunks[ index ].m_Size != chunkSize ) )
+            {
+                return false; // Sender and receiver are out of sync
+            }
+            if ( store.Retrieve( hash, chunkSize, data.Get() + dataWritten ) == false )
+            {
+                return false; // Evicted to make space for chunks from other connections
+            }
+            Touch( index );
+        }
+        dataWritten += chunkSize;
+    }
+    if ( ( dataWritten != dataSize ) || ( newChunksRemaining != 0 ) )
+    {
+        return false;
+    }
+
+    outData = data.ReleaseOwnership();
+    outDataSize = dataSize;
+    return true;
+}
+
+// FindChunks
+//------------------------------------------------------------------------------
+/*static*/ void ChunkCache::FindChunks( const void * data, size_t dataSize, Array< uint32_t > & outChunkSizes )
+{
+    const uint8_t * chunkStart = static_cast< const uint8_t * >( data );
+    const uint8_t * const end = ( chunkStart + dataSize );
+    while ( chunkStart < end )
+    {
+        const size_t remaining = static_cast< size_t >( end - chunkStart );
+        if ( remaining <= MIN_CHUNK_SIZE )
+        {
+            outChunkSizes.Append( static_cast< uint32_t >( remaining ) );
+            break;
+        }
+
+        // Look for a boundary between the min and max sizes
+        const uint8_t * const maxEnd = ( remaining > MAX_CHUNK_SIZE ) ? ( chunkStart + MAX_CHUNK_SIZE ) : end;
+        const uint8_t * pos = ( chunkStart + MIN_CHUNK_SIZE );
+        uint64_t hash = 0;
+        while ( pos < maxEnd )
+        {
+            hash = ( hash << 1 ) + s_GearTable.m_Values[ *pos ];
+            ++pos;
+            if ( ( hash & kBoundaryMask ) == 0 )
+            {
+                break;
+            }
+        }
+        outChunkSizes.Append( static_cast< uint32_t >( pos - chunkStart ) );
+        chunkStart = pos;
+    }
+}
+
+// Find
+//------------------------------------------------------------------------------
+uint32_t ChunkCache::Find( uint64_t hash ) const
+{
+    uint32_t index = m_Buckets[ hash % NUM_BUCKETS ];
+    while ( index != INVALID_INDEX )
+    {
+        const Chunk & chunk = m_Chunks[ index ];
+        if ( chunk.m_Hash == hash )
+        {
+            return index;
+        }
+        index = chunk.m_NextInBucket;
+    }
+    return INVALID_INDEX;
+}
+
+// Touch
+//------------------------------------------------------------------------------
+void ChunkCache::Touch( uint32_t index )
+{
+    if ( index != m_MostRecent )
+    {
+        Unlink( index );
+        LinkMostRecent( index );
+    }
+}
+
+// Insert
+//------------------------------------------------------------------------------
+void ChunkCache::Insert( uint64_t hash, const void * data, uint32_t size )
+{
+    ASSERT( Find( hash ) == INVALID_INDEX );
+
+    // Make space
+    while ( ( m_TotalSize + size ) > m_Capacity )
+    {
+        EvictLeastRecent();
+    }
+
+    // Reuse a free entry if possible
+    uint32_t index = m_FirstFree;
+    if ( index != INVALID_INDEX )
+    {
+        m_FirstFree = m_Chunks[ index ].m_NextInBucket;
+    }
+    else
+    {
+        index = static_cast< uint32_t >( m_Chunks.GetSize() );
+        m_Chunks.SetSize( index + 1 );
+    }
+
+    Chunk & chunk = m_Chunks[ index ];
+    chunk.m_Hash = hash;
+    chunk.m_Data = nullptr;
+    chunk.m_Size = size;
+    if ( m_StoreData )
+    {
+        chunk.m_Data = ALLOC( size );
+        memcpy( chunk.m_Data, data, size );
+    }
+
+    uint32_t & bucket = m_Buckets[ hash % NUM_BUCKETS ];
+    chunk.m_NextInBucket = bucket;
+    bucket = index;
+    LinkMostRecent( index );
+
+    ++m_NumChunks;
+    m_TotalSize += size;
+}
+
+// EvictLeastRecent
+//------------------------------------------------------------------------------
+void ChunkCache::EvictLeastRecent()
+{
+    const uint32_t index = m_LeastRecent;
+    ASSERT( index != INVALID_INDEX );
+    Chunk & chunk = m_Chunks[ index ];
+
+    // Remove from bucket
+    uint32_t * link = &m_Buckets[ chunk.m_Hash % NUM_BUCKETS ];
+    while ( *link != index )
+    {
+        link = &m_Chunks[ *link ].m_NextInBucket;
+    }
+    *link = chunk.m_NextInBucket;
+
+    Unlink( index );
+
+    FREE( chunk.m_Data );
+    chunk.m_Data = nullptr;
+    --m_NumChunks;
+    m_TotalSize -= chunk.m_Size;
+
+    // Add to free list
+    chunk.m_NextInBucket = m_FirstFree;
+    m_FirstFree = index;
+}
+
+// LinkMostRecent
+//------------------------------------------------------------------------------
+void ChunkCache::LinkMostRecent( uint32_t index )
+{
+    Chunk & chunk = m_Chunks[ index ];
+    chunk.m_MoreRecent = INVALID_INDEX;
+    chunk.m_LessRecent = m_MostRecent;
+    if ( m_MostRecent != INVALID_INDEX )
+    {
+        m_Chunks[ m_MostRecent ].m_MoreRecent = index;
+    }
+    else
+    {
+        m_LeastRecent = index;
+    }
+    m_MostRecent = index;
+}
+
+// Unlink
+//------------------------------------------------------------------------------
+void ChunkCache::Unlink( uint32_t index )
+{
+    const Chunk & chunk = m_Chunks[ index ];
+    if ( chunk.m_MoreRecent != INVALID_INDEX )
+    {
+        m_Chunks[ chunk.m_MoreRecent ].m_LessRecent = chunk.m_LessRecent;
+    }
+    else
+    {
+        m_MostRecent = chunk.m_LessRecent;
+    }
+    if ( chunk.m_LessRecent != INVALID_INDEX )
+    {
+        m_Chunks[ chunk.m_LessRecent ].m_MoreRecent = chunk.m_MoreRecent;
+    }
+    else
+    {
+        m_LeastRecent = chunk.m_MoreRecent;
+    }
+}
+
+// ChunkStore::CONSTRUCTOR
+//------------------------------------------------------------------------------
+ChunkStore::ChunkStore( uint64_t capacity )
+    : m_Chunks( true, capacity )
+{
+}
+
+// ChunkStore::DESTRUCTOR
+//------------------------------------------------------------------------------
+ChunkStore::~ChunkStore() = default;
+
+// ChunkStore::Store
+//------------------------------------------------------------------------------
+void ChunkStore::Store( uint64_t hash, const void * data, uint32_t size )
+{
+    MutexHolder mh( m_Mutex );
+
+    // Another connection may have sent the same chunk
+    const uint32_t index = m_Chunks.Find( hash );
+    if ( index != ChunkCache::INVALID_INDEX )
+    {
+        m_Chunks.Touch( index );
+        return;
+    }
+    m_Chunks.Insert( hash, data, size );
+}
+
+// ChunkStore::Retrieve
+//------------------------------------------------------------------------------
+bool ChunkStore::Retrieve( uint64_t hash, uint32_t size, void * outData )
+{
+    MutexHolder mh( m_Mutex );
+
+    const uint32_t index = m_Chunks.Find( hash );
+    if ( ( index == ChunkCache::INVALID_INDEX ) || ( m_Chunks.m_Chunks[ index ].m_Size != size ) )
+    {
+        return false;
+    }
+    memcpy( outData, m_Chunks.m_Chunks[ index ].m_Data, size );
+    m_Chunks.Touch( index );
+    return true;
+}
+
+// ChunkStore::GetTotalSize
+//------------------------------------------------------------------------------
+uint64_t ChunkStore::GetTotalSize() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Chunks.GetTotalSize();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,124 @@
+// ChunkCache - Content addressed cache of data chunks, mirrored between peers
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ChunkStore;
+class MemoryStream;
+
+// ChunkCache
+//------------------------------------------------------------------------------
+// Data is split into chunks at content defined boundaries, so regions common to
+// many buffers (such as headers expanded into many preprocessed translation
+// units) produce identical chunks wherever they appear.
+//
+// A sender and a receiver each keep a ChunkCache of chunk hashes for their
+// connection. Both use the same capacity and eviction policy and apply the same
+// operations in the same order, so the sender always knows which chunks the
+// receiver has seen and only sends the contents of the others. The receiver
+// keeps the contents in a ChunkStore, shared by all of its connections.
+//
+// The contents of a chunk may have been evicted from the ChunkStore when it is
+// next referenced, so decoding can fail. The receiver then rejects encodings
+// until the sender Clears its cache, which starts a new generation.
+class ChunkCache
+{
+public:
+    explicit ChunkCache( bool storeData, uint64_t capacity = CAPACITY );
+    ~ChunkCache();
+
+    // Sender: forget all chunks and start a new generation (the receiver starts
+    // again when it sees it)
+    void        Clear();
+
+    // Sender: encode data as a list of chunks, including the contents of chunks
+    // the receiver doesn't have (the generation is omitted for older receivers)
+    void        Encode( const void * data, size_t dataSize, int32_t compressionLevel, bool includeGeneration, MemoryStream & outStream );
+
+    // Receiver: rebuild data from an encoding (outData must be freed with FREE)
+    // On failure, further encodings are rejected until the sender starts a new
+    // generation (without generations, the connection must be dropped)
+    bool        Decode( const void * encodedData, size_t encodedDataSize, ChunkStore & store, bool includeGeneration, void * & outData, size_t & outDataSize );
+
+    // Split data into chunks at content defined boundaries
+    static void FindChunks( const void * data, size_t dataSize, Array< uint32_t > & outChunkSizes );
+
+    uint32_t    GetNumChunks() const    { return m_NumChunks; }
+    uint64_t    GetTotalSize() const    { return m_TotalSize; }
+    uint32_t    GetGeneration() const   { return m_Generation; }
+
+    enum : uint32_t { MIN_CHUNK_SIZE = ( 2 * 1024 ) };
+    enum : uint32_t { MAX_CHUNK_SIZE = ( 64 * 1024 ) };
+    enum : uint64_t { CAPACITY = ( 32 * 1024 * 1024 ) }; // Must match on both sides
+
+private:
+    friend class ChunkStore;
+
+    enum : uint32_t { NUM_BUCKETS = 8192 };
+    enum : uint32_t { INVALID_INDEX = 0xFFFFFFFF };
+    enum : uint32_t { NEW_CHUNK_FLAG = 0x80000000 };
+
+    struct Chunk
+    {
+        uint64_t    m_Hash;
+        void *      m_Data;         // Only when storing data
+        uint32_t    m_Size;
+        uint32_t    m_NextInBucket; // Also links the free list
+        uint32_t    m_MoreRecent;
+        uint32_t    m_LessRecent;
+    };
+
+    bool        DecodeInternal( const void * encodedData, size_t encodedDataSize, ChunkStore & store, bool includeGeneration, void * & outData, size_t & outDataSize );
+    void        Reset();
+    uint32_t    Find( uint64_t hash ) const;
+    void        Touch( uint32_t index );
+    void        Insert( uint64_t hash, const void * data, uint32_t size );
+    void        EvictLeastRecent();
+    void        LinkMostRecent( uint32_t index );
+    void        Unlink( uint32_t index );
+
+    bool                m_StoreData;
+    bool                m_AwaitingNewGeneration;    // Receiver: decoding failed, so the sender must start again
+    uint32_t            m_Generation;
+    uint64_t            m_Capacity;
+    uint32_t            m_NumChunks;
+    uint64_t            m_TotalSize;
+    uint32_t            m_MostRecent;
+    uint32_t            m_LeastRecent;
+    uint32_t            m_FirstFree;
+    Array< Chunk >      m_Chunks;
+    Array< uint32_t >   m_Buckets;
+};
+
+// ChunkStore
+//------------------------------------------------------------------------------
+// The contents of chunks received on all of a receiver's connections, within a
+// single budget. The least recently used are evicted to make space, whichever
+// connection they were received on.
+class ChunkStore
+{
+public:
+    explicit ChunkStore( uint64_t capacity = DEFAULT_CAPACITY );
+    ~ChunkStore();
+
+    void        Store( uint64_t hash, const void * data, uint32_t size );
+    bool        Retrieve( uint64_t hash, uint32_t size, void * outData ); // false if evicted
+
+    uint64_t    GetTotalSize() const;
+
+    enum : uint64_t { DEFAULT_CAPACITY = ( 256 * 1024 * 1024 ) };
+
+private:
+    mutable Mutex   m_Mutex; // Shared by connections receiving concurrently
+    ChunkCache      m_Chunks;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,343 @@
+// CompilerServers - Long-lived processes which compile on request
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompilerServers.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <string.h> // for strchr
+
+// Defines
+//------------------------------------------------------------------------------
+#define COMPILER_SERVER_GREETING "FASTBuild-CompilerServer 1\n"
+
+// Static Data
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CompilerServers::s_ResponseTimeoutForTestsMS = 0;
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompilerServers::CompilerServers( const volatile bool * mainAbortFlag )
+    : m_MainAbortFlag( mainAbortFlag )
+    , m_IdleServers( 32 )
+    , m_DisabledCompilers( 4 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompilerServers::~CompilerServers()
+{
+    PROFILE_FUNCTION;
+
+    // All servers are idle once the build is complete
+    for ( Server * server : m_IdleServers )
+    {
+        StopServer( server, false );
+    }
+}
+
+// Compile
+//------------------------------------------------------------------------------
+CompilerServers::Result CompilerServers::Compile( const CompilerNode * compilerNode,
+                                                  const AString & compiler,
+                                                  const AString & args,
+                                                  const char * workingDir,
+                                                  uint32_t expectedTimeMS,
+                                                  const volatile bool * abortFlag,
+                                                  int32_t & outResult,
+                                                  AString & outStdOut,
+                                                  AString & outStdErr )
+{
+    PROFILE_FUNCTION;
+
+    // Requests are line based, so can't contain line breaks
+    if ( compiler.Find( '\n' ) ||
+         args.Find( '\n' ) ||
+         ( workingDir && strchr( workingDir, '\n' ) ) )
+    {
+        return Result::eUnavailable;
+    }
+
+    Server * server = AcquireServer( compilerNode );
+    if ( server == nullptr )
+    {
+        return HasAborted( abortFlag ) ? Result::eAborted : Result::eUnavailable;
+    }
+
+    // Send request
+    AStackString< 4096 > request( "compile\n" );
+    request += compiler;
+    request += '\n';
+    request += workingDir ? workingDir : "";
+    request += '\n';
+    request += args;
+    request += '\n';
+    if ( server->m_Process->WriteStdIn( request.Get(), request.GetLength() ) == false )
+    {
+        StopServer( server, true );
+        return Result::eUnavailable;
+    }
+
+    // Read response
+    const uint32_t timeoutMS = GetResponseTimeoutMS( expectedTimeMS );
+    const Result headerResult = ReadResponse( server, abortFlag, timeoutMS, 0 );
+    if ( headerResult != Result::eOk )
+    {
+        if ( headerResult == Result::eTimedOut )
+        {
+            FLOG_WARN( "Compiler server '%s' did not respond within %u ms. Compiling without it.", compilerNode->GetCompilerServer().Get(), timeoutMS );
+            DisableServers( compilerNode );
+        }
+        StopServer( server, true );
+        return headerResult;
+    }
+    const char * const headerEnd = server->m_StdOut.Find( '\n' );
+    const uint32_t headerSize = static_cast< uint32_t >( headerEnd - server->m_StdOut.Get() + 1 );
+    int32_t result = 0;
+    uint32_t stdOutSize = 0;
+    uint32_t stdErrSize = 0;
+    if ( server->m_StdOut.Scan( "result %i %u %u", &result, &stdOutSize, &stdErrSize ) != 3 )
+    {
+        FLOG_WARN( "Invalid response from compiler server '%s'", compilerNode->GetCompilerServer().Get() );
+        StopServer( server, true );
+        return Result::eUnavailable;
+    }
+    const uint32_t responseSize = ( headerSize + stdOutSize + stdErrSize );
+    const Result outputResult = ReadResponse( server, abortFlag, timeoutMS, responseSize );
+    if ( outputResult != Result::eOk )
+    {
+        StopServer( server, true );
+        return outputResult;
+    }
+    if ( server->m_StdOut.GetLength() != responseSize )
+    {
+        // Output beyond the response would be misinterpreted as a later response
+        FLOG_WARN( "Invalid response from compiler server '%s'", compilerNode->GetCompilerServer().Get() );
+        StopServer( server, true );
+        return Result::eUnavailable;
+    }
+
+    const char * const stdOut = ( server->m_StdOut.Get() + headerSize );
+    const char * const stdErr = ( stdOut + stdOutSize );
+    outStdOut.Assign( stdOut, stdErr );
+    outStdErr.Assign( stdErr, stdErr + stdErrSize );
+    outResult = result;
+
+    server->m_StdOut.Clear();
+    server->m_StdErr.Clear();
+    ReleaseServer( server );
+    return Result::eOk;
+}
+
+// AcquireServer
+//------------------------------------------------------------------------------
+CompilerServers::Server * CompilerServers::AcquireServer( const CompilerNode * compilerNode )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_DisabledCompilers.Find( compilerNode ) )
+        {
+            return nullptr;
+        }
+        for ( size_t i = 0; i < m_IdleServers.GetSize(); ++i )
+        {
+            Server * server = m_IdleServers[ i ];
+            if ( server->m_CompilerNode == compilerNode )
+            {
+                m_IdleServers.EraseIndex( i );
+                return server;
+            }
+        }
+    }
+
+    // Each thread uses one server at a time, so the pool grows to at most the
+    // number of compilations in progress for the compiler
+    Server * server = StartServer( compilerNode );
+    if ( server == nullptr )
+    {
+        DisableServers( compilerNode );
+    }
+    return server;
+}
+
+// ReleaseServer
+//------------------------------------------------------------------------------
+void CompilerServers::ReleaseServer( Server * server )
+{
+    MutexHolder mh( m_Mutex );
+    m_IdleServers.Append( server );
+}
+
+// StartServer
+//------------------------------------------------------------------------------
+CompilerServers::Server * CompilerServers::StartServer( const CompilerNode * compilerNode )
+{
+    PROFILE_FUNCTION;
+
+    Server * server = FNEW( Server );
+    server->m_CompilerNode = compilerNode;
+    server->m_Process = FNEW( Process( m_MainAbortFlag ) );
+    server->m_Process->EnableStdInPipe();
+
+    const AString & serverExe = compilerNode->GetCompilerServer();
+    if ( server->m_Process->Spawn( serverExe.Get(),
+                                   nullptr,
+                                   nullptr,
+                                   compilerNode->GetEnvironmentString() ) == false )
+    {
+        if ( HasAborted( nullptr ) == false )
+        {
+            FLOG_WARN( "Failed to start compiler server '%s'. Error: %s", serverExe.Get(), LAST_ERROR_STR );
+        }
+        FDELETE server->m_Process;
+        FDELETE server;
+        return nullptr;
+    }
+
+    // A server must identify itself before being used, in case something else
+    // has been configured by mistake
+    const uint32_t greetingSize = static_cast< uint32_t >( strlen( COMPILER_SERVER_GREETING ) );
+    const Result result = ReadResponse( server, nullptr, STARTUP_TIMEOUT_MS, greetingSize );
+    if ( ( result != Result::eOk ) ||
+         ( server->m_StdOut.GetLength() != greetingSize ) ||
+         ( server->m_StdOut != COMPILER_SERVER_GREETING ) )
+    {
+        if ( result != Result::eAborted )
+        {
+            FLOG_WARN( "Compiler server '%s' did not start correctly. Compiling without it.", serverExe.Get() );
+        }
+        StopServer( server, true );
+        return nullptr;
+    }
+    server->m_StdOut.Clear();
+
+    return server;
+}
+
+// StopServer
+//------------------------------------------------------------------------------
+/*static*/ void CompilerServers::StopServer( Server * server, bool kill )
+{
+    Process * process = server->m_Process;
+
+    // Servers exit when stdin is closed
+    process->CloseStdIn();
+    if ( kill == false )
+    {
+        const Timer t;
+        while ( process->ReadAvailableData( server->m_StdOut, server->m_StdErr, 10 ) )
+        {
+            if ( t.GetElapsedMS() >= static_cast< float >( SHUTDOWN_TIMEOUT_MS ) )
+            {
+                kill = true;
+                break;
+            }
+            server->m_StdOut.Clear();
+            server->m_StdErr.Clear();
+        }
+    }
+    if ( kill )
+    {
+        process->KillProcessTree();
+    }
+    process->WaitForExit();
+
+    FDELETE process;
+    FDELETE server;
+}
+
+// ReadResponse
+//------------------------------------------------------------------------------
+CompilerServers::Result CompilerServers::ReadResponse( Server * server,
+                                                       const volatile bool * abortFlag,
+                                                       uint32_t timeoutMS,
+                                                       uint32_t size ) const
+{
+    const Timer t;
+    for ( ;; )
+    {
+        // Is the response (or a line of it, if the size is not known) complete?
+        if ( ( size > 0 ) ? ( server->m_StdOut.GetLength() >= size )
+                          : ( server->m_StdOut.Find( '\n' ) != nullptr ) )
+        {
+            return Result::eOk;
+        }
+
+        if ( HasAborted( abortFlag ) )
+        {
+            return Result::eAborted;
+        }
+        if ( ( timeoutMS > 0 ) && ( t.GetElapsedMS() >= static_cast< float >( timeoutMS ) ) )
+        {
+            return Result::eTimedOut;
+        }
+
+        // Abort flags are not signalled, so wake periodically to check them
+        if ( server->m_Process->ReadAvailableData( server->m_StdOut, server->m_StdErr, 50 ) == false )
+        {
+            return Result::eUnavailable; // Server exited
+        }
+    }
+}
+
+// DisableServers
+//------------------------------------------------------------------------------
+void CompilerServers::DisableServers( const CompilerNode * compilerNode )
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_DisabledCompilers.Find( compilerNode ) == nullptr )
+    {
+        m_DisabledCompilers.Append( compilerNode );
+    }
+}
+
+// GetResponseTimeoutMS
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CompilerServers::GetResponseTimeoutMS( uint32_t expectedTimeMS )
+{
+    if ( s_ResponseTimeoutForTestsMS )
+    {
+        return s_ResponseTimeoutForTestsMS;
+    }
+
+    // Allow plenty of time, as a compilation is repeated if it times out
+    if ( expectedTimeMS == 0 )
+    {
+        return RESPONSE_TIMEOUT_MS;
+    }
+    const uint64_t timeoutMS = ( static_cast< uint64_t >( expectedTimeMS ) * RESPONSE_TIMEOUT_RATIO );
+    return static_cast< uint32_t >( Math::Clamp< uint64_t >( timeoutMS, RESPONSE_TIMEOUT_MIN_MS, RESPONSE_TIMEOUT_MS ) );
+}
+
+// SetResponseTimeoutForTests
+//------------------------------------------------------------------------------
+/*static*/ void CompilerServers::SetResponseTimeoutForTests( uint32_t timeoutMS )
+{
+    s_ResponseTimeoutForTestsMS = timeoutMS;
+}
+
+// HasAborted
+//------------------------------------------------------------------------------
+bool CompilerServers::HasAborted( const volatile bool * abortFlag ) const
+{
+    return ( m_MainAbortFlag && AtomicLoadRelaxed( m_MainAbortFlag ) ) ||
+           ( abortFlag && AtomicLoadRelaxed( abortFlag ) );
+}
+
+//------------------------------------------------------------------------------
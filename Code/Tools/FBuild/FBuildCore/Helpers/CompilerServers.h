@@ -0,0 +1,96 @@
+// CompilerServers - Long-lived processes which compile on request
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompilerNode;
+class Process;
+
+// CompilerServers
+//------------------------------------------------------------------------------
+// For small translation units, starting the compiler process (loading and
+// linking the executable, parsing options etc.) can take longer than the
+// compilation itself. A Compiler() with a .CompilerServer_Experimental has a
+// pool of server processes which stay running, each handling one compilation
+// request at a time.
+//
+// Servers communicate over stdin/stdout with a line based protocol:
+//  - On start, the server writes "FASTBuild-CompilerServer 1\n"
+//  - Each request is 4 lines: "compile", the compiler executable, the working
+//    dir (may be empty) and the arguments
+//  - The server replies with "result <exitCode> <stdOutSize> <stdErrSize>\n"
+//    followed by the output of the compilation (stdout then stderr)
+//  - When stdin is closed, the server should exit
+//
+// Servers are started with the environment of the Compiler(). Anything a
+// server can't handle falls back to spawning the compiler. A server which
+// doesn't respond in time is assumed to have hung, so is killed (and no more
+// are used for that compiler).
+class CompilerServers
+{
+public:
+    explicit CompilerServers( const volatile bool * mainAbortFlag );
+    ~CompilerServers();
+
+    enum class Result : uint8_t
+    {
+        eOk,            // Compilation was performed by a server (possibly unsuccessfully)
+        eUnavailable,   // No server could perform the compilation (compiler should be spawned)
+        eAborted,       // Build (or job) was aborted
+        eTimedOut,      // Server did not respond in time (compiler should be spawned)
+    };
+
+    Result Compile( const CompilerNode * compilerNode,
+                    const AString & compiler,
+                    const AString & args,
+                    const char * workingDir,
+                    uint32_t expectedTimeMS, // Previous compile time, if known
+                    const volatile bool * abortFlag,
+                    int32_t & outResult,
+                    AString & outStdOut,
+                    AString & outStdErr );
+
+    enum : uint32_t { STARTUP_TIMEOUT_MS = 10 * 1000 };
+    enum : uint32_t { SHUTDOWN_TIMEOUT_MS = 1000 };
+    enum : uint32_t { RESPONSE_TIMEOUT_MS = 10 * 60 * 1000 };   // When the compile time is not known
+    enum : uint32_t { RESPONSE_TIMEOUT_MIN_MS = 60 * 1000 };
+    enum : uint32_t { RESPONSE_TIMEOUT_RATIO = 10 };            // Relative to the previous compile time
+
+    static void SetResponseTimeoutForTests( uint32_t timeoutMS ); // 0 to restore
+
+private:
+    struct Server
+    {
+        const CompilerNode *    m_CompilerNode;
+        Process *               m_Process;
+        AString                 m_StdOut;   // Responses
+        AString                 m_StdErr;   // Diagnostic output of the server itself
+    };
+
+    Server *    AcquireServer( const CompilerNode * compilerNode );
+    void        ReleaseServer( Server * server );
+    Server *    StartServer( const CompilerNode * compilerNode );
+    static void StopServer( Server * server, bool kill );
+    Result      ReadResponse( Server * server, const volatile bool * abortFlag, uint32_t timeoutMS, uint32_t size ) const;
+    bool        HasAborted( const volatile bool * abortFlag ) const;
+    void        DisableServers( const CompilerNode * compilerNode );
+    static uint32_t GetResponseTimeoutMS( uint32_t expectedTimeMS );
+
+    const volatile bool *           m_MainAbortFlag;
+    Mutex                           m_Mutex;
+    Array< Server * >               m_IdleServers;
+    Array< const CompilerNode * >   m_DisabledCompilers;    // Servers which failed to start or hung
+
+    static uint32_t                 s_ResponseTimeoutForTestsMS;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,245 @@
+// CompressionDictionary
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressionDictionary.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// External
+#include "zstd.h"
+
+// system
+#include <string.h> // for memcpy, memset
+
+// Training
+//------------------------------------------------------------------------------
+namespace
+{
+    // Content is scored by the frequency of each run of kDmerSize bytes (d-mer)
+    // it contains. Frequencies are stored in a table indexed by a hash of the
+    // d-mer, so some collisions are tolerated in exchange for bounded memory.
+    static constexpr size_t kDmerSize = 8;
+    static constexpr uint32_t kFrequencyTableBits = 20;
+    static constexpr size_t kSegmentSize = 1024;    // Size of each piece of content selected
+    static constexpr size_t kPasses = 4;            // Times each part of the samples is considered
+
+    inline uint32_t HashDmer( const char * pos )
+    {
+        uint64_t value;
+        memcpy( &value, pos, sizeof( value ) );
+        return static_cast< uint32_t >( ( value * 0xCF1BBCDCB7A56463ULL ) >> ( 64 - kFrequencyTableBits ) );
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::CompressionDictionary( const void * data, size_t dataSize )
+    : m_Data( ALLOC( dataSize ) )
+    , m_DataSize( dataSize )
+    , m_Id( CalcId( data, dataSize ) )
+    , m_CompressionDictionaries( 2 )
+    , m_DecompressionDictionary( nullptr )
+{
+    memcpy( m_Data, data, dataSize );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::~CompressionDictionary()
+{
+    for ( const CompressionDictionaryForLevel & dictionary : m_CompressionDictionaries )
+    {
+        ZSTD_freeCDict( dictionary.m_Dictionary );
+    }
+    ZSTD_freeDDict( m_DecompressionDictionary );
+    FREE( m_Data );
+}
+
+// Train
+//------------------------------------------------------------------------------
+/*static*/ bool CompressionDictionary::Train( const void * samples,
+                                              const Array< uint32_t > & sampleSizes,
+                                              size_t maxSize,
+                                              MemoryStream & outDictionary )
+{
+    PROFILE_FUNCTION;
+
+    const char * const data = static_cast< const char * >( samples );
+    size_t dataSize = 0;
+    for ( const uint32_t sampleSize : sampleSizes )
+    {
+        dataSize += sampleSize;
+    }
+    if ( ( dataSize < kSegmentSize ) || ( maxSize < kSegmentSize ) )
+    {
+        return false; // Not enough to learn from
+    }
+
+    // Count how often each d-mer occurs within the samples
+    const size_t tableSize = ( size_t( 1 ) << kFrequencyTableBits );
+    UniquePtr< uint32_t, FreeDeletor > frequencies( static_cast< uint32_t * >( ALLOC( tableSize * sizeof( uint32_t ) ) ) );
+    memset( frequencies.Get(), 0, tableSize * sizeof( uint32_t ) );
+    {
+        const char * sample = data;
+        for ( const uint32_t sampleSize : sampleSizes )
+        {
+            for ( size_t i = 0; ( i + kDmerSize ) <= sampleSize; ++i )
+            {
+                ++frequencies.Get()[ HashDmer( sample + i ) ];
+            }
+            sample += sampleSize;
+        }
+    }
+
+    // Samples are divided into epochs, and the best segment of each epoch is
+    // selected in turn. This spreads selections across all the samples. Each
+    // selected segment is placed before the last, as content nearer to the end
+    // of a dictionary is cheaper for the compressor to reference.
+    UniquePtr< char, FreeDeletor > dictionary( static_cast< char * >( ALLOC( maxSize ) ) );
+    UniquePtr< uint16_t, FreeDeletor > segmentCounts( static_cast< uint16_t * >( ALLOC( tableSize * sizeof( uint16_t ) ) ) );
+    memset( segmentCounts.Get(), 0, tableSize * sizeof( uint16_t ) );
+    uint32_t * const freqs = frequencies.Get();
+    uint16_t * const counts = segmentCounts.Get();
+    const size_t numDmers = ( dataSize - kDmerSize + 1 );
+    const size_t maxDmersPerSegment = ( kSegmentSize - kDmerSize + 1 );
+    size_t numEpochs = ( maxSize / kSegmentSize / kPasses );
+    numEpochs = ( numEpochs == 0 ) ? 1 : numEpochs;
+    const size_t epochSize = ( ( numDmers / numEpochs ) > maxDmersPerSegment ) ? ( numDmers / numEpochs ) : maxDmersPerSegment;
+    numEpochs = ( ( numDmers + epochSize - 1 ) / epochSize );
+
+    size_t tail = maxSize;
+    size_t epochsWithoutProgress = 0;
+    for ( size_t epoch = 0; ( tail >= kDmerSize ) && ( epochsWithoutProgress < numEpochs ); epoch = ( ( epoch + 1 ) % numEpochs ) )
+    {
+        const size_t epochBegin = ( epoch * epochSize );
+        const size_t epochEnd = ( ( epochBegin + epochSize ) < numDmers ) ? ( epochBegin + epochSize ) : numDmers;
+
+        // Find the segment containing the most frequent d-mers (each counted once)
+        uint64_t score = 0;
+        uint64_t bestScore = 0;
+        size_t bestBegin = 0;
+        size_t bestEnd = 0;
+        size_t activeBegin = epochBegin;
+        for ( size_t pos = epochBegin; pos < epochEnd; ++pos )
+        {
+            const uint32_t index = HashDmer( data + pos );
+            if ( counts[ index ]++ == 0 )
+            {
+                score += freqs[ index ];
+            }
+            if ( ( pos - activeBegin + 1 ) > maxDmersPerSegment )
+            {
+                const uint32_t oldIndex = HashDmer( data + activeBegin );
+                if ( --counts[ oldIndex ] == 0 )
+                {
+                    score -= freqs[ oldIndex ];
+                }
+                ++activeBegin;
+            }
+            if ( score > bestScore )
+            {
+                bestScore = score;
+                bestBegin = activeBegin;
+                bestEnd = ( pos + 1 );
+            }
+        }
+        for ( size_t pos = activeBegin; pos < epochEnd; ++pos )
+        {
+            counts[ HashDmer( data + pos ) ] = 0;
+        }
+
+        if ( bestScore == 0 )
+        {
+            ++epochsWithoutProgress;
+            continue;
+        }
+        epochsWithoutProgress = 0;
+
+        // Selected content is no longer valuable for other segments
+        for ( size_t pos = bestBegin; pos < bestEnd; ++pos )
+        {
+            freqs[ HashDmer( data + pos ) ] = 0;
+        }
+
+        size_t segmentSize = ( bestEnd - bestBegin + kDmerSize - 1 );
+        segmentSize = ( segmentSize < tail ) ? segmentSize : tail;
+        tail -= segmentSize;
+        memcpy( dictionary.Get() + tail, data + bestBegin, segmentSize );
+    }
+
+    const size_t dictionarySize = ( maxSize - tail );
+    if ( dictionarySize < kSegmentSize )
+    {
+        return false; // Nothing worth sharing
+    }
+
+    // Content starting with the Zstd magic number would be interpreted as a
+    // Zstd formatted dictionary, which it is not
+    char * dictionaryBegin = ( dictionary.Get() + tail );
+    uint32_t magic;
+    memcpy( &magic, dictionaryBegin, sizeof( magic ) );
+    if ( magic == ZSTD_MAGIC_DICTIONARY )
+    {
+        dictionaryBegin[ 0 ] = 0;
+    }
+
+    outDictionary.WriteBuffer( dictionaryBegin, dictionarySize );
+    return true;
+}
+
+// CalcId
+//------------------------------------------------------------------------------
+/*static*/ uint64_t CompressionDictionary::CalcId( const void * data, size_t dataSize )
+{
+    return xxHash3::Calc64( data, dataSize );
+}
+
+// GetCompressionDictionary
+//------------------------------------------------------------------------------
+ZSTD_CDict_s * CompressionDictionary::GetCompressionDictionary( int32_t compressionLevel ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    // Dictionaries are specific to a compression level
+    for ( const CompressionDictionaryForLevel & dictionary : m_CompressionDictionaries )
+    {
+        if ( dictionary.m_CompressionLevel == compressionLevel )
+        {
+            return dictionary.m_Dictionary;
+        }
+    }
+
+    PROFILE_FUNCTION;
+
+    CompressionDictionaryForLevel dictionary;
+    dictionary.m_CompressionLevel = compressionLevel;
+    dictionary.m_Dictionary = ZSTD_createCDict( m_Data, m_DataSize, compressionLevel );
+    if ( dictionary.m_Dictionary )
+    {
+        m_CompressionDictionaries.Append( dictionary );
+    }
+    return dictionary.m_Dictionary;
+}
+
+// GetDecompressionDictionary
+//------------------------------------------------------------------------------
+ZSTD_DDict_s * CompressionDictionary::GetDecompressionDictionary() const
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_DecompressionDictionary == nullptr )
+    {
+        PROFILE_FUNCTION;
+        m_DecompressionDictionary = ZSTD_createDDict( m_Data, m_DataSize );
+    }
+    return m_DecompressionDictionary;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,83 @@
+// CompressionDictionary - Content shared by many buffers, to improve Zstd compression
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class MemoryStream;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+// CompressionDictionary
+//------------------------------------------------------------------------------
+// Small buffers compress poorly on their own, as the compressor has little data
+// to learn from. A dictionary primes the compressor with content common to many
+// such buffers (for example, the output of the same compiler), which can then be
+// referenced instead of being stored in each compressed buffer.
+//
+// Dictionaries are "raw content" dictionaries, trained by selecting the segments
+// of sample buffers whose content occurs most frequently. Data must be
+// decompressed with the same dictionary it was compressed with, identified by
+// a hash of the content.
+class CompressionDictionary
+{
+public:
+    explicit CompressionDictionary( const void * data, size_t dataSize );
+    ~CompressionDictionary();
+
+    // Build dictionary content (of at most maxSize) from samples stored one after another
+    static bool Train( const void * samples,
+                       const Array< uint32_t > & sampleSizes,
+                       size_t maxSize,
+                       MemoryStream & outDictionary );
+
+    enum : uint32_t { DEFAULT_MAX_SIZE = ( 112 * 1024 ) };
+
+    inline uint64_t     GetId() const       { return m_Id; }
+    inline const void * GetData() const     { return m_Data; }
+    inline size_t       GetDataSize() const { return m_DataSize; }
+
+    static uint64_t     CalcId( const void * data, size_t dataSize );
+
+    // Digested forms used by Zstd, created on first use (thread-safe)
+    ZSTD_CDict_s *      GetCompressionDictionary( int32_t compressionLevel ) const;
+    ZSTD_DDict_s *      GetDecompressionDictionary() const;
+
+    CompressionDictionary( const CompressionDictionary & ) = delete;
+    CompressionDictionary & operator = ( const CompressionDictionary & ) = delete;
+
+private:
+    struct CompressionDictionaryForLevel
+    {
+        int32_t         m_CompressionLevel;
+        ZSTD_CDict_s *  m_Dictionary;
+    };
+
+    void *                  m_Data;
+    size_t                  m_DataSize;
+    uint64_t                m_Id;
+    mutable Mutex           m_Mutex;
+    mutable Array< CompressionDictionaryForLevel > m_CompressionDictionaries;
+    mutable ZSTD_DDict_s *  m_DecompressionDictionary;
+};
+
+// ICompressionDictionaryProvider
+//------------------------------------------------------------------------------
+// Finds the dictionary data was compressed with, so it can be decompressed
+class ICompressionDictionaryProvider
+{
+public:
+    virtual ~ICompressionDictionaryProvider() = default;
+
+    // Return nullptr if the dictionary is not available
+    virtual const CompressionDictionary * FindDictionary( uint64_t dictionaryId ) = 0;
+};
+
+//------------------------------------------------------------------------------
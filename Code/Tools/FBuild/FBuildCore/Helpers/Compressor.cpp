@@ -7,12 +7,15 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Assert.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/IOStream.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Profile/Profile.h"
 
@@ -43,7 +46,11 @@ Compressor::~Compressor()
 {
     ASSERT( data );
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > eZstd )
+    if ( header->m_CompressionType > eZstdDictionary )
+    {
+        return false;
+    }
+    if ( ( header->m_CompressionType == eZstdDictionary ) && ( header->m_CompressedSize < sizeof( uint64_t ) ) )
     {
         return false;
     }
@@ -132,7 +139,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, ICompressionDictionaryProvider * dictionaries )
 {
     PROFILE_FUNCTION;
 
@@ -170,10 +177,8 @@ bool Compressor::Decompress( const void * data )
             return true;
         }
     }
-    else
+    else if ( header->m_CompressionType == eZstd )
     {
-        ASSERT( header->m_CompressionType == eZstd );
-
         // decompress
         const size_t bytesDecompressed = ZSTD_decompress( m_Result,
                                                           uncompressedSize,
@@ -184,6 +189,35 @@ bool Compressor::Decompress( const void * data )
             return true;
         }
     }
+    else
+    {
+        ASSERT( header->m_CompressionType == eZstdDictionary );
+
+        // find the dictionary the data was compressed with
+        uint64_t dictionaryId = 0;
+        if ( header->m_CompressedSize >= sizeof( dictionaryId ) )
+        {
+            memcpy( &dictionaryId, compressedData, sizeof( dictionaryId ) );
+        }
+        const CompressionDictionary * dictionary = ( dictionaries && dictionaryId ) ? dictionaries->FindDictionary( dictionaryId ) : nullptr;
+        ZSTD_DDict * ddict = dictionary ? dictionary->GetDecompressionDictionary() : nullptr;
+        if ( ddict )
+        {
+            // decompress
+            ZSTD_DCtx * context = ZSTD_createDCtx();
+            const size_t bytesDecompressed = ZSTD_decompress_usingDDict( context,
+                                                                         m_Result,
+                                                                         uncompressedSize,
+                                                                         compressedData + sizeof( dictionaryId ),
+                                                                         header->m_CompressedSize - sizeof( dictionaryId ),
+                                                                         ddict );
+            ZSTD_freeDCtx( context );
+            if ( bytesDecompressed == uncompressedSize )
+            {
+                return true;
+            }
+        }
+    }
 
     // Data is corrupt
     FREE( m_Result );
@@ -196,21 +230,41 @@ bool Compressor::Decompress( const void * data )
 //------------------------------------------------------------------------------
 bool Compressor::CompressZstd( const void * data,
                                size_t dataSize,
-                               int32_t compressionLevel)
+                               int32_t compressionLevel,
+                               const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
     ASSERT( data );
     ASSERT( m_Result == nullptr );
 
+    // Digest the dictionary (if there is one) for this compression level
+    ZSTD_CDict * cdict = ( dictionary && ( compressionLevel > 0 ) ) ? dictionary->GetCompressionDictionary( compressionLevel ) : nullptr;
+
     // allocate worst case output size for LZ4
-    const size_t worstCaseSize = ZSTD_compressBound( dataSize );
+    // (data compressed with a dictionary is preceded by the dictionary id)
+    const size_t prefixSize = cdict ? sizeof( uint64_t ) : 0;
+    const size_t worstCaseSize = ZSTD_compressBound( dataSize ) + prefixSize;
     UniquePtr<char, FreeDeletor> output( (char *)ALLOC( worstCaseSize ) );
 
     size_t compressedSize;
 
     // do compression
-    if ( compressionLevel > 0 )
+    if ( cdict )
+    {
+        const uint64_t dictionaryId = dictionary->GetId();
+        memcpy( output.Get(), &dictionaryId, sizeof( dictionaryId ) );
+        ZSTD_CCtx * context = ZSTD_createCCtx();
+        compressedSize = ZSTD_compress_usingCDict( context,
+                                                   output.Get() + prefixSize,
+                                                   worstCaseSize - prefixSize,
+                                                   static_cast<const char *>( data ),
+                                                   dataSize,
+                                                   cdict );
+        ZSTD_freeCCtx( context );
+        compressedSize = ZSTD_isError( compressedSize ) ? dataSize : ( compressedSize + prefixSize );
+    }
+    else if ( compressionLevel > 0 )
     {
         compressedSize = ZSTD_compress( output.Get(),
                                         worstCaseSize,
@@ -244,11 +298,239 @@ bool Compressor::CompressZstd( const void * data,
 
     // fill out header
     Header * header = (Header *)m_Result;
-    header->m_CompressionType = compressed ? eZstd : eUncompressed;   // compression type
+    header->m_CompressionType = compressed ? ( cdict ? eZstdDictionary : eZstd ) : eUncompressed;   // compression type
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize; // output size
 
     return compressed;
 }
 
+// DecompressionStream - CONSTRUCTOR
+//------------------------------------------------------------------------------
+DecompressionStream::DecompressionStream( IOStream & input,
+                                          uint64_t inputSize,
+                                          xxHash3Accumulator * inputHash,
+                                          ICompressionDictionaryProvider * dictionaries )
+    : m_Input( input )
+    , m_InputRemaining( inputSize )
+    , m_InputHash( inputHash )
+    , m_Dictionaries( dictionaries )
+    , m_DictionaryMissing( false )
+    , m_CompressionType( Compressor::eUncompressed )
+    , m_UncompressedSize( 0 )
+    , m_UncompressedRemaining( 0 )
+    , m_BlockPos( 0 )
+    , m_ZstdContext( nullptr )
+    , m_InputBuffer( nullptr )
+    , m_InputBufferSize( 0 )
+    , m_InputBufferPos( 0 )
+    , m_InputBufferUsed( 0 )
+    , m_FrameComplete( false )
+{
+}
+
+// DecompressionStream - DESTRUCTOR
+//------------------------------------------------------------------------------
+DecompressionStream::~DecompressionStream()
+{
+    ZSTD_freeDCtx( m_ZstdContext );
+    FREE( m_InputBuffer );
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool DecompressionStream::Open()
+{
+    PROFILE_FUNCTION;
+
+    // Validate the header (as per Compressor::IsValidData)
+    Compressor::Header header;
+    if ( ( m_InputRemaining < sizeof( header ) ) ||
+         ( ReadInput( &header, sizeof( header ) ) == false ) )
+    {
+        return false;
+    }
+    if ( ( header.m_CompressionType > Compressor::eZstdDictionary ) ||
+         ( header.m_CompressedSize != m_InputRemaining ) ||
+         ( header.m_CompressedSize > header.m_UncompressedSize ) )
+    {
+        return false;
+    }
+
+    // Find the dictionary the data was compressed with (after which the data
+    // is the same as any other Zstd data)
+    ZSTD_DDict * ddict = nullptr;
+    if ( header.m_CompressionType == Compressor::eZstdDictionary )
+    {
+        uint64_t dictionaryId;
+        if ( ( m_InputRemaining < sizeof( dictionaryId ) ) ||
+             ( ReadInput( &dictionaryId, sizeof( dictionaryId ) ) == false ) )
+        {
+            return false;
+        }
+        const CompressionDictionary * dictionary = m_Dictionaries ? m_Dictionaries->FindDictionary( dictionaryId ) : nullptr;
+        if ( dictionary == nullptr )
+        {
+            m_DictionaryMissing = true;
+            return false;
+        }
+        ddict = dictionary->GetDecompressionDictionary();
+        if ( ddict == nullptr )
+        {
+            return false;
+        }
+        header.m_CompressionType = Compressor::eZstd;
+    }
+
+    m_CompressionType = header.m_CompressionType;
+    m_UncompressedSize = header.m_UncompressedSize;
+    m_UncompressedRemaining = header.m_UncompressedSize;
+
+    if ( m_CompressionType == Compressor::eLZ4 )
+    {
+        // Decompress the whole block
+        UniquePtr< char, FreeDeletor > data( (char *)ALLOC( sizeof( header ) + header.m_CompressedSize ) );
+        memcpy( data.Get(), &header, sizeof( header ) );
+        return ReadInput( data.Get() + sizeof( header ), header.m_CompressedSize ) &&
+               m_Block.Decompress( data.Get() );
+    }
+
+    if ( m_CompressionType == Compressor::eZstd )
+    {
+        m_ZstdContext = ZSTD_createDCtx();
+        if ( ddict && ZSTD_isError( ZSTD_DCtx_refDDict( m_ZstdContext, ddict ) ) )
+        {
+            return false;
+        }
+        m_InputBufferSize = ZSTD_DStreamInSize();
+        m_InputBuffer = (char *)ALLOC( m_InputBufferSize );
+    }
+    return true;
+}
+
+// Read
+//------------------------------------------------------------------------------
+bool DecompressionStream::Read( void * buffer, size_t size )
+{
+    if ( size > m_UncompressedRemaining )
+    {
+        return false;
+    }
+    m_UncompressedRemaining -= size;
+
+    if ( m_CompressionType == Compressor::eUncompressed )
+    {
+        return ReadInput( buffer, size );
+    }
+
+    if ( m_CompressionType == Compressor::eLZ4 )
+    {
+        memcpy( buffer, (const char *)m_Block.GetResult() + m_BlockPos, size );
+        m_BlockPos += size;
+        return true;
+    }
+
+    ZSTD_outBuffer out = { buffer, size, 0 };
+    while ( out.pos < out.size )
+    {
+        if ( m_FrameComplete )
+        {
+            return false; // Less data than the header indicates
+        }
+
+        // Refill input
+        if ( m_InputBufferPos == m_InputBufferUsed )
+        {
+            if ( m_InputRemaining == 0 )
+            {
+                return false;
+            }
+            const size_t inputSize = (size_t)Math::Min< uint64_t >( m_InputBufferSize, m_InputRemaining );
+            if ( ReadInput( m_InputBuffer, inputSize ) == false )
+            {
+                return false;
+            }
+            m_InputBufferPos = 0;
+            m_InputBufferUsed = inputSize;
+        }
+
+        ZSTD_inBuffer in = { m_InputBuffer, m_InputBufferUsed, m_InputBufferPos };
+        const size_t result = ZSTD_decompressStream( m_ZstdContext, &out, &in );
+        m_InputBufferPos = in.pos;
+        if ( ZSTD_isError( result ) )
+        {
+            return false;
+        }
+        m_FrameComplete = ( result == 0 );
+    }
+    return true;
+}
+
+// Finish
+//------------------------------------------------------------------------------
+bool DecompressionStream::Finish()
+{
+    // Consume data which wasn't read
+    char scratch[ 4096 ];
+    while ( m_UncompressedRemaining > 0 )
+    {
+        const size_t size = (size_t)Math::Min< uint64_t >( sizeof( scratch ), m_UncompressedRemaining );
+        if ( Read( scratch, size ) == false )
+        {
+            return false;
+        }
+    }
+
+    // Consume the end of the frame, which must not contain more data
+    if ( m_CompressionType == Compressor::eZstd )
+    {
+        while ( m_FrameComplete == false )
+        {
+            if ( m_InputBufferPos == m_InputBufferUsed )
+            {
+                if ( m_InputRemaining == 0 )
+                {
+                    return false;
+                }
+                const size_t inputSize = (size_t)Math::Min< uint64_t >( m_InputBufferSize, m_InputRemaining );
+                if ( ReadInput( m_InputBuffer, inputSize ) == false )
+                {
+                    return false;
+                }
+                m_InputBufferPos = 0;
+                m_InputBufferUsed = inputSize;
+            }
+
+            ZSTD_outBuffer out = { scratch, sizeof( scratch ), 0 };
+            ZSTD_inBuffer in = { m_InputBuffer, m_InputBufferUsed, m_InputBufferPos };
+            const size_t result = ZSTD_decompressStream( m_ZstdContext, &out, &in );
+            m_InputBufferPos = in.pos;
+            if ( ZSTD_isError( result ) || ( out.pos != 0 ) )
+            {
+                return false;
+            }
+            m_FrameComplete = ( result == 0 );
+        }
+    }
+
+    return ( m_InputRemaining == 0 ) && ( m_InputBufferPos == m_InputBufferUsed );
+}
+
+// ReadInput
+//------------------------------------------------------------------------------
+bool DecompressionStream::ReadInput( void * buffer, size_t size )
+{
+    if ( ( size > m_InputRemaining ) ||
+         ( m_Input.ReadBuffer( buffer, size ) != size ) )
+    {
+        return false;
+    }
+    m_InputRemaining -= size;
+    if ( m_InputHash )
+    {
+        m_InputHash->AddData( buffer, size );
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -6,6 +6,14 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressionDictionary;
+class ICompressionDictionaryProvider;
+class IOStream;
+class xxHash3Accumulator;
+struct ZSTD_DCtx_s;
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
@@ -24,10 +32,12 @@ public:
     bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default LZ4 compression level
 
     // Zstd
-    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default Zstd compression level
+    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1, // -1 = default Zstd compression level
+                       const CompressionDictionary * dictionary = nullptr );
 
     // Decompress (handled all formats including uncompressed)
-    bool Decompress( const void * data );
+    // Data compressed with a dictionary needs a provider to find it
+    bool Decompress( const void * data, ICompressionDictionaryProvider * dictionaries = nullptr );
 
     const void *    GetResult() const       { return m_Result; }
     size_t          GetResultSize() const   { return m_ResultSize; }
@@ -35,11 +45,14 @@ public:
     inline void *   ReleaseResult()         { void * r = m_Result; m_Result = nullptr; m_ResultSize = 0; return r; }
 
 private:
+    friend class DecompressionStream;
+
     enum CompressionType : uint32_t
     {
         eUncompressed   = 0,
         eLZ4            = 1,
         eZstd           = 2,
+        eZstdDictionary = 3,    // Dictionary id (uint64_t) followed by Zstd data
     };
     struct Header
     {
@@ -51,4 +64,61 @@ private:
     size_t m_ResultSize;
 };
 
+// DecompressionStream
+//------------------------------------------------------------------------------
+// Decompresses data in Compressor format as it's read from a stream, so that
+// neither the compressed nor the decompressed data need to be held in memory.
+// Zstd data is decompressed in chunks. LZ4 data (a single block) can't be, so
+// is decompressed in full when opened.
+class DecompressionStream
+{
+public:
+    explicit DecompressionStream( IOStream & input,
+                                  uint64_t inputSize,
+                                  xxHash3Accumulator * inputHash = nullptr,
+                                  ICompressionDictionaryProvider * dictionaries = nullptr );
+    ~DecompressionStream();
+
+    // Read and validate the header
+    bool Open();
+
+    uint64_t    GetUncompressedSize() const { return m_UncompressedSize; }
+
+    // Did Open fail because the data needs a dictionary which can't be found?
+    bool        IsDictionaryMissing() const { return m_DictionaryMissing; }
+
+    // Read decompressed data, failing if there is not enough or it's corrupt
+    bool        Read( void * buffer, size_t size );
+
+    // Consume any remaining data, failing if it's corrupt
+    bool        Finish();
+
+    DecompressionStream( const DecompressionStream & ) = delete;
+    DecompressionStream & operator = ( const DecompressionStream & ) = delete;
+
+private:
+    bool ReadInput( void * buffer, size_t size );
+
+    IOStream &              m_Input;
+    uint64_t                m_InputRemaining;
+    xxHash3Accumulator *    m_InputHash;            // Optional hash of all data read from input
+    ICompressionDictionaryProvider * m_Dictionaries;
+    bool                    m_DictionaryMissing;
+    uint32_t                m_CompressionType;
+    uint64_t                m_UncompressedSize;
+    uint64_t                m_UncompressedRemaining;
+
+    // LZ4 (data decompressed in full)
+    Compressor              m_Block;
+    size_t                  m_BlockPos;
+
+    // Zstd
+    ZSTD_DCtx_s *           m_ZstdContext;
+    char *                  m_InputBuffer;
+    size_t                  m_InputBufferSize;
+    size_t                  m_InputBufferPos;
+    size_t                  m_InputBufferUsed;
+    bool                    m_FrameComplete;
+};
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,668 @@
+// FileWatcher - Track file system changes between builds
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileWatcher.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h>
+#if defined( __LINUX__ )
+    #include <dirent.h>
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// FileWatcherSharedData
+//------------------------------------------------------------------------------
+// Memory shared between a FileWatcher and its clients. Changes are appended to
+// a log which clients read without locking. Resetting the log (or modifying
+// other data which is not append-only) is bracketed by increments of m_Epoch,
+// so clients can detect it.
+class FileWatcherSharedData
+{
+public:
+    enum : uint32_t { VERSION = 1 };
+    enum : uint32_t { MAX_ROOT_PATH_LENGTH = 4096 };
+    enum : uint32_t { UNWATCHED_DIRS_CAPACITY = 64 * 1024 };
+    enum : uint32_t { LOG_CAPACITY = 16 * 1024 * 1024 };
+
+    uint32_t            m_Version;
+    volatile uint32_t   m_Running;          // Cleared if the FileWatcher stops
+    uint64_t            m_InstanceId;
+    volatile uint64_t   m_Epoch;            // Odd while data is being modified
+    volatile uint64_t   m_FirstSequence;    // Changes after this are in the log
+    volatile uint64_t   m_Sequence;         // Most recently recorded change
+    volatile uint64_t   m_LogSize;
+    volatile uint64_t   m_SyncRequest;      // Incremented by clients
+    volatile uint64_t   m_SyncResponse;     // Most recently handled request
+    volatile uint64_t   m_SyncSequence;     // Sequence when that request was handled
+    uint32_t            m_UnwatchedDirsSize;
+    uint32_t            m_Padding;
+    char                m_RootPath[ MAX_ROOT_PATH_LENGTH ];
+    char                m_UnwatchedDirs[ UNWATCHED_DIRS_CAPACITY ]; // Null separated
+    char                m_Log[ LOG_CAPACITY ];
+};
+
+// FileWatcherLogRecord
+//------------------------------------------------------------------------------
+// A change in the log, followed by the null terminated path (padded to 8 bytes)
+class FileWatcherLogRecord
+{
+public:
+    enum : uint32_t { FLAG_DIRECTORY = 0x1 }; // Everything within the directory may have changed
+
+    uint64_t    m_Sequence;
+    uint32_t    m_Flags;
+    uint32_t    m_PathLength;
+
+    const char * GetPath() const { return reinterpret_cast< const char * >( this + 1 ); }
+    static uint32_t GetRecordSize( uint32_t pathLength ) { return (uint32_t)( sizeof( FileWatcherLogRecord ) + ( ( pathLength + 1 + 7 ) & ~7u ) ); }
+};
+
+// IsChanged
+//------------------------------------------------------------------------------
+bool FileWatcherChanges::IsChanged( const AString & fileName ) const
+{
+    // Search sorted files
+    size_t low = 0;
+    size_t high = m_Files.GetSize();
+    while ( low < high )
+    {
+        const size_t mid = ( low + ( ( high - low ) / 2 ) );
+        const int32_t result = m_Files[ mid ].Compare( fileName );
+        if ( result == 0 )
+        {
+            return true;
+        }
+        if ( result < 0 )
+        {
+            low = ( mid + 1 );
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    // Anything within a changed directory is also changed
+    for ( const AString & dir : m_Dirs )
+    {
+        if ( fileName.BeginsWith( dir ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// CONSTRUCTOR (FileWatcherClient)
+//------------------------------------------------------------------------------
+FileWatcherClient::FileWatcherClient()
+    : m_SharedData( nullptr )
+{
+}
+
+// DESTRUCTOR (FileWatcherClient)
+//------------------------------------------------------------------------------
+FileWatcherClient::~FileWatcherClient() = default;
+
+// Connect
+//------------------------------------------------------------------------------
+bool FileWatcherClient::Connect( const char * sharedMemoryName, uint32_t timeoutMS )
+{
+    ASSERT( IsConnected() == false );
+
+    #if defined( __LINUX__ )
+        if ( m_SharedMemory.Open( sharedMemoryName, sizeof( FileWatcherSharedData ) ) == false )
+        {
+            return false; // FileWatcher not running
+        }
+        FileWatcherSharedData * data = static_cast< FileWatcherSharedData * >( m_SharedMemory.GetPtr() );
+        if ( ( data->m_Version != FileWatcherSharedData::VERSION ) ||
+             ( AtomicLoadAcquire( &data->m_Running ) == 0 ) )
+        {
+            return false;
+        }
+
+        // Wait for the FileWatcher to record all changes made before now. If
+        // it doesn't respond (it may have been killed), changes are unknown.
+        const uint64_t request = AtomicInc( &data->m_SyncRequest );
+        const Timer timer;
+        while ( AtomicLoadAcquire( &data->m_SyncResponse ) < request )
+        {
+            if ( ( AtomicLoadAcquire( &data->m_Running ) == 0 ) ||
+                 ( timer.GetElapsedMS() > (float)timeoutMS ) )
+            {
+                return false;
+            }
+            Thread::Sleep( 1 );
+        }
+        m_Snapshot.m_InstanceId = data->m_InstanceId;
+        m_Snapshot.m_Sequence = AtomicLoadAcquire( &data->m_SyncSequence );
+
+        // Take a consistent copy of the watched directories
+        for ( ;; )
+        {
+            const uint64_t epoch = AtomicLoadAcquire( &data->m_Epoch );
+            if ( ( epoch & 1 ) == 0 )
+            {
+                m_RootPath = data->m_RootPath;
+                m_UnwatchedDirs.Clear();
+                const char * pos = data->m_UnwatchedDirs;
+                const char * const end = ( pos + data->m_UnwatchedDirsSize );
+                while ( pos < end )
+                {
+                    const size_t len = strlen( pos );
+                    m_UnwatchedDirs.EmplaceBack( pos, pos + len );
+                    pos += ( len + 1 );
+                }
+                if ( AtomicLoadAcquire( &data->m_Epoch ) == epoch )
+                {
+                    break;
+                }
+            }
+            Thread::Sleep( 0 );
+        }
+
+        m_SharedData = data;
+        return true;
+    #else
+        (void)sharedMemoryName;
+        (void)timeoutMS;
+        return false; // FileWatcher is not supported on this platform
+    #endif
+}
+
+// IsWatched
+//------------------------------------------------------------------------------
+bool FileWatcherClient::IsWatched( const AString & fileName ) const
+{
+    if ( ( IsConnected() == false ) || ( fileName.BeginsWith( m_RootPath ) == false ) )
+    {
+        return false;
+    }
+
+    // Changes within symlinked directories are not seen
+    for ( const AString & dir : m_UnwatchedDirs )
+    {
+        if ( fileName.BeginsWith( dir ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// GetChangesSince
+//------------------------------------------------------------------------------
+bool FileWatcherClient::GetChangesSince( const FileWatcherSnapshot & since, FileWatcherChanges & outChanges ) const
+{
+    outChanges.m_Files.Clear();
+    outChanges.m_Dirs.Clear();
+
+    if ( ( IsConnected() == false ) ||
+         ( since.m_InstanceId != m_Snapshot.m_InstanceId ) ||
+         ( since.m_Sequence > m_Snapshot.m_Sequence ) )
+    {
+        return false;
+    }
+    if ( since.m_Sequence == m_Snapshot.m_Sequence )
+    {
+        return true; // Nothing changed
+    }
+
+    // Log must not be reset while we read it
+    const uint64_t epoch = AtomicLoadAcquire( &m_SharedData->m_Epoch );
+    if ( ( ( epoch & 1 ) != 0 ) ||
+         ( since.m_Sequence < AtomicLoadAcquire( &m_SharedData->m_FirstSequence ) ) )
+    {
+        return false; // Changes were discarded
+    }
+
+    const uint64_t logSize = AtomicLoadAcquire( &m_SharedData->m_LogSize );
+    uint64_t offset = 0;
+    while ( ( offset + sizeof( FileWatcherLogRecord ) ) <= logSize )
+    {
+        const FileWatcherLogRecord * record = reinterpret_cast< const FileWatcherLogRecord * >( m_SharedData->m_Log + offset );
+        if ( record->m_Sequence > m_Snapshot.m_Sequence )
+        {
+            break; // Changed after our snapshot
+        }
+        const uint32_t recordSize = FileWatcherLogRecord::GetRecordSize( record->m_PathLength );
+        if ( ( offset + recordSize ) > logSize )
+        {
+            return false; // Log was reset while being read
+        }
+        if ( record->m_Sequence > since.m_Sequence )
+        {
+            const char * path = record->GetPath();
+            Array< AString > & changes = ( record->m_Flags & FileWatcherLogRecord::FLAG_DIRECTORY ) ? outChanges.m_Dirs : outChanges.m_Files;
+            changes.EmplaceBack( path, path + record->m_PathLength );
+        }
+        offset += recordSize;
+    }
+
+    if ( AtomicLoadAcquire( &m_SharedData->m_Epoch ) != epoch )
+    {
+        return false; // Log was reset while being read
+    }
+
+    outChanges.m_Files.Sort();
+    return true;
+}
+
+// CONSTRUCTOR (FileWatcher)
+//------------------------------------------------------------------------------
+FileWatcher::FileWatcher()
+    : m_SharedData( nullptr )
+    , m_NumWatchedDirs( 0 )
+    #if defined( __LINUX__ )
+        , m_INotifyFD( -1 )
+        , m_LastChangeIsDir( false )
+    #endif
+{
+}
+
+// DESTRUCTOR (FileWatcher)
+//------------------------------------------------------------------------------
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+// Start
+//------------------------------------------------------------------------------
+bool FileWatcher::Start( const AString & rootPath, const char * sharedMemoryName )
+{
+    ASSERT( m_SharedData == nullptr );
+
+    #if defined( __LINUX__ )
+        m_RootPath = rootPath;
+        PathUtils::EnsureTrailingSlash( m_RootPath );
+        if ( m_RootPath.GetLength() >= FileWatcherSharedData::MAX_ROOT_PATH_LENGTH )
+        {
+            OUTPUT( "FBuild: Error: Path too long to watch '%s'\n", m_RootPath.Get() );
+            return false;
+        }
+
+        m_INotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+        if ( m_INotifyFD < 0 )
+        {
+            OUTPUT( "FBuild: Error: Failed to initialize inotify (error %i)\n", errno );
+            return false;
+        }
+
+        m_SharedMemory.Create( sharedMemoryName, sizeof( FileWatcherSharedData ) );
+        m_SharedData = static_cast< FileWatcherSharedData * >( m_SharedMemory.GetPtr() );
+        if ( m_SharedData == nullptr )
+        {
+            OUTPUT( "FBuild: Error: Failed to create shared memory '%s'\n", sharedMemoryName );
+            Stop();
+            return false;
+        }
+
+        // Initialize everything except the log (which may be left over from a
+        // previous instance but is unused until written)
+        memset( m_SharedData, 0, sizeof( FileWatcherSharedData ) - FileWatcherSharedData::LOG_CAPACITY );
+        m_SharedData->m_Version = FileWatcherSharedData::VERSION;
+        m_SharedData->m_InstanceId = ( ( (uint64_t)Timer::GetNow() << 16 ) ^ (uint64_t)getpid() ) | 1; // Never 0
+        AString::Copy( m_RootPath.Get(), m_SharedData->m_RootPath, m_RootPath.GetLength() );
+
+        // Watch all directories. Changes made before a directory is watched
+        // are not seen, but clients can't connect until we're ready and
+        // don't trust anything recorded by a different instance.
+        AddWatchRecursive( m_RootPath );
+        if ( m_NumWatchedDirs == 0 )
+        {
+            OUTPUT( "FBuild: Error: Failed to watch '%s' (error %i)\n", m_RootPath.Get(), errno );
+            Stop();
+            return false;
+        }
+
+        AtomicStoreRelease( &m_SharedData->m_Running, 1u );
+        return true;
+    #else
+        (void)rootPath;
+        (void)sharedMemoryName;
+        OUTPUT( "FBuild: Error: File watching is not supported on this platform\n" );
+        return false;
+    #endif
+}
+
+// Stop
+//------------------------------------------------------------------------------
+void FileWatcher::Stop()
+{
+    if ( m_SharedData )
+    {
+        AtomicStoreRelease( &m_SharedData->m_Running, 0u );
+        m_SharedData = nullptr;
+    }
+    #if defined( __LINUX__ )
+        if ( m_INotifyFD >= 0 )
+        {
+            close( m_INotifyFD );
+            m_INotifyFD = -1;
+        }
+        m_WatchPaths.Clear();
+    #endif
+    m_NumWatchedDirs = 0;
+}
+
+// Update
+//------------------------------------------------------------------------------
+void FileWatcher::Update( uint32_t timeoutMS )
+{
+    ASSERT( m_SharedData );
+
+    #if defined( __LINUX__ )
+        // Wait for notifications
+        pollfd pfd;
+        pfd.fd = m_INotifyFD;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if ( poll( &pfd, 1, (int)timeoutMS ) > 0 )
+        {
+            ProcessEvents();
+        }
+
+        ProcessSyncRequest();
+    #else
+        (void)timeoutMS;
+    #endif
+}
+
+#if defined( __LINUX__ )
+// ProcessEvents
+//------------------------------------------------------------------------------
+void FileWatcher::ProcessEvents()
+{
+    alignas( inotify_event ) char buffer[ 16 * 1024 ];
+    for ( ;; )
+    {
+        const ssize_t bytesRead = read( m_INotifyFD, buffer, sizeof( buffer ) );
+        if ( bytesRead <= 0 )
+        {
+            return; // No more events
+        }
+
+        const char * pos = buffer;
+        const char * const end = ( buffer + bytesRead );
+        while ( pos < end )
+        {
+            const inotify_event & event = *reinterpret_cast< const inotify_event * >( pos );
+            pos += ( sizeof( inotify_event ) + event.len );
+
+            // Events were discarded, so changes are unknown
+            if ( event.mask & IN_Q_OVERFLOW )
+            {
+                ResetLog();
+                continue;
+            }
+
+            if ( ( event.wd < 0 ) ||
+                 ( (size_t)event.wd >= m_WatchPaths.GetSize() ) ||
+                 m_WatchPaths[ (size_t)event.wd ].IsEmpty() )
+            {
+                continue; // Watch was removed
+            }
+            if ( event.mask & IN_IGNORED )
+            {
+                m_WatchPaths[ (size_t)event.wd ].Clear();
+                --m_NumWatchedDirs;
+                continue;
+            }
+            const AString & dirPath = m_WatchPaths[ (size_t)event.wd ];
+
+            // Watched directory itself was deleted or moved
+            if ( event.len == 0 )
+            {
+                if ( event.mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) )
+                {
+                    RecordChange( dirPath, true );
+                }
+                continue;
+            }
+
+            AStackString<> path( dirPath );
+            path += event.name;
+            if ( event.mask & IN_ISDIR )
+            {
+                path += '/';
+                if ( event.mask & ( IN_CREATE | IN_MOVED_TO ) )
+                {
+                    AddWatchRecursive( path );
+                }
+                else if ( event.mask & ( IN_DELETE | IN_MOVED_FROM ) )
+                {
+                    RemoveWatchRecursive( path );
+                }
+                else
+                {
+                    continue; // Directory attributes don't affect the build
+                }
+                RecordChange( path, true );
+                continue;
+            }
+
+            // A symlink to a directory makes its contents visible via a path
+            // we can't watch
+            if ( event.mask & ( IN_CREATE | IN_MOVED_TO ) )
+            {
+                struct stat st;
+                if ( ( lstat( path.Get(), &st ) == 0 ) && S_ISLNK( st.st_mode ) &&
+                     ( stat( path.Get(), &st ) == 0 ) && S_ISDIR( st.st_mode ) )
+                {
+                    path += '/';
+                    AddUnwatchedDir( path );
+                    RecordChange( path, true );
+                    continue;
+                }
+            }
+
+            RecordChange( path, false );
+        }
+    }
+}
+
+// ProcessSyncRequest
+//------------------------------------------------------------------------------
+void FileWatcher::ProcessSyncRequest()
+{
+    const uint64_t request = AtomicLoadAcquire( &m_SharedData->m_SyncRequest );
+    if ( request == m_SharedData->m_SyncResponse )
+    {
+        return;
+    }
+
+    // Changes made before the request are already queued
+    ProcessEvents();
+
+    // Changes after this point must be recorded separately, even if repeated
+    m_LastChange.Clear();
+
+    m_SharedData->m_SyncSequence = m_SharedData->m_Sequence;
+    AtomicStoreRelease( &m_SharedData->m_SyncResponse, request );
+}
+
+// AddWatchRecursive
+//------------------------------------------------------------------------------
+void FileWatcher::AddWatchRecursive( const AString & dirPath )
+{
+    ASSERT( dirPath.EndsWith( '/' ) );
+
+    const uint32_t mask = ( IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                            IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK );
+    const int wd = inotify_add_watch( m_INotifyFD, dirPath.Get(), mask );
+    if ( wd < 0 )
+    {
+        // Directory could have been removed already, but otherwise we
+        // can't see changes within it (e.g. watch limit reached)
+        if ( ( errno != ENOENT ) && ( errno != ENOTDIR ) )
+        {
+            AddUnwatchedDir( dirPath );
+        }
+        return;
+    }
+    if ( (size_t)wd >= m_WatchPaths.GetSize() )
+    {
+        m_WatchPaths.SetSize( (size_t)wd + 1 );
+    }
+    if ( m_WatchPaths[ (size_t)wd ].IsEmpty() )
+    {
+        ++m_NumWatchedDirs;
+    }
+    m_WatchPaths[ (size_t)wd ] = dirPath;
+
+    // Watch sub-directories
+    DIR * dir = opendir( dirPath.Get() );
+    if ( dir == nullptr )
+    {
+        return;
+    }
+    while ( const dirent * entry = readdir( dir ) )
+    {
+        if ( ( AString::StrNCmp( entry->d_name, ".", 2 ) == 0 ) ||
+             ( AString::StrNCmp( entry->d_name, "..", 3 ) == 0 ) )
+        {
+            continue;
+        }
+
+        AStackString<> path( dirPath );
+        path += entry->d_name;
+
+        unsigned char type = entry->d_type;
+        if ( type == DT_UNKNOWN )
+        {
+            struct stat st;
+            if ( lstat( path.Get(), &st ) != 0 )
+            {
+                continue;
+            }
+            type = S_ISDIR( st.st_mode ) ? DT_DIR : S_ISLNK( st.st_mode ) ? DT_LNK : DT_REG;
+        }
+
+        if ( type == DT_DIR )
+        {
+            path += '/';
+            AddWatchRecursive( path );
+        }
+        else if ( type == DT_LNK )
+        {
+            struct stat st;
+            if ( ( stat( path.Get(), &st ) == 0 ) && S_ISDIR( st.st_mode ) )
+            {
+                path += '/';
+                AddUnwatchedDir( path );
+            }
+        }
+    }
+    closedir( dir );
+}
+
+// RemoveWatchRecursive
+//------------------------------------------------------------------------------
+void FileWatcher::RemoveWatchRecursive( const AString & dirPath )
+{
+    // Watches remain on moved directories, but the paths we know them by are
+    // no longer valid
+    for ( size_t wd = 0; wd < m_WatchPaths.GetSize(); ++wd )
+    {
+        AString & watchPath = m_WatchPaths[ wd ];
+        if ( watchPath.IsEmpty() == false && watchPath.BeginsWith( dirPath ) )
+        {
+            inotify_rm_watch( m_INotifyFD, (int)wd );
+            watchPath.Clear();
+            --m_NumWatchedDirs;
+        }
+    }
+}
+
+// AddUnwatchedDir
+//------------------------------------------------------------------------------
+void FileWatcher::AddUnwatchedDir( const AString & dirPath )
+{
+    const uint32_t size = m_SharedData->m_UnwatchedDirsSize;
+    const uint32_t pathSize = ( dirPath.GetLength() + 1 );
+    if ( ( size + pathSize ) > FileWatcherSharedData::UNWATCHED_DIRS_CAPACITY )
+    {
+        // We can no longer describe what is watched, so clients must not
+        // rely on us
+        if ( AtomicLoadAcquire( &m_SharedData->m_Running ) )
+        {
+            OUTPUT( "FBuild: Warning: Too many directories can't be watched - file watching disabled\n" );
+            AtomicStoreRelease( &m_SharedData->m_Running, 0u );
+        }
+        return;
+    }
+
+    AtomicStoreRelease( &m_SharedData->m_Epoch, m_SharedData->m_Epoch + 1 );
+    memcpy( m_SharedData->m_UnwatchedDirs + size, dirPath.Get(), pathSize );
+    m_SharedData->m_UnwatchedDirsSize = ( size + pathSize );
+    AtomicStoreRelease( &m_SharedData->m_Epoch, m_SharedData->m_Epoch + 1 );
+}
+
+// RecordChange
+//------------------------------------------------------------------------------
+void FileWatcher::RecordChange( const AString & path, bool isDir )
+{
+    // Files are usually modified by several operations in quick succession
+    if ( ( isDir == m_LastChangeIsDir ) && ( path == m_LastChange ) )
+    {
+        return;
+    }
+
+    const uint32_t recordSize = FileWatcherLogRecord::GetRecordSize( path.GetLength() );
+    if ( ( m_SharedData->m_LogSize + recordSize ) > FileWatcherSharedData::LOG_CAPACITY )
+    {
+        ResetLog(); // Older changes are discarded
+    }
+
+    const uint64_t logSize = m_SharedData->m_LogSize;
+    const uint64_t sequence = ( m_SharedData->m_Sequence + 1 );
+    FileWatcherLogRecord * record = reinterpret_cast< FileWatcherLogRecord * >( m_SharedData->m_Log + logSize );
+    record->m_Sequence = sequence;
+    record->m_Flags = isDir ? (uint32_t)FileWatcherLogRecord::FLAG_DIRECTORY : 0;
+    record->m_PathLength = path.GetLength();
+    char * recordPath = const_cast< char * >( record->GetPath() );
+    memset( recordPath, 0, recordSize - sizeof( FileWatcherLogRecord ) );
+    memcpy( recordPath, path.Get(), path.GetLength() );
+
+    // Publish
+    AtomicStoreRelease( &m_SharedData->m_Sequence, sequence );
+    AtomicStoreRelease( &m_SharedData->m_LogSize, logSize + recordSize );
+
+    m_LastChange = path;
+    m_LastChangeIsDir = isDir;
+}
+
+// ResetLog
+//------------------------------------------------------------------------------
+void FileWatcher::ResetLog()
+{
+    // Changes before now are no longer known
+    AtomicStoreRelease( &m_SharedData->m_Epoch, m_SharedData->m_Epoch + 1 );
+    m_SharedData->m_LogSize = 0;
+    m_SharedData->m_Sequence = ( m_SharedData->m_Sequence + 1 );
+    m_SharedData->m_FirstSequence = m_SharedData->m_Sequence;
+    AtomicStoreRelease( &m_SharedData->m_Epoch, m_SharedData->m_Epoch + 1 );
+
+    m_LastChange.Clear();
+}
+#endif
+
+//------------------------------------------------------------------------------
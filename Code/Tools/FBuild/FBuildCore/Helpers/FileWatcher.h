@@ -0,0 +1,124 @@
+// FileWatcher - Track file system changes between builds
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/SharedMemory.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class FileWatcherSharedData;
+
+// FileWatcherSnapshot
+//------------------------------------------------------------------------------
+// A point in the sequence of changes recorded by a FileWatcher
+class FileWatcherSnapshot
+{
+public:
+    bool IsValid() const { return ( m_InstanceId != 0 ); }
+    bool operator == ( const FileWatcherSnapshot & other ) const { return ( m_InstanceId == other.m_InstanceId ) && ( m_Sequence == other.m_Sequence ); }
+
+    uint64_t    m_InstanceId    = 0;    // FileWatcher which recorded the changes (0 = none)
+    uint64_t    m_Sequence      = 0;
+};
+
+// FileWatcherChanges
+//------------------------------------------------------------------------------
+// Files and directories changed between two snapshots
+class FileWatcherChanges
+{
+public:
+    bool IsChanged( const AString & fileName ) const;
+    bool IsEmpty() const { return m_Files.IsEmpty() && m_Dirs.IsEmpty(); }
+
+    const Array< AString > & GetFiles() const { return m_Files; }
+    const Array< AString > & GetDirs() const { return m_Dirs; }
+
+private:
+    friend class FileWatcherClient;
+
+    Array< AString >    m_Files;    // Sorted
+    Array< AString >    m_Dirs;     // Everything within these is also changed (with trailing slash)
+};
+
+// FileWatcherClient
+//------------------------------------------------------------------------------
+// Used by a build to query changes recorded by a FileWatcher running in
+// another process
+class FileWatcherClient
+{
+public:
+    FileWatcherClient();
+    ~FileWatcherClient();
+
+    // Connect to the FileWatcher (if running) and take a snapshot once all
+    // file system changes made before this call have been recorded
+    bool Connect( const char * sharedMemoryName, uint32_t timeoutMS = 500 );
+    void Disconnect();
+    bool IsConnected() const { return ( m_SharedData != nullptr ); }
+
+    const FileWatcherSnapshot & GetSnapshot() const { return m_Snapshot; }
+
+    // Is the file covered by the FileWatcher?
+    bool IsWatched( const AString & fileName ) const;
+
+    // Changes made between the given snapshot and the one taken when
+    // connecting. Fails if changes are unknown (older snapshot, changes
+    // lost due to overflow, different FileWatcher etc.)
+    bool GetChangesSince( const FileWatcherSnapshot & since, FileWatcherChanges & outChanges ) const;
+
+private:
+    SharedMemory                    m_SharedMemory;
+    const FileWatcherSharedData *   m_SharedData;
+    FileWatcherSnapshot             m_Snapshot;
+    AString                         m_RootPath;
+    Array< AString >                m_UnwatchedDirs;
+};
+
+// FileWatcher
+//------------------------------------------------------------------------------
+// Records changes to files within a directory tree as they happen, allowing
+// builds to skip retrieving the timestamps of unchanged files (Linux only)
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    bool Start( const AString & rootPath, const char * sharedMemoryName );
+    void Stop();
+
+    // Process pending file system notifications and requests from clients
+    void Update( uint32_t timeoutMS );
+
+    uint32_t GetNumWatchedDirs() const { return m_NumWatchedDirs; }
+
+private:
+    #if defined( __LINUX__ )
+        void ProcessEvents();
+        void ProcessSyncRequest();
+        void AddWatchRecursive( const AString & dirPath );
+        void RemoveWatchRecursive( const AString & dirPath );
+        void AddUnwatchedDir( const AString & dirPath );
+        void RecordChange( const AString & path, bool isDir );
+        void ResetLog();
+    #endif
+
+    SharedMemory            m_SharedMemory;
+    FileWatcherSharedData * m_SharedData;
+    AString                 m_RootPath;
+    uint32_t                m_NumWatchedDirs;
+    #if defined( __LINUX__ )
+        int                 m_INotifyFD;
+        Array< AString >    m_WatchPaths;   // Indexed by watch descriptor (with trailing slash)
+        AString             m_LastChange;   // Repeated changes are only recorded once
+        bool                m_LastChangeIsDir;
+    #endif
+};
+
+//------------------------------------------------------------------------------
@@ -9,12 +9,18 @@
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Strings/AString.h"
 
+// system
+#include <memory.h> // for memcpy
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 MultiBuffer::MultiBuffer()
@@ -133,6 +139,78 @@ bool MultiBuffer::ExtractFile( size_t index, const AString& fileName ) const
     const void * fileData = (void *)( (size_t)m_ReadStream->GetData() + offset );
 
     FileStream fs;
+    if ( !OpenFileForWrite( fs, fileName ) )
+    {
+        return false;
+    }
+    if ( fs.WriteBuffer( fileData, fileSize ) != fileSize )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// ExtractFiles
+//------------------------------------------------------------------------------
+/*static*/ bool MultiBuffer::ExtractFiles( DecompressionStream & stream, const Array< AString > & fileNames, size_t * outProblemFileIndex )
+{
+    // Read the file sizes
+    uint32_t numFiles;
+    if ( !stream.Read( &numFiles, sizeof( numFiles ) ) ||
+         ( numFiles > MAX_FILES ) ||
+         ( numFiles < fileNames.GetSize() ) ) // Caller and MultiBuffer are out of sync
+    {
+        return false;
+    }
+    uint64_t fileSizes[ MAX_FILES ];
+    if ( !stream.Read( fileSizes, sizeof( uint64_t ) * numFiles ) )
+    {
+        return false;
+    }
+
+    // Copy each file's data to disk as it is decompressed
+    UniquePtr< char, FreeDeletor > chunk( (char *)ALLOC( EXTRACT_CHUNK_SIZE ) );
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        FileStream fs;
+        if ( !OpenFileForWrite( fs, fileNames[ i ] ) )
+        {
+            if ( outProblemFileIndex )
+            {
+                *outProblemFileIndex = i;
+            }
+            return false;
+        }
+
+        uint64_t remaining = fileSizes[ i ];
+        while ( remaining > 0 )
+        {
+            const size_t size = (size_t)Math::Min< uint64_t >( EXTRACT_CHUNK_SIZE, remaining );
+            if ( !stream.Read( chunk.Get(), size ) )
+            {
+                return false;
+            }
+            if ( fs.WriteBuffer( chunk.Get(), size ) != size )
+            {
+                if ( outProblemFileIndex )
+                {
+                    *outProblemFileIndex = i;
+                }
+                return false;
+            }
+            remaining -= size;
+        }
+    }
+
+    // Consume any remaining data, validating the stream
+    return stream.Finish();
+}
+
+// OpenFileForWrite
+//------------------------------------------------------------------------------
+/*static*/ bool MultiBuffer::OpenFileForWrite( FileStream & fs, const AString & fileName )
+{
     if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
     {
         // On Windows, we can occasionally fail to open the file with error 1224 (ERROR_USER_MAPPED_FILE), due to
@@ -147,11 +225,6 @@ bool MultiBuffer::ExtractFile( size_t index, const AString& fileName ) const
             return false;
         }
     }
-    if ( fs.WriteBuffer( fileData, fileSize ) != fileSize )
-    {
-        return false;
-    }
-
     return true;
 }
 
@@ -223,4 +296,266 @@ void * MultiBuffer::Release( size_t & outSize )
     return m_WriteStream->Release();
 }
 
+// MultiBufferBlockReader - CONSTRUCTOR
+//------------------------------------------------------------------------------
+MultiBufferBlockReader::MultiBufferBlockReader( uint32_t blockSize, int32_t compressionLevel, bool allowZstdUse )
+    : m_BlockSize( blockSize )
+    , m_CompressionLevel( compressionLevel )
+    , m_AllowZstdUse( allowZstdUse )
+    , m_NumFiles( 0 )
+    , m_NumBlocks( 0 )
+    , m_NumBlocksRead( 0 )
+    , m_FileIndex( 0 )
+    , m_FileRemaining( 0 )
+    , m_Block( nullptr )
+{
+    ASSERT( blockSize >= ( sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::MAX_FILES ) ) ); // Sizes must fit in first block
+}
+
+// MultiBufferBlockReader - DESTRUCTOR
+//------------------------------------------------------------------------------
+MultiBufferBlockReader::~MultiBufferBlockReader()
+{
+    FDELETE m_Block;
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MultiBufferBlockReader::Open( const Array< AString > & fileNames, size_t * outProblemFileIndex )
+{
+    ASSERT( m_NumFiles == 0 ); // Only open once
+    ASSERT( fileNames.GetSize() <= MultiBuffer::MAX_FILES );
+
+    // Open all the files and determine their size
+    uint64_t totalSize = sizeof( uint32_t ) + ( sizeof( uint64_t ) * fileNames.GetSize() );
+    for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+    {
+        if ( m_Files[ i ].Open( fileNames[ i ].Get(), FileStream::READ_ONLY ) == false )
+        {
+            if ( outProblemFileIndex )
+            {
+                *outProblemFileIndex = i;
+            }
+            return false;
+        }
+        m_FileSizes[ i ] = m_Files[ i ].GetFileSize();
+        totalSize += m_FileSizes[ i ];
+    }
+    m_NumFiles = (uint32_t)fileNames.GetSize();
+    m_NumBlocks = (uint32_t)( ( totalSize + m_BlockSize - 1 ) / m_BlockSize );
+    m_FileRemaining = m_NumFiles ? m_FileSizes[ 0 ] : 0;
+    m_Block = FNEW( MemoryStream( m_BlockSize ) );
+    return true;
+}
+
+// ReadBlock
+//------------------------------------------------------------------------------
+bool MultiBufferBlockReader::ReadBlock( Compressor & outBlock, size_t * outProblemFileIndex )
+{
+    ASSERT( m_NumBlocksRead < m_NumBlocks );
+
+    // First block starts with the number of files and the size of each
+    m_Block->Reset();
+    if ( m_NumBlocksRead == 0 )
+    {
+        m_Block->Write( m_NumFiles );
+        for ( size_t i = 0; i < m_NumFiles; ++i )
+        {
+            m_Block->Write( m_FileSizes[ i ] );
+        }
+    }
+
+    // Fill the block with the data for each file in turn
+    while ( ( m_Block->GetSize() < m_BlockSize ) && ( m_FileIndex < m_NumFiles ) )
+    {
+        if ( m_FileRemaining == 0 )
+        {
+            ++m_FileIndex;
+            m_FileRemaining = ( m_FileIndex < m_NumFiles ) ? m_FileSizes[ m_FileIndex ] : 0;
+            continue;
+        }
+        const uint64_t size = Math::Min< uint64_t >( ( m_BlockSize - m_Block->GetSize() ), m_FileRemaining );
+        if ( m_Block->WriteBuffer( m_Files[ m_FileIndex ], size ) != size )
+        {
+            if ( outProblemFileIndex )
+            {
+                *outProblemFileIndex = m_FileIndex;
+            }
+            return false;
+        }
+        m_FileRemaining -= size;
+    }
+    ++m_NumBlocksRead;
+
+    if ( m_AllowZstdUse && ( m_CompressionLevel != 0 ) )
+    {
+        outBlock.CompressZstd( m_Block->GetData(), m_Block->GetSize(), m_CompressionLevel );
+    }
+    else
+    {
+        outBlock.Compress( m_Block->GetData(), m_Block->GetSize(), m_CompressionLevel ); // Level 0 stores data uncompressed
+    }
+    return true;
+}
+
+// MultiBufferExtractor - CONSTRUCTOR
+//------------------------------------------------------------------------------
+MultiBufferExtractor::MultiBufferExtractor( const Array< AString > & fileNames )
+    : m_FileNames( fileNames )
+    , m_NumFiles( 0 )
+    , m_FileIndex( 0 )
+    , m_FileRemaining( 0 )
+    , m_HeaderUsed( 0 )
+    , m_HeaderComplete( false )
+    , m_Failed( false )
+    , m_FileFailed( false )
+{
+    ASSERT( fileNames.GetSize() <= MultiBuffer::MAX_FILES );
+}
+
+// MultiBufferExtractor - DESTRUCTOR
+//------------------------------------------------------------------------------
+MultiBufferExtractor::~MultiBufferExtractor() = default;
+
+// Write
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::Write( const void * data, size_t dataSize )
+{
+    if ( m_Failed )
+    {
+        return false;
+    }
+
+    const char * pos = static_cast< const char * >( data );
+    const char * const end = ( pos + dataSize );
+    while ( pos < end )
+    {
+        // Number of files and their sizes
+        if ( m_HeaderComplete == false )
+        {
+            if ( ReadHeader( pos, end ) == false )
+            {
+                m_Failed = true;
+                return false;
+            }
+            continue;
+        }
+
+        // More data than the sizes indicate?
+        if ( m_FileIndex == m_NumFiles )
+        {
+            m_Failed = true;
+            return false;
+        }
+
+        // Data for current file (which may not be wanted by the caller)
+        const size_t size = (size_t)Math::Min< uint64_t >( m_FileRemaining, (uint64_t)( end - pos ) );
+        if ( m_File.IsOpen() && ( m_File.WriteBuffer( pos, size ) != size ) )
+        {
+            m_Failed = true;
+            m_FileFailed = true;
+            return false;
+        }
+        pos += size;
+        m_FileRemaining -= size;
+
+        if ( m_FileRemaining == 0 )
+        {
+            ++m_FileIndex;
+            if ( OpenFile() == false )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Finish
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::Finish()
+{
+    if ( m_File.IsOpen() )
+    {
+        m_File.Close();
+    }
+    return ( m_Failed == false ) && m_HeaderComplete && ( m_FileIndex == m_NumFiles );
+}
+
+// GetProblemFile
+//------------------------------------------------------------------------------
+const AString * MultiBufferExtractor::GetProblemFile() const
+{
+    return m_FileFailed ? &m_FileNames[ m_FileIndex ] : nullptr;
+}
+
+// ReadHeader
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::ReadHeader( const char * & pos, const char * end )
+{
+    // The number of files, then the size of each
+    const size_t headerSize = ( m_HeaderUsed < sizeof( uint32_t ) ) ? sizeof( uint32_t )
+                                                                     : ( sizeof( uint32_t ) + ( sizeof( uint64_t ) * m_NumFiles ) );
+    const size_t size = Math::Min( ( headerSize - m_HeaderUsed ), (size_t)( end - pos ) );
+    memcpy( m_Header + m_HeaderUsed, pos, size );
+    m_HeaderUsed += size;
+    pos += size;
+    if ( m_HeaderUsed < headerSize )
+    {
+        return true; // Need more data
+    }
+
+    if ( headerSize == sizeof( uint32_t ) )
+    {
+        memcpy( &m_NumFiles, m_Header, sizeof( uint32_t ) );
+        if ( ( m_NumFiles > MultiBuffer::MAX_FILES ) ||
+             ( m_NumFiles < m_FileNames.GetSize() ) ) // Caller and MultiBuffer are out of sync
+        {
+            return false;
+        }
+        if ( m_NumFiles > 0 )
+        {
+            return true; // Sizes follow
+        }
+    }
+    memcpy( m_FileSizes, m_Header + sizeof( uint32_t ), sizeof( uint64_t ) * m_NumFiles );
+    m_HeaderComplete = true;
+
+    return OpenFile();
+}
+
+// OpenFile
+//------------------------------------------------------------------------------
+bool MultiBufferExtractor::OpenFile()
+{
+    if ( m_File.IsOpen() )
+    {
+        m_File.Close();
+    }
+
+    // Open the next file with data, creating any empty files on the way
+    for ( ; m_FileIndex < m_NumFiles; ++m_FileIndex )
+    {
+        if ( ( m_FileIndex < m_FileNames.GetSize() ) &&
+             ( MultiBuffer::OpenFileForWrite( m_File, m_FileNames[ m_FileIndex ] ) == false ) )
+        {
+            m_Failed = true;
+            m_FileFailed = true;
+            return false;
+        }
+
+        m_FileRemaining = m_FileSizes[ m_FileIndex ];
+        if ( m_FileRemaining > 0 )
+        {
+            return true;
+        }
+
+        if ( m_File.IsOpen() )
+        {
+            m_File.Close();
+        }
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
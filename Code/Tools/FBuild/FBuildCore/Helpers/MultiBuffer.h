@@ -7,11 +7,14 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class Compressor;
 class ConstMemoryStream;
+class DecompressionStream;
 class MemoryStream;
 
 // MultiBuffer
@@ -26,6 +29,10 @@ public:
     bool CreateFromFiles( const Array< AString > & fileNames, size_t * outProblemFileIndex = nullptr );
     bool ExtractFile( size_t index, const AString& fileName ) const;
 
+    // Extract files directly from a compressed stream, without holding the
+    // decompressed data in memory
+    static bool ExtractFiles( DecompressionStream & stream, const Array< AString > & fileNames, size_t * outProblemFileIndex = nullptr );
+
     void Compress( int32_t compressionLevel, bool allowZstdUse );
     bool Decompress();
 
@@ -36,9 +43,86 @@ public:
 
 private:
     enum : uint32_t { MAX_FILES = 4 };
+    enum : uint32_t { EXTRACT_CHUNK_SIZE = ( 256 * 1024 ) };
+
+    friend class MultiBufferBlockReader;
+    friend class MultiBufferExtractor;
+
+    static bool OpenFileForWrite( FileStream & fs, const AString & fileName );
 
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
 };
 
+// MultiBufferBlockReader
+//------------------------------------------------------------------------------
+// Reads files as MultiBuffer data in blocks of at most blockSize bytes, each
+// compressed independently, one block at a time, so the data never needs to be
+// held in memory in full. Blocks can be written out with MultiBufferExtractor.
+class MultiBufferBlockReader
+{
+public:
+    MultiBufferBlockReader( uint32_t blockSize, int32_t compressionLevel, bool allowZstdUse );
+    ~MultiBufferBlockReader();
+
+    // Open all the files, failing if any can't be
+    bool Open( const Array< AString > & fileNames, size_t * outProblemFileIndex = nullptr );
+
+    // Number of blocks the files will be read as
+    uint32_t GetNumBlocks() const { return m_NumBlocks; }
+
+    // Read and compress the next block (outBlock must be unused)
+    bool ReadBlock( Compressor & outBlock, size_t * outProblemFileIndex = nullptr );
+
+private:
+    uint32_t            m_BlockSize;
+    int32_t             m_CompressionLevel;
+    bool                m_AllowZstdUse;
+    uint32_t            m_NumFiles;
+    uint32_t            m_NumBlocks;
+    uint32_t            m_NumBlocksRead;
+    uint32_t            m_FileIndex;
+    uint64_t            m_FileRemaining;
+    uint64_t            m_FileSizes[ MultiBuffer::MAX_FILES ];
+    FileStream          m_Files[ MultiBuffer::MAX_FILES ];
+    MemoryStream *      m_Block;
+};
+
+// MultiBufferExtractor
+//------------------------------------------------------------------------------
+// Writes the files in MultiBuffer data as the data arrives, in pieces of any
+// size, so the data never needs to be held in memory in full.
+class MultiBufferExtractor
+{
+public:
+    explicit MultiBufferExtractor( const Array< AString > & fileNames );
+    ~MultiBufferExtractor();
+
+    // Write the next piece of data, failing if it doesn't match the expected
+    // files or a file can't be written
+    bool Write( const void * data, size_t dataSize );
+
+    // Check all the data has been written
+    bool Finish();
+
+    // After a failure, the file which couldn't be written (if any)
+    const AString * GetProblemFile() const;
+
+private:
+    bool ReadHeader( const char * & pos, const char * end );
+    bool OpenFile();
+
+    Array< AString >    m_FileNames;
+    FileStream          m_File;
+    uint32_t            m_NumFiles;
+    uint32_t            m_FileIndex;
+    uint64_t            m_FileRemaining;
+    uint64_t            m_FileSizes[ MultiBuffer::MAX_FILES ];
+    char                m_Header[ sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::MAX_FILES ) ];
+    size_t              m_HeaderUsed;
+    bool                m_HeaderComplete;
+    bool                m_Failed;
+    bool                m_FileFailed;
+};
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,212 @@
+// ToolFileStore - Worker-side content addressed store of toolchain files
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ToolFileStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#endif
+#if defined( __LINUX__ ) || defined( __OSX__ )
+    #include <unistd.h>
+#endif
+
+// Static Data
+//------------------------------------------------------------------------------
+static AStackString<> s_StorePathOverride;
+
+// LeastRecentlyUsedSorter
+//------------------------------------------------------------------------------
+class LeastRecentlyUsedSorter
+{
+public:
+    bool operator () ( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) const
+    {
+        return ( a.m_LastWriteTime < b.m_LastWriteTime );
+    }
+};
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*static*/ bool ToolFileStore::Retrieve( uint64_t hash, uint32_t size, const AString & dstFileName )
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( hash, storeFileName );
+
+    FileIO::FileInfo info;
+    if ( ( FileIO::GetFileInfo( storeFileName, info ) == false ) ||
+         ( info.m_Size != size ) )
+    {
+        return false; // Content not seen before (or incomplete)
+    }
+
+    if ( FileIO::EnsurePathExistsForFile( dstFileName ) == false )
+    {
+        return false;
+    }
+
+    // Replace any stale or partial file
+    if ( FileIO::FileExists( dstFileName.Get() ) )
+    {
+        FileIO::FileDelete( dstFileName.Get() );
+    }
+
+    if ( LinkOrCopy( storeFileName, dstFileName ) == false )
+    {
+        return false;
+    }
+
+    // Mark as recently used so Trim keeps it
+    FileIO::SetFileLastWriteTimeToNow( storeFileName );
+
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        FileIO::SetExecutable( dstFileName.Get() );
+    #endif
+    return true;
+}
+
+// Store
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::Store( uint64_t hash, const AString & srcFileName )
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( hash, storeFileName );
+
+    if ( FileIO::FileExists( storeFileName.Get() ) )
+    {
+        return; // Already have this content
+    }
+
+    if ( FileIO::EnsurePathExistsForFile( storeFileName ) == false )
+    {
+        return; // Not fatal, the file will just be transferred again if needed
+    }
+
+    if ( LinkOrCopy( srcFileName, storeFileName ) == false )
+    {
+        FileIO::FileDelete( storeFileName.Get() ); // Don't leave partial copies behind
+    }
+}
+
+// Discard
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::Discard( uint64_t hash )
+{
+    AStackString<> storeFileName;
+    GetStoreFileName( hash, storeFileName );
+    FileIO::FileDelete( storeFileName.Get() );
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::Trim( uint64_t maxSize )
+{
+    AStackString<> storePath;
+    GetStorePath( storePath );
+
+    Array< FileIO::FileInfo > files( 1024 );
+    if ( FileIO::GetFilesEx( storePath, nullptr, false, &files ) == false )
+    {
+        return; // Nothing stored yet
+    }
+
+    uint64_t totalSize = 0;
+    for ( const FileIO::FileInfo & info : files )
+    {
+        totalSize += info.m_Size;
+    }
+    if ( totalSize <= maxSize )
+    {
+        return;
+    }
+
+    // Delete least recently used first. Toolchain files linked to the store are
+    // unaffected, and files in use are refreshed by ToolManifest::TouchFiles
+    LeastRecentlyUsedSorter sorter;
+    files.Sort( sorter );
+    for ( const FileIO::FileInfo & info : files )
+    {
+        // Try to delete (ok to fail if file is in use)
+        if ( FileIO::FileDelete( info.m_Name.Get() ) )
+        {
+            totalSize -= info.m_Size;
+            if ( totalSize <= maxSize )
+            {
+                break;
+            }
+        }
+    }
+}
+
+// GetStorePath
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::GetStorePath( AString & outPath )
+{
+    if ( s_StorePathOverride.IsEmpty() == false )
+    {
+        outPath = s_StorePathOverride;
+        return;
+    }
+
+    VERIFY( FBuild::GetTempDir( outPath ) );
+    #if defined( __WINDOWS__ )
+        outPath += ".fbuild.tmp\\worker\\toolstore\\";
+    #else
+        outPath += "_fbuild.tmp/worker/toolstore/";
+    #endif
+}
+
+// SetStorePathForTests
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::SetStorePathForTests( const AString & path )
+{
+    s_StorePathOverride = path;
+    if ( ( s_StorePathOverride.IsEmpty() == false ) &&
+         ( s_StorePathOverride.EndsWith( NATIVE_SLASH ) == false ) )
+    {
+        s_StorePathOverride += NATIVE_SLASH;
+    }
+}
+
+// GetStoreFileName
+//------------------------------------------------------------------------------
+/*static*/ void ToolFileStore::GetStoreFileName( uint64_t hash, AString & outFileName )
+{
+    GetStorePath( outFileName );
+    outFileName.AppendFormat( "%016" PRIx64, hash );
+}
+
+// LinkOrCopy
+//------------------------------------------------------------------------------
+/*static*/ bool ToolFileStore::LinkOrCopy( const AString & srcFileName, const AString & dstFileName )
+{
+    // Toolchain files and the store are in the same temp dir, so are on the same
+    // volume and can normally be hard linked
+    #if defined( __WINDOWS__ )
+        if ( CreateHardLinkA( dstFileName.Get(), srcFileName.Get(), nullptr ) )
+        {
+            return true;
+        }
+    #else
+        if ( link( srcFileName.Get(), dstFileName.Get() ) == 0 )
+        {
+            return true;
+        }
+    #endif
+
+    return FileIO::FileCopy( srcFileName.Get(), dstFileName.Get() );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+// ToolFileStore - Worker-side content addressed store of toolchain files
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// ToolFileStore
+//------------------------------------------------------------------------------
+// Every toolchain file a worker receives is also kept in the store, keyed by its
+// content. When the toolchain changes (so gets a new ToolId), files with content
+// the worker already has are taken from the store instead of being transferred
+// again. Files are hard linked where possible, so the store takes no extra space.
+//
+// Files retrieved from the store must be verified by the caller, and discarded
+// from the store if they don't match.
+//
+// The store is trimmed to a maximum size, removing the least recently used
+// content first.
+class ToolFileStore
+{
+public:
+    enum : uint64_t { DEFAULT_MAX_SIZE = ( 2048ULL * MEGABYTE ) };
+
+    // Place a copy of a file with the given content at dstFileName
+    static bool Retrieve( uint64_t hash, uint32_t size, const AString & dstFileName );
+
+    // Add a file to the store (if not already present)
+    static void Store( uint64_t hash, const AString & srcFileName );
+
+    // Remove a file whose content didn't match
+    static void Discard( uint64_t hash );
+
+    // Remove least recently used content until the store is no larger than maxSize
+    static void Trim( uint64_t maxSize = DEFAULT_MAX_SIZE );
+
+    static void GetStorePath( AString & outPath );
+    static void SetStorePathForTests( const AString & path ); // Empty to restore the default
+
+private:
+    static void GetStoreFileName( uint64_t hash, AString & outFileName );
+    static bool LinkOrCopy( const AString & srcFileName, const AString & dstFileName );
+};
+
+//------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
 
 // system
 #include <memory.h> // memcpy
@@ -38,6 +39,7 @@ REFLECT_STRUCT_BEGIN( ToolManifestFile, Struct, MetaNone() )
     REFLECT( m_Name,        "Name",         MetaHidden() )
     REFLECT( m_TimeStamp,   "TimeStamp",    MetaHidden() )
     REFLECT( m_Hash,        "Hash",         MetaHidden() )
+    REFLECT( m_ContentHash, "ContentHash",  MetaHidden() )
     REFLECT( m_UncompressedContentSize, "UncompressedContentSize",  MetaHidden() )
     REFLECT( m_CompressedContentSize, "CompressedContentSize",  MetaHidden() )
 REFLECT_END( ToolManifestFile )
@@ -118,7 +120,7 @@ bool ToolManifestFile::DoBuild()
     ASSERT( m_CompressedContentSize == 0 );
 
     // Do we already have a hash?
-    if ( m_Hash != 0 )
+    if ( ( m_Hash != 0 ) && ( m_ContentHash != 0 ) )
     {
         // Can we trust the hash? (timestamp has not changed)
         if ( m_TimeStamp == FileIO::GetFileLastWriteTime( m_Name ) )
@@ -140,7 +142,8 @@ bool ToolManifestFile::DoBuild()
     m_UncompressedContentSize = uncompressedContentSize;
 
     // Store the hash and timestamp
-    m_Hash = xxHash::Calc32( uncompressedContent, uncompressedContentSize ); // TODO:C Switch to 64 bit hash
+    m_Hash = xxHash::Calc32( uncompressedContent, uncompressedContentSize ); // Feeds into ToolId
+    m_ContentHash = xxHash3::Calc64( uncompressedContent, uncompressedContentSize ); // Identifies content on workers
     m_TimeStamp = FileIO::GetFileLastWriteTime( m_Name );
 
     // Compress and keep the data if it might be useful
@@ -161,6 +164,31 @@ void ToolManifestFile::Migrate( const ToolManifestFile & oldFile )
     ASSERT( m_Name == oldFile.m_Name );
     m_TimeStamp = oldFile.m_TimeStamp;
     m_Hash = oldFile.m_Hash;
+    m_ContentHash = oldFile.m_ContentHash;
+}
+
+// HasSameContent (ToolManifestFile)
+//------------------------------------------------------------------------------
+bool ToolManifestFile::HasSameContent( const ToolManifestFile & other ) const
+{
+    return ( m_Hash == other.m_Hash ) &&
+           ( m_ContentHash == other.m_ContentHash ) &&
+           ( m_UncompressedContentSize == other.m_UncompressedContentSize );
+}
+
+// IsContentValid (ToolManifestFile)
+//------------------------------------------------------------------------------
+bool ToolManifestFile::IsContentValid( const void * data, size_t dataSize ) const
+{
+    if ( dataSize != m_UncompressedContentSize )
+    {
+        return false;
+    }
+    if ( m_ContentHash != 0 )
+    {
+        return ( xxHash3::Calc64( data, dataSize ) == m_ContentHash );
+    }
+    return ( xxHash::Calc32( data, dataSize ) == m_Hash ); // Older clients
 }
 
 // Generate
@@ -248,7 +276,7 @@ void ToolManifest::Migrate( const ToolManifest & oldManifest )
 
 // SerializeForRemote
 //------------------------------------------------------------------------------
-void ToolManifest::SerializeForRemote( IOStream & ms ) const
+void ToolManifest::SerializeForRemote( IOStream & ms, bool includeContentHashes ) const
 {
     ms.Write( m_ToolId );
     ms.Write( m_MainExecutableRootPath );
@@ -271,11 +299,20 @@ void ToolManifest::SerializeForRemote( IOStream & ms ) const
     {
         ms.Write( m_CustomEnvironmentVariables[ i ] );
     }
+
+    // Content hashes (Protocol 22.8+)
+    if ( includeContentHashes )
+    {
+        for ( const ToolManifestFile & f : m_Files )
+        {
+            ms.Write( f.GetContentHash() );
+        }
+    }
 }
 
 // DeserializeFromRemote
 //------------------------------------------------------------------------------
-bool ToolManifest::DeserializeFromRemote( IOStream & ms )
+bool ToolManifest::DeserializeFromRemote( IOStream & ms, bool includeContentHashes )
 {
     // NOTE: In clients prior to v1.07 a bug could cause ToolManifests to be
     //       corrupt so we try to read this stream in a way that allows us to
@@ -341,17 +378,32 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
         customEnvironmentVariables.EmplaceBack( Move( envVar ) );
     }
 
+    // Content hashes (Protocol 22.8+)
+    if ( includeContentHashes )
+    {
+        for ( ToolManifestFile & file : files )
+        {
+            uint64_t contentHash( 0 );
+            if ( !ms.Read( contentHash ) )
+            {
+                return false; // Corrupt stream
+            }
+            file.SetContentHash( contentHash );
+        }
+    }
+
     // Deserialization is complete so we can keep what we've read
     m_MainExecutableRootPath = mainExecutablePath;
     m_Files = Move( files );
     m_CustomEnvironmentVariables = Move( customEnvironmentVariables );
 
-    // determine if any files are remaining from a previous run
+    // determine if any files are remaining from a previous run, or have
+    // content already received for another toolchain
     size_t numFilesAlreadySynchronized = 0;
-    for ( size_t i=0; i<(size_t)numFiles; ++i )
+    for ( uint32_t i=0; i<numFiles; ++i )
     {
         AStackString<> localFile;
-        GetRemoteFilePath( (uint32_t)i, localFile );
+        GetRemoteFilePath( i, localFile );
 
         // Set modification time to now
         //  - On OSX (and possibly some Linux variants) this will prevent
@@ -362,30 +414,31 @@ bool ToolManifest::DeserializeFromRemote( IOStream & ms )
         FileIO::SetFileLastWriteTimeToNow( localFile );
 
         // is this file already present?
-        UniquePtr<FileStream> fileStream( FNEW( FileStream ) );
-        FileStream & f = *( fileStream.Get() );
-        if ( f.Open( localFile.Get() ) == false )
-        {
-            continue; // file not found
-        }
-        if ( f.GetFileSize() != m_Files[ i ].GetUncompressedContentSize() )
+        const ToolManifestFile & file = m_Files[ i ];
+        const bool useStore = ( file.GetContentHash() != 0 ); // Not sent by older clients
+        if ( LockExistingFile( i ) )
         {
-            continue; // file is not complete
+            // Make it available to other toolchains (files from older versions
+            // won't be in the store yet)
+            if ( useStore )
+            {
+                ToolFileStore::Store( file.GetContentHash(), localFile );
+            }
+            numFilesAlreadySynchronized++;
+            continue;
         }
-        UniquePtr< char, FreeDeletor > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
-        if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
-        {
-            continue; // problem reading file
-        }
-        if ( xxHash::Calc32( mem.Get(), (size_t)f.GetFileSize() ) != m_Files[ i ].GetHash() )
+
+        // has the content been received before?
+        if ( useStore &&
+             ToolFileStore::Retrieve( file.GetContentHash(), file.GetUncompressedContentSize(), localFile ) )
         {
-            continue; // file contents unexpected
+            if ( LockExistingFile( i ) )
+            {
+                numFilesAlreadySynchronized++;
+                continue;
+            }
+            ToolFileStore::Discard( file.GetContentHash() ); // stored content was bad
         }
-
-        // file present and ok
-        m_Files[ i ].SetFileLock( fileStream.ReleaseOwnership() ); // NOTE: keep file open to prevent deletions
-        m_Files[ i ].SetSyncState( ToolManifestFile::SYNCHRONIZED );
-        numFilesAlreadySynchronized++;
     }
 
     // Generate Environment
@@ -504,6 +557,41 @@ bool ToolManifest::GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syn
     return synching;
 }
 
+// MarkFilesAsSynchronizing
+//------------------------------------------------------------------------------
+void ToolManifest::MarkFilesAsSynchronizing( Array< uint32_t > & outFileIdsToRequest )
+{
+    MutexHolder mh( m_Mutex );
+
+    const size_t numFiles = m_Files.GetSize();
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        ToolManifestFile & file = m_Files[ i ];
+        if ( file.GetSyncState() != ToolManifestFile::NOT_SYNCHRONIZED )
+        {
+            continue;
+        }
+        file.SetSyncState( ToolManifestFile::SYNCHRONIZING );
+
+        // Files with the same content as one being requested are written
+        // when that one is received
+        bool sameContentRequested = false;
+        for ( const uint32_t fileId : outFileIdsToRequest )
+        {
+            const ToolManifestFile & other = m_Files[ fileId ];
+            if ( other.HasSameContent( file ) )
+            {
+                sameContentRequested = true;
+                break;
+            }
+        }
+        if ( sameContentRequested == false )
+        {
+            outFileIdsToRequest.Append( static_cast< uint32_t >( i ) );
+        }
+    }
+}
+
 // CancelSynchronizingFiles
 //------------------------------------------------------------------------------
 void ToolManifest::CancelSynchronizingFiles()
@@ -616,6 +704,89 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
     const void * uncompressedData = c.GetResult();
     const size_t uncompressedDataSize = c.GetResultSize();
 
+    if ( WriteFile( fileId, uncompressedData, uncompressedDataSize ) == false )
+    {
+        return false; // FAILED
+    }
+
+    // write any files with the same content, which were not requested separately
+    const size_t numFiles = m_Files.GetSize();
+    for ( size_t i = 0; i < numFiles; ++i )
+    {
+        const ToolManifestFile & other = m_Files[ i ];
+        if ( ( other.GetSyncState() == ToolManifestFile::SYNCHRONIZING ) &&
+             other.HasSameContent( f ) )
+        {
+            if ( WriteFile( static_cast< uint32_t >( i ), uncompressedData, uncompressedDataSize ) == false )
+            {
+                return false; // FAILED
+            }
+        }
+    }
+
+    // keep the content for future versions of the toolchain
+    if ( ( f.GetContentHash() != 0 ) &&
+         f.IsContentValid( uncompressedData, uncompressedDataSize ) )
+    {
+        AStackString<> fileName;
+        GetRemoteFilePath( fileId, fileName );
+        ToolFileStore::Store( f.GetContentHash(), fileName );
+    }
+
+    // is completely synchronized?
+    for ( const ToolManifestFile & file : m_Files )
+    {
+        if ( file.GetSyncState() != ToolManifestFile::SYNCHRONIZED )
+        {
+            // still some files to be received
+            return true; // file stored ok
+        }
+    }
+
+    // all files received
+    m_Synchronized = true;
+    return true; // file stored ok
+}
+
+// LockExistingFile
+//------------------------------------------------------------------------------
+bool ToolManifest::LockExistingFile( uint32_t fileId )
+{
+    ToolManifestFile & file = m_Files[ fileId ];
+
+    AStackString<> localFile;
+    GetRemoteFilePath( fileId, localFile );
+
+    UniquePtr<FileStream> fileStream( FNEW( FileStream ) );
+    FileStream & f = *( fileStream.Get() );
+    if ( f.Open( localFile.Get() ) == false )
+    {
+        return false; // file not found
+    }
+    if ( f.GetFileSize() != file.GetUncompressedContentSize() )
+    {
+        return false; // file is not complete
+    }
+    UniquePtr< char, FreeDeletor > mem( (char *)ALLOC( (size_t)f.GetFileSize() ) );
+    if ( f.Read( mem.Get(), (size_t)f.GetFileSize() ) != f.GetFileSize() )
+    {
+        return false; // problem reading file
+    }
+    if ( file.IsContentValid( mem.Get(), (size_t)f.GetFileSize() ) == false )
+    {
+        return false; // file contents unexpected
+    }
+
+    // file present and ok
+    file.SetFileLock( fileStream.ReleaseOwnership() ); // NOTE: keep file open to prevent deletions
+    file.SetSyncState( ToolManifestFile::SYNCHRONIZED );
+    return true;
+}
+
+// WriteFile
+//------------------------------------------------------------------------------
+bool ToolManifest::WriteFile( uint32_t fileId, const void * data, size_t dataSize )
+{
     // prepare name for this file
     AStackString<> fileName;
     GetRemoteFilePath( fileId, fileName );
@@ -627,13 +798,19 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         return false; // FAILED
     }
 
+    // remove any stale file first, as it may be linked to the ToolFileStore
+    if ( FileIO::FileExists( fileName.Get() ) )
+    {
+        FileIO::FileDelete( fileName.Get() );
+    }
+
     // write to disk
     FileStream fs;
     if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
     {
         return false; // FAILED
     }
-    if ( fs.Write( uncompressedData, uncompressedDataSize ) != uncompressedDataSize )
+    if ( fs.Write( data, dataSize ) != dataSize )
     {
         return false; // FAILED
     }
@@ -652,22 +829,10 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
     }
 
     // This file is now synchronized
+    ToolManifestFile & f = m_Files[ fileId ];
     f.SetFileLock( fileStream.ReleaseOwnership() ); // NOTE: Keep file open to prevent deletion
     f.SetSyncState( ToolManifestFile::SYNCHRONIZED );
-
-    // is completely synchronized?
-    for ( const ToolManifestFile & file : m_Files )
-    {
-        if ( file.GetSyncState() != ToolManifestFile::SYNCHRONIZED )
-        {
-            // still some files to be received
-            return true; // file stored ok
-        }
-    }
-
-    // all files received
-    m_Synchronized = true;
-    return true; // file stored ok
+    return true;
 }
 
 // GetRelativePath
@@ -41,16 +41,20 @@ public:
     void                Migrate( const ToolManifestFile & oldFile );
 
     const void *        GetFileData( size_t & outDataSize ) const;
+    bool                HasSameContent( const ToolManifestFile & other ) const;
+    bool                IsContentValid( const void * data, size_t dataSize ) const;
 
     // Access state
     const AString &     GetName() const                     { return m_Name; }
     uint64_t            GetTimeStamp() const                { return m_TimeStamp; }
     uint32_t            GetHash() const                     { return m_Hash; }
+    uint64_t            GetContentHash() const              { return m_ContentHash; }
     uint32_t            GetUncompressedContentSize() const  { return m_UncompressedContentSize; }
     SyncState           GetSyncState() const                { return m_SyncState; }
 
     // Modify state
     void                SetSyncState( SyncState state )         { m_SyncState = state; }
+    void                SetContentHash( uint64_t contentHash )  { m_ContentHash = contentHash; }
     void                SetFileLock( FileStream * fileLock )    { m_FileLock = fileLock; }
 
 protected:
@@ -60,6 +64,7 @@ protected:
     AString          m_Name;
     uint64_t         m_TimeStamp     = 0;
     uint32_t         m_Hash          = 0;
+    uint64_t         m_ContentHash   = 0; // 0 if not known (from older clients)
     mutable uint32_t m_UncompressedContentSize = 0;
     mutable uint32_t m_CompressedContentSize = 0;
 
@@ -88,8 +93,8 @@ public:
     inline uint64_t GetToolId() const { return m_ToolId; }
     inline uint64_t GetTimeStamp() const { return m_TimeStamp; }
 
-    void SerializeForRemote( IOStream & ms ) const;
-    bool DeserializeFromRemote( IOStream & ms );
+    void SerializeForRemote( IOStream & ms, bool includeContentHashes ) const;
+    bool DeserializeFromRemote( IOStream & ms, bool includeContentHashes );
 
     inline bool IsSynchronized() const { return m_Synchronized; }
     bool GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syncTotal ) const;
@@ -104,7 +109,9 @@ public:
     inline void *   GetUserData() const         { return m_UserData; }
     const Array< ToolManifestFile > & GetFiles() const { return m_Files; }
 
-    void MarkFileAsSynchronizing( size_t fileId ) { ASSERT( m_Files[ fileId ].GetSyncState() == ToolManifestFile::NOT_SYNCHRONIZED ); m_Files[ fileId ].SetSyncState( ToolManifestFile::SYNCHRONIZING ); }
+    // Mark all unsynchronized files as synchronizing, and get those which must be
+    // requested (files with the same content as another are only requested once)
+    void MarkFilesAsSynchronizing( Array< uint32_t > & outFileIdsToRequest );
     void CancelSynchronizingFiles();
 
     const void *    GetFileData( uint32_t fileId, size_t & dataSize ) const;
@@ -121,6 +128,9 @@ public:
     #endif
 
 private:
+    bool            LockExistingFile( uint32_t fileId );
+    bool            WriteFile( uint32_t fileId, const void * data, size_t dataSize );
+
     mutable Mutex   m_Mutex;
 
     // Reflected
@@ -13,6 +13,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include <Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h>
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
@@ -29,6 +30,9 @@
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
+#define SLOW_WORKER_SPEED_RATIO ( 1.5f ) // Workers this much slower than the fastest get the cheapest jobs
+#define STRAGGLER_TIME_RATIO ( 1.5f ) // Jobs taking this much longer than expected are raced locally
+#define STRAGGLER_MIN_OVERDUE_MS ( 1000 )
 #define DIST_INFO( ... ) do { if ( m_DetailedLogging ) { FLOG_OUTPUT( __VA_ARGS__ ); } } while( false )
 
 // CONSTRUCTOR
@@ -40,6 +44,7 @@ Client::Client( const Array< AString > & workerList,
     : m_WorkerList( workerList )
     , m_ShouldExit( false )
     , m_DetailedLogging( detailedLogging )
+    , m_FastestWorkerSpeed( 0 )
     , m_WorkerConnectionLimit( workerConnectionLimit )
     , m_Port( port )
 {
@@ -70,6 +75,12 @@ Client::~Client()
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
+    // A result being streamed can't be completed
+    if ( ss->m_StreamBlocksRemaining > 0 )
+    {
+        FinishStreamedResult( ss );
+    }
+
     MutexHolder mh( ss->m_Mutex );
     DIST_INFO( "Disconnected: %s\n", ss->m_RemoteName.Get() );
     if ( ss->m_Jobs.IsEmpty() == false )
@@ -87,6 +98,8 @@ Client::~Client()
     FREE( (void *)( ss->m_CurrentMessage ) );
 
     ss->m_RemoteName.Clear();
+    ss->m_ChunkCache.Clear(); // the server's chunks are discarded with the connection
+    ss->m_Stats.Reset();
     AtomicStoreRelaxed( &ss->m_Connection, static_cast< const ConnectionInfo * >( nullptr ) );
     ss->m_CurrentMessage = nullptr;
 }
@@ -240,6 +253,7 @@ void Client::CommunicateJobAvailability()
 
     // Update each server so it knows how many jobs we have available now
     MutexHolder mh( m_ServerListMutex );
+    float fastestWorkerSpeed = 0.0f;
     for ( ServerState & ss : m_ServerList )
     {
         // Do we have a connection?
@@ -250,6 +264,13 @@ void Client::CommunicateJobAvailability()
             continue; // no connection
         }
 
+        // Find the fastest worker, to compare the others with
+        const float speed = ss.m_Stats.GetSpeedFactor();
+        if ( ( speed > 0.0f ) && ( ( fastestWorkerSpeed == 0.0f ) || ( speed < fastestWorkerSpeed ) ) )
+        {
+            fastestWorkerSpeed = speed;
+        }
+
         // Update the worker periodically (but only if the state has changed)
         bool sendAvailabilityToWorker = timerExpired && ( ss.m_NumJobsAvailable != numJobsAvailable );
 
@@ -275,6 +296,8 @@ void Client::CommunicateJobAvailability()
         }
     }
 
+    m_FastestWorkerSpeed.Store( static_cast< uint32_t >( fastestWorkerSpeed * 1000.0f ) );
+
     // Restart periodic update timer if needed
     if ( timerExpired )
     {
@@ -372,6 +395,12 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast< const Protocol::MsgRequestJobs * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_JOB_RESULT:
         {
             const Protocol::MsgJobResult * msg = static_cast< const Protocol::MsgJobResult * >( imsg );
@@ -384,6 +413,24 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_JOB_RESULT_STREAMED:
+        {
+            const Protocol::MsgJobResultStreamed * msg = static_cast< const Protocol::MsgJobResultStreamed * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_JOB_RESULT_BLOCK:
+        {
+            const Protocol::MsgJobResultBlock * msg = static_cast< const Protocol::MsgJobResultBlock * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_JOB_REJECTED:
+        {
+            const Protocol::MsgJobRejected * msg = static_cast< const Protocol::MsgJobRejected * >( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_REQUEST_MANIFEST:
         {
             const Protocol::MsgRequestManifest * msg = static_cast< const Protocol::MsgRequestManifest * >( imsg );
@@ -396,6 +443,12 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_FILES:
+        {
+            const Protocol::MsgRequestFiles * msg = static_cast< const Protocol::MsgRequestFiles * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_CONNECTION_ACK:
         {
             const Protocol::MsgConnectionAck * msg = static_cast< const Protocol::MsgConnectionAck * >( imsg );
@@ -427,30 +480,105 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     ServerState * ss = (ServerState *)connection->GetUserData();
     ASSERT( ss );
 
-    // no jobs for deny listed workers
-    if ( ss->m_Denylisted )
+    if ( SendJob( connection ) == false )
     {
+        // tell the client we don't have anything right now
+        // (we completed or gave away the job already)
         MutexHolder mh( ss->m_Mutex );
         const Protocol::MsgNoJobAvailable msg;
         SendMessageInternal( connection, msg );
-        return;
+    }
+}
+
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // Stream as many jobs as we have credit for
+    const uint32_t numJobs = msg->GetNumJobs();
+    uint32_t numJobsSent = 0;
+    while ( ( numJobsSent < numJobs ) && SendJob( connection ) )
+    {
+        ++numJobsSent;
+    }
+
+    // Every credit must be answered, so return any we couldn't use
+    if ( numJobsSent < numJobs )
+    {
+        MutexHolder mh( ss->m_Mutex );
+        const Protocol::MsgNoJobAvailable noJobMsg;
+        for ( uint32_t i = numJobsSent; i < numJobs; ++i )
+        {
+            SendMessageInternal( connection, noJobMsg );
+        }
+    }
+}
+
+// SendJob
+//------------------------------------------------------------------------------
+bool Client::SendJob( const ConnectionInfo * connection )
+{
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // no jobs for deny listed workers
+    if ( ss->m_Denylisted )
+    {
+        return false;
     }
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
+    // Snapshot the stats, which are updated under the lock as results arrive
+    WorkerStats stats;
+    {
+        MutexHolder statsMH( ss->m_Mutex );
+        stats = ss->m_Stats;
+    }
+
+    // Slow workers take the cheapest jobs, leaving the most expensive ones
+    // (which are the most likely to hold up the build) for faster workers
+    const float fastestWorkerSpeed = ( static_cast< float >( m_FastestWorkerSpeed.Load() ) / 1000.0f );
+    const bool isSlowWorker = ( fastestWorkerSpeed > 0.0f ) &&
+                              ( stats.GetSpeedFactor() > ( fastestWorkerSpeed * SLOW_WORKER_SPEED_RATIO ) );
+
+    Job * job = JobQueue::Get().GetDistributableJobToProcess( true, isSlowWorker );
     if ( job == nullptr )
     {
         PROFILE_SECTION( "NoJob" );
-        // tell the client we don't have anything right now
-        // (we completed or gave away the job already)
-        MutexHolder mh( ss->m_Mutex );
-        const Protocol::MsgNoJobAvailable msg;
-        SendMessageInternal( connection, msg );
-        return;
+        return false;
     }
 
+    // Note when the job should be returned by, so it can be raced locally if
+    // the worker takes much longer than expected
+    const int64_t now = Timer::GetNow();
+    int64_t deadline = 0;
+    const uint32_t expectedMS = stats.EstimateRoundTripMS( job->GetNode()->GetLastBuildTime() );
+    if ( expectedMS > 0 )
+    {
+        const double allowedMS = ( (double)expectedMS * STRAGGLER_TIME_RATIO ) + STRAGGLER_MIN_OVERDUE_MS;
+        deadline = now + (int64_t)( ( allowedMS / 1000 ) * (double)Timer::GetFrequency() );
+    }
+    job->SetRemoteTimes( now, deadline );
+
     // send the job to the client
     MemoryStream stream;
-    job->Serialize( stream );
+    const bool isDataChunked = ( ss->m_ProtocolVersionMinor.Load() >= 6 );
+    if ( isDataChunked )
+    {
+        // Send the preprocessed source as a list of chunks, with the contents
+        // of only those chunks the server doesn't already have. The chunk cache
+        // is only used by this connection's receive and disconnect callbacks,
+        // which don't run concurrently, so it stays in step with what is sent.
+        SerializeChunked( job, ss, stream );
+    }
+    else
+    {
+        job->Serialize( stream );
+    }
 
     MutexHolder mh( ss->m_Mutex );
 
@@ -475,12 +603,17 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     }
     FLOG_MONITOR( "START_JOB %s \"%s\" \n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
 
+    // Have the results returned in blocks we can write to disk as they arrive
+    const bool isResultStreamed = ( ss->m_ProtocolVersionMinor.Load() >= 7 );
+    job->SetResultStreamed( isResultStreamed );
+
     // Determine compression level we'd like the Server to use for returning the results
     int16_t resultCompressionLevel = -1; // Default compression level
-    if ( FBuild::IsValid() )
+    if ( FBuild::IsValid() && ( isResultStreamed == false ) )
     {
         // If we will write the results to the cache, and this node is cacheable
         // then we want to respect higher cache compression levels if set
+        // (streamed results are written to the cache from the files instead)
         const int16_t cacheCompressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
         if ( ( cacheCompressionLevel != 0 ) &&
              ( FBuild::Get().GetOptions().m_UseCacheWrite ) &&
@@ -497,9 +630,35 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
 
     {
         PROFILE_SECTION( "SendJob" );
-        const Protocol::MsgJob msg( toolId, resultCompressionLevel );
+        const Protocol::MsgJob msg( toolId, resultCompressionLevel, isDataChunked, isResultStreamed );
         SendMessageInternal( connection, msg, stream );
     }
+    return true;
+}
+
+// SerializeChunked
+//------------------------------------------------------------------------------
+void Client::SerializeChunked( const Job * job, ServerState * ss, MemoryStream & outStream ) const
+{
+    PROFILE_FUNCTION;
+
+    // Chunk boundaries depend on the content, so we need the uncompressed data
+    const void * data = job->GetData();
+    size_t dataSize = job->GetDataSize();
+    Compressor c;
+    if ( job->IsDataCompressed() )
+    {
+        VERIFY( c.Decompress( data ) );
+        data = c.GetResult();
+        dataSize = c.GetResultSize();
+    }
+
+    const int32_t compressionLevel = FBuild::IsValid() ? FBuild::Get().GetOptions().m_DistributionCompressionLevel : -1;
+    MemoryStream chunks;
+    const bool includeGeneration = ( ss->m_ProtocolVersionMinor.Load() >= 9 );
+    ss->m_ChunkCache.Encode( data, dataSize, compressionLevel, includeGeneration, chunks );
+
+    job->Serialize( outStream, chunks.GetData(), chunks.GetSize(), false );
 }
 
 // Process( MsgJobResult )
@@ -508,7 +667,8 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
 {
     PROFILE_SECTION( "MsgJobResult" );
     const bool compressed = false;
-    ProcessJobResultCommon( connection, compressed, payload, payloadSize );
+    const bool streamed = false;
+    ProcessJobResultCommon( connection, compressed, streamed, payload, payloadSize );
 }
 
 // Process( MsgJobResultCompressed )
@@ -517,7 +677,169 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
 {
     PROFILE_SECTION( "MsgJobResultCompressed" );
     const bool compressed = true;
-    ProcessJobResultCommon( connection, compressed, payload, payloadSize );
+    const bool streamed = false;
+    ProcessJobResultCommon( connection, compressed, streamed, payload, payloadSize );
+}
+
+// Process( MsgJobResultStreamed )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultStreamed * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultStreamed" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // Only one result is streamed at a time
+    if ( ss->m_StreamBlocksRemaining > 0 )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        DIST_INFO( "Protocol Error: %s\n", ss->m_RemoteName.Get() );
+        Disconnect( connection );
+        return;
+    }
+    ss->m_StreamBlocksRemaining = msg->GetNumBlocks();
+
+    const bool compressed = false; // Blocks are compressed individually
+    const bool streamed = true;
+    ProcessJobResultCommon( connection, compressed, streamed, payload, payloadSize );
+}
+
+// Process( MsgJobResultBlock )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultBlock * /*msg*/, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultBlock" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // Blocks must follow a MsgJobResultStreamed
+    if ( ss->m_StreamBlocksRemaining == 0 )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        DIST_INFO( "Protocol Error: %s\n", ss->m_RemoteName.Get() );
+        Disconnect( connection );
+        return;
+    }
+    --ss->m_StreamBlocksRemaining;
+
+    // Decompress the block and write it out, so only one block is in memory
+    // at a time (blocks of a discarded result are ignored)
+    if ( ss->m_StreamExtractor && ( ss->m_StreamFailed == false ) )
+    {
+        Compressor c;
+        if ( ( payloadSize == 0 ) ||
+             ( Compressor::IsValidData( payload, payloadSize ) == false ) ||
+             ( c.Decompress( payload ) == false ) )
+        {
+            FLOG_ERROR( "Invalid remote result for '%s'", ss->m_StreamJob->GetNode()->GetName().Get() );
+            ss->m_StreamFailed = true;
+        }
+        else if ( ss->m_StreamExtractor->Write( c.GetResult(), c.GetResultSize() ) == false )
+        {
+            const AString * problemFile = ss->m_StreamExtractor->GetProblemFile();
+            if ( problemFile )
+            {
+                FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, problemFile->Get() );
+            }
+            else
+            {
+                FLOG_ERROR( "Invalid remote result for '%s'", ss->m_StreamJob->GetNode()->GetName().Get() );
+            }
+            ss->m_StreamFailed = true;
+        }
+    }
+
+    if ( ss->m_StreamBlocksRemaining == 0 )
+    {
+        FinishStreamedResult( ss );
+    }
+}
+
+// Process( MsgJobRejected )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobRejected * msg )
+{
+    PROFILE_SECTION( "MsgJobRejected" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // The worker discarded chunks we expected it to have, so start again with
+    // all of them. Jobs sent before it sees the new generation are rejected too,
+    // but we only need to start again once. (Like SendJob, this runs on the
+    // connection's receive thread)
+    if ( msg->GetChunkGeneration() == ss->m_ChunkCache.GetGeneration() )
+    {
+        ss->m_ChunkCache.Clear();
+    }
+
+    Job * job = nullptr;
+    {
+        MutexHolder mh( ss->m_Mutex );
+        Job ** sentJob = ss->m_Jobs.FindDeref( msg->GetJobId() );
+        if ( sentJob )
+        {
+            job = *sentJob;
+            ss->m_Jobs.Erase( sentJob );
+        }
+    }
+
+    // Make the job available again (it may have been cancelled in the interim)
+    if ( job )
+    {
+        DIST_INFO( "Job rejected: %s - %s\n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
+        JobQueue::Get().ReturnUnfinishedDistributableJob( job );
+    }
+}
+
+// FinishStreamedResult
+//------------------------------------------------------------------------------
+void Client::FinishStreamedResult( ServerState * ss )
+{
+    Job * job = ss->m_StreamJob;
+    if ( job && ( ss->m_StreamBlocksRemaining > 0 ) )
+    {
+        // The connection was lost part way through the result. Any local race
+        // was cancelled when the result started to arrive, so the job must be
+        // built again.
+        DIST_INFO( "Connection lost while receiving result: %s - %s\n", ss->m_RemoteName.Get(), job->GetNode()->GetName().Get() );
+        FDELETE ss->m_StreamExtractor;
+        JobQueue::Get().ReturnIncompleteRemoteJob( job );
+    }
+    else if ( job ) // Otherwise the result was discarded
+    {
+        bool result = ( ss->m_StreamFailed == false );
+        if ( ss->m_StreamExtractor->Finish() == false )
+        {
+            if ( result )
+            {
+                FLOG_ERROR( "Invalid remote result for '%s'", job->GetNode()->GetName().Get() );
+            }
+            result = false;
+        }
+        FDELETE ss->m_StreamExtractor;
+
+        // Store to cache if needed, from the files as written
+        ObjectNode * objectNode = job->GetNode()->CastTo< ObjectNode >();
+        if ( result && FBuild::Get().GetOptions().m_UseCacheWrite && objectNode->ShouldUseCache() )
+        {
+            objectNode->WriteToCache_FromDisk( job );
+        }
+
+        OnResultFilesWritten( job, result, ss->m_StreamBuildTime );
+
+        JobQueue::Get().FinishedProcessingJob( job,
+                                               result ? Node::BuildResult::eOk : Node::BuildResult::eFailed,
+                                               true ); // remote job
+    }
+
+    ss->m_StreamJob = nullptr;
+    ss->m_StreamExtractor = nullptr;
+    ss->m_StreamBlocksRemaining = 0;
+    ss->m_StreamBuildTime = 0;
+    ss->m_StreamFailed = false;
 }
 
 // Process( MsgConnectionAck )
@@ -545,7 +867,7 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgConn
 
 // ProcessJobResultCommon
 //------------------------------------------------------------------------------
-void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize )
+void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, bool isStreamed, const void * payload, size_t payloadSize )
 {
     // Take note of the current time. We'll consider the job to have completed at this time.
     // Doing it as soon as possible makes it more accurate, as work below can take a non-trivial
@@ -586,6 +908,17 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
 
     {
         MutexHolder mh( ss->m_Mutex );
+
+        // Track how quickly the worker returns jobs
+        Job ** sentJob = ss->m_Jobs.FindDeref( jobId );
+        ASSERT( sentJob );
+        if ( sentJob && ( systemError == false ) )
+        {
+            const int64_t roundTrip = ( receivedResultEndTime - (*sentJob)->GetRemoteStartTime() );
+            const uint32_t roundTripMS = (uint32_t)( (float)roundTrip * Timer::GetFrequencyInvFloatMS() );
+            ss->m_Stats.OnJobCompleted( roundTripMS, buildTime, (*sentJob)->GetNode()->GetLastBuildTime() );
+        }
+
         VERIFY( ss->m_Jobs.FindDerefAndErase( jobId ) );
     }
 
@@ -713,6 +1046,7 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
     if ( job == nullptr )
     {
         // don't save result as we were cancelled
+        // (any streamed blocks which follow are ignored)
         return;
     }
 
@@ -725,9 +1059,10 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
         ObjectNode * objectNode = node->CastTo< ObjectNode >();
 
         // Store to cache if needed
+        // (streamed results are stored once all their blocks have arrived)
         const bool writeToCache = FBuild::Get().GetOptions().m_UseCacheWrite &&
                                   objectNode->ShouldUseCache();
-        if ( writeToCache )
+        if ( writeToCache && ( isStreamed == false ) )
         {
             if ( isCompressed )
             {
@@ -744,13 +1079,6 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
             }
         }
 
-        // Decompress if needed
-        MultiBuffer mb( data, dataSize );
-        if ( isCompressed )
-        {
-            mb.Decompress();
-        }
-
         const AString & nodeName = objectNode->GetName();
         if ( Node::EnsurePathExistsForFile( nodeName ) == false )
         {
@@ -759,70 +1087,37 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
         }
         else
         {
-            size_t fileIndex = 0;
-
-            const ObjectNode * on = job->GetNode()->CastTo< ObjectNode >();
-
-            // 1. Object file
-            result = WriteFileToDisk( nodeName, mb, fileIndex++ );
+            StackArray< AString > fileNames;
+            GetResultFileNames( objectNode, fileNames );
 
-            // 2. PDB file (optional)
-            if ( result && on->IsUsingPDB() )
+            if ( isStreamed )
             {
-                AStackString<> pdbName;
-                on->GetPDBName( pdbName );
-                result = WriteFileToDisk( pdbName, mb, fileIndex++ );
+                // Files are written as the blocks which follow arrive, and the
+                // job is finished after the last one
+                ss->m_StreamJob = job;
+                ss->m_StreamExtractor = FNEW( MultiBufferExtractor( fileNames ) );
+                ss->m_StreamBuildTime = buildTime;
+                if ( ss->m_StreamBlocksRemaining == 0 )
+                {
+                    FinishStreamedResult( ss ); // Will fail, as there is no data
+                }
+                return;
             }
 
-            // 3. .nativecodeanalysis.xml (optional)
-            if ( result && on->IsUsingStaticAnalysisMSVC() )
+            // Decompress if needed
+            MultiBuffer mb( data, dataSize );
+            if ( isCompressed )
             {
-                AStackString<> xmlFileName;
-                on->GetNativeAnalysisXMLPath( xmlFileName );
-                result = WriteFileToDisk( xmlFileName, mb, fileIndex++ );
+                mb.Decompress();
             }
 
-            if ( result )
-            {
-                // record new file time
-                objectNode->RecordStampFromBuiltFile();
-
-                // record time taken to build
-                objectNode->SetLastBuildTime( buildTime );
-                objectNode->SetStatFlag(Node::STATS_BUILT);
-                objectNode->SetStatFlag(Node::STATS_BUILT_REMOTE);
-            }
-            else
+            for ( size_t i = 0; result && ( i < fileNames.GetSize() ); ++i )
             {
-                objectNode->SetStatFlag( Node::STATS_FAILED );
+                result = WriteFileToDisk( fileNames[ i ], mb, i );
             }
         }
 
-        // get list of messages during remote work
-        AStackString<> msgBuffer;
-        job->GetMessagesForLog( msgBuffer );
-
-        if ( objectNode->IsMSVC())
-        {
-            if ( objectNode->IsWarningsAsErrorsMSVC() == false )
-            {
-                FileNode::HandleWarningsMSVC( job, objectNode->GetName(), msgBuffer );
-            }
-        }
-        else if ( objectNode->IsClangCl() )
-        {
-            if ( objectNode->IsWarningsAsErrorsMSVC() == false )
-            {
-                FileNode::HandleWarningsClangCl( job, objectNode->GetName(), msgBuffer );
-            }
-        }
-        else if ( objectNode->IsClang() || objectNode->IsGCC() )
-        {
-            if ( objectNode->IsWarningsAsErrorsClangGCC() == false )
-            {
-                FileNode::HandleWarningsClangGCC( job, objectNode->GetName(), msgBuffer );
-            }
-        }
+        OnResultFilesWritten( job, result, buildTime );
     }
     else
     {
@@ -856,6 +1151,78 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
                                            true ); // remote job
 }
 
+// OnResultFilesWritten
+//------------------------------------------------------------------------------
+void Client::OnResultFilesWritten( Job * job, bool success, uint32_t buildTime ) const
+{
+    ObjectNode * objectNode = job->GetNode()->CastTo< ObjectNode >();
+
+    if ( success )
+    {
+        // record new file time
+        objectNode->RecordStampFromBuiltFile();
+
+        // record time taken to build
+        objectNode->SetLastBuildTime( buildTime );
+        objectNode->SetStatFlag(Node::STATS_BUILT);
+        objectNode->SetStatFlag(Node::STATS_BUILT_REMOTE);
+    }
+    else
+    {
+        objectNode->SetStatFlag( Node::STATS_FAILED );
+    }
+
+    // get list of messages during remote work
+    AStackString<> msgBuffer;
+    job->GetMessagesForLog( msgBuffer );
+
+    if ( objectNode->IsMSVC())
+    {
+        if ( objectNode->IsWarningsAsErrorsMSVC() == false )
+        {
+            FileNode::HandleWarningsMSVC( job, objectNode->GetName(), msgBuffer );
+        }
+    }
+    else if ( objectNode->IsClangCl() )
+    {
+        if ( objectNode->IsWarningsAsErrorsMSVC() == false )
+        {
+            FileNode::HandleWarningsClangCl( job, objectNode->GetName(), msgBuffer );
+        }
+    }
+    else if ( objectNode->IsClang() || objectNode->IsGCC() )
+    {
+        if ( objectNode->IsWarningsAsErrorsClangGCC() == false )
+        {
+            FileNode::HandleWarningsClangGCC( job, objectNode->GetName(), msgBuffer );
+        }
+    }
+}
+
+// GetResultFileNames
+//------------------------------------------------------------------------------
+/*static*/ void Client::GetResultFileNames( const ObjectNode * objectNode, Array< AString > & outFileNames )
+{
+    // 1. Object file
+    outFileNames.Append( objectNode->GetName() );
+
+    // 2. PDB file (optional)
+    if ( objectNode->IsUsingPDB() )
+    {
+        AStackString<> pdbName;
+        objectNode->GetPDBName( pdbName );
+        outFileNames.Append( pdbName );
+    }
+
+    // 3. .nativecodeanalysis.xml (optional)
+    if ( objectNode->IsUsingStaticAnalysisMSVC() )
+    {
+        AStackString<> xmlFileName;
+        objectNode->GetNativeAnalysisXMLPath( xmlFileName );
+        outFileNames.Append( xmlFileName );
+    }
+}
+
 // Process( MsgRequestManifest )
 //------------------------------------------------------------------------------
 void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg )
@@ -876,7 +1243,8 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     }
 
     MemoryStream ms;
-    manifest->SerializeForRemote( ms );
+    const bool includeContentHashes = ( static_cast<ServerState *>(connection->GetUserData())->m_ProtocolVersionMinor.Load() >= 8 );
+    manifest->SerializeForRemote( ms, includeContentHashes );
 
     // Send manifest to worker
     const Protocol::MsgManifest resultMsg( toolId );
@@ -921,6 +1289,78 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     SendMessageInternal( connection, resultMsg, ms );
 }
 
+// Process ( MsgRequestFiles )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestFiles * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgRequestFiles" );
+
+    // find a job associated with this client with this toolId
+    const uint64_t toolId = msg->GetToolId();
+    ASSERT( toolId != 0 ); // server should not request 'no sync' tool id
+    const ToolManifest * manifest = FindManifest( connection, toolId );
+
+    ConstMemoryStream request( payload, payloadSize );
+    uint32_t numFiles = 0;
+    if ( ( manifest == nullptr ) || ( request.Read( numFiles ) == false ) )
+    {
+        // client asked for a manifest that is not valid
+        ASSERT( false ); // this indicates a logic bug
+        Disconnect( connection );
+        return;
+    }
+
+    // Send files in batches, to avoid a round trip per file without making
+    // single messages excessively large
+    MemoryStream batch;
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        uint32_t fileId = 0;
+        size_t dataSize( 0 );
+        const void * data = nullptr;
+        if ( request.Read( fileId ) &&
+             ( fileId < manifest->GetFiles().GetSize() ) )
+        {
+            data = manifest->GetFileData( fileId, dataSize );
+        }
+        if ( !data )
+        {
+            ASSERT( false ); // something is terribly wrong
+            Disconnect( connection );
+            return;
+        }
+
+        // Large files are sent on their own, avoiding a copy
+        if ( dataSize >= Protocol::TOOL_FILES_BATCH_SIZE )
+        {
+            const ConstMemoryStream ms( data, dataSize );
+            const Protocol::MsgFile resultMsg( toolId, fileId );
+            MutexHolder mh( static_cast<ServerState *>(connection->GetUserData())->m_Mutex );
+            SendMessageInternal( connection, resultMsg, ms );
+            continue;
+        }
+
+        if ( ( batch.GetSize() + dataSize ) > Protocol::TOOL_FILES_BATCH_SIZE )
+        {
+            const Protocol::MsgFiles resultMsg( toolId );
+            MutexHolder mh( static_cast<ServerState *>(connection->GetUserData())->m_Mutex );
+            SendMessageInternal( connection, resultMsg, batch );
+            batch.Reset();
+        }
+
+        batch.Write( fileId );
+        batch.Write( static_cast< uint32_t >( dataSize ) );
+        batch.WriteBuffer( data, dataSize );
+    }
+
+    if ( batch.GetSize() > 0 )
+    {
+        const Protocol::MsgFiles resultMsg( toolId );
+        MutexHolder mh( static_cast<ServerState *>(connection->GetUserData())->m_Mutex );
+        SendMessageInternal( connection, resultMsg, batch );
+    }
+}
+
 // FindManifest
 //------------------------------------------------------------------------------
 const ToolManifest * Client::FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const
@@ -963,6 +1403,12 @@ Client::ServerState::ServerState()
     , m_CurrentMessage( nullptr )
     , m_NumJobsAvailable( 0 )
     , m_Jobs( 16 )
+    , m_ChunkCache( false )
+    , m_StreamJob( nullptr )
+    , m_StreamExtractor( nullptr )
+    , m_StreamBlocksRemaining( 0 )
+    , m_StreamBuildTime( 0 )
+    , m_StreamFailed( false )
     , m_Denylisted( false )
 {
     m_DelayTimer.Start( 999.0f );
@@ -4,6 +4,9 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkCache.h"
+#include "Tools/FBuild/FBuildCore/Protocol/WorkerStats.h"
+
 #include "Core/Containers/Array.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
@@ -17,15 +20,22 @@ class ConstMemoryStream;
 class Job;
 class MemoryStream;
 class MultiBuffer;
+class MultiBufferExtractor;
+class ObjectNode;
 namespace Protocol
 {
     class IMessage;
     class MsgConnectionAck;
     class MsgJobResult;
     class MsgJobResultCompressed;
+    class MsgJobResultStreamed;
+    class MsgJobResultBlock;
+    class MsgJobRejected;
     class MsgRequestJob;
+    class MsgRequestJobs;
     class MsgRequestManifest;
     class MsgRequestFile;
+    class MsgRequestFiles;
     class MsgServerStatus;
 }
 class ToolManifest;
@@ -46,13 +56,21 @@ private:
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJobs * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultCompressed * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultStreamed * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultBlock * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobRejected * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFiles * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgConnectionAck * msg );
 
-    void ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize );
+    bool SendJob( const ConnectionInfo * connection );
+    void ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, bool isStreamed, const void * payload, size_t payloadSize );
+    void OnResultFilesWritten( Job * job, bool success, uint32_t buildTime ) const;
+    static void GetResultFileNames( const ObjectNode * objectNode, Array< AString > & outFileNames );
 
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
     bool WriteFileToDisk( const AString& fileName, const MultiBuffer & multiBuffer, size_t index ) const;
@@ -90,11 +108,24 @@ private:
         Timer                   m_DelayTimer;
         uint32_t                m_NumJobsAvailable;     // num jobs we've told this server we have available
         Array< Job * >          m_Jobs;                 // jobs we've sent to this server
+        ChunkCache              m_ChunkCache;           // mirrors the chunks this server holds (v22.6)
+        WorkerStats             m_Stats;                // how quickly this server returns jobs (guarded by m_Mutex)
+
+        // Result being received in blocks (v22.7)
+        Job *                   m_StreamJob;            // null if the result is being discarded
+        MultiBufferExtractor *  m_StreamExtractor;
+        uint32_t                m_StreamBlocksRemaining;
+        uint32_t                m_StreamBuildTime;
+        bool                    m_StreamFailed;
 
         bool                    m_Denylisted;
     };
+    void                    SerializeChunked( const Job * job, ServerState * ss, MemoryStream & outStream ) const;
+    void                    FinishStreamedResult( ServerState * ss );
+
     Mutex                   m_ServerListMutex;
     Array< ServerState >    m_ServerList;
+    Atomic<uint32_t>        m_FastestWorkerSpeed;   // lowest speed factor of connected servers x1000 (0 if unknown)
     uint32_t                m_WorkerConnectionLimit;
     uint16_t                m_Port;
 };
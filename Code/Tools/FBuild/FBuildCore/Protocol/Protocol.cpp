@@ -41,6 +41,12 @@
             "File",
             "JobResultCompressed",
             "ConnectionAck",
+            "RequestJobs",
+            "JobResultStreamed",
+            "JobResultBlock",
+            "RequestFiles",
+            "Files",
+            "JobRejected",
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -145,6 +151,14 @@ Protocol::MsgRequestJob::MsgRequestJob()
 {
 }
 
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+{
+}
+
 // MsgNoJobAvailable
 //------------------------------------------------------------------------------
 Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
@@ -154,12 +168,13 @@ Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
 
 // MsgJob
 //------------------------------------------------------------------------------
-Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel )
+Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel, bool isDataChunked, bool isResultStreamed )
     : Protocol::IMessage( Protocol::MSG_JOB, sizeof( MsgJob ), true )
     , m_ResultCompressionLevel( resultCompressionLevel )
+    , m_IsDataChunked( isDataChunked )
+    , m_IsResultStreamed( isResultStreamed )
     , m_ToolId( toolId )
 {
-    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     ASSERT( toolId );
 }
 
@@ -177,6 +192,21 @@ Protocol::MsgJobResultCompressed::MsgJobResultCompressed()
 {
 }
 
+// MsgJobResultStreamed
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultStreamed::MsgJobResultStreamed( uint32_t numBlocks )
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_STREAMED, sizeof( MsgJobResultStreamed ), true )
+    , m_NumBlocks( numBlocks )
+{
+}
+
+// MsgJobResultBlock
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultBlock::MsgJobResultBlock()
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_BLOCK, sizeof( MsgJobResultBlock ), true )
+{
+}
+
 // MsgRequestManifest
 //------------------------------------------------------------------------------
 Protocol::MsgRequestManifest::MsgRequestManifest( uint64_t toolId )
@@ -213,4 +243,31 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 {
 }
 
+// MsgRequestFiles
+//------------------------------------------------------------------------------
+Protocol::MsgRequestFiles::MsgRequestFiles( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_FILES, sizeof( MsgRequestFiles ), true )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgFiles
+//------------------------------------------------------------------------------
+Protocol::MsgFiles::MsgFiles( uint64_t toolId )
+    : Protocol::IMessage( Protocol::MSG_FILES, sizeof( MsgFiles ), true )
+    , m_ToolId( toolId )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgJobRejected
+//------------------------------------------------------------------------------
+Protocol::MsgJobRejected::MsgJobRejected( uint32_t jobId, uint32_t chunkGeneration )
+    : Protocol::IMessage( Protocol::MSG_JOB_REJECTED, sizeof( MsgJobRejected ), false )
+    , m_JobId( jobId )
+    , m_ChunkGeneration( chunkGeneration )
+{
+}
+
 //------------------------------------------------------------------------------
@@ -32,10 +32,13 @@ namespace Protocol
 
     // Protocol Version
     enum : uint32_t { PROTOCOL_VERSION_MAJOR = 22 };    // Changes here make workers incompatible
-    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 4 };     // Changes must be forwards and backwards compatible
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 9 };     // Changes must be forwards and backwards compatible
 
     enum { PROTOCOL_TEST_PORT = PROTOCOL_PORT + 1 }; // Different port for use by tests
 
+    enum : uint32_t { JOB_RESULT_BLOCK_SIZE = ( 1024 * 1024 ) }; // Max uncompressed size of each MsgJobResultBlock
+    enum : uint32_t { TOOL_FILES_BATCH_SIZE = ( 16 * 1024 * 1024 ) }; // Max compressed size of each MsgFiles (larger files are sent in a MsgFile)
+
     // Identifiers for all unique messages
     //------------------------------------------------------------------------------
     enum MessageType : uint8_t
@@ -61,6 +64,20 @@ namespace Protocol
         // v22.3 or later
         MSG_CONNECTION_ACK      = 12,// Server -> Client : Handshake ack
 
+        // v22.5 or later
+        MSG_REQUEST_JOBS        = 13,// Server -> Client : Ask for several jobs to do (pipelined)
+
+        // v22.7 or later
+        MSG_JOB_RESULT_STREAMED = 14,// Server -> Client : Return completed job, with the files following in blocks
+        MSG_JOB_RESULT_BLOCK    = 15,// Server -> Client : A block of the files of a streamed job result
+
+        // v22.8 or later
+        MSG_REQUEST_FILES       = 16,// Server -> Client : Ask client for several files
+        MSG_FILES               = 17,// Server <- Client : Send several requested files
+
+        // v22.9 or later
+        MSG_JOB_REJECTED        = 18,// Server -> Client : Return a job which could not be accepted (to be sent again)
+
         NUM_MESSAGES            // leave last
     };
 }
@@ -156,6 +173,21 @@ namespace Protocol
     };
     static_assert( sizeof( MsgRequestJob ) == sizeof( IMessage ), "MsgRequestJob message has incorrect size" );
 
+    // MsgRequestJobs
+    //  - Grants the Client credit to send several jobs in one go. Each credit is
+    //    answered with either a MsgJob or a MsgNoJobAvailable.
+    //------------------------------------------------------------------------------
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        explicit MsgRequestJobs( uint32_t numJobs );
+
+        inline uint32_t GetNumJobs() const { return m_NumJobs; }
+    private:
+        uint32_t    m_NumJobs;
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 4, "MsgRequestJobs message has incorrect size" );
+
     // MsgNoJobAvailable
     //------------------------------------------------------------------------------
     class MsgNoJobAvailable : public IMessage
@@ -170,13 +202,16 @@ namespace Protocol
     class MsgJob : public IMessage
     {
     public:
-        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel );
+        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel, bool isDataChunked = false, bool isResultStreamed = false );
 
         inline uint64_t GetToolId() const { return m_ToolId; }
         int16_t         GetResultCompressionLevel() const { return m_ResultCompressionLevel; }
+        bool            IsDataChunked() const { return m_IsDataChunked; } // v22.6 or later
+        bool            IsResultStreamed() const { return m_IsResultStreamed; } // v22.7 or later
     private:
         int16_t     m_ResultCompressionLevel;
-        char        m_Padding2[ 2 ];
+        bool        m_IsDataChunked;
+        bool        m_IsResultStreamed;
         uint64_t m_ToolId;
     };
     static_assert( sizeof( MsgJob ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgJob message has incorrect size" );
@@ -199,6 +234,30 @@ namespace Protocol
     };
     static_assert( sizeof( MsgJobResultCompressed ) == sizeof( IMessage ), "MsgJobResultCompressed message has incorrect size" );
 
+    // MsgJobResultStreamed
+    //  - The same as MsgJobResult, but without the files, which follow in
+    //    independently compressed MsgJobResultBlocks
+    //------------------------------------------------------------------------------
+    class MsgJobResultStreamed : public IMessage
+    {
+    public:
+        explicit MsgJobResultStreamed( uint32_t numBlocks );
+
+        inline uint32_t GetNumBlocks() const { return m_NumBlocks; }
+    private:
+        uint32_t    m_NumBlocks;
+    };
+    static_assert( sizeof( MsgJobResultStreamed ) == sizeof( IMessage ) + 4, "MsgJobResultStreamed message has incorrect size" );
+
+    // MsgJobResultBlock
+    //------------------------------------------------------------------------------
+    class MsgJobResultBlock : public IMessage
+    {
+    public:
+        MsgJobResultBlock();
+    };
+    static_assert( sizeof( MsgJobResultBlock ) == sizeof( IMessage ), "MsgJobResultBlock message has incorrect size" );
+
     // MsgRequestManifest
     //------------------------------------------------------------------------------
     class MsgRequestManifest : public IMessage
@@ -257,6 +316,55 @@ namespace Protocol
     };
     static_assert( sizeof( MsgFile ) == sizeof( IMessage ) + 12, "MsgFile message has incorrect size" );
 
+    // MsgRequestFiles
+    //  - Payload is the number of files, followed by each fileId
+    //------------------------------------------------------------------------------
+    class MsgRequestFiles : public IMessage
+    {
+    public:
+        explicit MsgRequestFiles( uint64_t toolId );
+
+        inline uint64_t GetToolId() const { return m_ToolId; }
+    private:
+        char     m_Padding2[ 4 ];
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgRequestFiles ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgRequestFiles message has incorrect size" );
+
+    // MsgFiles
+    //  - Payload is a fileId and compressed data size, followed by the data,
+    //    for each file
+    //------------------------------------------------------------------------------
+    class MsgFiles : public IMessage
+    {
+    public:
+        explicit MsgFiles( uint64_t toolId );
+
+        inline uint64_t GetToolId() const { return m_ToolId; }
+    private:
+        char     m_Padding2[ 4 ];
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgFiles ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgFiles message has incorrect size" );
+
+    // MsgJobRejected
+    //  - The job's chunked data could not be decoded, so the client must send
+    //    it again (or elsewhere), starting a new generation of chunks if it
+    //    hasn't already done so since the rejected generation
+    //------------------------------------------------------------------------------
+    class MsgJobRejected : public IMessage
+    {
+    public:
+        explicit MsgJobRejected( uint32_t jobId, uint32_t chunkGeneration );
+
+        inline uint32_t GetJobId() const { return m_JobId; }
+        inline uint32_t GetChunkGeneration() const { return m_ChunkGeneration; }
+    private:
+        uint32_t m_JobId;
+        uint32_t m_ChunkGeneration;
+    };
+    static_assert( sizeof( MsgJobRejected ) == sizeof( IMessage ) + 8, "MsgJobRejected message has incorrect size" );
+
     // MsgServerStatus
     //------------------------------------------------------------------------------
     class MsgServerStatus : public IMessage
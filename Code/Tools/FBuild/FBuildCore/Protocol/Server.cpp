@@ -7,6 +7,9 @@
 #include "Protocol.h"
 
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
@@ -25,6 +28,8 @@
     // Touch files every 4 hours
     #define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS (60.0f * 60.0f * 4.0f)
 #endif
+// Jobs to keep queued per core for clients supporting MsgRequestJobs (v22.5)
+#define SERVER_JOBS_QUEUED_PER_CPU ( 1 )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -248,6 +253,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_FILES:
+        {
+            const Protocol::MsgFiles * msg = static_cast< const Protocol::MsgFiles * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -343,11 +354,40 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
         Job * job = FNEW( Job( ms ) );
         job->SetUserData( cs );
 
+        // Rebuild job data sent as chunks
+        if ( msg->IsDataChunked() )
+        {
+            void * data = nullptr;
+            size_t dataSize = 0;
+            const bool hasGeneration = ( cs->m_ProtocolVersionMinor >= 9 );
+            if ( cs->m_ChunkCache.Decode( job->GetData(), job->GetDataSize(), m_ChunkStore, hasGeneration, data, dataSize ) == false )
+            {
+                // Chunks the client expects us to have were evicted to make space
+                // for those of other clients (or the data is invalid)
+                cs->m_NumJobsActive.Decrement();
+                if ( hasGeneration )
+                {
+                    // The client will send the job again, with a new generation of chunks
+                    const Protocol::MsgJobRejected rejectMsg( job->GetJobId(), cs->m_ChunkCache.GetGeneration() );
+                    rejectMsg.Send( connection );
+                }
+                else
+                {
+                    // Older clients can only start again with a new connection
+                    Disconnect( connection );
+                }
+                FDELETE job;
+                return;
+            }
+            job->OwnData( data, dataSize, false );
+        }
+
         // Take not of client support requirements
         // - Zstd suport can become unconditional if protocol compatibility is broken
         static_assert( Protocol::PROTOCOL_VERSION_MAJOR == 22 );
         const bool allowZstdUse = ( cs->m_ProtocolVersionMinor >= 4 );
         job->SetResultCompressionLevel( msg->GetResultCompressionLevel(), allowZstdUse );
+        job->SetResultStreamed( msg->IsResultStreamed() );
 
         // Get ToolId
         const uint64_t toolId = msg->GetToolId();
@@ -430,6 +470,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
     ToolManifest * manifest = nullptr;
     const uint64_t toolId = msg->GetToolId();
     ConstMemoryStream ms( payload, payloadSize );
+    const bool includeContentHashes = ( static_cast<ClientState *>(connection->GetUserData())->m_ProtocolVersionMinor >= 8 );
 
     {
         MutexHolder manifestMH( m_ToolManifestsMutex ); // ensure we don't make redundant requests
@@ -438,7 +479,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
         ToolManifest ** found = m_Tools.FindDeref( toolId );
         ASSERT( found );
         manifest = *found;
-        if ( manifest->DeserializeFromRemote( ms ) == false )
+        if ( manifest->DeserializeFromRemote( ms, includeContentHashes ) == false )
         {
             // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
             //       corrupt and for deserialization to corrupt internal state.
@@ -494,50 +535,66 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
         ToolManifest ** found = m_Tools.FindDeref( toolId );
         ASSERT( found );
         manifest = *found;
-        ASSERT( manifest->GetUserData() == connection ); (void)connection;
+        ASSERT( manifest->GetUserData() == connection );
+
+        if ( ReceiveFile( connection, manifest, fileId, payload, payloadSize ) == false )
+        {
+            return; // ReceiveFile has disconnected
+        }
+
+        if ( manifest->IsSynchronized() == false )
+        {
+            // wait for more files
+            return;
+        }
+        manifest->SetUserData( nullptr );
+    }
+
+    // ToolChain is now synchronized
+    // Allow any jobs that were waiting on it to start
+    CheckWaitingJobs( manifest );
+
+    // Newly received content has been added to the store
+    ToolFileStore::Trim();
+}
+
+// Process( MsgFiles )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFiles * msg, const void * payload, size_t payloadSize )
+{
+    const uint64_t toolId = msg->GetToolId();
+
+    // Update the Manifest
+    ToolManifest * manifest = nullptr;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        ASSERT( found );
+        manifest = *found;
+        ASSERT( manifest->GetUserData() == connection );
 
-        bool corruptData = false;
-        if ( manifest->ReceiveFileData( fileId, payload, payloadSize, corruptData ) == false )
+        ConstMemoryStream ms( payload, payloadSize );
+        while ( ms.Tell() < payloadSize )
         {
-            if ( corruptData )
+            uint32_t fileId = 0;
+            uint32_t dataSize = 0;
+            if ( ( ms.Read( fileId ) == false ) ||
+                 ( ms.Read( dataSize ) == false ) ||
+                 ( fileId >= manifest->GetFiles().GetSize() ) ||
+                 ( dataSize > ( payloadSize - ms.Tell() ) ) )
             {
-                // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
-                //       corrupt and for deserialization to corrupt internal state.
-                //       To maintain backwards compatibility we detect this case and disconnect
-                //       the worker (which can retry connecting).
-                //       The bug has been fixed so should not happen with latest code (only
-                //       when dealing with backwards compatibility with old workers)
-                // If we ever break protocol compatibility, we can remove special handling
-                static_assert( Protocol::PROTOCOL_VERSION_MAJOR == 22, "Remove backwards compat shims" );
-
-                // This should not happen with latest code so we want to catch that when
-                // debugging
-                ASSERT( false && "MsgFile corrupt" );
-
-                // Disconnect to handle old workers misbehaving
-                ClientState * cs = (ClientState *)connection->GetUserData();
-                AStackString<> remoteAddr;
-                TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
-                FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt MsgFile (Client protocol %u.%u)\n",
-                           remoteAddr.Get(),
-                           cs->m_HostName.Get(),
-                           Protocol::PROTOCOL_VERSION_MAJOR,
-                           cs->m_ProtocolVersionMinor );
+                ASSERT( false && "MsgFiles corrupt" ); // this indicates a protocol bug
+                Disconnect( connection );
+                return;
             }
-            else
+
+            const void * data = ( static_cast< const char * >( payload ) + ms.Tell() );
+            if ( ReceiveFile( connection, manifest, fileId, data, dataSize ) == false )
             {
-                // something went wrong storing the file
-                AStackString<> fileName;
-                manifest->GetRemoteFilePath( fileId, fileName );
-                FLOG_WARN( "Failed to store fileId %u for manifest 0x%" PRIx64 "\n"
-                           " - %s\n",
-                           fileId,
-                           toolId,
-                           fileName.Get() );
+                return; // ReceiveFile has disconnected
             }
-
-            Disconnect( connection );
-            return;
+            ms.Seek( ms.Tell() + dataSize );
         }
 
         if ( manifest->IsSynchronized() == false )
@@ -551,6 +608,60 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     // ToolChain is now synchronized
     // Allow any jobs that were waiting on it to start
     CheckWaitingJobs( manifest );
+
+    // Newly received content has been added to the store
+    ToolFileStore::Trim();
+}
+
+// ReceiveFile
+//------------------------------------------------------------------------------
+bool Server::ReceiveFile( const ConnectionInfo * connection, ToolManifest * manifest, uint32_t fileId, const void * data, size_t dataSize )
+{
+    bool corruptData = false;
+    if ( manifest->ReceiveFileData( fileId, data, dataSize, corruptData ) )
+    {
+        return true;
+    }
+
+    if ( corruptData )
+    {
+        // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
+        //       corrupt and for deserialization to corrupt internal state.
+        //       To maintain backwards compatibility we detect this case and disconnect
+        //       the worker (which can retry connecting).
+        //       The bug has been fixed so should not happen with latest code (only
+        //       when dealing with backwards compatibility with old workers)
+        // If we ever break protocol compatibility, we can remove special handling
+        static_assert( Protocol::PROTOCOL_VERSION_MAJOR == 22, "Remove backwards compat shims" );
+
+        // This should not happen with latest code so we want to catch that when
+        // debugging
+        ASSERT( false && "MsgFile corrupt" );
+
+        // Disconnect to handle old workers misbehaving
+        ClientState * cs = (ClientState *)connection->GetUserData();
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+        FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt MsgFile (Client protocol %u.%u)\n",
+                   remoteAddr.Get(),
+                   cs->m_HostName.Get(),
+                   Protocol::PROTOCOL_VERSION_MAJOR,
+                   cs->m_ProtocolVersionMinor );
+    }
+    else
+    {
+        // something went wrong storing the file
+        AStackString<> fileName;
+        manifest->GetRemoteFilePath( fileId, fileName );
+        FLOG_WARN( "Failed to store fileId %u for manifest 0x%" PRIx64 "\n"
+                   " - %s\n",
+                   fileId,
+                   manifest->GetToolId(),
+                   fileName.Get() );
+    }
+
+    Disconnect( connection );
+    return false;
 }
 
 // CheckWaitingJobs
@@ -634,13 +745,18 @@ void Server::FindNeedyClients()
     PROFILE_FUNCTION;
 
     // determine job availability
-    int32_t availableJobs = (int32_t)WorkerThreadRemote::GetNumCPUsToUse();
-    if ( availableJobs == 0 )
+    const int32_t numCPUs = (int32_t)WorkerThreadRemote::GetNumCPUsToUse();
+    if ( numCPUs == 0 )
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
 
+    // Older clients are asked for one job at a time, over requesting by one to
+    // parallelize building/network transfers. Clients supporting MsgRequestJobs
+    // are granted credit for several jobs at once so each core has more work
+    // queued behind the job it is building.
+    int32_t availableJobs = ( numCPUs + 1 );
+    int32_t availablePipelinedJobs = ( numCPUs * ( 1 + SERVER_JOBS_QUEUED_PER_CPU ) );
 
     {
         MutexHolder mh( m_ClientListMutex );
@@ -653,7 +769,8 @@ void Server::FindNeedyClients()
             const uint32_t jobsActive = cs->m_NumJobsActive.Load();
             const int32_t reservedJobs = static_cast<int32_t>( jobsRequested + jobsActive );
             availableJobs -= reservedJobs;
-            if ( availableJobs <= 0 )
+            availablePipelinedJobs -= reservedJobs;
+            if ( availablePipelinedJobs <= 0 )
             {
                 return;
             }
@@ -664,37 +781,38 @@ void Server::FindNeedyClients()
         // sort clients to find neediest first
         m_ClientList.SortDeref();
 
-        const Protocol::MsgRequestJob msg;
-
-        while ( availableJobs > 0 )
+        // hand out credit round-robin so each client gets a fair share
+        const size_t numClients = m_ClientList.GetSize();
+        StackArray< uint32_t > credits;
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            credits.Append( 0 );
+        }
+        while ( availablePipelinedJobs > 0 )
         {
             bool anyJobsRequested = false;
 
-            for ( ClientState * cs : m_ClientList )
+            for ( size_t i = 0; i < numClients; ++i )
             {
-                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load();
+                const ClientState * cs = m_ClientList[ i ];
+                const uint32_t reservedJobs = ( cs->m_NumJobsRequested.Load() + credits[ i ] );
 
                 if ( reservedJobs >= cs->m_NumJobsAvailable.Load() )
                 {
                     continue; // we've maxed out the requests to this worker
                 }
-
-                // request job from this client
+                if ( ( cs->m_ProtocolVersionMinor < 5 ) && ( availableJobs <= 0 ) )
                 {
-                    // Acquire the lock but don't wait if unavailable
-                    TryMutexHolder tryLock( cs->m_Mutex );
-                    if ( tryLock.IsLocked() == false )
-                    {
-                        continue; // Skip this worker for now
-                    }
-                    cs->m_NumJobsRequested.Increment(); // Must be before Send() to ensure consistent counts
-                    msg.Send( cs->m_Connection );
+                    continue; // older clients don't get queued jobs
                 }
+
+                ++credits[ i ];
                 availableJobs--;
+                availablePipelinedJobs--;
                 anyJobsRequested = true;
 
                 // Have we consumed all of our requests?
-                if ( availableJobs == 0 )
+                if ( availablePipelinedJobs == 0 )
                 {
                     break;
                 }
@@ -706,6 +824,39 @@ void Server::FindNeedyClients()
                 break;
             }
         }
+
+        // request jobs from each client
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            const uint32_t numJobs = credits[ i ];
+            if ( numJobs == 0 )
+            {
+                continue;
+            }
+
+            ClientState * cs = m_ClientList[ i ];
+
+            // Acquire the lock but don't wait if unavailable
+            TryMutexHolder tryLock( cs->m_Mutex );
+            if ( tryLock.IsLocked() == false )
+            {
+                continue; // Skip this worker for now
+            }
+            cs->m_NumJobsRequested.Add( numJobs ); // Must be before Send() to ensure consistent counts
+            if ( cs->m_ProtocolVersionMinor >= 5 )
+            {
+                const Protocol::MsgRequestJobs msg( numJobs );
+                msg.Send( cs->m_Connection );
+            }
+            else
+            {
+                const Protocol::MsgRequestJob msg;
+                for ( uint32_t j = 0; j < numJobs; ++j )
+                {
+                    msg.Send( cs->m_Connection );
+                }
+            }
+        }
     }
 }
 
@@ -731,6 +882,21 @@ void Server::FinalizeCompletedJobs()
             const bool connectionStillActive = ( m_ClientList.Find( cs ) != nullptr );
             if ( connectionStillActive )
             {
+                // Streamed results are read from the output files, and sent
+                // in blocks after the other details
+                MultiBufferBlockReader blockReader( Protocol::JOB_RESULT_BLOCK_SIZE,
+                                                    job->GetResultCompressionLevel(),
+                                                    job->GetAllowZstdUse() );
+                bool isResultStreamed = ( result == Node::BuildResult::eOk ) && job->IsResultStreamed();
+                size_t problemFileIndex = 0;
+                if ( isResultStreamed && ( blockReader.Open( job->GetResultFiles(), &problemFileIndex ) == false ) )
+                {
+                    job->Error( "Error reading file: '%s'", job->GetResultFiles()[ problemFileIndex ].Get() );
+                    FLOG_ERROR( "Error reading file: '%s'", job->GetResultFiles()[ problemFileIndex ].Get() );
+                    result = Node::BuildResult::eFailed;
+                    isResultStreamed = false;
+                }
+
                 MemoryStream ms;
                 ms.Write( job->GetJobId() );
                 ms.Write( job->GetNode()->GetName() );
@@ -741,8 +907,15 @@ void Server::FinalizeCompletedJobs()
                 ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
 
                 // write the data - build result for success, or output+errors for failure
-                ms.Write( (uint32_t)job->GetDataSize() );
-                ms.WriteBuffer( job->GetData(), job->GetDataSize() );
+                if ( isResultStreamed )
+                {
+                    ms.Write( (uint32_t)0 );
+                }
+                else
+                {
+                    ms.Write( (uint32_t)job->GetDataSize() );
+                    ms.WriteBuffer( job->GetData(), job->GetDataSize() );
+                }
 
                 {
                     ASSERT( cs->m_NumJobsActive.Load() > 0 );
@@ -750,7 +923,11 @@ void Server::FinalizeCompletedJobs()
 
                     MutexHolder mh2( cs->m_Mutex );
 
-                    if ( job->GetResultCompressionLevel() == 0 )
+                    if ( isResultStreamed )
+                    {
+                        SendStreamedResult( cs->m_Connection, blockReader, ms );
+                    }
+                    else if ( job->GetResultCompressionLevel() == 0 )
                     {
                         // Uncompressed
                         const Protocol::MsgJobResult msg;
@@ -775,6 +952,40 @@ void Server::FinalizeCompletedJobs()
     }
 }
 
+// SendStreamedResult
+//------------------------------------------------------------------------------
+void Server::SendStreamedResult( const ConnectionInfo * connection, MultiBufferBlockReader & blockReader, const MemoryStream & header )
+{
+    PROFILE_FUNCTION;
+
+    // Header, followed by each block as it is read and compressed, which the
+    // client decompresses and writes to disk as it arrives
+    const uint32_t numBlocks = blockReader.GetNumBlocks();
+    const Protocol::MsgJobResultStreamed msg( numBlocks );
+    if ( msg.Send( connection, header ) == false )
+    {
+        return; // Connection lost
+    }
+    const Protocol::MsgJobResultBlock blockMsg;
+    for ( uint32_t i = 0; i < numBlocks; ++i )
+    {
+        Compressor block;
+        if ( blockReader.ReadBlock( block ) == false )
+        {
+            // The result can't be failed part way through, so drop the
+            // connection (the client will build the job again)
+            FLOG_ERROR( "Error reading result for job" );
+            Disconnect( connection );
+            return;
+        }
+        const ConstMemoryStream ms( block.GetResult(), block.GetResultSize() );
+        if ( blockMsg.Send( connection, ms ) == false )
+        {
+            return; // Connection lost
+        }
+    }
+}
+
 // TouchToolchains
 //------------------------------------------------------------------------------
 void Server::TouchToolchains()
@@ -802,26 +1013,40 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
 {
     MutexHolder manifestMH( m_ToolManifestsMutex );
 
-    const Array< ToolManifestFile > & files = manifest->GetFiles();
-    const size_t numFiles = files.GetSize();
-    for ( size_t i=0; i<numFiles; ++i )
+    // mark files so they are not requested again
+    Array< uint32_t > fileIds;
+    manifest->MarkFilesAsSynchronizing( fileIds );
+    if ( fileIds.IsEmpty() )
+    {
+        return;
+    }
+
+    // either this is the first file being synchronized, or we
+    // are synchronizing multiple files from the same connection
+    // (it should not be possible to have files requested from different connections)
+    ASSERT( ( manifest->GetUserData() == nullptr ) || ( manifest->GetUserData() == connection ) );
+    manifest->SetUserData( (void *)connection );
+
+    // Clients supporting MsgRequestFiles (v22.8) get all the requests at once
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    if ( cs->m_ProtocolVersionMinor >= 8 )
     {
-        const ToolManifestFile & f = files[ i ];
-        if ( f.GetSyncState() == ToolManifestFile::NOT_SYNCHRONIZED )
+        MemoryStream ms;
+        ms.Write( static_cast< uint32_t >( fileIds.GetSize() ) );
+        for ( const uint32_t fileId : fileIds )
         {
-            // request this file
-            const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), (uint32_t)i );
-            reqFileMsg.Send( connection );
-
-            // prevent it being requested again
-            manifest->MarkFileAsSynchronizing( i );
-
-            // either this is the first file being synchronized, or we
-            // are synchronizing multiple files from the same connection
-            // (it should not be possible to have files requested from different connections)
-            ASSERT( ( manifest->GetUserData() == nullptr ) || ( manifest->GetUserData() == connection ) );
-            manifest->SetUserData( (void *)connection );
+            ms.Write( fileId );
         }
+        const Protocol::MsgRequestFiles reqFilesMsg( manifest->GetToolId() );
+        reqFilesMsg.Send( connection, ms );
+        return;
+    }
+
+    for ( const uint32_t fileId : fileIds )
+    {
+        // request this file
+        const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), fileId );
+        reqFileMsg.Send( connection );
     }
 }
 
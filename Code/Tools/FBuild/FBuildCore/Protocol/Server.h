@@ -4,6 +4,8 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkCache.h"
+
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Time/Timer.h"
@@ -12,6 +14,8 @@
 //------------------------------------------------------------------------------
 class Job;
 class JobQueueRemote;
+class MemoryStream;
+class MultiBufferBlockReader;
 namespace Protocol
 {
     class IMessage;
@@ -21,6 +25,7 @@ namespace Protocol
     class MsgNoJobAvailable;
     class MsgStatus;
     class MsgFile;
+    class MsgFiles;
 }
 class ToolManifest;
 
@@ -49,14 +54,17 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgFiles * msg, const void * payload, size_t payloadSize );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
 
     void            FindNeedyClients();
     void            FinalizeCompletedJobs();
+    void            SendStreamedResult( const ConnectionInfo * connection, MultiBufferBlockReader & blockReader, const MemoryStream & header );
     void            TouchToolchains();
     void            CheckWaitingJobs( const ToolManifest * manifest );
+    bool            ReceiveFile( const ConnectionInfo * connection, ToolManifest * manifest, uint32_t fileId, const void * data, size_t dataSize );
 
     void            RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
 
@@ -65,6 +73,7 @@ private:
         explicit ClientState( const ConnectionInfo * ci )
             : m_Connection( ci )
             , m_WaitingJobs( 16 )
+            , m_ChunkCache( false )
         {}
 
         inline bool operator < ( const ClientState & other ) const { return ( m_NumJobsAvailable.Load() > other.m_NumJobsAvailable.Load() ); }
@@ -81,6 +90,7 @@ private:
         AString                 m_HostName;
 
         Array< Job * >          m_WaitingJobs; // jobs waiting for manifests/toolchains
+        ChunkCache              m_ChunkCache;  // mirrors the chunks the client has sent (v22.6), contents are in m_ChunkStore
 
         Timer                   m_StatusTimer;
     };
@@ -95,6 +105,8 @@ private:
     mutable Mutex           m_ToolManifestsMutex;
     Array< ToolManifest * > m_Tools;
 
+    ChunkStore              m_ChunkStore;   // chunks received from all clients, within one budget
+
     #if defined( __OSX__ ) || defined( __LINUX__ )
         Timer                   m_TouchToolchainTimer;
     #endif
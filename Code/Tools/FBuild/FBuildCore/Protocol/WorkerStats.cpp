@@ -0,0 +1,85 @@
+// WorkerStats - Tracks how quickly a worker returns distributed jobs
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "WorkerStats.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerStats::WorkerStats()
+{
+    Reset();
+}
+
+// Reset
+//------------------------------------------------------------------------------
+void WorkerStats::Reset()
+{
+    m_NumJobs = 0;
+    m_NumSpeedSamples = 0;
+    m_AvgBuildTimeMS = 0.0f;
+    m_AvgOverheadMS = 0.0f;
+    m_SpeedFactor = 0.0f;
+}
+
+// OnJobCompleted
+//------------------------------------------------------------------------------
+void WorkerStats::OnJobCompleted( uint32_t roundTripMS, uint32_t buildTimeMS, uint32_t lastBuildTimeMS )
+{
+    // Anything not spent building was spent transferring data or queued
+    const uint32_t overheadMS = ( roundTripMS > buildTimeMS ) ? ( roundTripMS - buildTimeMS ) : 0;
+    m_AvgBuildTimeMS = Blend( m_AvgBuildTimeMS, static_cast< float >( buildTimeMS ), m_NumJobs );
+    m_AvgOverheadMS = Blend( m_AvgOverheadMS, static_cast< float >( overheadMS ), m_NumJobs );
+    ++m_NumJobs;
+
+    // Compare with how long the job took previously
+    if ( lastBuildTimeMS >= MIN_COMPARABLE_BUILD_TIME_MS )
+    {
+        const float speed = static_cast< float >( buildTimeMS ) / static_cast< float >( lastBuildTimeMS );
+        m_SpeedFactor = Blend( m_SpeedFactor, speed, m_NumSpeedSamples );
+        ++m_NumSpeedSamples;
+    }
+}
+
+// EstimateRoundTripMS
+//------------------------------------------------------------------------------
+uint32_t WorkerStats::EstimateRoundTripMS( uint32_t lastBuildTimeMS ) const
+{
+    if ( m_NumJobs == 0 )
+    {
+        return 0; // Nothing known about this worker yet
+    }
+
+    // Scale the previous build time by this worker's speed if we can, or
+    // assume it's a typical job for this worker if it's not been built before
+    float buildTimeMS = m_AvgBuildTimeMS;
+    if ( lastBuildTimeMS > 0 )
+    {
+        const float speedFactor = GetSpeedFactor();
+        buildTimeMS = static_cast< float >( lastBuildTimeMS ) * ( ( speedFactor > 0.0f ) ? speedFactor : 1.0f );
+    }
+
+    return static_cast< uint32_t >( buildTimeMS + m_AvgOverheadMS );
+}
+
+// GetSpeedFactor
+//------------------------------------------------------------------------------
+float WorkerStats::GetSpeedFactor() const
+{
+    return ( m_NumSpeedSamples >= MIN_SPEED_SAMPLES ) ? m_SpeedFactor : 0.0f;
+}
+
+// Blend
+//------------------------------------------------------------------------------
+/*static*/ float WorkerStats::Blend( float average, float sample, uint32_t numSamples )
+{
+    // Moving average, favoring recent samples so we adapt to changes in load
+    if ( numSamples == 0 )
+    {
+        return sample;
+    }
+    return average + ( ( sample - average ) * 0.25f );
+}
+
+//------------------------------------------------------------------------------
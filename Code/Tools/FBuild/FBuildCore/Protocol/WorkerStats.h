@@ -0,0 +1,51 @@
+// WorkerStats - Tracks how quickly a worker returns distributed jobs
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+
+// WorkerStats
+//------------------------------------------------------------------------------
+// Build times are compared with how long the same job took the last time it was
+// built (wherever that was), so workers can be compared with each other
+// regardless of which jobs they were given.
+class WorkerStats
+{
+public:
+    WorkerStats();
+
+    void        Reset();
+
+    // Record a job returned by the worker
+    //  - roundTripMS       : time from sending the job to receiving the result
+    //  - buildTimeMS       : time the worker took to build the job
+    //  - lastBuildTimeMS   : time the job took the last time it was built (0 if unknown)
+    void        OnJobCompleted( uint32_t roundTripMS, uint32_t buildTimeMS, uint32_t lastBuildTimeMS );
+
+    // Estimate the time from sending a job to receiving the result (0 if unknown)
+    uint32_t    EstimateRoundTripMS( uint32_t lastBuildTimeMS ) const;
+
+    // Build time relative to previous builds of the same jobs (lower is faster)
+    // or 0 if not enough is known yet
+    float       GetSpeedFactor() const;
+
+    uint32_t    GetNumJobs() const          { return m_NumJobs; }
+    uint32_t    GetAvgOverheadMS() const    { return static_cast< uint32_t >( m_AvgOverheadMS ); }
+
+private:
+    enum : uint32_t { MIN_SPEED_SAMPLES = 3 };              // Samples needed to trust speed factor
+    enum : uint32_t { MIN_COMPARABLE_BUILD_TIME_MS = 10 };  // Shorter jobs are too noisy to compare
+
+    static float Blend( float average, float sample, uint32_t numSamples );
+
+    uint32_t    m_NumJobs;
+    uint32_t    m_NumSpeedSamples;
+    float       m_AvgBuildTimeMS;   // Time spent building on the worker
+    float       m_AvgOverheadMS;    // Time spent on the network and in the worker's queue
+    float       m_SpeedFactor;
+};
+
+//------------------------------------------------------------------------------
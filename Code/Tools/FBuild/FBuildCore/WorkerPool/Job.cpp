@@ -54,6 +54,11 @@ Job::~Job()
         FDELETE m_Node;
     }
 
+    for ( const AString & file : m_ResultFiles )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+
     ASSERT( m_BuildProfilerScope == nullptr ); // If set, must be unhooked
 }
 
@@ -73,6 +78,16 @@ void Job::CancelDueToRemoteRaceWin()
     AtomicStoreRelaxed( &m_Abort, true );
 }
 
+// ClearCancellation
+//------------------------------------------------------------------------------
+void Job::ClearCancellation()
+{
+    // TODO:B ASSERT that this thread holds the JobQueue::m_DistributedJobsMutex lock
+    ASSERT( ( m_DistributionState == Job::DIST_COMPLETED_REMOTELY ) ||
+            ( m_DistributionState == Job::DIST_RACE_WON_REMOTELY ) ); // Local job must not be running
+    AtomicStoreRelaxed( &m_Abort, false );
+}
+
 // OwnData
 //------------------------------------------------------------------------------
 void Job::OwnData( void * data, size_t size, bool compressed )
@@ -158,10 +173,19 @@ void Job::SetMessages( const Array< AString > & messages )
 
 // Serialize
 //------------------------------------------------------------------------------
-void Job::Serialize( IOStream & stream )
+void Job::Serialize( IOStream & stream ) const
+{
+    Serialize( stream, m_Data, m_DataSize, IsDataCompressed() );
+}
+
+// Serialize
+//------------------------------------------------------------------------------
+void Job::Serialize( IOStream & stream, const void * data, size_t dataSize, bool dataIsCompressed ) const
 {
     PROFILE_FUNCTION;
 
+    ASSERT( dataSize <= 0xFFFFFFFF ); // only 32bit data supported
+
     // write jobid
     stream.Write( m_JobId );
     stream.Write( m_Node->GetName() );
@@ -172,10 +196,10 @@ void Job::Serialize( IOStream & stream )
     // write properties of node
     Node::SaveRemote( stream, m_Node );
 
-    stream.Write( IsDataCompressed() );
+    stream.Write( dataIsCompressed );
 
-    stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
+    stream.Write( static_cast< uint32_t >( dataSize ) );
+    stream.Write( data, dataSize );
 }
 
 // Deserialize
@@ -37,6 +37,7 @@ public:
 
     inline const volatile bool * GetAbortFlagPointer() const { return &m_Abort; }
     void CancelDueToRemoteRaceWin();
+    void ClearCancellation();
 
     // associate some data with this object, and destroy it when freed
     void    OwnData( void * data, size_t size, bool compressed = false );
@@ -65,7 +66,8 @@ public:
     inline uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
-    void Serialize( IOStream & stream );
+    void Serialize( IOStream & stream ) const;
+    void Serialize( IOStream & stream, const void * data, size_t dataSize, bool dataIsCompressed ) const; // Replacing job data
     void Deserialize( IOStream & stream );
 
     void                GetMessagesForLog( AString & buffer ) const;
@@ -84,6 +86,25 @@ public:
     int16_t             GetResultCompressionLevel() const   { return m_ResultCompressionLevel; }
     bool                GetAllowZstdUse() const             { return m_AllowZstdUse; }
 
+    // When a distributed job was sent to a worker, and after which it's overdue
+    // and should be raced locally (0 if unknown)
+    void                SetRemoteTimes( int64_t startTime, int64_t deadline )
+    {
+        m_RemoteStartTime = startTime;
+        AtomicStoreRelaxed( &m_RemoteDeadline, deadline );
+    }
+    int64_t             GetRemoteStartTime() const          { return m_RemoteStartTime; }
+    int64_t             GetRemoteDeadline() const           { return AtomicLoadRelaxed( &m_RemoteDeadline ); }
+
+    // Results returned in independently compressed blocks (v22.7)
+    void                SetResultStreamed( bool streamed )  { m_IsResultStreamed = streamed; }
+    bool                IsResultStreamed() const            { return m_IsResultStreamed; }
+
+    // On worker, the output files of a streamed result, kept until it is sent
+    // (deleted with the job)
+    void                SetResultFiles( Array< AString > && files ) { m_ResultFiles = Move( files ); }
+    const Array< AString > & GetResultFiles() const         { return m_ResultFiles; }
+
     enum DistributionState : uint8_t
     {
         DIST_NONE                           = 0, // All non-distributable jobs
@@ -128,8 +149,12 @@ private:
     ToolManifest *      m_ToolManifest      = nullptr;
     int16_t             m_ResultCompressionLevel = 0; // Compression level of returned results
     bool                m_AllowZstdUse = false; // Can client accept Zstd results?
+    bool                m_IsResultStreamed = false; // Are results returned in blocks?
+    int64_t             m_RemoteStartTime = 0;  // On client, when the job was sent to a worker
+    int64_t             m_RemoteDeadline = 0;   // On client, when the job is overdue from the worker
 
     Array< AString >    m_Messages;
+    Array< AString >    m_ResultFiles;
 
     static Atomic<int64_t> s_TotalLocalDataMemoryUsage; // Total memory being managed by OwnData
 };
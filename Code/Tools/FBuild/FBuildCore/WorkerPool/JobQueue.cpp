@@ -10,15 +10,24 @@
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 
 #include "Core/Time/Timer.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Arena.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 
+// Static Data
+//------------------------------------------------------------------------------
+// A worker with jobs of its own only steals a job this much (%) more expensive
+static const uint32_t sJobStealCostThresholdPercent = ( 25 );
+static THREAD_LOCAL uint32_t s_NextVictimOffset = 0;
+
 // JobCostSorter
 //------------------------------------------------------------------------------
 class JobCostSorter
@@ -34,6 +43,7 @@ public:
 //------------------------------------------------------------------------------
 JobSubQueue::JobSubQueue()
     : m_Count( 0 )
+    , m_TopCost( 0 )
 {
 }
 
@@ -52,23 +62,20 @@ uint32_t JobSubQueue::GetCount() const
     return AtomicLoadRelaxed( &m_Count );
 }
 
+// GetTopCost
+//------------------------------------------------------------------------------
+uint32_t JobSubQueue::GetTopCost() const
+{
+    return AtomicLoadRelaxed( &m_TopCost );
+}
+
 // JobSubQueue:QueueJobs
 //------------------------------------------------------------------------------
-void JobSubQueue::QueueJobs( Array< Node * > & nodes )
+void JobSubQueue::QueueJobs( Array< Job * > & jobs )
 {
     PROFILE_FUNCTION;
 
-    // Create wrapper Jobs around Nodes
-    Array< Job * > jobs( nodes.GetSize() );
-    for ( Node * node : nodes )
-    {
-        Job * job = FNEW( Job( node ) );
-        jobs.Append( job );
-    }
-
-    // Sort Jobs by cost
     JobCostSorter sorter;
-    jobs.Sort( sorter );
 
     // lock to add job
     MutexHolder mh( m_Mutex );
@@ -79,6 +86,7 @@ void JobSubQueue::QueueJobs( Array< Node * > & nodes )
     if ( wasEmpty )
     {
         m_Jobs.Swap( jobs );
+        UpdateTopCost();
         return; // skip re-sorting
     }
 
@@ -111,6 +119,7 @@ void JobSubQueue::QueueJobs( Array< Node * > & nodes )
     }
     ASSERT( dst == mergedList.End() );
     m_Jobs.Swap( mergedList );
+    UpdateTopCost();
 }
 
 // RemoveJob
@@ -136,13 +145,66 @@ Job * JobSubQueue::RemoveJob()
 
     Job * job = m_Jobs.Top();
     m_Jobs.Pop();
+    UpdateTopCost();
 
     return job;
 }
 
+// FindQueueToConsume
+//------------------------------------------------------------------------------
+/*static*/ JobSubQueue * JobSubQueue::FindQueueToConsume( const Array< JobSubQueue * > & subQueues,
+                                                          size_t ownQueueIndex,
+                                                          size_t firstVictimOffset )
+{
+    // Take from our own queue, unless another has a job sufficiently more
+    // expensive that building it first shortens the critical path
+    JobSubQueue * bestQueue = nullptr;
+    uint64_t bestCost = 0;
+    JobSubQueue * ownQueue = subQueues[ ownQueueIndex ];
+    if ( ownQueue->GetCount() > 0 )
+    {
+        bestQueue = ownQueue;
+        bestCost = ownQueue->GetTopCost();
+    }
+
+    // Check the other queues, starting at the given victim. A victim only
+    // replaces the current choice if it is more expensive by the threshold
+    // so equally good queues are shared out by the rotating start point.
+    const size_t numSubQueues = subQueues.GetSize();
+    const size_t numVictims = ( numSubQueues - 1 );
+    for ( size_t i = 0; i < numVictims; ++i )
+    {
+        const size_t victimIndex = ( ownQueueIndex + 1 + ( ( firstVictimOffset + i ) % numVictims ) ) % numSubQueues;
+        JobSubQueue * subQueue = subQueues[ victimIndex ];
+        if ( subQueue->GetCount() == 0 )
+        {
+            continue;
+        }
+        const uint64_t cost = subQueue->GetTopCost();
+        if ( ( bestQueue == nullptr ) ||
+             ( ( cost * 100 ) > ( bestCost * ( 100 + sJobStealCostThresholdPercent ) ) ) )
+        {
+            bestQueue = subQueue;
+            bestCost = cost;
+        }
+    }
+    return bestQueue;
+}
+
+// UpdateTopCost
+//------------------------------------------------------------------------------
+void JobSubQueue::UpdateTopCost()
+{
+    // Caller must hold m_Mutex
+    const uint32_t topCost = m_Jobs.IsEmpty() ? 0 : m_Jobs.Top()->GetNode()->GetRecursiveCost();
+    AtomicStoreRelaxed( &m_TopCost, topCost );
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueue::JobQueue( uint32_t numWorkerThreads, ThreadPool * threadPool ) :
+    m_LocalJobs_Available( numWorkerThreads ? numWorkerThreads : 1 ),
+    m_NextSubQueueIndex( 0 ),
     m_NumLocalJobsActive( 0 ),
     m_DistributableJobs_Available( 1024 ),
     m_DistributableJobs_InProgress( 1024 ),
@@ -163,6 +225,14 @@ JobQueue::JobQueue( uint32_t numWorkerThreads, ThreadPool * threadPool ) :
 
     WorkerThread::InitTmpDir();
 
+    // A queue per worker thread (or a single queue for the main thread if
+    // there are no workers)
+    const uint32_t numSubQueues = ( numWorkerThreads ? numWorkerThreads : 1 );
+    for ( uint32_t i = 0; i < numSubQueues; ++i )
+    {
+        m_LocalJobs_Available.Append( FNEW( JobSubQueue() ) );
+    }
+
     if ( numWorkerThreads > 0 )
     {
         // Create a job to run on each thread
@@ -188,9 +258,12 @@ JobQueue::~JobQueue()
     SignalStopWorkers();
 
     // delete incomplete jobs
-    while ( Job * job = m_LocalJobs_Available.RemoveJob() )
+    for ( JobSubQueue * subQueue : m_LocalJobs_Available )
     {
-        FDELETE job;
+        while ( Job * job = subQueue->RemoveJob() )
+        {
+            FDELETE job;
+        }
     }
 
     // wait for workers to finish - ok if they stopped before this
@@ -201,6 +274,12 @@ JobQueue::~JobQueue()
         FDELETE m_Workers[ i ];
     }
 
+    // free queues (only once workers can no longer access them)
+    for ( JobSubQueue * subQueue : m_LocalJobs_Available )
+    {
+        FDELETE subQueue;
+    }
+
     // free locally available distributed jobs
     {
         MutexHolder m( m_DistributedJobsMutex );
@@ -266,7 +345,11 @@ void JobQueue::GetJobStats( uint32_t & numJobs,
 {
     MutexHolder m( m_DistributedJobsMutex );
 
-    numJobs = m_LocalJobs_Available.GetCount();
+    numJobs = 0;
+    for ( const JobSubQueue * subQueue : m_LocalJobs_Available )
+    {
+        numJobs += subQueue->GetCount();
+    }
     numJobsDist = (uint32_t)m_DistributableJobs_Available.GetSize();
     numJobsActive = AtomicLoadRelaxed( &m_NumLocalJobsActive );
     numJobsDistActive = (uint32_t)m_DistributableJobs_InProgress.GetSize();
@@ -303,10 +386,59 @@ void JobQueue::FlushJobBatch()
         return;
     }
 
-    // Make the jobs available
-    m_LocalJobs_Available.QueueJobs( m_LocalJobs_Staging );
-    m_WorkerThreadSemaphore.Signal( (uint32_t)m_LocalJobs_Staging.GetSize() );
+    PROFILE_FUNCTION;
+
+    // Create wrapper Jobs around Nodes
+    const size_t numJobs = m_LocalJobs_Staging.GetSize();
+    Array< Job * > jobs( numJobs );
+    for ( Node * node : m_LocalJobs_Staging )
+    {
+        jobs.Append( FNEW( Job( node ) ) );
+    }
     m_LocalJobs_Staging.Clear();
+
+    // Sort Jobs by cost
+    JobCostSorter sorter;
+    jobs.Sort( sorter );
+
+    // Deal jobs to each worker's queue, most expensive first, so the most
+    // expensive jobs are spread across workers. Rotate the starting queue
+    // so small batches don't always go to the same worker.
+    const size_t numSubQueues = m_LocalJobs_Available.GetSize();
+    const size_t numQueuesUsed = Math::Min( numJobs, numSubQueues );
+    Array< Array< Job * > > jobsPerQueue;
+    jobsPerQueue.SetSize( numQueuesUsed );
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        jobsPerQueue[ i % numQueuesUsed ].Append( jobs[ numJobs - 1 - i ] );
+    }
+    for ( size_t i = 0; i < numQueuesUsed; ++i )
+    {
+        // Queues are sorted with the most expensive jobs at the end
+        Array< Job * > & queueJobs = jobsPerQueue[ i ];
+        queueJobs.Sort( sorter );
+
+        const size_t subQueueIndex = ( m_NextSubQueueIndex + i ) % numSubQueues;
+        m_LocalJobs_Available[ subQueueIndex ]->QueueJobs( queueJobs );
+    }
+    m_NextSubQueueIndex = ( m_NextSubQueueIndex + numQueuesUsed ) % numSubQueues;
+
+    // Wake workers. Workers consume all available jobs before waiting again,
+    // so there is no need to signal more than once per worker.
+    m_WorkerThreadSemaphore.Signal( (uint32_t)numQueuesUsed );
+}
+
+// GetReadyNodes (Main Thread)
+//------------------------------------------------------------------------------
+bool JobQueue::GetReadyNodes( Array< Node * > & outNodes )
+{
+    ASSERT( outNodes.IsEmpty() );
+    if ( m_ReadyNodes.IsEmpty() )
+    {
+        return false;
+    }
+    outNodes.Swap( m_ReadyNodes );
+    return true;
 }
 
 // QueueDistributableJob
@@ -340,7 +472,7 @@ void JobQueue::QueueDistributableJob( Job * job )
 
 // GetDistributableJobToProcess
 //------------------------------------------------------------------------------
-Job * JobQueue::GetDistributableJobToProcess( bool remote )
+Job * JobQueue::GetDistributableJobToProcess( bool remote, bool cheapest )
 {
     MutexHolder m( m_DistributedJobsMutex );
 
@@ -349,10 +481,19 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote )
         return nullptr;
     }
 
-    // Jobs are sorted from least to most expensive, so we consume
+    // Jobs are sorted from least to most expensive, so we normally consume
     // from the end of the list.
-    Job * job = m_DistributableJobs_Available.Top();
-    m_DistributableJobs_Available.Pop();
+    Job * job;
+    if ( cheapest )
+    {
+        job = m_DistributableJobs_Available[ 0 ];
+        m_DistributableJobs_Available.PopFront();
+    }
+    else
+    {
+        job = m_DistributableJobs_Available.Top();
+        m_DistributableJobs_Available.Pop();
+    }
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
@@ -372,6 +513,28 @@ Job * JobQueue::GetDistributableJobToRace()
         return nullptr;
     }
 
+    // Prefer the job which is most overdue from its worker, as the worker is
+    // slower or busier than expected and the job may otherwise hold up the build
+    const int64_t now = Timer::GetNow();
+    Job * mostOverdueJob = nullptr;
+    int64_t earliestDeadline = now;
+    for ( Job * job : m_DistributableJobs_InProgress )
+    {
+        const int64_t deadline = job->GetRemoteDeadline();
+        if ( ( job->GetDistributionState() == Job::DIST_BUILDING_REMOTELY ) &&
+             ( deadline != 0 ) &&
+             ( deadline < earliestDeadline ) )
+        {
+            mostOverdueJob = job;
+            earliestDeadline = deadline;
+        }
+    }
+    if ( mostOverdueJob )
+    {
+        mostOverdueJob->SetDistributionState( Job::DIST_RACING );
+        return mostOverdueJob;
+    }
+
     // take newest job, which is least likely to finish first
     // compared to older distributed jobs
     const int32_t numJobs = (int32_t)m_DistributableJobs_InProgress.GetSize();
@@ -536,6 +699,30 @@ void JobQueue::ReturnUnfinishedDistributableJob( Job * job )
     m_WorkerThreadSemaphore.Signal();
 }
 
+// ReturnIncompleteRemoteJob
+//------------------------------------------------------------------------------
+void JobQueue::ReturnIncompleteRemoteJob( Job * job )
+{
+    {
+        MutexHolder m( m_DistributedJobsMutex );
+
+        // The job was returned by OnReturnRemoteJob, which ended any local race
+        ASSERT( ( job->GetDistributionState() == Job::DIST_COMPLETED_REMOTELY ) ||
+                ( job->GetDistributionState() == Job::DIST_RACE_WON_REMOTELY ) );
+
+        // Remove from in progress (keep order)
+        VERIFY( m_DistributableJobs_InProgress.FindAndErase( job ) );
+
+        // Put back in available queue, clearing any cancellation of a local race
+        job->ClearCancellation();
+        m_DistributableJobs_Available.Append( job );
+        job->SetDistributionState( Job::DIST_AVAILABLE );
+    }
+
+    // Signal local threads that new work is available
+    m_WorkerThreadSemaphore.Signal();
+}
+
 // FinalizeCompletedJobs (Main Thread)
 //------------------------------------------------------------------------------
 void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
@@ -561,6 +748,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
         for ( Job * job : *jobArray )
         {
             Node * n = job->GetNode();
+            n->m_UnsavedChanges = true; // Stamp, build time and dependency stamps may have changed
 
             if ( completedJob )
             {
@@ -573,11 +761,13 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
                 {
                     n->SetState( Node::FAILED );
                 }
+                nodeGraph.OnNodeCompleted( n );
             }
             else if ( failedJob )
             {
                 // Mark failed jobs
                 n->SetState( Node::FAILED );
+                nodeGraph.OnNodeCompleted( n );
             }
 
             // Free normal jobs
@@ -652,14 +842,51 @@ void JobQueue::WorkerThreadWait( uint32_t maxWaitMS )
 //------------------------------------------------------------------------------
 Job * JobQueue::GetJobToProcess()
 {
-    Job * job = m_LocalJobs_Available.RemoveJob();
-    if ( job )
+    // Each worker owns a queue (the main thread uses the first in -j0 mode)
+    const uint16_t threadIndex = WorkerThread::GetThreadIndex();
+    const size_t numSubQueues = m_LocalJobs_Available.GetSize();
+    const size_t ownQueueIndex = ( threadIndex > 0 ) ? ( ( threadIndex - 1u ) % numSubQueues ) : 0;
+
+    for ( ;; )
+    {
+        JobSubQueue * subQueue = FindSubQueueToConsume( ownQueueIndex );
+        if ( subQueue == nullptr )
+        {
+            return nullptr; // no jobs available anywhere
+        }
+
+        // Job can be taken by another worker between finding and removing it
+        Job * job = subQueue->RemoveJob();
+        if ( job )
+        {
+            AtomicInc( &m_NumLocalJobsActive );
+            return job;
+        }
+    }
+}
+
+// HasJobsToProcess (Worker Thread)
+//------------------------------------------------------------------------------
+bool JobQueue::HasJobsToProcess() const
+{
+    for ( const JobSubQueue * subQueue : m_LocalJobs_Available )
     {
-        AtomicInc( &m_NumLocalJobsActive );
-        return job;
+        if ( subQueue->GetCount() > 0 )
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    return nullptr;
+// FindSubQueueToConsume (Worker Thread)
+//------------------------------------------------------------------------------
+JobSubQueue * JobQueue::FindSubQueueToConsume( size_t ownQueueIndex ) const
+{
+    // Start looking at a different victim each time so idle workers spread
+    // out over the other queues instead of all contending on the same one
+    const uint32_t victimOffset = s_NextVictimOffset++;
+    return JobSubQueue::FindQueueToConsume( m_LocalJobs_Available, ownQueueIndex, victimOffset );
 }
 
 // FinishedProcessingJob (Worker Thread)
@@ -750,6 +977,10 @@ void JobQueue::FinishedProcessingJob( Job * job, Node::BuildResult result, bool
 //------------------------------------------------------------------------------
 /*static*/ Node::BuildResult JobQueue::DoBuild( Job * job )
 {
+    // Transient allocations made by the job are released all at once when complete
+    // (and unusually large ones aren't kept for later jobs)
+    const ArenaScope arenaScope( WorkerThread::GetArena(), WorkerThread::ARENA_MAX_RETAINED_SIZE );
+
     const Timer timer; // track how long the item takes
 
     Node * node = job->GetNode();
@@ -28,14 +28,23 @@ public:
     ~JobSubQueue();
 
     uint32_t GetCount() const;
+    uint32_t GetTopCost() const;
 
-    // jobs pushed by the main thread
-    void QueueJobs( Array< Node * > & nodes );
+    // jobs pushed by the main thread (must be sorted)
+    void QueueJobs( Array< Job * > & jobs );
 
     // jobs consumed by workers
     Job * RemoveJob();
+
+    // choose the queue a worker should take its next job from
+    static JobSubQueue * FindQueueToConsume( const Array< JobSubQueue * > & subQueues,
+                                             size_t ownQueueIndex,
+                                             size_t firstVictimOffset );
 private:
+    void UpdateTopCost();
+
     uint32_t    m_Count;    // access the current count
+    uint32_t    m_TopCost;  // cost of most expensive job, for lock-free comparison between queues
     Mutex       m_Mutex;    // lock to add/remove jobs
     Array< Job * > m_Jobs;  // Sorted, most expensive at end
 };
@@ -52,6 +61,8 @@ public:
     void AddJobToBatch( Node * node );  // Add new job to the staging queue
     void FlushJobBatch();               // Sort and flush the staging queue
     bool HasJobsToFlush() const { return ( m_LocalJobs_Staging.IsEmpty() == false ); }
+    void AddReadyNode( Node * node ) { m_ReadyNodes.Append( node ); } // Node can progress now its dependencies are complete
+    bool GetReadyNodes( Array< Node * > & outNodes );
     void FinalizeCompletedJobs( NodeGraph & nodeGraph );
     void MainThreadWait( uint32_t maxWaitMS );
 
@@ -74,6 +85,8 @@ private:
     friend class WorkerThread;
     void        WorkerThreadWait( uint32_t maxWaitMS );
     Job *       GetJobToProcess();
+    bool        HasJobsToProcess() const;
+    JobSubQueue * FindSubQueueToConsume( size_t ownQueueIndex ) const;
     Job *       GetDistributableJobToRace();
     static Node::BuildResult DoBuild( Job * job );
     void        FinishedProcessingJob( Job * job, Node::BuildResult result, bool wasARemoteJob );
@@ -82,7 +95,8 @@ private:
 
     // client side of protocol consumes jobs via this interface
     friend class Client;
-    Job *       GetDistributableJobToProcess( bool remote );
+    friend class TestJobQueue;
+    Job *       GetDistributableJobToProcess( bool remote, bool cheapest );
     Job *       OnReturnRemoteJob( uint32_t jobId,
                                    bool systemError,
                                    bool & outRaceLost,
@@ -90,13 +104,19 @@ private:
                                    const Node * & outNode,
                                    uint32_t & outJobSystemErrorCount );
     void        ReturnUnfinishedDistributableJob( Job * job );
+    void        ReturnIncompleteRemoteJob( Job * job );
 
     // Semaphore to manage work
     Semaphore           m_WorkerThreadSemaphore;
 
-    // Jobs available for local processing
+    // Nodes waiting to be progressed by the main thread now their dependencies are complete
+    Array< Node * >     m_ReadyNodes;
+
+    // Jobs available for local processing. Each worker thread owns a queue,
+    // and steals from the others when that has no jobs (or only much cheaper ones)
     Array< Node * >     m_LocalJobs_Staging;
-    JobSubQueue         m_LocalJobs_Available;
+    Array< JobSubQueue * > m_LocalJobs_Available;
+    size_t              m_NextSubQueueIndex;
 
     // Jobs in progress locally
     uint32_t            m_NumLocalJobsActive;
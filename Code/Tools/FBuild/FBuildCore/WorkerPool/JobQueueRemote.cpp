@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #include "JobQueueRemote.h"
 #include "Job.h"
+#include "WorkerResultCache.h"
 #include "WorkerThreadRemote.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
@@ -12,6 +13,7 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 
 // Core
@@ -19,6 +21,8 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Arena.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Time/Timer.h"
@@ -35,6 +39,13 @@ JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads ) :
 {
     WorkerThread::InitTmpDir( true ); // remote == true
 
+    // Results of previous jobs, to answer duplicates
+    AStackString<> resultCachePath;
+    WorkerResultCache::GetDefaultPath( resultCachePath );
+    m_ResultCache = FNEW( WorkerResultCache( resultCachePath,
+                                             WorkerResultCache::DEFAULT_MEMORY_LIMIT,
+                                             WorkerResultCache::DEFAULT_DISK_LIMIT ) );
+
     // Create thread pool
     m_ThreadPool = FNEW( ThreadPool( numWorkerThreads ) );
 
@@ -66,6 +77,7 @@ JobQueueRemote::~JobQueueRemote()
     }
 
     FDELETE m_ThreadPool;
+    FDELETE m_ResultCache;
 }
 
 // SignalStopWorkers (Main Thread)
@@ -298,6 +310,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
 //------------------------------------------------------------------------------
 /*static*/ Node::BuildResult JobQueueRemote::DoBuild( Job * job, bool racingRemoteJob )
 {
+    // Transient allocations made by the job are released all at once when complete
+    // (and unusually large ones aren't kept for later jobs)
+    const ArenaScope arenaScope( WorkerThread::GetArena(), WorkerThread::ARENA_MAX_RETAINED_SIZE );
+
     BuildProfilerScope profileScope( *job, WorkerThread::GetThreadIndex(), job->GetNode()->GetTypeName() );
 
     const Timer timer; // track how long the item takes
@@ -312,14 +328,21 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     // remote tasks must output to a tmp file
     if ( job->IsLocal() == false )
     {
-        // file name should be the same as on host
-        const char * fileName = ( job->GetRemoteName().FindLast( NATIVE_SLASH ) + 1 );
-
-        AStackString<> tmpFileName;
-        WorkerThread::CreateTempFilePath( fileName, tmpFileName );
-        node->ReplaceDummyName( tmpFileName );
-
-        //DEBUGSPAM( "REMOTE: %s (%s)\n", fileName, job->GetRemoteName().Get() );
+        // Keep the job's files in memory (if enabled) when there's space for them
+        if ( WorkerThread::UseMemoryBackedTempDirForJob( GetTempSpaceRequired( job ) ) &&
+             ( node->SetRemoteOutputName( job ) == false ) )
+        {
+            // Fall back to the regular temp dir
+            WorkerThread::UseDiskTempDirForJob();
+        }
+        if ( WorkerThread::IsUsingMemoryBackedTempDir() == false )
+        {
+            node->SetRemoteOutputName( job );
+        }
+    }
+    else
+    {
+        WorkerThread::UseDiskTempDirForJob();
     }
 
     ASSERT( node->IsAFile() );
@@ -339,7 +362,18 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
         FileIO::FileDelete( pdbName.Get() );
     }
 
+    // Duplicates of previous remote jobs can be answered without building
+    AStackString<> resultCacheKey;
+    uint32_t cachedBuildTimeMS = 0;
+    const bool retrievedFromCache = ( job->IsLocal() == false ) &&
+                                    RetrieveFromResultCache( job, resultCacheKey, cachedBuildTimeMS );
+
     Node::BuildResult result;
+    if ( retrievedFromCache )
+    {
+        result = Node::BuildResult::eOk;
+    }
+    else
     {
         PROFILE_SECTION( racingRemoteJob ? "RACE" : "LOCAL" );
         result = ((Node *)node )->DoBuild2( job, racingRemoteJob );
@@ -383,7 +417,9 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
         case Node::BuildResult::eOk:
         {
             // record new build time
-            node->SetLastBuildTime( timeTakenMS );
+            // (for cached results, report the original build time so the client's
+            // view of how long the job takes, and how fast this worker is, is unaffected)
+            node->SetLastBuildTime( retrievedFromCache ? cachedBuildTimeMS : timeTakenMS );
             node->SetStatFlag( Node::STATS_BUILT );
 
             #ifdef DEBUG
@@ -396,7 +432,8 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
 
 
             // TODO:A Also read into job if cache is being used
-            if ( job->IsLocal() == false )
+            // (streamed results are read from the files as they are sent)
+            if ( ( job->IsLocal() == false ) && ( job->IsResultStreamed() == false ) )
             {
                 // read results into memory to send back to client
                 if ( ReadResults( job ) == false )
@@ -408,9 +445,34 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
         }
     }
 
+    // Keep new results for any duplicates
+    if ( ( resultCacheKey.IsEmpty() == false ) && ( retrievedFromCache == false ) )
+    {
+        WorkerResultCache * resultCache = JobQueueRemote::Get().m_ResultCache;
+        if ( ( result == Node::BuildResult::eOk ) && ( job->GetSystemErrorCount() == 0 ) )
+        {
+            StackArray< AString > fileNames;
+            GetResultFileNames( node, fileNames );
+            resultCache->Store( resultCacheKey, fileNames, job->GetMessages(), timeTakenMS );
+        }
+        else
+        {
+            resultCache->Abandon( resultCacheKey );
+        }
+    }
+
     // if compiling to a tmp file, do cleanup
     if ( job->IsLocal() == false )
     {
+        // Keep the files for a streamed result until it is sent
+        if ( ( result == Node::BuildResult::eOk ) && job->IsResultStreamed() )
+        {
+            if ( KeepResultFiles( job ) == false )
+            {
+                result = Node::BuildResult::eFailed;
+            }
+        }
+
         // Cleanup obj file
         FileIO::FileDelete( node->GetName().Get() );
 
@@ -440,20 +502,30 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     return result;
 }
 
-// ReadResults
+// GetTempSpaceRequired
 //------------------------------------------------------------------------------
-/*static*/ bool JobQueueRemote::ReadResults( Job * job )
+/*static*/ uint64_t JobQueueRemote::GetTempSpaceRequired( const Job * job )
+{
+    // The preprocessed source is written out, and the outputs (object and debug
+    // info) can be of a similar size, so allow for several times its size
+    uint64_t inputSize = job->GetDataSize();
+    if ( job->IsDataCompressed() )
+    {
+        inputSize = Compressor::GetUncompressedSize( job->GetData(), job->GetDataSize() );
+    }
+    return ( inputSize * 4 );
+}
+
+// GetResultFileNames
+//------------------------------------------------------------------------------
+/*static*/ void JobQueueRemote::GetResultFileNames( const ObjectNode * node, Array< AString > & outFileNames )
 {
-    const ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
     const bool includePDB = node->IsUsingPDB();
     const bool usingStaticAnalysis = node->IsUsingStaticAnalysisMSVC();
 
-    // Determine list of files to send
-
     // 1. Object file
     //---------------
-    StackArray< AString > fileNames;
-    fileNames.Append( node->GetName() );
+    outFileNames.Append( node->GetName() );
 
     // 2. PDB file (optional)
     //-----------------------
@@ -461,7 +533,7 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     {
         AStackString<> pdbFileName;
         node->GetPDBName( pdbFileName );
-        fileNames.Append( pdbFileName );
+        outFileNames.Append( pdbFileName );
     }
 
     // 3. .nativecodeanalysis.xml file (optional)
@@ -470,11 +542,21 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     {
         AStackString<> xmlFileName;
         node->GetNativeAnalysisXMLPath( xmlFileName );
-        fileNames.Append( xmlFileName );
+        outFileNames.Append( xmlFileName );
     }
+}
+
+// ReadResults
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::ReadResults( Job * job )
+{
+    // Determine list of files to send
+    StackArray< AString > fileNames;
+    GetResultFileNames( job->GetNode()->CastTo< ObjectNode >(), fileNames );
 
-    MultiBuffer mb;
     size_t problemFileIndex = 0;
+
+    MultiBuffer mb;
     if ( !mb.CreateFromFiles( fileNames, &problemFileIndex ) )
     {
         job->Error( "Error reading file: '%s'", fileNames[ problemFileIndex ].Get() );
@@ -496,4 +578,80 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     return true;
 }
 
+// KeepResultFiles
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::KeepResultFiles( Job * job )
+{
+    // Move the files aside, as the worker thread's next job can output files
+    // with the same names before this result has been sent
+    static Atomic< uint32_t > s_NextResultId;
+    const uint32_t resultId = s_NextResultId.Increment();
+
+    StackArray< AString > fileNames;
+    GetResultFileNames( job->GetNode()->CastTo< ObjectNode >(), fileNames );
+
+    Array< AString > resultFiles( fileNames.GetSize() );
+    for ( const AString & fileName : fileNames )
+    {
+        AStackString<> resultFile;
+        resultFile.Format( "%s.%u.result", fileName.Get(), resultId );
+        if ( FileIO::FileMove( fileName, resultFile ) == false )
+        {
+            job->Error( "Error reading file: '%s'", fileName.Get() );
+            FLOG_ERROR( "Error reading file: '%s'", fileName.Get() );
+            job->SetResultFiles( Move( resultFiles ) ); // Delete those already moved
+            return false;
+        }
+        resultFiles.Append( resultFile );
+    }
+    job->SetResultFiles( Move( resultFiles ) );
+    return true;
+}
+
+// RetrieveFromResultCache
+//------------------------------------------------------------------------------
+/*static*/ bool JobQueueRemote::RetrieveFromResultCache( Job * job, AString & outKey, uint32_t & outBuildTimeMS )
+{
+    PROFILE_FUNCTION;
+
+    #if defined( ENABLE_FAKE_SYSTEM_FAILURE )
+        // Tests relying on a failure must actually build
+        if ( ObjectNode::GetFakeSystemFailureForNextJob() )
+        {
+            return false;
+        }
+    #endif
+
+    // The key is formed from the preprocessed source itself, so decompress it
+    // once here (the compiler would need it decompressed anyway)
+    if ( job->IsDataCompressed() )
+    {
+        Compressor c;
+        if ( c.Decompress( job->GetData() ) == false )
+        {
+            return false; // Let the build report the problem
+        }
+        const size_t uncompressedSize = c.GetResultSize();
+        job->OwnData( c.ReleaseResult(), uncompressedSize, false );
+    }
+
+    const ObjectNode * node = job->GetNode()->CastTo< ObjectNode >();
+    if ( node->GetRemoteCacheName( job, outKey ) == false )
+    {
+        outKey.Clear();
+        return false;
+    }
+
+    StackArray< AString > fileNames;
+    GetResultFileNames( node, fileNames );
+    Array< AString > messages;
+    if ( JobQueueRemote::Get().m_ResultCache->Retrieve( outKey, fileNames, messages, outBuildTimeMS ) == false )
+    {
+        return false; // Caller will build and Store (or Abandon) the result
+    }
+
+    job->SetMessages( messages );
+    return true;
+}
+
 //------------------------------------------------------------------------------
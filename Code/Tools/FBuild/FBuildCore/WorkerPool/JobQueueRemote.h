@@ -15,7 +15,9 @@
 //------------------------------------------------------------------------------
 class Node;
 class Job;
+class ObjectNode;
 class ThreadPool;
+class WorkerResultCache;
 class WorkerThread;
 
 // JobQueueRemote
@@ -54,7 +56,11 @@ private:
     void        FinishedProcessingJob( Job * job, Node::BuildResult result );
 
     // internal helpers
+    static uint64_t GetTempSpaceRequired( const Job * job );
+    static void GetResultFileNames( const ObjectNode * node, Array< AString > & outFileNames );
     static bool ReadResults( Job * job );
+    static bool KeepResultFiles( Job * job );
+    static bool RetrieveFromResultCache( Job * job, AString & outKey, uint32_t & outBuildTimeMS );
 
     mutable Mutex       m_PendingJobsMutex;
     Array< Job * >      m_PendingJobs;
@@ -70,6 +76,7 @@ private:
     Semaphore           m_WorkerThreadSleepSemaphore;
 
     ThreadPool *        m_ThreadPool;
+    WorkerResultCache * m_ResultCache;
     Array< WorkerThread * > m_Workers;
 };
 
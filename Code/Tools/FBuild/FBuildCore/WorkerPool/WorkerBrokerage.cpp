@@ -88,6 +88,9 @@ void WorkerBrokerage::InitBrokerage()
         }
     }
 
+    // optional brokerage service, for pools too large to use a shared folder efficiently
+    Env::GetEnvVariable( "FASTBUILD_BROKERAGE_SERVICE", m_ServiceAddress );
+
     m_BrokerageInitialized = true;
 }
 
@@ -24,6 +24,7 @@ protected:
 
     Array<AString>      m_BrokerageRoots;
     AString             m_BrokerageRootPaths;
+    AString             m_ServiceAddress;       // WorkerBrokerageService <host>[:<port>], if used
     bool                m_BrokerageInitialized;
 };
 
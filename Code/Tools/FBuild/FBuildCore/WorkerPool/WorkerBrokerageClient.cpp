@@ -7,6 +7,7 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageService.h"
 
 // Core
 #include "Core/Env/Env.h"
@@ -15,6 +16,10 @@
 #include "Core/Network/Network.h"
 #include "Core/Profile/Profile.h"
 
+// Static Data
+//------------------------------------------------------------------------------
+static const uint32_t sBrokerageServiceTimeoutMS = ( 2 * 1000 );
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerBrokerageClient::WorkerBrokerageClient() = default;
@@ -46,9 +51,26 @@ void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList )
 
     // Init the brokerage
     InitBrokerage();
+
+    // Prefer the brokerage service if there is one
+    if ( m_ServiceAddress.IsEmpty() == false )
+    {
+        if ( FindWorkersFromService( outWorkerList ) )
+        {
+            return;
+        }
+        if ( m_BrokerageRoots.IsEmpty() == false )
+        {
+            FLOG_WARN( "Brokerage service unavailable; falling back to brokerage path" );
+        }
+    }
+
     if ( m_BrokerageRoots.IsEmpty() )
     {
-        FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
+        if ( m_ServiceAddress.IsEmpty() )
+        {
+            FLOG_WARN( "No brokerage root; did you set FASTBUILD_BROKERAGE_PATH?" );
+        }
         return;
     }
 
@@ -95,4 +117,49 @@ void WorkerBrokerageClient::FindWorkers( Array< AString > & outWorkerList )
     }
 }
 
+// FindWorkersFromService
+//------------------------------------------------------------------------------
+bool WorkerBrokerageClient::FindWorkersFromService( Array< AString > & outWorkerList )
+{
+    PROFILE_FUNCTION;
+
+    WorkerBrokerageServiceConnection connection;
+    if ( connection.ConnectToService( m_ServiceAddress, sBrokerageServiceTimeoutMS ) == false )
+    {
+        FLOG_WARN( "Failed to connect to brokerage service '%s'", m_ServiceAddress.Get() );
+        return false;
+    }
+
+    // The list is sent as soon as we subscribe
+    Array< WorkerBrokerageInfo > workers;
+    if ( ( connection.Subscribe() == false ) ||
+         ( connection.WaitForWorkerList( workers, sBrokerageServiceTimeoutMS ) == false ) )
+    {
+        FLOG_WARN( "No worker list from brokerage service '%s'", m_ServiceAddress.Get() );
+        return false;
+    }
+    FLOG_WARN( "%zu workers found via brokerage service '%s'", workers.GetSize(), m_ServiceAddress.Get() );
+
+    // Get addresses for the local host
+    StackArray<AString> localAddresses;
+    Network::GetIPv4Addresses( localAddresses );
+
+    // Workers are ranked by the service, so keep them in order
+    if ( ( outWorkerList.GetSize() + workers.GetSize() ) > outWorkerList.GetCapacity() )
+    {
+        outWorkerList.SetCapacity( outWorkerList.GetSize() + workers.GetSize() );
+    }
+    for ( const WorkerBrokerageInfo & worker : workers )
+    {
+        // Filter out local addresses
+        if ( worker.m_Address.IsEmpty() || localAddresses.Find( worker.m_Address ) )
+        {
+            continue;
+        }
+
+        outWorkerList.Append( worker.m_Address );
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
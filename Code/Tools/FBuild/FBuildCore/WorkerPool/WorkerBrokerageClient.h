@@ -19,6 +19,9 @@ public:
     ~WorkerBrokerageClient();
 
     void FindWorkers( Array< AString > & outWorkerList );
+
+protected:
+    bool FindWorkersFromService( Array< AString > & outWorkerList );
 };
 
 //------------------------------------------------------------------------------
@@ -8,11 +8,13 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageService.h"
 #include "Tools/FBuild/FBuildWorker/Worker/WorkerSettings.h"
 
 // Core
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Strings/AStackString.h"
@@ -24,6 +26,9 @@ static const float sBrokerageElapsedTimeBetweenClean = ( 12 * 60 * 60.0f );
 static const uint32_t sBrokerageCleanOlderThan = ( 24 * 60 * 60 );
 static const float sBrokerageAvailabilityUpdateTime = ( 10.0f );
 static const float sBrokerageIPAddressUpdateTime = ( 5 * 60.0f );
+static const float sBrokerageServiceReconnectTime = ( 10.0f );
+static const float sBrokerageServiceLoadUpdateTime = ( 1.0f );
+static const uint32_t sBrokerageServiceConnectTimeoutMS = ( 2 * 1000 );
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -32,6 +37,8 @@ WorkerBrokerageServer::WorkerBrokerageServer()
     m_TimerLastUpdate.Start();
     m_TimerLastIPUpdate.Start();
     m_TimerLastCleanBroker.Start( sBrokerageElapsedTimeBetweenClean ); // Set timer so we trigger right away
+    m_TimerLastServiceConnect.Start( sBrokerageServiceReconnectTime ); // Set timer so we trigger right away
+    m_TimerLastServiceUpdate.Start();
 }
 
 // DESTRUCTOR
@@ -43,6 +50,9 @@ WorkerBrokerageServer::~WorkerBrokerageServer()
     {
         FileIO::FileDelete( m_BrokerageFilePath.Get() );
     }
+
+    // Disconnecting from the service removes us from the pool
+    FDELETE m_ServiceConnection;
 }
 
 // SetAvailability
@@ -52,6 +62,12 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     // Init the brokerage if not already
     InitBrokerage();
 
+    // The service is kept up to date independently of the brokerage share
+    if ( m_ServiceAddress.IsEmpty() == false )
+    {
+        UpdateService( available );
+    }
+
     // ignore if brokerage not configured
     if ( m_BrokerageRoots.IsEmpty() )
     {
@@ -220,6 +236,72 @@ void WorkerBrokerageServer::SetAvailability( bool available )
     }
 }
 
+// SetLoad
+//------------------------------------------------------------------------------
+void WorkerBrokerageServer::SetLoad( uint32_t numCPUsToUse, uint32_t cpuUsagePercent, uint32_t freeMemoryMiB )
+{
+    m_NumCPUsToUse = numCPUsToUse;
+    m_CPUUsagePercent = cpuUsagePercent;
+    m_FreeMemoryMiB = freeMemoryMiB;
+}
+
+// UpdateService
+//------------------------------------------------------------------------------
+void WorkerBrokerageServer::UpdateService( bool available )
+{
+    // (Re)connect if needed, but don't hammer an unavailable service
+    bool connected = false;
+    if ( m_ServiceConnection == nullptr )
+    {
+        m_ServiceConnection = FNEW( WorkerBrokerageServiceConnection );
+    }
+    if ( m_ServiceConnection->IsConnected() == false )
+    {
+        if ( m_TimerLastServiceConnect.GetElapsed() < sBrokerageServiceReconnectTime )
+        {
+            return;
+        }
+        m_TimerLastServiceConnect.Start();
+        if ( m_ServiceConnection->ConnectToService( m_ServiceAddress, sBrokerageServiceConnectTimeoutMS ) == false )
+        {
+            FLOG_WARN( "Failed to connect to brokerage service '%s'", m_ServiceAddress.Get() );
+            return;
+        }
+        connected = true;
+
+        // Identify ourselves, in case the service sees us via a loopback address
+        Network::GetHostName( m_ServiceHostName );
+        m_ServiceIPAddress.Clear();
+        const uint32_t ip = Network::GetHostIPFromName( m_ServiceHostName );
+        if ( ( ip != 0 ) && ( ip != 0x0100007f ) )
+        {
+            TCPConnectionPool::GetAddressAsString( ip, m_ServiceIPAddress );
+        }
+    }
+
+    // Joining or leaving the pool is sent right away, but changes in load are throttled
+    if ( ( connected == false ) &&
+         ( available == m_ServiceAvailable ) &&
+         ( m_TimerLastServiceUpdate.GetElapsed() < sBrokerageServiceLoadUpdateTime ) )
+    {
+        return;
+    }
+
+    WorkerBrokerageInfo info;
+    info.m_Address = m_ServiceIPAddress;
+    info.m_HostName = m_ServiceHostName;
+    info.m_Available = available;
+    info.m_NumCPUs = m_NumCPUsToUse;
+    info.m_CPUUsagePercent = m_CPUUsagePercent;
+    info.m_FreeMemoryMiB = m_FreeMemoryMiB;
+
+    if ( m_ServiceConnection->SendStatus( info ) )
+    {
+        m_ServiceAvailable = available;
+    }
+    m_TimerLastServiceUpdate.Start();
+}
+
 // UpdateBrokerageFilePath
 //------------------------------------------------------------------------------
 void WorkerBrokerageServer::UpdateBrokerageFilePath()
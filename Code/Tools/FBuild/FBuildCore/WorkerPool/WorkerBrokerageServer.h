@@ -12,6 +12,7 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class WorkerBrokerageServiceConnection;
 
 // WorkerBrokerageClient
 //------------------------------------------------------------------------------
@@ -23,10 +24,14 @@ public:
 
     void SetAvailability( bool available );
 
+    // Load reported to the brokerage service (if used) with the next update
+    void SetLoad( uint32_t numCPUsToUse, uint32_t cpuUsagePercent, uint32_t freeMemoryMiB );
+
     const AString & GetHostName() const { return m_HostName; }
 
 protected:
     void UpdateBrokerageFilePath();
+    void UpdateService( bool available );
 
     Timer               m_TimerLastUpdate;      // Throttle network access
     Timer               m_TimerLastIPUpdate;    // Throttle dns access
@@ -37,6 +42,17 @@ protected:
     AString             m_IPAddress;
     AString             m_DomainName;
     AString             m_HostName;
+
+    // Brokerage service
+    WorkerBrokerageServiceConnection * m_ServiceConnection = nullptr;
+    Timer               m_TimerLastServiceConnect;
+    Timer               m_TimerLastServiceUpdate;
+    bool                m_ServiceAvailable = false; // Availability last sent to the service
+    AString             m_ServiceHostName;      // Resolved on (re)connection
+    AString             m_ServiceIPAddress;
+    uint32_t            m_NumCPUsToUse = 0;
+    uint32_t            m_CPUUsagePercent = 0;
+    uint32_t            m_FreeMemoryMiB = 0;
 };
 
 //------------------------------------------------------------------------------
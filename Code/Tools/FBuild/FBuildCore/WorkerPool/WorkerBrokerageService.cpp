@@ -0,0 +1,487 @@
+// WorkerBrokerageService - Push-based worker discovery
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "WorkerBrokerageService.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+#define BROKERAGE_SERVICE_SEND_TIMEOUT_MS ( 5 * 1000 ) // Don't let one slow subscriber stall the service for long
+#define LOOPBACK_ADDRESS ( 0x0100007f ) // 127.0.0.1
+
+// WorkerBrokerageInfo::Write
+//------------------------------------------------------------------------------
+void WorkerBrokerageInfo::Write( MemoryStream & stream ) const
+{
+    stream.Write( m_Address );
+    stream.Write( m_HostName );
+    stream.Write( m_Available );
+    stream.Write( m_NumCPUs );
+    stream.Write( m_CPUUsagePercent );
+    stream.Write( m_FreeMemoryMiB );
+}
+
+// WorkerBrokerageInfo::Read
+//------------------------------------------------------------------------------
+bool WorkerBrokerageInfo::Read( ConstMemoryStream & stream )
+{
+    return ( stream.Read( m_Address ) &&
+             stream.Read( m_HostName ) &&
+             stream.Read( m_Available ) &&
+             stream.Read( m_NumCPUs ) &&
+             stream.Read( m_CPUUsagePercent ) &&
+             stream.Read( m_FreeMemoryMiB ) );
+}
+
+// WorkerBrokerageInfo::GetSpareCapacity
+//------------------------------------------------------------------------------
+float WorkerBrokerageInfo::GetSpareCapacity() const
+{
+    const float idle = ( 1.0f - ( (float)Math::Min( m_CPUUsagePercent, 100u ) / 100.0f ) );
+    return ( (float)m_NumCPUs * idle );
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerBrokerageService::WorkerBrokerageService()
+    : m_Workers( 256 )
+    , m_Subscribers( 16 )
+    , m_ShouldExit( false )
+{
+    m_LastBroadcast.Start();
+    m_BroadcastThread.Start( BroadcastThreadFuncStatic, "BrokerageService", this );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+WorkerBrokerageService::~WorkerBrokerageService()
+{
+    m_ShouldExit.Store( true );
+    m_BroadcastSemaphore.Signal();
+    m_BroadcastThread.Join();
+
+    ShutdownAllConnections();
+
+    // OnDisconnected should have freed everything
+    ASSERT( m_Workers.IsEmpty() );
+    ASSERT( m_Subscribers.IsEmpty() );
+}
+
+// Start
+//------------------------------------------------------------------------------
+bool WorkerBrokerageService::Start( uint16_t port )
+{
+    return Listen( port );
+}
+
+// GetNumWorkers
+//------------------------------------------------------------------------------
+size_t WorkerBrokerageService::GetNumWorkers() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Workers.GetSize();
+}
+
+// ParseAddress
+//------------------------------------------------------------------------------
+/*static*/ void WorkerBrokerageService::ParseAddress( const AString & address, AString & outHost, uint16_t & outPort )
+{
+    outPort = DEFAULT_PORT;
+
+    const char * colon = address.Find( ':' );
+    if ( colon == nullptr )
+    {
+        outHost = address;
+        return;
+    }
+
+    outHost.Assign( address.Get(), colon );
+    uint32_t port = 0;
+    if ( ( AString::ScanS( colon + 1, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+    {
+        outPort = (uint16_t)port;
+    }
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerBrokerageService::OnDisconnected( const ConnectionInfo * connection )
+{
+    {
+        MutexHolder mh( m_Mutex );
+
+        m_Subscribers.FindAndErase( connection );
+
+        WorkerState * worker = static_cast< WorkerState * >( connection->GetUserData() );
+        if ( worker )
+        {
+            VERIFY( m_Workers.FindAndErase( worker ) );
+            const bool wasAvailable = worker->m_Info.m_Available;
+            FDELETE worker;
+            connection->SetUserData( nullptr );
+
+            // Subscribers must stop using this worker
+            if ( wasAvailable )
+            {
+                OnWorkerListChanged( true );
+            }
+        }
+    }
+
+    // The connection is freed when we return, so wait for any list being sent
+    // to it (from a copy of m_Subscribers) to complete
+    MutexHolder sendLock( m_SendMutex );
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerBrokerageService::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & /*keepMemory*/ )
+{
+    ConstMemoryStream ms( data, size );
+    uint8_t msgType = 0;
+    if ( ms.Read( msgType ) == false )
+    {
+        msgType = 0; // handled as unknown message
+    }
+
+    switch ( msgType )
+    {
+        case MSG_WORKER_STATUS:
+        {
+            WorkerBrokerageInfo info;
+            if ( info.Read( ms ) == false )
+            {
+                break; // Corrupt message
+            }
+
+            // Use the address the worker connected from, unless it's on this
+            // machine and can tell us a more useful one
+            if ( ( connection->GetRemoteAddress() != LOOPBACK_ADDRESS ) || info.m_Address.IsEmpty() )
+            {
+                TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), info.m_Address );
+            }
+
+            MutexHolder mh( m_Mutex );
+            WorkerState * worker = static_cast< WorkerState * >( connection->GetUserData() );
+            bool availabilityChanged;
+            if ( worker == nullptr )
+            {
+                worker = FNEW( WorkerState );
+                worker->m_Connection = connection;
+                connection->SetUserData( worker );
+                m_Workers.Append( worker );
+                availabilityChanged = info.m_Available;
+            }
+            else
+            {
+                availabilityChanged = ( worker->m_Info.m_Available != info.m_Available );
+            }
+            worker->m_Info = info;
+
+            // Workers joining or leaving the pool are sent right away, but
+            // changes in load are throttled
+            OnWorkerListChanged( availabilityChanged );
+            return;
+        }
+        case MSG_SUBSCRIBE:
+        {
+            // Send the current list, ordered with respect to broadcasts
+            MutexHolder sendLock( m_SendMutex );
+            MemoryStream list;
+            {
+                MutexHolder mh( m_Mutex );
+                if ( m_Subscribers.Find( connection ) == nullptr )
+                {
+                    m_Subscribers.Append( connection );
+                }
+                BuildWorkerList( list );
+            }
+            SendWorkerList( connection, list );
+            return;
+        }
+        default:
+        {
+            break; // Unknown message
+        }
+    }
+
+    // Something is wrong with this connection
+    Disconnect( connection );
+}
+
+// BroadcastThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t WorkerBrokerageService::BroadcastThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "BrokerageServiceThread" );
+
+    WorkerBrokerageService * service = static_cast< WorkerBrokerageService * >( param );
+    service->BroadcastThreadFunc();
+    return 0;
+}
+
+// BroadcastThreadFunc
+//------------------------------------------------------------------------------
+void WorkerBrokerageService::BroadcastThreadFunc()
+{
+    while ( m_ShouldExit.Load() == false )
+    {
+        // Wake for changes which are sent right away, and periodically to
+        // send throttled changes
+        m_BroadcastSemaphore.Wait( BROADCAST_INTERVAL_MS );
+        if ( m_ShouldExit.Load() )
+        {
+            break;
+        }
+        BroadcastWorkerList();
+    }
+}
+
+// OnWorkerListChanged
+//------------------------------------------------------------------------------
+void WorkerBrokerageService::OnWorkerListChanged( bool sendNow )
+{
+    // NOTE: m_Mutex must be held
+    m_ListChanged = true;
+    if ( sendNow || ( m_LastBroadcast.GetElapsedMS() >= (float)BROADCAST_INTERVAL_MS ) )
+    {
+        m_SendNow = true;
+        m_BroadcastSemaphore.Signal();
+    }
+}
+
+// SendWorkerList
+//------------------------------------------------------------------------------
+void WorkerBrokerageService::SendWorkerList( const ConnectionInfo * connection, const MemoryStream & list )
+{
+    // NOTE: m_SendMutex must be held, serializing sends to each subscriber
+    Send( connection, list.GetData(), list.GetSize(), BROKERAGE_SERVICE_SEND_TIMEOUT_MS );
+}
+
+// BroadcastWorkerList
+//------------------------------------------------------------------------------
+void WorkerBrokerageService::BroadcastWorkerList()
+{
+    // Lists are sent without holding m_Mutex, so a slow subscriber doesn't hold
+    // up workers. Holding m_SendMutex keeps the subscribers connected until the
+    // sends complete (see OnDisconnected).
+    MutexHolder sendLock( m_SendMutex );
+
+    MemoryStream list;
+    Array< const ConnectionInfo * > subscribers;
+    {
+        MutexHolder mh( m_Mutex );
+        if ( ( m_ListChanged == false ) ||
+             ( ( m_SendNow == false ) && ( m_LastBroadcast.GetElapsedMS() < (float)BROADCAST_INTERVAL_MS ) ) )
+        {
+            return; // Nothing to send yet
+        }
+        m_ListChanged = false;
+        m_SendNow = false;
+        m_LastBroadcast.Start();
+        if ( m_Subscribers.IsEmpty() )
+        {
+            return;
+        }
+
+        BuildWorkerList( list );
+        subscribers = m_Subscribers;
+    }
+
+    for ( const ConnectionInfo * subscriber : subscribers )
+    {
+        SendWorkerList( subscriber, list );
+    }
+}
+
+// BuildWorkerList
+//------------------------------------------------------------------------------
+void WorkerBrokerageService::BuildWorkerList( MemoryStream & outList ) const
+{
+    // NOTE: m_Mutex must be held
+
+    // Gather available workers
+    Array< const WorkerBrokerageInfo * > workers( m_Workers.GetSize() );
+    for ( const WorkerState * worker : m_Workers )
+    {
+        if ( worker->m_Info.m_Available )
+        {
+            workers.Append( &worker->m_Info );
+        }
+    }
+
+    // Most spare capacity first
+    struct SpareCapacityDescending
+    {
+        bool operator () ( const WorkerBrokerageInfo * a, const WorkerBrokerageInfo * b ) const
+        {
+            const float capacityA = a->GetSpareCapacity();
+            const float capacityB = b->GetSpareCapacity();
+            if ( capacityA != capacityB )
+            {
+                return ( capacityA > capacityB );
+            }
+            return ( a->m_FreeMemoryMiB > b->m_FreeMemoryMiB );
+        }
+    };
+    workers.Sort( SpareCapacityDescending() );
+
+    outList.Write( static_cast< uint8_t >( MSG_WORKER_LIST ) );
+    outList.Write( static_cast< uint32_t >( workers.GetSize() ) );
+    for ( const WorkerBrokerageInfo * worker : workers )
+    {
+        worker->Write( outList );
+    }
+}
+
+// CONSTRUCTOR (WorkerBrokerageServiceConnection)
+//------------------------------------------------------------------------------
+WorkerBrokerageServiceConnection::WorkerBrokerageServiceConnection() = default;
+
+// DESTRUCTOR (WorkerBrokerageServiceConnection)
+//------------------------------------------------------------------------------
+WorkerBrokerageServiceConnection::~WorkerBrokerageServiceConnection()
+{
+    ShutdownAllConnections();
+}
+
+// ConnectToService
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServiceConnection::ConnectToService( const AString & serviceAddress, uint32_t timeoutMS )
+{
+    ASSERT( IsConnected() == false );
+
+    AStackString<> host;
+    uint16_t port;
+    WorkerBrokerageService::ParseAddress( serviceAddress, host, port );
+
+    const ConnectionInfo * connection = Connect( host, port, timeoutMS );
+    if ( connection == nullptr )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_Connection = connection;
+    m_HasWorkerList = false;
+    return true;
+}
+
+// IsConnected
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServiceConnection::IsConnected() const
+{
+    MutexHolder mh( m_Mutex );
+    return ( m_Connection != nullptr );
+}
+
+// SendStatus
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServiceConnection::SendStatus( const WorkerBrokerageInfo & info )
+{
+    MemoryStream ms;
+    ms.Write( static_cast< uint8_t >( WorkerBrokerageService::MSG_WORKER_STATUS ) );
+    info.Write( ms );
+
+    MutexHolder mh( m_Mutex );
+    return ( m_Connection && Send( m_Connection, ms.GetData(), ms.GetSize() ) );
+}
+
+// Subscribe
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServiceConnection::Subscribe()
+{
+    const uint8_t msgType = WorkerBrokerageService::MSG_SUBSCRIBE;
+
+    MutexHolder mh( m_Mutex );
+    return ( m_Connection && Send( m_Connection, &msgType, sizeof( msgType ) ) );
+}
+
+// WaitForWorkerList
+//------------------------------------------------------------------------------
+bool WorkerBrokerageServiceConnection::WaitForWorkerList( Array< WorkerBrokerageInfo > & outWorkers, uint32_t timeoutMS )
+{
+    const Timer timer;
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_HasWorkerList )
+            {
+                outWorkers = m_WorkerList;
+                m_HasWorkerList = false;
+                return true;
+            }
+            if ( m_Connection == nullptr )
+            {
+                return false; // Disconnected
+            }
+        }
+
+        const float elapsedMS = timer.GetElapsedMS();
+        if ( elapsedMS >= (float)timeoutMS )
+        {
+            return false; // Timed out
+        }
+        m_WorkerListSemaphore.Wait( timeoutMS - (uint32_t)elapsedMS );
+    }
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerBrokerageServiceConnection::OnDisconnected( const ConnectionInfo * connection )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        ASSERT( ( m_Connection == connection ) || ( m_Connection == nullptr ) ); (void)connection;
+        m_Connection = nullptr;
+    }
+    m_WorkerListSemaphore.Signal(); // Wake anything waiting for a list
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void WorkerBrokerageServiceConnection::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & /*keepMemory*/ )
+{
+    ConstMemoryStream ms( data, size );
+    uint8_t msgType = 0;
+    uint32_t numWorkers = 0;
+    if ( ( ms.Read( msgType ) == false ) ||
+         ( msgType != WorkerBrokerageService::MSG_WORKER_LIST ) ||
+         ( ms.Read( numWorkers ) == false ) ||
+         ( numWorkers > size ) ) // each worker takes more than a byte
+    {
+        Disconnect( connection );
+        return;
+    }
+
+    Array< WorkerBrokerageInfo > workers( numWorkers );
+    for ( uint32_t i = 0; i < numWorkers; ++i )
+    {
+        WorkerBrokerageInfo & info = workers.EmplaceBack();
+        if ( info.Read( ms ) == false )
+        {
+            Disconnect( connection );
+            return;
+        }
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        m_WorkerList = Move( workers );
+        m_HasWorkerList = true;
+    }
+    m_WorkerListSemaphore.Signal();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+// WorkerBrokerageService - Push-based worker discovery
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuild
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ConstMemoryStream;
+class MemoryStream;
+
+// WorkerBrokerageInfo
+//------------------------------------------------------------------------------
+// The state of a worker, as reported to the brokerage service
+class WorkerBrokerageInfo
+{
+public:
+    void        Write( MemoryStream & stream ) const;
+    bool        Read( ConstMemoryStream & stream );
+
+    // CPUs which are free to take work (higher is better)
+    float       GetSpareCapacity() const;
+
+    AString     m_Address;              // The service prefers the address the worker connected from
+    AString     m_HostName;
+    bool        m_Available = false;
+    uint32_t    m_NumCPUs = 0;          // CPUs the worker will use for remote work
+    uint32_t    m_CPUUsagePercent = 0;  // Total CPU usage of the machine
+    uint32_t    m_FreeMemoryMiB = 0;    // 0 if unknown
+};
+
+// WorkerBrokerageService
+//------------------------------------------------------------------------------
+// An alternative to the brokerage share (FASTBUILD_BROKERAGE_PATH), for large
+// worker pools where enumerating the share is slow. Workers connect and push
+// their availability and load as it changes. Clients subscribe and are sent the
+// list of available workers, best first, whenever it changes (at most every
+// BROADCAST_INTERVAL_MS for changes only in load). Lists are sent from a
+// dedicated thread, so a slow subscriber doesn't hold up workers reporting
+// their status.
+//
+// The service is run by FBuildWorker -brokerageservice, and is found via the
+// FASTBUILD_BROKERAGE_SERVICE environment variable (<host>[:<port>]).
+class WorkerBrokerageService : public TCPConnectionPool
+{
+public:
+    WorkerBrokerageService();
+    virtual ~WorkerBrokerageService() override;
+
+    enum : uint16_t { DEFAULT_PORT = Protocol::PROTOCOL_PORT + 2 };
+    enum : uint32_t { BROADCAST_INTERVAL_MS = 1000 };
+
+    enum MessageType : uint8_t
+    {
+        MSG_WORKER_STATUS   = 1, // Service <- Worker : Availability and load
+        MSG_SUBSCRIBE       = 2, // Service <- Client : Send worker list now and when it changes
+        MSG_WORKER_LIST     = 3, // Service -> Client : Available workers, best first
+    };
+
+    bool        Start( uint16_t port );
+
+    size_t      GetNumWorkers() const;
+
+    // Parse <host>[:<port>]
+    static void ParseAddress( const AString & address, AString & outHost, uint16_t & outPort );
+
+private:
+    // TCPConnectionPool interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    static uint32_t BroadcastThreadFuncStatic( void * param );
+    void        BroadcastThreadFunc();
+
+    void        OnWorkerListChanged( bool sendNow );
+    void        SendWorkerList( const ConnectionInfo * connection, const MemoryStream & list );
+    void        BroadcastWorkerList();
+    void        BuildWorkerList( MemoryStream & outList ) const;
+
+    struct WorkerState
+    {
+        const ConnectionInfo *  m_Connection;
+        WorkerBrokerageInfo     m_Info;
+    };
+
+    mutable Mutex                   m_Mutex;
+    Mutex                           m_SendMutex;            // Held while sending lists (taken before m_Mutex)
+    Array< WorkerState * >          m_Workers;
+    Array< const ConnectionInfo * > m_Subscribers;
+    bool                            m_ListChanged = false;  // Changes not yet sent to subscribers
+    bool                            m_SendNow = false;      // Changes which aren't throttled
+    Timer                           m_LastBroadcast;
+    Atomic< bool >                  m_ShouldExit;
+    Semaphore                       m_BroadcastSemaphore;
+    Thread                          m_BroadcastThread;
+};
+
+// WorkerBrokerageServiceConnection
+//------------------------------------------------------------------------------
+// A connection to the brokerage service, for workers and clients
+class WorkerBrokerageServiceConnection : public TCPConnectionPool
+{
+public:
+    WorkerBrokerageServiceConnection();
+    virtual ~WorkerBrokerageServiceConnection() override;
+
+    bool        ConnectToService( const AString & serviceAddress, uint32_t timeoutMS );
+    bool        IsConnected() const;
+
+    // Worker
+    bool        SendStatus( const WorkerBrokerageInfo & info );
+
+    // Client
+    bool        Subscribe();
+    bool        WaitForWorkerList( Array< WorkerBrokerageInfo > & outWorkers, uint32_t timeoutMS );
+
+private:
+    // TCPConnectionPool interface
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+
+    mutable Mutex                   m_Mutex;
+    const ConnectionInfo *          m_Connection = nullptr;
+    Array< WorkerBrokerageInfo >    m_WorkerList;
+    bool                            m_HasWorkerList = false;
+    Semaphore                       m_WorkerListSemaphore;
+};
+
+//------------------------------------------------------------------------------
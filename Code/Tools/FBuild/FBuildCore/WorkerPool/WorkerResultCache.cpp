@@ -0,0 +1,456 @@
+// WorkerResultCache - Worker-side cache of remote job results
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "WorkerResultCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <string.h> // for memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+// Each entry has a header: version, build time, payload size and payload hash
+#define ENTRY_HEADER_SIZE ( sizeof( uint32_t ) + sizeof( uint32_t ) + sizeof( uint64_t ) + sizeof( uint64_t ) )
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+WorkerResultCache::WorkerResultCache( const AString & path, uint64_t memoryLimit, uint64_t diskLimit )
+    : m_Path( path )
+    , m_MemoryLimit( memoryLimit )
+    , m_DiskLimit( diskLimit )
+    , m_MemoryUsed( 0 )
+    , m_DiskUsed( 0 )
+    , m_Entries( 1024 )
+    , m_Building( 64 )
+    , m_NumWaiting( 0 )
+{
+    LoadIndex();
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+WorkerResultCache::~WorkerResultCache()
+{
+    ASSERT( m_NumWaiting == 0 );
+    for ( Entry * entry : m_Entries )
+    {
+        FREE( entry->m_Data );
+        FDELETE entry;
+    }
+}
+
+// GetDefaultPath
+//------------------------------------------------------------------------------
+/*static*/ void WorkerResultCache::GetDefaultPath( AString & outPath )
+{
+    VERIFY( FBuild::GetTempDir( outPath ) );
+    #if defined( __WINDOWS__ )
+        outPath += ".fbuild.tmp\\worker\\resultcache\\";
+    #else
+        outPath += "_fbuild.tmp/worker/resultcache/";
+    #endif
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool WorkerResultCache::Retrieve( const AString & key,
+                                  const Array< AString > & fileNames,
+                                  Array< AString > & outMessages,
+                                  uint32_t & outBuildTimeMS )
+{
+    PROFILE_FUNCTION;
+
+    UniquePtr< void, FreeDeletor > data;
+    uint64_t dataSize = 0;
+    bool inMemory = false;
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+
+            size_t index;
+            Entry * entry = FindEntry( key, index );
+            if ( entry )
+            {
+                // Now the most recently used
+                m_Entries.Erase( m_Entries.Begin() + index );
+                m_Entries.Append( entry );
+
+                // Take a copy, as the entry can be evicted once the lock is released
+                dataSize = entry->m_DataSize;
+                if ( entry->m_Data )
+                {
+                    data = ALLOC( dataSize );
+                    memcpy( data.Get(), entry->m_Data, dataSize );
+                    inMemory = true;
+                }
+                break;
+            }
+
+            if ( m_Building.Find( key ) == nullptr )
+            {
+                // Not seen before - the caller will build it
+                m_Building.Append( key );
+                return false;
+            }
+
+            // A duplicate is being built already
+            ++m_NumWaiting;
+        }
+
+        // Wait for the duplicate to finish (and check again)
+        m_BuildFinished.Wait( WAIT_FOR_DUPLICATE_MS );
+
+        MutexHolder mh( m_Mutex );
+        --m_NumWaiting;
+    }
+
+    // Load from disk if not held in memory
+    bool ok = true;
+    if ( inMemory == false )
+    {
+        AStackString<> fileName;
+        GetEntryFileName( key, fileName );
+        FileStream fs;
+        data = ALLOC( dataSize );
+        ok = ( fs.Open( fileName.Get(), FileStream::READ_ONLY ) &&
+               ( fs.GetFileSize() == dataSize ) &&
+               ( fs.ReadBuffer( data.Get(), dataSize ) == dataSize ) );
+    }
+
+    // Write the files
+    const void * files = nullptr;
+    uint64_t filesSize = 0;
+    if ( ok )
+    {
+        ok = ParseEntry( data.Get(), dataSize, outMessages, outBuildTimeMS, files, filesSize );
+    }
+    if ( ok )
+    {
+        const MultiBuffer mb( files, (size_t)filesSize );
+        for ( size_t i = 0; i < fileNames.GetSize(); ++i )
+        {
+            if ( mb.ExtractFile( i, fileNames[ i ] ) == false )
+            {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    MutexHolder mh( m_Mutex );
+    size_t index;
+    Entry * entry = FindEntry( key, index );
+    if ( ok == false )
+    {
+        // Entry was evicted while being read, or is unusable, so it must be built
+        if ( entry )
+        {
+            RemoveEntry( index );
+        }
+        if ( m_Building.Find( key ) == nullptr )
+        {
+            m_Building.Append( key );
+        }
+        return false;
+    }
+
+    // Keep recently used results in memory
+    if ( entry && ( entry->m_Data == nullptr ) && ( dataSize <= m_MemoryLimit ) )
+    {
+        entry->m_Data = data.ReleaseOwnership();
+        m_MemoryUsed += dataSize;
+        TrimToLimits( entry );
+    }
+    return true;
+}
+
+// Store
+//------------------------------------------------------------------------------
+void WorkerResultCache::Store( const AString & key,
+                               const Array< AString > & fileNames,
+                               const Array< AString > & messages,
+                               uint32_t buildTimeMS )
+{
+    PROFILE_FUNCTION;
+
+    {
+        MutexHolder mh( m_Mutex );
+        size_t index;
+        if ( FindEntry( key, index ) )
+        {
+            FinishBuilding( key ); // Stored by another job in the mean time
+            return;
+        }
+    }
+
+    MultiBuffer mb;
+    if ( mb.CreateFromFiles( fileNames ) == false )
+    {
+        Abandon( key );
+        return;
+    }
+
+    MemoryStream payload;
+    payload.Write( messages );
+    payload.WriteBuffer( mb.GetData(), mb.GetDataSize() );
+
+    MemoryStream entryData( ENTRY_HEADER_SIZE + payload.GetSize() );
+    entryData.Write( static_cast< uint32_t >( ENTRY_VERSION ) );
+    entryData.Write( buildTimeMS );
+    entryData.Write( static_cast< uint64_t >( payload.GetSize() ) );
+    entryData.Write( xxHash3::Calc64( payload.GetData(), payload.GetSize() ) );
+    entryData.WriteBuffer( payload.GetData(), payload.GetSize() );
+    const uint64_t dataSize = entryData.GetSize();
+    if ( dataSize > m_DiskLimit )
+    {
+        Abandon( key ); // Too big to keep
+        return;
+    }
+
+    // Write to disk, so results survive being evicted from memory
+    AStackString<> fileName;
+    GetEntryFileName( key, fileName );
+    FileStream fs;
+    if ( ( FileIO::EnsurePathExistsForFile( fileName ) == false ) ||
+         ( fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( fs.WriteBuffer( entryData.GetData(), dataSize ) != dataSize ) )
+    {
+        if ( fs.IsOpen() )
+        {
+            fs.Close();
+        }
+        FileIO::FileDelete( fileName.Get() );
+        Abandon( key );
+        return;
+    }
+    fs.Close();
+
+    MutexHolder mh( m_Mutex );
+    Entry * entry = FNEW( Entry );
+    entry->m_Key = key;
+    entry->m_Data = nullptr;
+    entry->m_DataSize = dataSize;
+    if ( dataSize <= m_MemoryLimit )
+    {
+        entry->m_Data = entryData.Release();
+        m_MemoryUsed += dataSize;
+    }
+    m_DiskUsed += dataSize;
+    m_Entries.Append( entry );
+    TrimToLimits( entry );
+
+    FinishBuilding( key );
+}
+
+// Abandon
+//------------------------------------------------------------------------------
+void WorkerResultCache::Abandon( const AString & key )
+{
+    MutexHolder mh( m_Mutex );
+    FinishBuilding( key );
+}
+
+// GetNumEntries
+//------------------------------------------------------------------------------
+size_t WorkerResultCache::GetNumEntries() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Entries.GetSize();
+}
+
+// GetMemoryUsed
+//------------------------------------------------------------------------------
+uint64_t WorkerResultCache::GetMemoryUsed() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_MemoryUsed;
+}
+
+// GetDiskUsed
+//------------------------------------------------------------------------------
+uint64_t WorkerResultCache::GetDiskUsed() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_DiskUsed;
+}
+
+// LoadIndex
+//------------------------------------------------------------------------------
+void WorkerResultCache::LoadIndex()
+{
+    // Pick up results from before the worker was restarted
+    Array< FileIO::FileInfo > files;
+    if ( FileIO::GetFilesEx( m_Path, nullptr, false, &files ) == false )
+    {
+        return;
+    }
+
+    // Oldest first (last use is not known, so this is the best approximation)
+    files.Sort( []( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) { return ( a.m_LastWriteTime < b.m_LastWriteTime ); } );
+
+    for ( const FileIO::FileInfo & file : files )
+    {
+        const char * lastSlash = file.m_Name.FindLast( NATIVE_SLASH );
+        Entry * entry = FNEW( Entry );
+        entry->m_Key = lastSlash ? ( lastSlash + 1 ) : file.m_Name.Get();
+        entry->m_Data = nullptr;
+        entry->m_DataSize = file.m_Size;
+        m_DiskUsed += file.m_Size;
+        m_Entries.Append( entry );
+    }
+
+    // Limit may have been reduced since
+    TrimToLimits( nullptr );
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+WorkerResultCache::Entry * WorkerResultCache::FindEntry( const AString & key, size_t & outIndex ) const
+{
+    // NOTE: m_Mutex must be held
+    const size_t numEntries = m_Entries.GetSize();
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        if ( m_Entries[ i ]->m_Key == key )
+        {
+            outIndex = i;
+            return m_Entries[ i ];
+        }
+    }
+    return nullptr;
+}
+
+// RemoveEntry
+//------------------------------------------------------------------------------
+void WorkerResultCache::RemoveEntry( size_t index )
+{
+    // NOTE: m_Mutex must be held
+    Entry * entry = m_Entries[ index ];
+
+    AStackString<> fileName;
+    GetEntryFileName( entry->m_Key, fileName );
+    FileIO::FileDelete( fileName.Get() );
+
+    if ( entry->m_Data )
+    {
+        FREE( entry->m_Data );
+        m_MemoryUsed -= entry->m_DataSize;
+    }
+    m_DiskUsed -= entry->m_DataSize;
+
+    FDELETE entry;
+    m_Entries.Erase( m_Entries.Begin() + index );
+}
+
+// TrimToLimits
+//------------------------------------------------------------------------------
+void WorkerResultCache::TrimToLimits( const Entry * keep )
+{
+    // NOTE: m_Mutex must be held
+
+    // Drop least recently used results from memory, keeping them on disk
+    for ( size_t i = 0; ( m_MemoryUsed > m_MemoryLimit ) && ( i < m_Entries.GetSize() ); ++i )
+    {
+        Entry * entry = m_Entries[ i ];
+        if ( entry->m_Data && ( entry != keep ) )
+        {
+            FREE( entry->m_Data );
+            entry->m_Data = nullptr;
+            m_MemoryUsed -= entry->m_DataSize;
+        }
+    }
+
+    // Remove least recently used results entirely
+    size_t index = 0;
+    while ( ( m_DiskUsed > m_DiskLimit ) && ( index < m_Entries.GetSize() ) )
+    {
+        if ( m_Entries[ index ] == keep )
+        {
+            ++index;
+            continue;
+        }
+        RemoveEntry( index );
+    }
+}
+
+// FinishBuilding
+//------------------------------------------------------------------------------
+void WorkerResultCache::FinishBuilding( const AString & key )
+{
+    // NOTE: m_Mutex must be held
+    m_Building.FindAndErase( key );
+
+    // Wake any duplicates waiting for this result
+    if ( m_NumWaiting > 0 )
+    {
+        m_BuildFinished.Signal( m_NumWaiting );
+    }
+}
+
+// GetEntryFileName
+//------------------------------------------------------------------------------
+void WorkerResultCache::GetEntryFileName( const AString & key, AString & outFileName ) const
+{
+    outFileName = m_Path;
+    outFileName += key;
+}
+
+// ParseEntry
+//------------------------------------------------------------------------------
+/*static*/ bool WorkerResultCache::ParseEntry( const void * data, uint64_t dataSize,
+                                               Array< AString > & outMessages,
+                                               uint32_t & outBuildTimeMS,
+                                               const void * & outFiles,
+                                               uint64_t & outFilesSize )
+{
+    ConstMemoryStream ms( data, (size_t)dataSize );
+    uint32_t version = 0;
+    uint64_t payloadSize = 0;
+    uint64_t payloadHash = 0;
+    if ( ( ms.Read( version ) == false ) ||
+         ( version != ENTRY_VERSION ) ||
+         ( ms.Read( outBuildTimeMS ) == false ) ||
+         ( ms.Read( payloadSize ) == false ) ||
+         ( ms.Read( payloadHash ) == false ) ||
+         ( payloadSize != ( dataSize - ENTRY_HEADER_SIZE ) ) )
+    {
+        return false; // Old version or incomplete
+    }
+
+    // Results from disk may have been corrupted
+    const char * payload = ( static_cast< const char * >( data ) + ENTRY_HEADER_SIZE );
+    if ( xxHash3::Calc64( payload, (size_t)payloadSize ) != payloadHash )
+    {
+        return false;
+    }
+
+    if ( ms.Read( outMessages ) == false )
+    {
+        return false;
+    }
+
+    outFiles = ( static_cast< const char * >( data ) + ms.Tell() );
+    outFilesSize = ( dataSize - ms.Tell() );
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+// WorkerResultCache - Worker-side cache of remote job results
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Strings/AString.h"
+
+// WorkerResultCache
+//------------------------------------------------------------------------------
+// Many clients often send the worker the same job (same preprocessed source,
+// args and toolchain). The output files and messages of each successful job
+// are kept, so duplicates can be answered without running the compiler.
+//
+// Results are written to disk and the most recently used are also kept in
+// memory. Both are bounded, with the least recently used results evicted first.
+//
+// A job arriving while a duplicate is being built waits for that build to
+// complete instead of building it again.
+class WorkerResultCache
+{
+public:
+    explicit WorkerResultCache( const AString & path, uint64_t memoryLimit, uint64_t diskLimit );
+    ~WorkerResultCache();
+
+    enum : uint64_t { DEFAULT_MEMORY_LIMIT = ( 256 * 1024 * 1024 ) };
+    enum : uint64_t { DEFAULT_DISK_LIMIT = ( 2048ULL * 1024 * 1024 ) };
+
+    static void GetDefaultPath( AString & outPath );
+
+    // Write the files and get the messages for a previous result. On a miss, the
+    // caller must build the job and then call either Store or Abandon.
+    bool Retrieve( const AString & key,
+                   const Array< AString > & fileNames,
+                   Array< AString > & outMessages,
+                   uint32_t & outBuildTimeMS );
+
+    // Keep the result of a successful build
+    void Store( const AString & key,
+                const Array< AString > & fileNames,
+                const Array< AString > & messages,
+                uint32_t buildTimeMS );
+
+    // The build failed, so there is nothing to keep
+    void Abandon( const AString & key );
+
+    // Stats
+    size_t      GetNumEntries() const;
+    uint64_t    GetMemoryUsed() const;
+    uint64_t    GetDiskUsed() const;
+
+private:
+    enum : uint32_t { ENTRY_VERSION = 1 };
+    enum : uint32_t { WAIT_FOR_DUPLICATE_MS = 100 };
+
+    struct Entry
+    {
+        AString     m_Key;
+        void *      m_Data;         // Only when held in memory
+        uint64_t    m_DataSize;
+    };
+
+    void        LoadIndex();
+    Entry *     FindEntry( const AString & key, size_t & outIndex ) const;
+    void        RemoveEntry( size_t index );
+    void        TrimToLimits( const Entry * keep );
+    void        FinishBuilding( const AString & key );
+    void        GetEntryFileName( const AString & key, AString & outFileName ) const;
+    static bool ParseEntry( const void * data, uint64_t dataSize,
+                            Array< AString > & outMessages,
+                            uint32_t & outBuildTimeMS,
+                            const void * & outFiles,
+                            uint64_t & outFilesSize );
+
+    mutable Mutex       m_Mutex;
+    AString             m_Path;
+    uint64_t            m_MemoryLimit;
+    uint64_t            m_DiskLimit;
+    uint64_t            m_MemoryUsed;
+    uint64_t            m_DiskUsed;
+    Array< Entry * >    m_Entries;      // Least recently used first
+    Array< AString >    m_Building;     // Keys of jobs being built
+    uint32_t            m_NumWaiting;
+    Semaphore           m_BuildFinished;
+};
+
+//------------------------------------------------------------------------------
@@ -13,6 +13,7 @@
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/PathUtils.h"
@@ -20,11 +21,22 @@
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 
+// system
+#if defined( __LINUX__ )
+    #include <linux/magic.h>
+    #include <sys/vfs.h>
+    #include <unistd.h>
+#endif
+
 // Static
 //------------------------------------------------------------------------------
 static THREAD_LOCAL uint16_t s_WorkerThreadThreadIndex = 0;
+static THREAD_LOCAL Arena * s_WorkerThreadArena = nullptr;
+static THREAD_LOCAL bool s_WorkerThreadUseMemoryBackedTmpDir = false;
 Mutex WorkerThread::s_TmpRootMutex;
 AStackString<> WorkerThread::s_TmpRoot;
+AStackString<> WorkerThread::s_MemoryBackedTmpRoot;
+bool WorkerThread::s_MemoryBackedTmpDirEnabled = false;
 
 //------------------------------------------------------------------------------
 WorkerThread::WorkerThread( uint16_t threadIndex )
@@ -57,6 +69,33 @@ WorkerThread::~WorkerThread()
 
     AStackString<> tmpDirPath;
     VERIFY( FBuild::GetTempDir( tmpDirPath ) );
+    AppendTmpDirSuffix( remote, tmpDirPath );
+    VERIFY( FileIO::EnsurePathExists( tmpDirPath ) );
+
+    // Files for remote jobs (preprocessed source in, objects out) are short
+    // lived, so keep them in memory rather than on disk if enabled
+    AStackString<> memoryBackedTmpDirPath;
+    if ( remote && s_MemoryBackedTmpDirEnabled && GetMemoryBackedTempDir( memoryBackedTmpDirPath ) )
+    {
+        AppendTmpDirSuffix( remote, memoryBackedTmpDirPath );
+        if ( FileIO::EnsurePathExists( memoryBackedTmpDirPath ) == false )
+        {
+            memoryBackedTmpDirPath.Clear();
+        }
+    }
+
+    MutexHolder lock( s_TmpRootMutex );
+    s_TmpRoot = tmpDirPath;
+    if ( remote )
+    {
+        s_MemoryBackedTmpRoot = memoryBackedTmpDirPath;
+    }
+}
+
+// AppendTmpDirSuffix
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::AppendTmpDirSuffix( bool remote, AString & tmpDirPath )
+{
     #if defined( __WINDOWS__ )
         tmpDirPath += ".fbuild.tmp\\";
     #else
@@ -67,11 +106,99 @@ WorkerThread::~WorkerThread()
     const uint32_t workingDirHash = remote ? 0 : FBuild::Get().GetOptions().GetWorkingDirHash();
     tmpDirPath.AppendFormat( "0x%08x", workingDirHash );
     tmpDirPath += NATIVE_SLASH;
+}
 
-    VERIFY( FileIO::EnsurePathExists( tmpDirPath ) );
+// SetMemoryBackedTempDirEnabled
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::SetMemoryBackedTempDirEnabled( bool enabled )
+{
+    // Takes effect when the remote tmp dir is next initialized
+    MutexHolder lock( s_TmpRootMutex );
+    s_MemoryBackedTmpDirEnabled = enabled;
+}
 
+// SetMemoryBackedTempDirForTests
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::SetMemoryBackedTempDirForTests( const AString & path )
+{
     MutexHolder lock( s_TmpRootMutex );
-    s_TmpRoot = tmpDirPath;
+    s_MemoryBackedTmpRoot = path;
+}
+
+// UseMemoryBackedTempDirForJob
+//------------------------------------------------------------------------------
+/*static*/ bool WorkerThread::UseMemoryBackedTempDirForJob( uint64_t requiredSpace )
+{
+    s_WorkerThreadUseMemoryBackedTmpDir = false;
+
+    AStackString<> memoryBackedTmpRoot;
+    {
+        MutexHolder lock( s_TmpRootMutex );
+        memoryBackedTmpRoot = s_MemoryBackedTmpRoot;
+    }
+    if ( memoryBackedTmpRoot.IsEmpty() )
+    {
+        return false; // Not enabled or not available
+    }
+
+    // tmpfs mounts can be small (Docker defaults /dev/shm to 64MiB) so only
+    // use it when the job fits
+    #if defined( __LINUX__ )
+        struct statfs info;
+        if ( ( statfs( memoryBackedTmpRoot.Get(), &info ) != 0 ) ||
+             ( ( (uint64_t)info.f_bavail * (uint64_t)info.f_bsize ) < requiredSpace ) )
+        {
+            return false;
+        }
+    #else
+        (void)requiredSpace;
+    #endif
+
+    s_WorkerThreadUseMemoryBackedTmpDir = true;
+    return true;
+}
+
+// UseDiskTempDirForJob
+//------------------------------------------------------------------------------
+/*static*/ void WorkerThread::UseDiskTempDirForJob()
+{
+    s_WorkerThreadUseMemoryBackedTmpDir = false;
+}
+
+// IsUsingMemoryBackedTempDir
+//------------------------------------------------------------------------------
+/*static*/ bool WorkerThread::IsUsingMemoryBackedTempDir()
+{
+    return s_WorkerThreadUseMemoryBackedTmpDir;
+}
+
+// GetMemoryBackedTempDir
+//------------------------------------------------------------------------------
+/*static*/ bool WorkerThread::GetMemoryBackedTempDir( AString & outTempDir )
+{
+    #if defined( __LINUX__ )
+        // An explicitly specified temp dir is always respected
+        AStackString<> envTempDir;
+        if ( Env::GetEnvVariable( "FASTBUILD_TEMP_PATH", envTempDir ) )
+        {
+            return false;
+        }
+
+        // Use /dev/shm if it's a writable tmpfs
+        const char * const shmPath = "/dev/shm/";
+        struct statfs info;
+        if ( ( statfs( shmPath, &info ) != 0 ) ||
+             ( info.f_type != TMPFS_MAGIC ) ||
+             ( access( shmPath, W_OK ) != 0 ) )
+        {
+            return false;
+        }
+        outTempDir = shmPath;
+        return true;
+    #else
+        (void)outTempDir;
+        return false; // Not supported
+    #endif
 }
 
 // Stop
@@ -103,14 +230,25 @@ void WorkerThread::WaitForStop()
     return s_WorkerThreadThreadIndex;
 }
 
+// GetArena
+//------------------------------------------------------------------------------
+/*static*/ Arena * WorkerThread::GetArena()
+{
+    return s_WorkerThreadArena;
+}
+
 // MainWrapper
 //------------------------------------------------------------------------------
 /*static*/ void WorkerThread::ThreadWrapperFunc( void * param )
 {
     WorkerThread * wt = static_cast< WorkerThread * >( param );
     s_WorkerThreadThreadIndex = wt->m_ThreadIndex;
+    s_WorkerThreadArena = &wt->m_Arena;
 
     wt->Main();
+
+    // Thread may be re-used by the ThreadPool after the WorkerThread is destroyed
+    s_WorkerThreadArena = nullptr;
 }
 
 // Main
@@ -132,6 +270,17 @@ void WorkerThread::WaitForStop()
         }
 
         Update();
+
+        // Workers are signalled once each when new jobs are queued, not once
+        // per job, so consume all locally available jobs before waiting again
+        while ( JobQueue::Get().HasJobsToProcess() )
+        {
+            if ( m_ShouldExit.Load() || FBuild::GetStopBuild() )
+            {
+                break;
+            }
+            Update();
+        }
     }
 
     m_Exited.Store( true );
@@ -180,7 +329,7 @@ void WorkerThread::WaitForStop()
     // no local job, see if we can do one from the remote queue
     if ( FBuild::Get().GetOptions().m_NoLocalConsumptionOfRemoteJobs == false )
     {
-        job = JobQueue::IsValid() ? JobQueue::Get().GetDistributableJobToProcess( false ) : nullptr;
+        job = JobQueue::IsValid() ? JobQueue::Get().GetDistributableJobToProcess( false, false ) : nullptr;
         if ( job != nullptr )
         {
             // process the work
@@ -234,8 +383,9 @@ void WorkerThread::WaitForStop()
     const uint32_t threadIndex = WorkerThread::GetThreadIndex();
 
     MutexHolder lock( s_TmpRootMutex );
-    ASSERT( !s_TmpRoot.IsEmpty() );
-    tmpFileDirectory.Format( "%score_%u%c", s_TmpRoot.Get(), threadIndex, NATIVE_SLASH );
+    const AString & tmpRoot = ( s_WorkerThreadUseMemoryBackedTmpDir && !s_MemoryBackedTmpRoot.IsEmpty() ) ? s_MemoryBackedTmpRoot : s_TmpRoot;
+    ASSERT( !tmpRoot.IsEmpty() );
+    tmpFileDirectory.Format( "%score_%u%c", tmpRoot.Get(), threadIndex, NATIVE_SLASH );
 }
 
 // CreateTempFile
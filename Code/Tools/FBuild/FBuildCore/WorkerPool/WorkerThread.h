@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
+#include "Core/Mem/Arena.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Mutex.h"
 #include "Core/Process/Semaphore.h"
@@ -33,6 +34,11 @@ public:
 
     static uint16_t GetThreadIndex();
 
+    // Arena for allocations which don't outlive the job being built (nullptr if
+    // not called from a worker thread)
+    static Arena * GetArena();
+    enum : size_t { ARENA_MAX_RETAINED_SIZE = ( 4 * MEGABYTE ) }; // Trimmed to this after each job
+
     static void GetTempFileDirectory( AString & tmpFileDirectory );
 
     static void CreateTempFilePath( const char * fileName,
@@ -40,6 +46,13 @@ public:
     static bool CreateTempFile( const AString & tmpFileName,
                                 FileStream & file );
     static void CreateThreadLocalTmpDir();
+
+    // Remote job files can be kept in a memory backed temp dir (tmpfs) on Linux (opt-in)
+    static void SetMemoryBackedTempDirEnabled( bool enabled );
+    static bool UseMemoryBackedTempDirForJob( uint64_t requiredSpace ); // false if unavailable or too full
+    static void UseDiskTempDirForJob();
+    static bool IsUsingMemoryBackedTempDir();
+    static void SetMemoryBackedTempDirForTests( const AString & path );
 protected:
     // allow update from the main thread when in -j0 mode
     friend class FBuild;
@@ -54,9 +67,15 @@ protected:
     Atomic<bool>  m_Exited;
     uint16_t      m_ThreadIndex;
     Semaphore     m_MainThreadWaitForExit; // Used by main thread to wait for exit of worker
+    Arena         m_Arena;
+
+    static void AppendTmpDirSuffix( bool remote, AString & tmpDirPath );
+    static bool GetMemoryBackedTempDir( AString & outTempDir );
 
     static Mutex s_TmpRootMutex; // s_TmpRoot is shared by local and remote queues in tests
     static AStackString<> s_TmpRoot;
+    static AStackString<> s_MemoryBackedTmpRoot; // Empty if not in use
+    static bool s_MemoryBackedTmpDirEnabled;
 };
 
 //------------------------------------------------------------------------------
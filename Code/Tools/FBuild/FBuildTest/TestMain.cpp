@@ -17,6 +17,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestBuildFBuild )
     REGISTER_TESTGROUP( TestCache )
     REGISTER_TESTGROUP( TestCachePlugin )
+    REGISTER_TESTGROUP( TestChunkCache )
     REGISTER_TESTGROUP( TestCompilationDatabase )
     REGISTER_TESTGROUP( TestCompiler )
     REGISTER_TESTGROUP( TestCompressor )
@@ -32,6 +33,7 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestGraph )
     REGISTER_TESTGROUP( TestIf )
     REGISTER_TESTGROUP( TestIncludeParser )
+    REGISTER_TESTGROUP( TestJobQueue )
     REGISTER_TESTGROUP( TestLibrary )
     REGISTER_TESTGROUP( TestLinker )
     REGISTER_TESTGROUP( TestListDependencies )
@@ -43,10 +45,14 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestRemoveDir )
     REGISTER_TESTGROUP( TestTest )
     REGISTER_TESTGROUP( TestTextFile )
+    REGISTER_TESTGROUP( TestToolFileStore )
     REGISTER_TESTGROUP( TestUnity )
     REGISTER_TESTGROUP( TestUserFunctions )
     REGISTER_TESTGROUP( TestVariableStack )
     REGISTER_TESTGROUP( TestWarnings )
+    REGISTER_TESTGROUP( TestWorkerBrokerageService )
+    REGISTER_TESTGROUP( TestWorkerResultCache )
+    REGISTER_TESTGROUP( TestWorkerStats )
 
     // Windows-specific tests
     #if defined( __WINDOWS__ )
@@ -57,6 +63,16 @@ int main( int, char *[] )
         REGISTER_TESTGROUP( TestZW )
     #endif
 
+    // Linux-specific tests
+    #if defined( __LINUX__ )
+        REGISTER_TESTGROUP( TestFileWatcher )
+    #endif
+
+    // Linux/OSX-specific tests
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TESTGROUP( TestCompilerServer )
+    #endif
+
     TestManager utm;
 
     const bool allPassed = utm.RunTests();
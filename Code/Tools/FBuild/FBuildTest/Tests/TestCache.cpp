@@ -6,16 +6,26 @@
 #include "FBuildTest.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheDictionaries.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
+#include <memory.h>
+
 // TestCache
 //------------------------------------------------------------------------------
 class TestCache : public FBuildTest
@@ -27,6 +37,8 @@ private:
     void Read() const;
     void ReadWrite() const;
     void ConsistentCacheKeysWithDist() const;
+    void Packed() const;
+    void Dictionaries() const;
 
     void LightCache_IncludeUsingMacro() const;
     void LightCache_IncludeUsingMacro2() const;
@@ -40,6 +52,7 @@ private:
     void LightCache_ForceInclude() const;
     void LightCache_SourceDependencies() const;
     void LightCache_ResponseFile() const;
+    void LightCache_Store() const;
 
     // MSVC Static Analysis tests
     const char* const mAnalyzeMSVCBFFPath = "Tools/FBuild/FBuildTest/Data/TestCache/Analyze_MSVC/fbuild.bff";
@@ -71,7 +84,10 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
     REGISTER_TEST( ConsistentCacheKeysWithDist )
+    REGISTER_TEST( Packed )
+    REGISTER_TEST( Dictionaries )
     REGISTER_TEST( ExtraFiles_GCNO )
+    REGISTER_TEST( LightCache_Store )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ExtraFiles_NativeCodeAnalysisXML )
         REGISTER_TEST( LightCache_IncludeUsingMacro )
@@ -338,6 +354,218 @@ void TestCache::ConsistentCacheKeysWithDist() const
     TEST_ASSERT( storeKey == hitKey );
 }
 
+// Packed
+//------------------------------------------------------------------------------
+void TestCache::Packed() const
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheRead = true;
+    options.m_UseCacheWrite = true;
+    options.m_CacheTrim = 0; // Remove everything
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Packed/fbuild.bff";
+
+    // Start with an empty cache
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+    }
+
+    // Write
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == 0 );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+    }
+
+    // Read
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+    }
+
+    // Info
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheOutputInfo() );
+    }
+
+    // Trim
+    {
+        const size_t outputSizeBefore = GetRecordedOutput().GetLength();
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+
+        const char * searchStart = GetRecordedOutput().Get() + outputSizeBefore;
+        TEST_ASSERT( GetRecordedOutput().Find( " - Before: 2 Entries", searchStart ) );
+        TEST_ASSERT( GetRecordedOutput().Find( " - After: 0 Entries", searchStart ) );
+    }
+
+    // Trimmed entries are not retrieved
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == 0 );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+    }
+}
+
+// Dictionaries
+//------------------------------------------------------------------------------
+void TestCache::Dictionaries() const
+{
+    // A cache in memory, from which entries can be removed
+    class MemoryCache : public ICache
+    {
+    public:
+        virtual ~MemoryCache() override
+        {
+            for ( Entry * entry : m_Entries )
+            {
+                FDELETE entry;
+            }
+        }
+        virtual bool Init( const AString &, const AString &, bool, bool, bool, const AString & ) override { return true; }
+        virtual void Shutdown() override {}
+        virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override
+        {
+            Entry * entry = Find( cacheId );
+            if ( entry == nullptr )
+            {
+                entry = FNEW( Entry );
+                entry->m_CacheId = cacheId;
+                m_Entries.Append( entry );
+            }
+            entry->m_Data.Reset();
+            entry->m_Data.WriteBuffer( data, dataSize );
+            ++m_NumPublished;
+            return true;
+        }
+        virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override
+        {
+            const Entry * entry = Find( cacheId );
+            if ( entry == nullptr )
+            {
+                return false;
+            }
+            dataSize = entry->m_Data.GetSize();
+            data = ALLOC( dataSize );
+            memcpy( data, entry->m_Data.GetData(), dataSize );
+            return true;
+        }
+        virtual void FreeMemory( void * data, size_t /*dataSize*/ ) override { FREE( data ); }
+        virtual bool OutputInfo( bool ) override { return true; }
+        virtual bool Trim( bool, uint32_t ) override { return true; }
+
+        bool Remove( const AString & cacheId )
+        {
+            Entry * entry = Find( cacheId );
+            if ( entry == nullptr )
+            {
+                return false;
+            }
+            m_Entries.FindAndErase( entry );
+            FDELETE entry;
+            return true;
+        }
+        bool Exists( const AString & cacheId ) const { return ( Find( cacheId ) != nullptr ); }
+
+        size_t m_NumPublished = 0;
+
+    private:
+        struct Entry
+        {
+            AString         m_CacheId;
+            MemoryStream    m_Data;
+        };
+        Entry * Find( const AString & cacheId ) const
+        {
+            for ( Entry * entry : m_Entries )
+            {
+                if ( entry->m_CacheId == cacheId )
+                {
+                    return entry;
+                }
+            }
+            return nullptr;
+        }
+        Array< Entry * > m_Entries;
+    };
+
+    // Data to train with
+    UniquePtr< char, FreeDeletor > data;
+    size_t dataSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        dataSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        TEST_ASSERT( (uint32_t)fs.Read( data.Get(), dataSize ) == dataSize );
+    }
+    const size_t sampleSize = ( 16 * 1024 );
+    TEST_ASSERT( ( sampleSize * CacheDictionaries::NUM_SAMPLES_TO_TRAIN ) < dataSize );
+
+    MemoryCache cache;
+    const uint64_t toolId = 0x1234;
+    uint64_t dictionaryId = 0;
+
+    // A dictionary is trained from the first entries and stored
+    {
+        CacheDictionaries dictionaries( cache );
+        TEST_ASSERT( dictionaries.GetDictionary( toolId ) == nullptr );
+        for ( size_t i = 0; i < CacheDictionaries::NUM_SAMPLES_TO_TRAIN; ++i )
+        {
+            dictionaries.AddSample( toolId, data.Get() + ( i * sampleSize ), sampleSize );
+        }
+        const CompressionDictionary * dictionary = dictionaries.GetDictionary( toolId );
+        TEST_ASSERT( dictionary );
+        dictionaryId = dictionary->GetId();
+
+        // It was just stored, so storing entries doesn't store it again
+        const size_t numPublished = cache.m_NumPublished;
+        dictionaries.OnEntryStored( toolId, *dictionary );
+        TEST_ASSERT( cache.m_NumPublished == numPublished );
+    }
+
+    // Trimming removes the dictionary (but not the toolchain's copy)
+    AStackString<> dictionaryCacheId;
+    CacheDictionaries::GetDictionaryCacheId( dictionaryId, dictionaryCacheId );
+    TEST_ASSERT( cache.Remove( dictionaryCacheId ) );
+
+    // Entries using it can't be decompressed, until an entry using it is stored
+    {
+        CacheDictionaries dictionaries( cache );
+        TEST_ASSERT( dictionaries.FindDictionary( dictionaryId ) == nullptr );
+
+        const CompressionDictionary * dictionary = dictionaries.GetDictionary( toolId );
+        TEST_ASSERT( dictionary && ( dictionary->GetId() == dictionaryId ) );
+        dictionaries.OnEntryStored( toolId, *dictionary );
+        TEST_ASSERT( cache.Exists( dictionaryCacheId ) );
+    }
+
+    // Entries using it can be decompressed again
+    {
+        CacheDictionaries dictionaries( cache );
+        TEST_ASSERT( dictionaries.FindDictionary( dictionaryId ) );
+    }
+}
+
 // LightCache_IncludeUsingMacro
 //------------------------------------------------------------------------------
 void TestCache::LightCache_IncludeUsingMacro() const
@@ -912,6 +1140,86 @@ void TestCache::LightCache_ResponseFile() const
     TEST_ASSERT( deps[ 1 ].GetNode()->GetName().EndsWith( "include.h") );
 }
 
+// LightCache_Store
+//------------------------------------------------------------------------------
+void TestCache::LightCache_Store() const
+{
+    // The LightCache is only supported for MSVC, but storing results is not
+    // compiler specific, so the files are hashed directly.
+    AStackString<> path;
+    VERIFY( FileIO::GetCurrentDir( path ) );
+    path += NATIVE_SLASH;
+    path += "../tmp/Test/Cache/LightCache_Store/";
+    NodeGraph::CleanPath( path ); // the LightCache works with full paths
+    AStackString<> sourceFile( path );
+    sourceFile += "file.cpp";
+    AStackString<> headerFile( path );
+    headerFile += "header.h";
+    AStackString<> otherFile( path );
+    otherFile += "other.h";
+    AStackString<> args( "-I" );
+    args += path;
+
+    TEST_ASSERT( FileIO::EnsurePathExistsForFile( sourceFile ) );
+    MakeFile( sourceFile.Get(), "#include \"header.h\"\n" );
+
+    // Use an empty store, keeping results out of the real (machine-wide) one
+    AStackString<> storePath( path );
+    storePath += "store";
+    AStackString<> storeFile( storePath );
+    storeFile += NATIVE_SLASH;
+    storeFile += "LightCache.fdb";
+    FileIO::FileDelete( storeFile.Get() );
+    LightCache::SetStorePathForTests( storePath );
+    MakeFile( headerFile.Get(), "#pragma once\n" );
+    MakeFile( otherFile.Get(), "#pragma once\n" );
+
+    // Hash, storing parse results for the next build
+    uint64_t hash1 = 0;
+    {
+        LightCache::ClearCachedFiles();
+        LightCache lc;
+        StackArray< AString > includes;
+        TEST_ASSERT( lc.Hash( sourceFile, args, hash1, includes ) );
+        TEST_ASSERT( includes.GetSize() == 2 );
+        TEST_ASSERT( lc.GetNumFilesFromStore() == 0 );
+        LightCache::SaveCachedFiles();
+    }
+
+    // Stored results are used and are equivalent to parsing the files again
+    {
+        LightCache::ClearCachedFiles();
+        LightCache lc;
+        uint64_t hash2 = 0;
+        StackArray< AString > includes;
+        TEST_ASSERT( lc.Hash( sourceFile, args, hash2, includes ) );
+        TEST_ASSERT( lc.GetNumFilesFromStore() == 2 );
+        TEST_ASSERT( hash2 == hash1 );
+        TEST_ASSERT( includes.GetSize() == 2 );
+        TEST_ASSERT( includes[ 1 ].EndsWith( "header.h" ) );
+        LightCache::SaveCachedFiles();
+    }
+
+    // Modify the header (changing the size, so it's detected regardless of
+    // file time resolution)
+    MakeFile( headerFile.Get(), "#pragma once\n#include \"other.h\"\n" );
+
+    // Stored results for the header must not be used
+    {
+        LightCache::ClearCachedFiles();
+        LightCache lc;
+        uint64_t hash3 = 0;
+        StackArray< AString > includes;
+        TEST_ASSERT( lc.Hash( sourceFile, args, hash3, includes ) );
+        TEST_ASSERT( lc.GetNumFilesFromStore() == 1 ); // file.cpp
+        TEST_ASSERT( hash3 != hash1 );
+        TEST_ASSERT( includes.GetSize() == 3 );
+        TEST_ASSERT( includes[ 2 ].EndsWith( "other.h" ) );
+    }
+    LightCache::ClearCachedFiles();
+    LightCache::SetStorePathForTests( AString::GetEmpty() );
+}
+
 // Analyze_MSVC_WarningsOnly_Write
 //------------------------------------------------------------------------------
 void TestCache::Analyze_MSVC_WarningsOnly_Write() const
@@ -0,0 +1,351 @@
+// TestChunkCache.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/ChunkCache.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Random.h"
+#include "Core/Mem/Mem.h"
+
+#include <memory.h>
+
+// TestChunkCache
+//------------------------------------------------------------------------------
+class TestChunkCache : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void FindChunks() const;
+    void RoundTrip() const;
+    void SharedContent() const;
+    void Eviction() const;
+    void OutOfSync() const;
+    void SharedStore() const;
+    void StoreEviction() const;
+
+    static size_t SendHelper( ChunkCache & sender, ChunkCache & receiver, ChunkStore & store, const void * data, size_t dataSize, bool includeGeneration = true );
+    static bool TrySend( ChunkCache & sender, ChunkCache & receiver, ChunkStore & store, const void * data, size_t dataSize );
+    static void FillRandom( Random & r, uint32_t * buffer, size_t bufferSize );
+    static void LoadHelper( const char * fileName, MemoryStream & outData );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestChunkCache )
+    REGISTER_TEST( FindChunks )
+    REGISTER_TEST( RoundTrip )
+    REGISTER_TEST( SharedContent )
+    REGISTER_TEST( Eviction )
+    REGISTER_TEST( OutOfSync )
+    REGISTER_TEST( SharedStore )
+    REGISTER_TEST( StoreEviction )
+REGISTER_TESTS_END
+
+// FindChunks
+//------------------------------------------------------------------------------
+void TestChunkCache::FindChunks() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    Array< uint32_t > chunkSizes;
+    ChunkCache::FindChunks( data.GetData(), data.GetSize(), chunkSizes );
+    TEST_ASSERT( chunkSizes.GetSize() > 1 );
+
+    // Chunks cover the data and respect the size limits
+    size_t total = 0;
+    for ( size_t i = 0; i < chunkSizes.GetSize(); ++i )
+    {
+        TEST_ASSERT( chunkSizes[ i ] <= ChunkCache::MAX_CHUNK_SIZE );
+        if ( i < ( chunkSizes.GetSize() - 1 ) )
+        {
+            TEST_ASSERT( chunkSizes[ i ] > ChunkCache::MIN_CHUNK_SIZE );
+        }
+        total += chunkSizes[ i ];
+    }
+    TEST_ASSERT( total == data.GetSize() );
+
+    // Boundaries depend on content, so are found again after an insertion
+    MemoryStream shifted;
+    shifted.WriteBuffer( "// Some inserted text\n", 22 );
+    shifted.WriteBuffer( data.GetData(), data.GetSize() );
+    Array< uint32_t > shiftedChunkSizes;
+    ChunkCache::FindChunks( shifted.GetData(), shifted.GetSize(), shiftedChunkSizes );
+    TEST_ASSERT( shiftedChunkSizes.GetSize() == chunkSizes.GetSize() );
+    TEST_ASSERT( shiftedChunkSizes[ 0 ] == ( chunkSizes[ 0 ] + 22 ) );
+    for ( size_t i = 1; i < chunkSizes.GetSize(); ++i )
+    {
+        TEST_ASSERT( shiftedChunkSizes[ i ] == chunkSizes[ i ] );
+    }
+
+    // Empty data has no chunks
+    Array< uint32_t > emptyChunkSizes;
+    ChunkCache::FindChunks( nullptr, 0, emptyChunkSizes );
+    TEST_ASSERT( emptyChunkSizes.IsEmpty() );
+}
+
+// RoundTrip
+//------------------------------------------------------------------------------
+void TestChunkCache::RoundTrip() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    ChunkCache sender( false );
+    ChunkCache receiver( false );
+    ChunkStore store;
+
+    // First send includes everything
+    const size_t firstSize = SendHelper( sender, receiver, store, data.GetData(), data.GetSize() );
+
+    // Second send only references chunks
+    const size_t secondSize = SendHelper( sender, receiver, store, data.GetData(), data.GetSize() );
+    TEST_ASSERT( ( secondSize * 10 ) < firstSize );
+
+    // Both sides agree
+    TEST_ASSERT( sender.GetNumChunks() == receiver.GetNumChunks() );
+    TEST_ASSERT( sender.GetTotalSize() == receiver.GetTotalSize() );
+    TEST_ASSERT( sender.GetTotalSize() == store.GetTotalSize() );
+    TEST_ASSERT( sender.GetTotalSize() <= data.GetSize() );
+
+    // Small and empty data
+    SendHelper( sender, receiver, store, "A", 1 );
+    SendHelper( sender, receiver, store, nullptr, 0 );
+
+    // Older peers don't send generations
+    ChunkCache oldSender( false );
+    ChunkCache oldReceiver( false );
+    SendHelper( oldSender, oldReceiver, store, data.GetData(), data.GetSize(), false );
+    const size_t oldSecondSize = SendHelper( oldSender, oldReceiver, store, data.GetData(), data.GetSize(), false );
+    TEST_ASSERT( oldSecondSize == ( secondSize - sizeof( uint32_t ) ) );
+}
+
+// SharedContent
+//------------------------------------------------------------------------------
+void TestChunkCache::SharedContent() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    ChunkCache sender( false );
+    ChunkCache receiver( false );
+    ChunkStore store;
+    SendHelper( sender, receiver, store, data.GetData(), data.GetSize() );
+
+    // A different translation unit with mostly the same content
+    MemoryStream other;
+    const size_t half = ( data.GetSize() / 2 );
+    other.WriteBuffer( "// Different file\n", 18 );
+    other.WriteBuffer( data.GetData(), half );
+    other.WriteBuffer( "int Function() { return 1; }\n", 29 );
+    other.WriteBuffer( static_cast< const char * >( data.GetData() ) + half, data.GetSize() - half );
+
+    // Only the changed regions are sent
+    const size_t otherSize = SendHelper( sender, receiver, store, other.GetData(), other.GetSize() );
+    TEST_ASSERT( ( otherSize * 4 ) < other.GetSize() );
+}
+
+// Eviction
+//------------------------------------------------------------------------------
+void TestChunkCache::Eviction() const
+{
+    ChunkCache sender( false );
+    ChunkCache receiver( false );
+    ChunkStore store;
+
+    // Send more unique data than the cache can hold
+    const size_t bufferSize = ( 4 * 1024 * 1024 );
+    const size_t numBuffers = ( ( ChunkCache::CAPACITY / bufferSize ) + 2 );
+    UniquePtr< uint32_t, FreeDeletor > first( static_cast< uint32_t * >( ALLOC( bufferSize ) ) );
+    UniquePtr< uint32_t, FreeDeletor > buffer( static_cast< uint32_t * >( ALLOC( bufferSize ) ) );
+    Random r( 1234 );
+    for ( size_t i = 0; i < numBuffers; ++i )
+    {
+        FillRandom( r, buffer.Get(), bufferSize );
+        if ( i == 0 )
+        {
+            memcpy( first.Get(), buffer.Get(), bufferSize );
+        }
+        SendHelper( sender, receiver, store, buffer.Get(), bufferSize );
+
+        TEST_ASSERT( receiver.GetTotalSize() <= ChunkCache::CAPACITY );
+        TEST_ASSERT( sender.GetNumChunks() == receiver.GetNumChunks() );
+        TEST_ASSERT( sender.GetTotalSize() == receiver.GetTotalSize() );
+    }
+
+    // The first buffer was evicted so must be sent again in full
+    const size_t resendSize = SendHelper( sender, receiver, store, first.Get(), bufferSize );
+    TEST_ASSERT( resendSize > bufferSize );
+
+    // The most recent buffer is still held
+    const size_t lastSize = SendHelper( sender, receiver, store, buffer.Get(), bufferSize );
+    TEST_ASSERT( ( lastSize * 10 ) < bufferSize );
+}
+
+// OutOfSync
+//------------------------------------------------------------------------------
+void TestChunkCache::OutOfSync() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    ChunkCache sender( false );
+    ChunkCache receiver( false );
+    ChunkStore store;
+    MemoryStream encoded;
+    sender.Encode( data.GetData(), data.GetSize(), -1, true, encoded );
+
+    // A receiver which missed the first encoding can't decode the second
+    MemoryStream encoded2;
+    sender.Encode( data.GetData(), data.GetSize(), -1, true, encoded2 );
+    void * decoded = nullptr;
+    size_t decodedSize = 0;
+    TEST_ASSERT( receiver.Decode( encoded2.GetData(), encoded2.GetSize(), store, true, decoded, decodedSize ) == false );
+
+    // Nothing more is accepted from that generation, even if it could be decoded
+    MemoryStream encoded3;
+    sender.Encode( "A", 1, -1, true, encoded3 );
+    TEST_ASSERT( receiver.Decode( encoded3.GetData(), encoded3.GetSize(), store, true, decoded, decodedSize ) == false );
+
+    // Until the sender starts a new one
+    sender.Clear();
+    SendHelper( sender, receiver, store, data.GetData(), data.GetSize() );
+    TEST_ASSERT( receiver.GetGeneration() == sender.GetGeneration() );
+
+    // Truncated data is rejected
+    ChunkCache receiver2( false );
+    TEST_ASSERT( receiver2.Decode( encoded.GetData(), encoded.GetSize() - 1, store, true, decoded, decodedSize ) == false );
+    ChunkCache receiver3( false );
+    TEST_ASSERT( receiver3.Decode( encoded.GetData(), 4, store, true, decoded, decodedSize ) == false );
+}
+
+// SharedStore
+//------------------------------------------------------------------------------
+void TestChunkCache::SharedStore() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    // Two connections to the same receiver
+    ChunkStore store;
+    ChunkCache senderA( false );
+    ChunkCache receiverA( false );
+    ChunkCache senderB( false );
+    ChunkCache receiverB( false );
+
+    // Content received on both is only stored once
+    SendHelper( senderA, receiverA, store, data.GetData(), data.GetSize() );
+    const uint64_t storeSize = store.GetTotalSize();
+    SendHelper( senderB, receiverB, store, data.GetData(), data.GetSize() );
+    TEST_ASSERT( store.GetTotalSize() == storeSize );
+
+    // Each connection still tracks its own chunks
+    TEST_ASSERT( receiverA.GetTotalSize() == storeSize );
+    TEST_ASSERT( receiverB.GetTotalSize() == storeSize );
+}
+
+// StoreEviction
+//------------------------------------------------------------------------------
+void TestChunkCache::StoreEviction() const
+{
+    MemoryStream data;
+    LoadHelper( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", data );
+
+    // A store smaller than a single connection's cache
+    const uint64_t capacity = ( 4 * 1024 * 1024 );
+    ChunkStore store( capacity );
+    ChunkCache senderA( false );
+    ChunkCache receiverA( false );
+    ChunkCache senderB( false );
+    ChunkCache receiverB( false );
+    const size_t firstSize = SendHelper( senderA, receiverA, store, data.GetData(), data.GetSize() );
+
+    // Unique data from another connection fills the store
+    const size_t bufferSize = ( 1024 * 1024 );
+    UniquePtr< uint32_t, FreeDeletor > buffer( static_cast< uint32_t * >( ALLOC( bufferSize ) ) );
+    Random r( 1234 );
+    for ( size_t i = 0; i < 6; ++i )
+    {
+        FillRandom( r, buffer.Get(), bufferSize );
+        SendHelper( senderB, receiverB, store, buffer.Get(), bufferSize );
+        TEST_ASSERT( store.GetTotalSize() <= capacity );
+    }
+
+    // The first connection's chunks were evicted, so its data can't be decoded
+    TEST_ASSERT( TrySend( senderA, receiverA, store, data.GetData(), data.GetSize() ) == false );
+
+    // Once the sender starts a new generation, everything is sent again
+    senderA.Clear();
+    const size_t resendSize = SendHelper( senderA, receiverA, store, data.GetData(), data.GetSize() );
+    TEST_ASSERT( resendSize == firstSize );
+
+    // The other connection's most recent chunks are still held
+    const size_t lastSize = SendHelper( senderB, receiverB, store, buffer.Get(), bufferSize );
+    TEST_ASSERT( ( lastSize * 10 ) < bufferSize );
+}
+
+// SendHelper
+//------------------------------------------------------------------------------
+/*static*/ size_t TestChunkCache::SendHelper( ChunkCache & sender, ChunkCache & receiver, ChunkStore & store, const void * data, size_t dataSize, bool includeGeneration )
+{
+    MemoryStream encoded;
+    sender.Encode( data, dataSize, -1, includeGeneration, encoded );
+
+    void * decoded = nullptr;
+    size_t decodedSize = 0;
+    TEST_ASSERT( receiver.Decode( encoded.GetData(), encoded.GetSize(), store, includeGeneration, decoded, decodedSize ) );
+    TEST_ASSERT( decodedSize == dataSize );
+    TEST_ASSERT( ( dataSize == 0 ) || ( memcmp( decoded, data, dataSize ) == 0 ) );
+    FREE( decoded );
+
+    return encoded.GetSize();
+}
+
+// TrySend
+//------------------------------------------------------------------------------
+/*static*/ bool TestChunkCache::TrySend( ChunkCache & sender, ChunkCache & receiver, ChunkStore & store, const void * data, size_t dataSize )
+{
+    MemoryStream encoded;
+    sender.Encode( data, dataSize, -1, true, encoded );
+
+    void * decoded = nullptr;
+    size_t decodedSize = 0;
+    if ( receiver.Decode( encoded.GetData(), encoded.GetSize(), store, true, decoded, decodedSize ) == false )
+    {
+        return false;
+    }
+    FREE( decoded );
+    return true;
+}
+
+// FillRandom
+//------------------------------------------------------------------------------
+/*static*/ void TestChunkCache::FillRandom( Random & r, uint32_t * buffer, size_t bufferSize )
+{
+    for ( size_t i = 0; i < ( bufferSize / sizeof( uint32_t ) ); ++i )
+    {
+        buffer[ i ] = ( r.GetRand() << 16 ) ^ r.GetRand();
+    }
+}
+
+// LoadHelper
+//------------------------------------------------------------------------------
+/*static*/ void TestChunkCache::LoadHelper( const char * fileName, MemoryStream & outData )
+{
+    FileStream fs;
+    TEST_ASSERT( fs.Open( fileName ) );
+    const size_t dataSize = (size_t)fs.GetFileSize();
+    UniquePtr< void, FreeDeletor > data( ALLOC( dataSize ) );
+    TEST_ASSERT( fs.ReadBuffer( data.Get(), dataSize ) == dataSize );
+    outData.WriteBuffer( data.Get(), dataSize );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,197 @@
+// TestCompilerServer.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompilerServers.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/Strings/AStackString.h"
+
+// TestCompilerServer
+//------------------------------------------------------------------------------
+class TestCompilerServer : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    // Tests
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        void Served() const;
+        void Fallback() const;
+        void Hung() const;
+
+        // Helpers
+        void MakeStandIns() const;
+        uint32_t GetNumServed() const;
+    #endif
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestCompilerServer )
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TEST( Served )
+        REGISTER_TEST( Fallback )
+        REGISTER_TEST( Hung )
+    #endif
+REGISTER_TESTS_END
+
+#if defined( __LINUX__ ) || defined( __OSX__ )
+
+// Defines
+//------------------------------------------------------------------------------
+#define CONFIG_FILE "Tools/FBuild/FBuildTest/Data/TestCompilerServer/fbuild.bff"
+#define OUT_DIR "../tmp/Test/CompilerServer/"
+
+// Served
+//------------------------------------------------------------------------------
+void TestCompilerServer::Served() const
+{
+    MakeStandIns();
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = CONFIG_FILE;
+    options.m_ForceCleanBuild = true;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    TEST_ASSERT( fBuild.Build( "Served" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::COMPILER_NODE );
+    CheckStatsNode ( 3,     3,      Node::OBJECT_NODE );
+
+    // All objects were compiled by the server
+    TEST_ASSERT( GetNumServed() == 3 );
+    AString output;
+    LoadFileContentsAsString( OUT_DIR "Served/b.out", output );
+    TEST_ASSERT( output == "b\n" );
+}
+
+// Fallback
+//------------------------------------------------------------------------------
+void TestCompilerServer::Fallback() const
+{
+    MakeStandIns();
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = CONFIG_FILE;
+    options.m_ForceCleanBuild = true;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // Server fails to start, so compiler is spawned instead
+    TEST_ASSERT( fBuild.Build( "Fallback" ) );
+    TEST_ASSERT( GetNumServed() == 0 );
+    TEST_ASSERT( GetRecordedOutput().Find( "did not start correctly" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::COMPILER_NODE );
+    CheckStatsNode ( 3,     3,      Node::OBJECT_NODE );
+
+    AString output;
+    LoadFileContentsAsString( OUT_DIR "Fallback/c.out", output );
+    TEST_ASSERT( output == "c\n" );
+}
+
+// Hung
+//------------------------------------------------------------------------------
+void TestCompilerServer::Hung() const
+{
+    MakeStandIns();
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = CONFIG_FILE;
+    options.m_ForceCleanBuild = true;
+    options.m_NumWorkerThreads = 1;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // Server never responds, so is killed and compiler is spawned instead
+    CompilerServers::SetResponseTimeoutForTests( 500 );
+    const bool built = fBuild.Build( "Hung" );
+    CompilerServers::SetResponseTimeoutForTests( 0 );
+    TEST_ASSERT( built );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::COMPILER_NODE );
+    CheckStatsNode ( 3,     3,      Node::OBJECT_NODE );
+
+    // Only the first compilation waited for the server
+    AString log( GetRecordedOutput() );
+    TEST_ASSERT( log.Replace( "did not respond", "" ) == 1 );
+
+    AString output;
+    LoadFileContentsAsString( OUT_DIR "Hung/a.out", output );
+    TEST_ASSERT( output == "a\n" );
+}
+
+// MakeStandIns
+//------------------------------------------------------------------------------
+void TestCompilerServer::MakeStandIns() const
+{
+    EnsureDirExists( OUT_DIR );
+    FileIO::FileDelete( OUT_DIR "served.log" );
+
+    // Compiles by copying input to output. Spawned with no args, the same
+    // script handles requests as a server, recording each one.
+    const char * const compiler = OUT_DIR "compiler.sh";
+    MakeFile( compiler,
+              "#!/bin/sh\n"
+              "if [ $# -gt 0 ]; then\n"
+              "    cp \"$1\" \"$2\"\n"
+              "    exit $?\n"
+              "fi\n"
+              "printf 'FASTBuild-CompilerServer 1\\n'\n"
+              "while read -r request && read -r exe && read -r dir && read -r args; do\n"
+              "    eval \"set -- $args\"\n"
+              "    cp \"$1\" \"$2\"\n"
+              "    result=$?\n"
+              "    echo \"$2\" >> \"$(dirname \"$0\")/served.log\"\n"
+              "    printf 'result %d 0 0\\n' $result\n"
+              "done\n" );
+
+    // Exits without identifying itself as a server
+    const char * const broken = OUT_DIR "broken.sh";
+    MakeFile( broken,
+              "#!/bin/sh\n"
+              "exit 1\n" );
+
+    // Identifies itself as a server, but never responds to requests
+    const char * const hung = OUT_DIR "hung.sh";
+    MakeFile( hung,
+              "#!/bin/sh\n"
+              "printf 'FASTBuild-CompilerServer 1\\n'\n"
+              "read -r request\n"
+              "sleep 60\n" );
+
+    TEST_ASSERT( FileIO::SetExecutable( compiler ) );
+    TEST_ASSERT( FileIO::SetExecutable( broken ) );
+    TEST_ASSERT( FileIO::SetExecutable( hung ) );
+}
+
+// GetNumServed
+//------------------------------------------------------------------------------
+uint32_t TestCompilerServer::GetNumServed() const
+{
+    if ( FileIO::FileExists( OUT_DIR "served.log" ) == false )
+    {
+        return 0;
+    }
+    AString log;
+    LoadFileContentsAsString( OUT_DIR "served.log", log );
+    return log.Replace( "\n", "" );
+}
+#endif
+
+//------------------------------------------------------------------------------
@@ -5,11 +5,15 @@
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
@@ -27,6 +31,9 @@ private:
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
     void TestHeaderValidity() const;
+    void DecompressStream() const;
+    void CompressedBlocks() const;
+    void CompressWithDictionary() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
@@ -34,6 +41,9 @@ private:
                                bool shouldCompress,
                                bool useZstd = false ) const;
     void CompressHelper( const char * fileName ) const;
+    void DecompressStreamHelper( const void * data, size_t dataSize, bool useZstd ) const;
+    static void ReadBlocksHelper( const Array< AString > & fileNames, uint32_t blockSize, int32_t compressionLevel, bool allowZstdUse, MemoryStream & outBlocks );
+    static bool ExtractBlocksHelper( const MemoryStream & blocks, const Array< AString > & fileNames, size_t numBlocksToUse );
 };
 
 // Register Tests
@@ -43,6 +53,9 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
     REGISTER_TEST( TestHeaderValidity )
+    REGISTER_TEST( DecompressStream )
+    REGISTER_TEST( CompressedBlocks )
+    REGISTER_TEST( CompressWithDictionary )
 REGISTER_TESTS_END
 
 // CompressSimple
@@ -287,4 +300,298 @@ void TestCompressor::TestHeaderValidity() const
     TEST_ASSERT( Compressor::IsValidData( buffer.Get(), 44 ) == false );
 }
 
+// DecompressStream
+//------------------------------------------------------------------------------
+void TestCompressor::DecompressStream() const
+{
+    UniquePtr< void, FreeDeletor > data;
+    size_t dataSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        dataSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        TEST_ASSERT( (uint32_t)fs.Read( data.Get(), dataSize ) == dataSize );
+    }
+
+    DecompressStreamHelper( data.Get(), dataSize, false );
+    DecompressStreamHelper( data.Get(), dataSize, true );
+
+    // Uncompressed data is passed through
+    DecompressStreamHelper( "A", 1, false );
+}
+
+// DecompressStreamHelper
+//------------------------------------------------------------------------------
+void TestCompressor::DecompressStreamHelper( const void * data, size_t dataSize, bool useZstd ) const
+{
+    Compressor c;
+    if ( useZstd )
+    {
+        c.CompressZstd( data, dataSize );
+    }
+    else
+    {
+        c.Compress( data, dataSize );
+    }
+
+    // Read in pieces of various sizes
+    UniquePtr< char, FreeDeletor > result( (char *)ALLOC( dataSize ) );
+    {
+        ConstMemoryStream input( c.GetResult(), c.GetResultSize() );
+        DecompressionStream stream( input, c.GetResultSize() );
+        TEST_ASSERT( stream.Open() );
+        TEST_ASSERT( stream.GetUncompressedSize() == dataSize );
+        size_t pos = 0;
+        size_t pieceSize = 1;
+        while ( pos < dataSize )
+        {
+            const size_t size = Math::Min( pieceSize, dataSize - pos );
+            TEST_ASSERT( stream.Read( result.Get() + pos, size ) );
+            pos += size;
+            pieceSize = ( pieceSize * 7 ) + 3;
+        }
+        TEST_ASSERT( stream.Read( result.Get(), 1 ) == false ); // Can't read past the end
+        TEST_ASSERT( stream.Finish() );
+        TEST_ASSERT( memcmp( data, result.Get(), dataSize ) == 0 );
+    }
+
+    // Truncated data is invalid
+    {
+        const size_t truncatedSize = ( c.GetResultSize() - 1 );
+        ConstMemoryStream input( c.GetResult(), truncatedSize );
+        DecompressionStream stream( input, truncatedSize );
+        TEST_ASSERT( ( stream.Open() && stream.Read( result.Get(), dataSize ) && stream.Finish() ) == false );
+    }
+}
+
+// CompressedBlocks
+//------------------------------------------------------------------------------
+void TestCompressor::CompressedBlocks() const
+{
+    // Create an empty file to include along with a file spanning several blocks
+    const char * const outPath = "../tmp/Test/Compressor/CompressedBlocks/";
+    EnsureDirExists( outPath );
+    const char * const emptyFile = "../tmp/Test/Compressor/CompressedBlocks/Empty.dat";
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( emptyFile, FileStream::WRITE_ONLY ) );
+    }
+    Array< AString > srcFiles;
+    srcFiles.EmplaceBack( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" );
+    srcFiles.EmplaceBack( emptyFile );
+    srcFiles.EmplaceBack( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" );
+
+    Array< AString > dstFiles;
+    dstFiles.EmplaceBack( "../tmp/Test/Compressor/CompressedBlocks/Out0.dat" );
+    dstFiles.EmplaceBack( "../tmp/Test/Compressor/CompressedBlocks/Out1.dat" );
+    dstFiles.EmplaceBack( "../tmp/Test/Compressor/CompressedBlocks/Out2.dat" );
+
+    const uint32_t blockSize = ( 64 * 1024 );
+    const bool useZstd[] = { false, true };
+    for ( const bool zstd : useZstd )
+    {
+        MemoryStream blocks;
+        ReadBlocksHelper( srcFiles, blockSize, -1, zstd, blocks );
+
+        // Extract block by block and check the files are reproduced
+        TEST_ASSERT( ExtractBlocksHelper( blocks, dstFiles, 0xFFFFFFFF ) );
+        for ( size_t i = 0; i < srcFiles.GetSize(); ++i )
+        {
+            FileStream src;
+            FileStream dst;
+            TEST_ASSERT( src.Open( srcFiles[ i ].Get() ) );
+            TEST_ASSERT( dst.Open( dstFiles[ i ].Get() ) );
+            const size_t size = (size_t)src.GetFileSize();
+            TEST_ASSERT( dst.GetFileSize() == size );
+            UniquePtr< char, FreeDeletor > srcData( (char *)ALLOC( size + 1 ) );
+            UniquePtr< char, FreeDeletor > dstData( (char *)ALLOC( size + 1 ) );
+            TEST_ASSERT( src.ReadBuffer( srcData.Get(), size ) == size );
+            TEST_ASSERT( dst.ReadBuffer( dstData.Get(), size ) == size );
+            TEST_ASSERT( memcmp( srcData.Get(), dstData.Get(), size ) == 0 );
+            if ( i == 0 )
+            {
+                TEST_ASSERT( size > ( blockSize * 2 ) ); // Check test is valid
+            }
+        }
+
+        // Extracting only some of the files is ok
+        Array< AString > firstFile;
+        firstFile.Append( dstFiles[ 0 ] );
+        TEST_ASSERT( ExtractBlocksHelper( blocks, firstFile, 0xFFFFFFFF ) );
+
+        // Missing blocks are detected
+        TEST_ASSERT( ExtractBlocksHelper( blocks, dstFiles, 3 ) == false );
+
+        // Expecting more files than there are is invalid
+        Array< AString > tooManyFiles( dstFiles );
+        tooManyFiles.EmplaceBack( "../tmp/Test/Compressor/CompressedBlocks/Out3.dat" );
+        TEST_ASSERT( ExtractBlocksHelper( blocks, tooManyFiles, 0xFFFFFFFF ) == false );
+    }
+
+    // Uncompressed blocks
+    {
+        MemoryStream blocks;
+        ReadBlocksHelper( srcFiles, blockSize, 0, true, blocks );
+        TEST_ASSERT( ExtractBlocksHelper( blocks, dstFiles, 0xFFFFFFFF ) );
+    }
+
+    // Missing files are reported
+    {
+        Array< AString > missingFiles( srcFiles );
+        missingFiles[ 1 ] = "../tmp/Test/Compressor/CompressedBlocks/Missing.dat";
+        MultiBufferBlockReader reader( blockSize, -1, false );
+        size_t problemFileIndex = 0;
+        TEST_ASSERT( reader.Open( missingFiles, &problemFileIndex ) == false );
+        TEST_ASSERT( problemFileIndex == 1 );
+    }
+}
+
+// ReadBlocksHelper
+//------------------------------------------------------------------------------
+/*static*/ void TestCompressor::ReadBlocksHelper( const Array< AString > & fileNames,
+                                                  uint32_t blockSize,
+                                                  int32_t compressionLevel,
+                                                  bool allowZstdUse,
+                                                  MemoryStream & outBlocks )
+{
+    // Read each block, and keep it preceded by its size
+    MultiBufferBlockReader reader( blockSize, compressionLevel, allowZstdUse );
+    TEST_ASSERT( reader.Open( fileNames ) );
+    TEST_ASSERT( reader.GetNumBlocks() > 2 );
+    for ( uint32_t i = 0; i < reader.GetNumBlocks(); ++i )
+    {
+        Compressor c;
+        TEST_ASSERT( reader.ReadBlock( c ) );
+        outBlocks.Write( (uint32_t)c.GetResultSize() );
+        outBlocks.WriteBuffer( c.GetResult(), c.GetResultSize() );
+    }
+}
+
+// ExtractBlocksHelper
+//------------------------------------------------------------------------------
+/*static*/ bool TestCompressor::ExtractBlocksHelper( const MemoryStream & blocks, const Array< AString > & fileNames, size_t numBlocksToUse )
+{
+    MultiBufferExtractor extractor( fileNames );
+    ConstMemoryStream input( blocks.GetData(), blocks.GetSize() );
+    for ( size_t i = 0; ( i < numBlocksToUse ) && ( input.Tell() < input.GetSize() ); ++i )
+    {
+        uint32_t blockSize = 0;
+        TEST_ASSERT( input.Read( blockSize ) );
+        const char * block = static_cast< const char * >( input.GetData() ) + input.Tell();
+        TEST_ASSERT( Compressor::IsValidData( block, blockSize ) );
+        TEST_ASSERT( input.Seek( input.Tell() + blockSize ) );
+
+        // Write the decompressed block in pieces of various sizes
+        Compressor c;
+        TEST_ASSERT( c.Decompress( block ) );
+        const char * data = static_cast< const char * >( c.GetResult() );
+        const size_t dataSize = c.GetResultSize();
+        size_t pos = 0;
+        size_t pieceSize = 1;
+        while ( pos < dataSize )
+        {
+            const size_t size = Math::Min( pieceSize, dataSize - pos );
+            if ( extractor.Write( data + pos, size ) == false )
+            {
+                return false;
+            }
+            pos += size;
+            pieceSize = ( pieceSize * 7 ) + 3;
+        }
+    }
+    return extractor.Finish();
+}
+
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    UniquePtr< void, FreeDeletor > data;
+    size_t dataSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        dataSize = (size_t)fs.GetFileSize();
+        data = (char *)ALLOC( dataSize );
+        TEST_ASSERT( (uint32_t)fs.Read( data.Get(), dataSize ) == dataSize );
+    }
+
+    // Train from pieces of the first half of the file
+    const size_t sampleSize = ( 16 * 1024 );
+    Array< uint32_t > sampleSizes;
+    for ( size_t i = 0; i < 32; ++i )
+    {
+        sampleSizes.Append( (uint32_t)sampleSize );
+    }
+    TEST_ASSERT( ( sampleSize * sampleSizes.GetSize() ) < ( dataSize / 2 ) );
+    MemoryStream dictionaryData;
+    TEST_ASSERT( CompressionDictionary::Train( data.Get(), sampleSizes, CompressionDictionary::DEFAULT_MAX_SIZE, dictionaryData ) );
+    TEST_ASSERT( dictionaryData.GetSize() <= CompressionDictionary::DEFAULT_MAX_SIZE );
+    const CompressionDictionary dictionary( dictionaryData.GetData(), dictionaryData.GetSize() );
+
+    // Provides the one dictionary
+    class Provider : public ICompressionDictionaryProvider
+    {
+    public:
+        explicit Provider( const CompressionDictionary * dictionary ) : m_Dictionary( dictionary ) {}
+        virtual const CompressionDictionary * FindDictionary( uint64_t dictionaryId ) override
+        {
+            return ( dictionaryId == m_Dictionary->GetId() ) ? m_Dictionary : nullptr;
+        }
+        const CompressionDictionary * m_Dictionary;
+    };
+    Provider provider( &dictionary );
+
+    // Compress a small piece from the end, which should benefit
+    const size_t pieceSize = ( 8 * 1024 );
+    const char * piece = ( static_cast< const char * >( data.Get() ) + dataSize - pieceSize );
+    Compressor withoutDictionary;
+    TEST_ASSERT( withoutDictionary.CompressZstd( piece, pieceSize, 3 ) );
+    Compressor withDictionary;
+    TEST_ASSERT( withDictionary.CompressZstd( piece, pieceSize, 3, &dictionary ) );
+    TEST_ASSERT( Compressor::IsValidData( withDictionary.GetResult(), withDictionary.GetResultSize() ) );
+    TEST_ASSERT( withDictionary.GetResultSize() < withoutDictionary.GetResultSize() );
+    OUTPUT( "Zstd (8 KiB)   : %u bytes without dictionary, %u with\n", (uint32_t)withoutDictionary.GetResultSize(), (uint32_t)withDictionary.GetResultSize() );
+
+    // Decompress
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult(), &provider ) );
+        TEST_ASSERT( d.GetResultSize() == pieceSize );
+        TEST_ASSERT( memcmp( d.GetResult(), piece, pieceSize ) == 0 );
+    }
+    {
+        ConstMemoryStream input( withDictionary.GetResult(), withDictionary.GetResultSize() );
+        DecompressionStream stream( input, withDictionary.GetResultSize(), nullptr, &provider );
+        UniquePtr< char, FreeDeletor > result( (char *)ALLOC( pieceSize ) );
+        TEST_ASSERT( stream.Open() );
+        TEST_ASSERT( stream.IsDictionaryMissing() == false );
+        TEST_ASSERT( stream.Read( result.Get(), pieceSize ) );
+        TEST_ASSERT( stream.Finish() );
+        TEST_ASSERT( memcmp( result.Get(), piece, pieceSize ) == 0 );
+    }
+
+    // Can't decompress without the dictionary
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult() ) == false );
+        const CompressionDictionary otherDictionary( piece, pieceSize );
+        Provider otherProvider( &otherDictionary );
+        TEST_ASSERT( d.Decompress( withDictionary.GetResult(), &otherProvider ) == false );
+    }
+    {
+        ConstMemoryStream input( withDictionary.GetResult(), withDictionary.GetResultSize() );
+        DecompressionStream stream( input, withDictionary.GetResultSize() );
+        TEST_ASSERT( stream.Open() == false );
+        TEST_ASSERT( stream.IsDictionaryMissing() );
+    }
+
+    // Not enough to train from
+    sampleSizes.SetSize( 1 );
+    sampleSizes[ 0 ] = 100;
+    MemoryStream tooSmall;
+    TEST_ASSERT( CompressionDictionary::Train( data.Get(), sampleSizes, CompressionDictionary::DEFAULT_MAX_SIZE, tooSmall ) == false );
+}
+
 //------------------------------------------------------------------------------
@@ -35,8 +35,11 @@ REGISTER_TESTS_END
 //------------------------------------------------------------------------------
 void TestDirectoryList::Build() const
 {
-    FBuild fb;
-    NodeGraph ng;
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/Empty/fbuild.bff";
+    FBuildForTest fb( options );
+    TEST_ASSERT( fb.Initialize() );
+    NodeGraph & ng = fb.GetDependencyGraph();
 
     // Generate a valid DirectoryListNode name
     AStackString<> name;
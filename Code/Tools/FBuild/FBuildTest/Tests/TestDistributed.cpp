@@ -6,14 +6,25 @@
 #include "Tools/FBuild/FBuildTest/Tests/FBuildTest.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
 
 // Defines
 //------------------------------------------------------------------------------
@@ -43,6 +54,11 @@ private:
     void WarningsAreCorrectlyReported_MSVC() const;
     void WarningsAreCorrectlyReported_Clang() const;
     void ShutdownMemoryLeak() const;
+    void JobRequestCredits() const;
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        void ToolFilesBatched() const;
+    #endif
+    void MemoryBackedTempDirFallback() const;
     void TestForceInclude() const;
     void TestZiDebugFormat() const;
     void TestZiDebugFormat_Local() const;
@@ -69,6 +85,11 @@ REGISTER_TESTS_BEGIN( TestDistributed )
     #endif
     REGISTER_TEST( AnonymousNamespaces )
     REGISTER_TEST( ShutdownMemoryLeak )
+    REGISTER_TEST( JobRequestCredits )
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TEST( ToolFilesBatched )
+    #endif
+    REGISTER_TEST( MemoryBackedTempDirFallback )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ErrorsAreCorrectlyReported_MSVC ) // TODO:B Enable for OSX and Linux
         REGISTER_TEST( ErrorsAreCorrectlyReported_Clang ) // TODO:B Enable for OSX and Linux
@@ -420,6 +441,341 @@ void TestDistributed::ShutdownMemoryLeak() const
     TEST_ASSERT( detectedDistributedJobs );
 }
 
+// JobRequestCredits
+//------------------------------------------------------------------------------
+void TestDistributed::JobRequestCredits() const
+{
+    // Emulate a build machine with plenty of jobs, recording the jobs requested
+    // by the worker without answering the requests
+    class TestClient : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestClient() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t, bool & ) override
+        {
+            if ( m_ExpectingPayload )
+            {
+                m_ExpectingPayload = false;
+                return;
+            }
+            const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+            m_ExpectingPayload = msg->HasPayload();
+            switch ( msg->GetType() )
+            {
+                case Protocol::MSG_CONNECTION_ACK:  m_Acked.Store( true ); break;
+                case Protocol::MSG_REQUEST_JOB:     m_NumJobsRequested.Increment(); break;
+                case Protocol::MSG_REQUEST_JOBS:    m_NumJobsRequested.Add( static_cast< const Protocol::MsgRequestJobs * >( msg )->GetNumJobs() ); break;
+                default:                            break;
+            }
+        }
+        Atomic< bool >      m_Acked { false };
+        Atomic< uint32_t >  m_NumJobsRequested { 0 };
+        bool                m_ExpectingPayload = false;
+    };
+
+    // Hold off requesting jobs until all clients are connected
+    const uint32_t originalNumCPUsToUse = WorkerThreadRemote::GetNumCPUsToUse();
+    WorkerThreadRemote::SetNumCPUsToUse( 0 );
+
+    Server s( 1 );
+    TEST_ASSERT( s.Listen( Protocol::PROTOCOL_TEST_PORT ) );
+
+    TestClient clients[ 2 ];
+    const ConnectionInfo * connections[ 2 ];
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        connections[ i ] = clients[ i ].Connect( AStackString<>( "127.0.0.1" ), Protocol::PROTOCOL_TEST_PORT );
+        TEST_ASSERT( connections[ i ] );
+        const Protocol::MsgConnection msg( 100 );
+        TEST_ASSERT( msg.Send( connections[ i ] ) );
+        const Timer t;
+        while ( clients[ i ].m_Acked.Load() == false )
+        {
+            TEST_ASSERT( t.GetElapsedMS() < 10000.0f );
+            Thread::Sleep( 1 );
+        }
+    }
+
+    // Credit is limited to the jobs the worker can queue, and shared between the clients
+    // (all credit granted to a client at once arrives in a single message, so a share
+    // larger than expected is seen as soon as it arrives)
+    const uint32_t numCPUs = 3;
+    const uint32_t maxJobs = ( numCPUs * 2 ); // building one job and one queued per CPU
+    WorkerThreadRemote::SetNumCPUsToUse( numCPUs );
+    const Timer t;
+    while ( ( clients[ 0 ].m_NumJobsRequested.Load() < ( maxJobs / 2 ) ) ||
+            ( clients[ 1 ].m_NumJobsRequested.Load() < ( maxJobs / 2 ) ) )
+    {
+        TEST_ASSERT( t.GetElapsedMS() < 10000.0f );
+        Thread::Sleep( 1 );
+    }
+    TEST_ASSERT( clients[ 0 ].m_NumJobsRequested.Load() == ( maxJobs / 2 ) );
+    TEST_ASSERT( clients[ 1 ].m_NumJobsRequested.Load() == ( maxJobs / 2 ) );
+
+    // Credit returned by a client can be used again, but the limit is not exceeded
+    const Protocol::MsgNoJobAvailable noJobMsg;
+    TEST_ASSERT( noJobMsg.Send( connections[ 0 ] ) );
+    while ( ( clients[ 0 ].m_NumJobsRequested.Load() + clients[ 1 ].m_NumJobsRequested.Load() ) < ( maxJobs + 1 ) )
+    {
+        TEST_ASSERT( t.GetElapsedMS() < 10000.0f );
+        Thread::Sleep( 1 );
+    }
+    TEST_ASSERT( ( clients[ 0 ].m_NumJobsRequested.Load() + clients[ 1 ].m_NumJobsRequested.Load() ) == ( maxJobs + 1 ) );
+
+    WorkerThreadRemote::SetNumCPUsToUse( originalNumCPUsToUse );
+}
+
+// ToolFilesBatched
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ ) || defined( __OSX__ )
+void TestDistributed::ToolFilesBatched() const
+{
+    // Emulate a worker which needs the whole toolchain, requesting all the files
+    // at once and recording how they are sent
+    class TestWorker : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestWorker() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & ) override
+        {
+            if ( m_PayloadType != Protocol::NUM_MESSAGES )
+            {
+                const Protocol::MessageType payloadType = m_PayloadType;
+                m_PayloadType = Protocol::NUM_MESSAGES;
+                ConstMemoryStream ms( data, size );
+                switch ( payloadType )
+                {
+                    case Protocol::MSG_MANIFEST:    OnManifest( connection, ms ); break;
+                    case Protocol::MSG_FILES:       OnFiles( ms ); break;
+                    default:                        break;
+                }
+                return;
+            }
+            const Protocol::IMessage * msg = static_cast< const Protocol::IMessage * >( data );
+            if ( msg->HasPayload() )
+            {
+                m_PayloadType = msg->GetType();
+            }
+            switch ( msg->GetType() )
+            {
+                case Protocol::MSG_CONNECTION:
+                {
+                    const Protocol::MsgConnectionAck ack;
+                    ack.Send( connection );
+                    const Protocol::MsgRequestJob request;
+                    request.Send( connection );
+                    break;
+                }
+                case Protocol::MSG_NO_JOB_AVAILABLE:
+                {
+                    // The job is not ready yet (still being preprocessed)
+                    Thread::Sleep( 10 );
+                    const Protocol::MsgRequestJob request;
+                    request.Send( connection );
+                    break;
+                }
+                case Protocol::MSG_JOB:
+                {
+                    m_ToolId = static_cast< const Protocol::MsgJob * >( msg )->GetToolId();
+                    const Protocol::MsgRequestManifest request( m_ToolId );
+                    request.Send( connection );
+                    break;
+                }
+                case Protocol::MSG_FILE:
+                {
+                    m_NumFileMessages.Increment();
+                    OnFileReceived();
+                    break;
+                }
+                case Protocol::MSG_FILES:
+                {
+                    m_NumFilesMessages.Increment();
+                    break;
+                }
+                default: break;
+            }
+        }
+        void OnManifest( const ConnectionInfo * connection, ConstMemoryStream & ms )
+        {
+            uint64_t toolId = 0;
+            AStackString<> mainExecutableRootPath;
+            uint32_t numFiles = 0;
+            if ( ( ms.Read( toolId ) == false ) ||
+                 ( ms.Read( mainExecutableRootPath ) == false ) ||
+                 ( ms.Read( numFiles ) == false ) ||
+                 ( toolId != m_ToolId ) )
+            {
+                FBuild::AbortBuild(); // Checked by the test
+                return;
+            }
+            m_NumFilesInManifest.Store( numFiles );
+
+            // Request every file in one message
+            MemoryStream request;
+            request.Write( numFiles );
+            for ( uint32_t i = 0; i < numFiles; ++i )
+            {
+                request.Write( i );
+            }
+            const Protocol::MsgRequestFiles msg( m_ToolId );
+            msg.Send( connection, request );
+        }
+        void OnFiles( ConstMemoryStream & ms )
+        {
+            while ( ms.Tell() < ms.GetSize() )
+            {
+                uint32_t fileId = 0;
+                uint32_t dataSize = 0;
+                if ( ( ms.Read( fileId ) == false ) ||
+                     ( ms.Read( dataSize ) == false ) ||
+                     ( fileId >= m_NumFilesInManifest.Load() ) )
+                {
+                    FBuild::AbortBuild(); // Checked by the test
+                    return;
+                }
+                ms.Seek( ms.Tell() + dataSize );
+                OnFileReceived();
+            }
+        }
+        void OnFileReceived()
+        {
+            if ( m_NumFilesReceived.Increment() == m_NumFilesInManifest.Load() )
+            {
+                FBuild::AbortBuild(); // The job will never be built
+            }
+        }
+
+        Protocol::MessageType   m_PayloadType = Protocol::NUM_MESSAGES;
+        uint64_t                m_ToolId = 0;
+        Atomic< uint32_t >      m_NumFilesInManifest { 0 };
+        Atomic< uint32_t >      m_NumFilesReceived { 0 };
+        Atomic< uint32_t >      m_NumFilesMessages { 0 };
+        Atomic< uint32_t >      m_NumFileMessages { 0 };
+    };
+
+    // A stand-in compiler made of many small files. It's never run remotely, and
+    // run locally it only needs to preprocess (by printing the source).
+    const char * const outDir = "../tmp/Test/TestDistributed/ToolFilesBatched/";
+    const char * const toolDir = "../tmp/Test/TestDistributed/ToolFilesBatched/Tool/";
+    EnsureDirExists( toolDir );
+    AStackString<> compiler( toolDir );
+    compiler += "compiler.sh";
+    MakeFile( compiler.Get(),
+              "#!/bin/sh\n"
+              "for arg; do\n"
+              "    case \"$arg\" in *.cpp) cat \"$arg\";; esac\n"
+              "done\n" );
+    TEST_ASSERT( FileIO::SetExecutable( compiler.Get() ) );
+    const uint32_t numExtraFiles = 8;
+    for ( uint32_t i = 1; i <= numExtraFiles; ++i )
+    {
+        AStackString<> fileName( toolDir );
+        fileName.AppendFormat( "file%u", i );
+        AStackString<> content;
+        content.Format( "ToolFilesBatched file %u", i );
+        MakeFile( fileName.Get(), content.Get() );
+    }
+    AStackString<> sourceFile( outDir );
+    sourceFile += "file.cpp";
+    MakeFile( sourceFile.Get(), "int Function() { return 0; }\n" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/ToolFilesBatched/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure the job is given to the worker
+    options.m_AllowLocalRace = false;
+    options.m_ForceCleanBuild = true;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    TestWorker worker;
+    TEST_ASSERT( worker.Listen( Protocol::PROTOCOL_TEST_PORT ) );
+
+    // The build is aborted once all the files have been received
+    TEST_ASSERT( fBuild.Build( "ToolFilesBatched" ) == false );
+
+    // All files arrive together, in a single message
+    TEST_ASSERT( worker.m_NumFilesInManifest.Load() == ( numExtraFiles + 1 ) );
+    TEST_ASSERT( worker.m_NumFilesReceived.Load() == worker.m_NumFilesInManifest.Load() );
+    TEST_ASSERT( worker.m_NumFilesMessages.Load() == 1 );
+    TEST_ASSERT( worker.m_NumFileMessages.Load() == 0 );
+}
+#endif
+
+// MemoryBackedTempDirFallback
+//------------------------------------------------------------------------------
+void TestDistributed::MemoryBackedTempDirFallback() const
+{
+    // Check that remote jobs fall back to the regular temp dir if the memory
+    // backed temp dir can't be written to (as when it fills up)
+    AStackString<> workingDir;
+    TEST_ASSERT( FileIO::GetCurrentDir( workingDir ) );
+    AStackString<> testDir( workingDir );
+    testDir += NATIVE_SLASH;
+    testDir += "../tmp/Test/TestDistributed/MemoryBackedTempDir/";
+    NodeGraph::CleanPath( testDir );
+    AStackString<> sourceFile( testDir );
+    sourceFile += "file.cpp";
+    AStackString<> memoryBackedTmpDir( testDir );
+    memoryBackedTmpDir += "tmpfs";
+    memoryBackedTmpDir += NATIVE_SLASH;
+
+    // The worker's only thread uses a dir named for its index
+    AStackString<> threadTmpDir( memoryBackedTmpDir );
+    threadTmpDir += "core_1001";
+
+    // The input for a job is written to a dir named for the source file
+    AStackString<> inputTmpDir( threadTmpDir );
+    inputTmpDir.AppendFormat( "%c%08X", NATIVE_SLASH, xxHash::Calc32( sourceFile ) );
+
+    for ( uint32_t pass = 0; pass < 2; ++pass )
+    {
+        // Block the creation of the dir for the outputs, then the input
+        FileIO::DirectoryDelete( inputTmpDir );
+        FileIO::FileDelete( inputTmpDir.Get() );
+        FileIO::DirectoryDelete( threadTmpDir );
+        FileIO::FileDelete( threadTmpDir.Get() );
+        EnsureDirExists( memoryBackedTmpDir );
+        if ( pass == 0 )
+        {
+            MakeFile( threadTmpDir.Get(), "" );
+        }
+        else
+        {
+            EnsureDirExists( threadTmpDir );
+            MakeFile( inputTmpDir.Get(), "" );
+        }
+
+        // Unique source so the worker's result cache can't answer the job
+        AStackString<> source;
+        source.Format( "int Function() { return %u; }\n", (uint32_t)( (uint64_t)Timer::GetNow() + pass ) );
+        MakeFile( sourceFile.Get(), source.Get() );
+
+        FBuildTestOptions options;
+        options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/MemoryBackedTempDir/fbuild.bff";
+        options.m_AllowDistributed = true;
+        options.m_NumWorkerThreads = 1;
+        options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+        options.m_AllowLocalRace = false;
+        options.m_ForceCleanBuild = true;
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // start a client to emulate the other end
+        Server s( 1 );
+        s.Listen( Protocol::PROTOCOL_TEST_PORT );
+        WorkerThread::SetMemoryBackedTempDirForTests( memoryBackedTmpDir );
+
+        const bool built = fBuild.Build( "MemoryBackedTempDir" );
+        WorkerThread::SetMemoryBackedTempDirForTests( AString::GetEmpty() );
+        TEST_ASSERT( built );
+
+        // Built remotely (no local consumption), in the regular temp dir
+        CheckStatsNode( fBuild.GetStats(), 1, 1, Node::OBJECT_NODE );
+    }
+}
+
 // TestZiDebugFormat
 //------------------------------------------------------------------------------
 void TestDistributed::TestZiDebugFormat() const
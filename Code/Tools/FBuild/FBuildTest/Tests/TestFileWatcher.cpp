@@ -0,0 +1,256 @@
+// TestFileWatcher.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// TestFileWatcher
+//------------------------------------------------------------------------------
+class TestFileWatcher : public FBuildTest
+{
+public:
+    #if defined( __LINUX__ )
+        static void GetFullPath( const char * relativePath, AString & outFullPath );
+    #endif
+
+private:
+    DECLARE_TESTS
+
+    // Tests
+    #if defined( __LINUX__ )
+        void RecordChanges() const;
+        void Build() const;
+
+        // Helpers
+        void ModifyFile( const char * fileName, const char * contents ) const;
+    #endif
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestFileWatcher )
+    #if defined( __LINUX__ )
+        REGISTER_TEST( RecordChanges )
+        REGISTER_TEST( Build )
+    #endif
+REGISTER_TESTS_END
+
+#if defined( __LINUX__ )
+// FileWatcherThread
+//------------------------------------------------------------------------------
+// Runs a FileWatcher as the "-watch" mode process would
+class FileWatcherThread
+{
+public:
+    explicit FileWatcherThread( const char * rootPath, const char * sharedMemoryName )
+    {
+        AStackString<> fullPath;
+        TestFileWatcher::GetFullPath( rootPath, fullPath );
+        m_Started = m_Watcher.Start( fullPath, sharedMemoryName );
+        if ( m_Started )
+        {
+            m_Thread.Start( ThreadFunc, "FileWatcher", this );
+        }
+    }
+    ~FileWatcherThread()
+    {
+        if ( m_Started )
+        {
+            AtomicStoreRelaxed( &m_Quit, true );
+            m_Thread.Join();
+        }
+    }
+
+    bool IsStarted() const { return m_Started; }
+
+private:
+    static uint32_t ThreadFunc( void * userData )
+    {
+        FileWatcherThread * self = static_cast< FileWatcherThread * >( userData );
+        while ( AtomicLoadRelaxed( &self->m_Quit ) == false )
+        {
+            self->m_Watcher.Update( 5 );
+        }
+        return 0;
+    }
+
+    FileWatcher     m_Watcher;
+    Thread          m_Thread;
+    bool            m_Started   = false;
+    volatile bool   m_Quit      = false;
+};
+
+// RecordChanges
+//------------------------------------------------------------------------------
+void TestFileWatcher::RecordChanges() const
+{
+    const char * const sharedMemoryName = "FASTBuildWatcher_Test";
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/FileWatcher/RecordChanges/Sub/" ) ) );
+    MakeFile( "../tmp/Test/FileWatcher/RecordChanges/modified.txt", "a" );
+    MakeFile( "../tmp/Test/FileWatcher/RecordChanges/unmodified.txt", "a" );
+    FileIO::FileDelete( "../tmp/Test/FileWatcher/RecordChanges/Sub/New/file.txt" );
+    FileIO::DirectoryDelete( AStackString<>( "../tmp/Test/FileWatcher/RecordChanges/Sub/New" ) );
+
+    AStackString<> modifiedFile;
+    AStackString<> unmodifiedFile;
+    AStackString<> newFile;
+    AStackString<> otherFile;
+    GetFullPath( "../tmp/Test/FileWatcher/RecordChanges/modified.txt", modifiedFile );
+    GetFullPath( "../tmp/Test/FileWatcher/RecordChanges/unmodified.txt", unmodifiedFile );
+    GetFullPath( "../tmp/Test/FileWatcher/RecordChanges/Sub/New/file.txt", newFile );
+    GetFullPath( "../tmp/Test/FileWatcher/Other/file.txt", otherFile );
+
+    // No watcher
+    {
+        FileWatcherClient client;
+        TEST_ASSERT( client.Connect( sharedMemoryName ) == false );
+        TEST_ASSERT( client.GetSnapshot().IsValid() == false );
+        TEST_ASSERT( client.IsWatched( modifiedFile ) == false );
+    }
+
+    const FileWatcherThread watcher( "../tmp/Test/FileWatcher/RecordChanges/", sharedMemoryName );
+    TEST_ASSERT( watcher.IsStarted() );
+
+    // Take a snapshot before making changes
+    FileWatcherClient before;
+    TEST_ASSERT( before.Connect( sharedMemoryName ) );
+    TEST_ASSERT( before.GetSnapshot().IsValid() );
+    TEST_ASSERT( before.IsWatched( modifiedFile ) );
+    TEST_ASSERT( before.IsWatched( otherFile ) == false );
+
+    // Nothing changed yet
+    FileWatcherChanges changes;
+    TEST_ASSERT( before.GetChangesSince( before.GetSnapshot(), changes ) );
+    TEST_ASSERT( changes.IsEmpty() );
+
+    // Modify a file and create a directory containing a file
+    MakeFile( "../tmp/Test/FileWatcher/RecordChanges/modified.txt", "b" );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/FileWatcher/RecordChanges/Sub/New/" ) ) );
+    MakeFile( "../tmp/Test/FileWatcher/RecordChanges/Sub/New/file.txt", "a" );
+
+    // Changes made before connecting are seen
+    FileWatcherClient after;
+    TEST_ASSERT( after.Connect( sharedMemoryName ) );
+    TEST_ASSERT( after.GetChangesSince( before.GetSnapshot(), changes ) );
+    TEST_ASSERT( changes.IsChanged( modifiedFile ) );
+    TEST_ASSERT( changes.IsChanged( newFile ) );
+    TEST_ASSERT( changes.IsChanged( unmodifiedFile ) == false );
+
+    // Changes are only known between snapshots from the same watcher
+    FileWatcherSnapshot otherWatcher( after.GetSnapshot() );
+    otherWatcher.m_InstanceId++;
+    TEST_ASSERT( after.GetChangesSince( otherWatcher, changes ) == false );
+    TEST_ASSERT( before.GetChangesSince( after.GetSnapshot(), changes ) == false );
+}
+
+// Build
+//------------------------------------------------------------------------------
+void TestFileWatcher::Build() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestFileWatcher/Build/fbuild.bff";
+
+    const char * dbFile = "../tmp/Test/FileWatcher/Build/fbuild.fdb";
+    const char * sourceFile = "../tmp/Test/FileWatcher/Build/Watched/source.txt";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/FileWatcher/Build/Watched/" ) ) );
+    MakeFile( sourceFile, "original" );
+
+    const FileWatcherThread watcher( "../tmp/Test/FileWatcher/Build/Watched/", options.GetFileWatcherSharedMemoryName().Get() );
+    TEST_ASSERT( watcher.IsStarted() );
+
+    // Initial build
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.GetFileWatcher().IsConnected() );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+    }
+
+    // Nothing changed, so stored stamps are used
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 0, Node::COPY_FILE_NODE );
+    }
+
+    // Change recorded by the watcher causes a rebuild
+    ModifyFile( sourceFile, "modified" );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+    }
+
+    // Updated stamp was journaled
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+
+        CheckStatsNode( 1, 0, Node::COPY_FILE_NODE );
+    }
+}
+
+// GetFullPath
+//------------------------------------------------------------------------------
+/*static*/ void TestFileWatcher::GetFullPath( const char * relativePath, AString & outFullPath )
+{
+    // Tests run without an FBuild instance, so the working dir must be prepended explicitly
+    AStackString<> path;
+    VERIFY( FileIO::GetCurrentDir( path ) );
+    path += '/';
+    path += relativePath;
+    NodeGraph::CleanPath( path, outFullPath );
+}
+
+// ModifyFile
+//------------------------------------------------------------------------------
+void TestFileWatcher::ModifyFile( const char * fileName, const char * contents ) const
+{
+    // Ensure filetime has changed (different file systems have different resolutions)
+    const uint64_t originalTime = FileIO::GetFileLastWriteTime( AStackString<>( fileName ) );
+    const Timer t;
+    uint32_t sleepTimeMS = 2;
+    for ( ;; )
+    {
+        MakeFile( fileName, contents );
+        if ( FileIO::GetFileLastWriteTime( AStackString<>( fileName ) ) != originalTime )
+        {
+            break; // All done
+        }
+
+        // Wait a while and try again
+        Thread::Sleep( sleepTimeMS );
+        sleepTimeMS = Math::Max<uint32_t>( sleepTimeMS * 2, 128 );
+
+        TEST_ASSERT( t.GetElapsed() < 10.0f ); // Sanity check fail test after a longtime
+    }
+}
+#endif
+
+//------------------------------------------------------------------------------
@@ -26,6 +26,7 @@
 
 // Core
 #include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
@@ -36,6 +37,8 @@
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Timer.h"
 
+#include <memory.h>
+
 // TestGraph
 //------------------------------------------------------------------------------
 class TestGraph : public FBuildTest
@@ -49,8 +52,11 @@ private:
     void TestCleanPathPartial() const;
     void SingleFileNode() const;
     void SingleFileNodeMissing() const;
+    void PrefetchFileStamps() const;
     void TestSerialization() const;
+    void TestSerializationMultipleChunks() const;
     void TestDeepGraph() const;
+    void TestDeepGraphMultipleThreads() const;
     void TestNoStopOnFirstError() const;
     void DBLocationChanged() const;
     void DBCorrupt() const;
@@ -59,6 +65,8 @@ private:
     void FixupErrorPaths() const;
     void CyclicDependency() const;
     void DBLocation() const;
+    void DBJournal() const;
+    void DBJournalInterrupted() const;
 };
 
 // Register Tests
@@ -70,8 +78,11 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( TestCleanPathPartial )
     REGISTER_TEST( SingleFileNode )
     REGISTER_TEST( SingleFileNodeMissing )
+    REGISTER_TEST( PrefetchFileStamps )
     REGISTER_TEST( TestSerialization )
+    REGISTER_TEST( TestSerializationMultipleChunks )
     REGISTER_TEST( TestDeepGraph )
+    REGISTER_TEST( TestDeepGraphMultipleThreads )
     REGISTER_TEST( TestNoStopOnFirstError )
     REGISTER_TEST( DBLocationChanged )
     REGISTER_TEST( DBCorrupt )
@@ -80,6 +91,8 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( FixupErrorPaths )
     REGISTER_TEST( CyclicDependency )
     REGISTER_TEST( DBLocation )
+    REGISTER_TEST( DBJournal )
+    REGISTER_TEST( DBJournalInterrupted )
 REGISTER_TESTS_END
 
 // NodeTestHelper
@@ -161,8 +174,11 @@ void TestGraph::TestNodeTypes() const
 //------------------------------------------------------------------------------
 void TestGraph::SingleFileNode() const
 {
-    FBuild fb;
-    NodeGraph ng;
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/Empty/fbuild.bff";
+    FBuildForTest fb( options );
+    TEST_ASSERT( fb.Initialize() );
+    NodeGraph & ng = fb.GetDependencyGraph();
 
     // make sure a node of the name we are going to use doesn't exist
     const AStackString<> testFileName( "SimpleLibrary/library.cpp" );
@@ -180,11 +196,13 @@ void TestGraph::SingleFileNode() const
 void TestGraph::SingleFileNodeMissing() const
 {
     // suppress error output for this test (as the errors are expected)
-    FBuildOptions options;
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/Empty/fbuild.bff";
     options.m_ShowErrors = false;
 
-    FBuild fb( options );
-    NodeGraph ng;
+    FBuildForTest fb( options );
+    TEST_ASSERT( fb.Initialize() );
+    NodeGraph & ng = fb.GetDependencyGraph();
 
     // make a node for a file that does not exist
     const AStackString<> testFileName( "ThisFileDoesNotExist.cpp" );
@@ -196,6 +214,34 @@ void TestGraph::SingleFileNodeMissing() const
     TEST_ASSERT( fb.Build( node ) == true );
 }
 
+// PrefetchFileStamps
+//------------------------------------------------------------------------------
+void TestGraph::PrefetchFileStamps() const
+{
+    FBuild fb;
+    NodeGraph ng;
+
+    // An existing file
+    {
+        FileNode * node = ng.CreateNode<FileNode>( AStackString<>( "Tools/FBuild/FBuildTest/Data/TestGraph/DatabaseJournal/fbuild.bff" ) );
+        TEST_ASSERT( node->UsePrefetchedStamp() == false ); // Not retrieved yet
+
+        ng.PrefetchFileStamps( node );
+        TEST_ASSERT( node->UsePrefetchedStamp() );
+        TEST_ASSERT( node->GetStamp() != 0 );
+        TEST_ASSERT( node->GetStamp() == FileIO::GetFileLastWriteTime( node->GetName() ) );
+        TEST_ASSERT( node->UsePrefetchedStamp() == false ); // Only used once
+    }
+
+    // A missing file
+    {
+        FileNode * node = ng.CreateNode<FileNode>( AStackString<>( "ThisFileDoesNotExist.cpp" ) );
+        ng.PrefetchFileStamps( node );
+        TEST_ASSERT( node->UsePrefetchedStamp() );
+        TEST_ASSERT( node->GetStamp() == 0 );
+    }
+}
+
 // TestSerialization
 //------------------------------------------------------------------------------
 void TestGraph::TestSerialization() const
@@ -249,6 +295,49 @@ void TestGraph::TestSerialization() const
     }
 }
 
+// TestSerializationMultipleChunks
+//------------------------------------------------------------------------------
+void TestGraph::TestSerializationMultipleChunks() const
+{
+    // Chunks are processed in parallel using the ThreadPool
+    FBuildTestOptions options;
+    options.m_NumWorkerThreads = 4;
+    FBuild fBuild( options );
+
+    const char * dbFile = "../tmp/Test/Graph/MultipleChunks/fbuild.fdb";
+
+    // Create a graph big enough to be split into several chunks
+    MemoryStream ms1;
+    {
+        NodeGraph ng;
+        ng.CreateNode<SettingsNode>( AStackString<>( "$$Settings$$" ) );
+        for ( uint32_t i = 0; i < 5000; ++i )
+        {
+            AStackString<> name;
+            name.Format( "file%u.cpp", i );
+            ng.CreateNode<FileNode>( name );
+            name.Format( "alias%u", i );
+            ng.CreateNode<AliasNode>( name );
+        }
+        ng.Save( ms1, dbFile );
+    }
+
+    // Load it and save it again
+    MemoryStream ms2;
+    {
+        NodeGraph ng;
+        ConstMemoryStream cms( ms1.GetData(), ms1.GetSize() );
+        TEST_ASSERT( ng.Load( cms, dbFile ) == NodeGraph::LoadResult::OK );
+        TEST_ASSERT( ng.GetNodeCount() == 10001 );
+        TEST_ASSERT( ng.FindNode( AStackString<>( "alias4999" ) ) );
+        ng.Save( ms2, dbFile );
+    }
+
+    // Result should be identical
+    TEST_ASSERT( ms1.GetSize() == ms2.GetSize() );
+    TEST_ASSERT( memcmp( ms1.GetData(), ms2.GetData(), ms1.GetSize() ) == 0 );
+}
+
 // TestCleanPath
 //------------------------------------------------------------------------------
 void TestGraph::TestCleanPath() const
@@ -486,6 +575,28 @@ void TestGraph::TestDeepGraph() const
     }
 }
 
+// TestDeepGraphMultipleThreads
+//------------------------------------------------------------------------------
+void TestGraph::TestDeepGraphMultipleThreads() const
+{
+    // Many nodes wait on the same in-flight dependencies. Ensure they are all
+    // progressed as those dependencies complete on multiple worker threads.
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+    options.m_NumWorkerThreads = 4;
+    options.m_ForceCleanBuild = true;
+
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "all" ) );
+
+    // Check stats
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 1,     1,      Node::OBJECT_NODE );
+    CheckStatsNode ( 31,    31,     Node::OBJECT_LIST_NODE );
+    CheckStatsNode ( 1,     1,      Node::ALIAS_NODE );
+}
+
 // TestNoStopOnFirstError
 //------------------------------------------------------------------------------
 void TestGraph::TestNoStopOnFirstError() const
@@ -917,4 +1028,150 @@ void TestGraph::DBLocation() const
     }
 }
 
+// DBJournal
+//------------------------------------------------------------------------------
+void TestGraph::DBJournal() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DatabaseJournal/fbuild.bff";
+
+    const char * dbFile = "../tmp/Test/Graph/DatabaseJournal/fbuild.fdb";
+    const char * journalFile = "../tmp/Test/Graph/DatabaseJournal/fbuild.fdb.journal";
+    const char * sourceFile = "../tmp/Test/Graph/DatabaseJournal/source.txt";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( journalFile );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/Graph/DatabaseJournal/" ) ) );
+    MakeFile( sourceFile, "original" );
+
+    // Initial build writes a complete DB
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+        EnsureFileDoesNotExist( journalFile );
+    }
+
+    // Modify the source, ensuring filetime has changed (different file systems have different resolutions)
+    const uint64_t originalTime = FileIO::GetFileLastWriteTime( AStackString<>( sourceFile ) );
+    const Timer t;
+    uint32_t sleepTimeMS = 2;
+    for ( ;; )
+    {
+        MakeFile( sourceFile, "modified" );
+        if ( FileIO::GetFileLastWriteTime( AStackString<>( sourceFile ) ) != originalTime )
+        {
+            break; // All done
+        }
+
+        // Wait a while and try again
+        Thread::Sleep( sleepTimeMS );
+        sleepTimeMS = Math::Max<uint32_t>( sleepTimeMS * 2, 128 );
+
+        TEST_ASSERT( t.GetElapsed() < 10.0f ); // Sanity check fail test after a longtime
+    }
+
+    // Rebuild - changes are appended to the journal and the DB is left untouched
+    const uint64_t dbTime = FileIO::GetFileLastWriteTime( AStackString<>( dbFile ) );
+    uint64_t dbSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( dbFile, FileStream::READ_ONLY ) );
+        dbSize = fs.GetFileSize();
+    }
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+        EnsureFileExists( journalFile );
+        TEST_ASSERT( FileIO::GetFileLastWriteTime( AStackString<>( dbFile ) ) == dbTime );
+        FileStream fs;
+        TEST_ASSERT( fs.Open( dbFile, FileStream::READ_ONLY ) );
+        TEST_ASSERT( fs.GetFileSize() == dbSize );
+    }
+
+    // Journal is replayed on load, so nothing needs to be built
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+
+        CheckStatsNode( 1, 0, Node::COPY_FILE_NODE );
+    }
+
+    // Truncate the journal mid-entry - torn tail is ignored and the target rebuilds
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( journalFile, FileStream::READ_ONLY ) );
+        MemoryStream contents;
+        TEST_ASSERT( contents.WriteBuffer( fs, fs.GetFileSize() ) == fs.GetFileSize() );
+        fs.Close();
+        TEST_ASSERT( fs.Open( journalFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( contents.GetData(), contents.GetSize() - 1 ) == ( contents.GetSize() - 1 ) );
+    }
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+    }
+}
+
+// DBJournalInterrupted
+//------------------------------------------------------------------------------
+void TestGraph::DBJournalInterrupted() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DatabaseJournalInterrupted/fbuild.bff";
+    options.m_SaveDBOnCompletion = true;
+    options.m_DBJournalInterval = 0.0f; // Journal as soon as the Copy completes
+
+    const char * dbFile = "../tmp/Test/Graph/DatabaseJournalInterrupted/fbuild.fdb";
+    const char * journalFile = "../tmp/Test/Graph/DatabaseJournalInterrupted/fbuild.fdb.journal";
+    const char * journalSnapshot = "../tmp/Test/Graph/DatabaseJournalInterrupted/journal.snapshot";
+
+    // Clean up anything left over from previous runs
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( journalFile );
+    EnsureFileDoesNotExist( journalSnapshot );
+
+    // Initial build writes a complete DB
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "Init" ) );
+        EnsureFileDoesNotExist( journalFile );
+    }
+
+    // Build the Copy, then snapshot the journal before the build completes
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "TestTarget" ) );
+
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+        EnsureFileExists( journalSnapshot );
+    }
+
+    // Discard what was journaled after the snapshot, as if the build was
+    // interrupted. The Copy was journaled when it completed, so doesn't
+    // build again.
+    TEST_ASSERT( FileIO::FileCopy( journalSnapshot, journalFile ) );
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "Copy" ) );
+
+        CheckStatsNode( 1, 0, Node::COPY_FILE_NODE );
+    }
+}
+
 //------------------------------------------------------------------------------
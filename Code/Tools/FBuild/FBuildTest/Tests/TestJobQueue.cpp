@@ -0,0 +1,339 @@
+// TestJobQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// Core
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// TestJobQueue
+//------------------------------------------------------------------------------
+class TestJobQueue : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void CriticalPathOrder() const;
+    void OwnQueueFirst() const;
+    void StealWhenEmpty() const;
+    void StealMoreExpensive() const;
+    void DistributeCheapest() const;
+    void RaceMostOverdue() const;
+
+    // Helpers
+    static Job * CreateJob( NodeGraph & ng, uint32_t cost );
+    static void QueueJob( JobSubQueue & subQueue, Job * job );
+    static void DeleteJobs( JobSubQueue & subQueue );
+    static void QueueDistributableJob( JobQueue & jq, Job * job );
+    static void DeleteDistributableJobs( JobQueue & jq );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestJobQueue )
+    REGISTER_TEST( CriticalPathOrder )
+    REGISTER_TEST( OwnQueueFirst )
+    REGISTER_TEST( StealWhenEmpty )
+    REGISTER_TEST( StealMoreExpensive )
+    REGISTER_TEST( DistributeCheapest )
+    REGISTER_TEST( RaceMostOverdue )
+REGISTER_TESTS_END
+
+// CriticalPathOrder
+//------------------------------------------------------------------------------
+void TestJobQueue::CriticalPathOrder() const
+{
+    FBuild fb;
+    NodeGraph ng;
+
+    // Jobs are queued in sorted batches, which are merged
+    JobSubQueue subQueue;
+    Array< Job * > batch1;
+    batch1.Append( CreateJob( ng, 10 ) );
+    batch1.Append( CreateJob( ng, 30 ) );
+    batch1.Append( CreateJob( ng, 50 ) );
+    subQueue.QueueJobs( batch1 );
+    Array< Job * > batch2;
+    batch2.Append( CreateJob( ng, 20 ) );
+    batch2.Append( CreateJob( ng, 40 ) );
+    subQueue.QueueJobs( batch2 );
+    TEST_ASSERT( subQueue.GetCount() == 5 );
+    TEST_ASSERT( subQueue.GetTopCost() == 50 );
+
+    // Most expensive (longest critical path) is always consumed first
+    const uint32_t expectedCosts[] = { 50, 40, 30, 20, 10 };
+    for ( const uint32_t expectedCost : expectedCosts )
+    {
+        Job * job = subQueue.RemoveJob();
+        TEST_ASSERT( job );
+        TEST_ASSERT( job->GetNode()->GetRecursiveCost() == expectedCost );
+        FDELETE job;
+    }
+    TEST_ASSERT( subQueue.GetCount() == 0 );
+    TEST_ASSERT( subQueue.GetTopCost() == 0 );
+    TEST_ASSERT( subQueue.RemoveJob() == nullptr );
+}
+
+// OwnQueueFirst
+//------------------------------------------------------------------------------
+void TestJobQueue::OwnQueueFirst() const
+{
+    FBuild fb;
+    NodeGraph ng;
+
+    JobSubQueue queue0;
+    JobSubQueue queue1;
+    JobSubQueue queue2;
+    Array< JobSubQueue * > subQueues;
+    subQueues.Append( &queue0 );
+    subQueues.Append( &queue1 );
+    subQueues.Append( &queue2 );
+
+    // Other queues have slightly more expensive jobs
+    QueueJob( queue0, CreateJob( ng, 100 ) );
+    QueueJob( queue1, CreateJob( ng, 110 ) );
+    QueueJob( queue2, CreateJob( ng, 120 ) );
+
+    // Each worker consumes its own queue, wherever it starts looking
+    for ( size_t victimOffset = 0; victimOffset < 2; ++victimOffset )
+    {
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, victimOffset ) == &queue0 );
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 1, victimOffset ) == &queue1 );
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 2, victimOffset ) == &queue2 );
+    }
+
+    DeleteJobs( queue0 );
+    DeleteJobs( queue1 );
+    DeleteJobs( queue2 );
+}
+
+// StealWhenEmpty
+//------------------------------------------------------------------------------
+void TestJobQueue::StealWhenEmpty() const
+{
+    FBuild fb;
+    NodeGraph ng;
+
+    JobSubQueue queue0;
+    JobSubQueue queue1;
+    JobSubQueue queue2;
+    JobSubQueue queue3;
+    Array< JobSubQueue * > subQueues;
+    subQueues.Append( &queue0 );
+    subQueues.Append( &queue1 );
+    subQueues.Append( &queue2 );
+    subQueues.Append( &queue3 );
+
+    // Nothing to consume anywhere
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 0 ) == nullptr );
+
+    // Queue 0 is empty and the others have jobs of similar cost
+    QueueJob( queue1, CreateJob( ng, 100 ) );
+    QueueJob( queue2, CreateJob( ng, 100 ) );
+    QueueJob( queue3, CreateJob( ng, 110 ) );
+
+    // The victim depends on where the search starts, so idle workers
+    // don't all contend on the same queue
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 0 ) == &queue1 );
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 1 ) == &queue2 );
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 2 ) == &queue3 );
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 3 ) == &queue1 );
+
+    // Empty queues are skipped
+    DeleteJobs( queue2 );
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 1 ) == &queue3 );
+
+    DeleteJobs( queue1 );
+    DeleteJobs( queue3 );
+}
+
+// StealMoreExpensive
+//------------------------------------------------------------------------------
+void TestJobQueue::StealMoreExpensive() const
+{
+    FBuild fb;
+    NodeGraph ng;
+
+    JobSubQueue queue0;
+    JobSubQueue queue1;
+    JobSubQueue queue2;
+    Array< JobSubQueue * > subQueues;
+    subQueues.Append( &queue0 );
+    subQueues.Append( &queue1 );
+    subQueues.Append( &queue2 );
+
+    // Queue 2 has a job on a much longer critical path
+    QueueJob( queue0, CreateJob( ng, 100 ) );
+    QueueJob( queue1, CreateJob( ng, 100 ) );
+    QueueJob( queue2, CreateJob( ng, 1000 ) );
+
+    // Workers with cheaper jobs steal it, wherever they start looking
+    for ( size_t victimOffset = 0; victimOffset < 2; ++victimOffset )
+    {
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, victimOffset ) == &queue2 );
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 1, victimOffset ) == &queue2 );
+        TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 2, victimOffset ) == &queue2 );
+    }
+
+    // Once it's taken, workers go back to their own queues
+    Job * job = queue2.RemoveJob();
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 1000 ) );
+    FDELETE job;
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 0, 0 ) == &queue0 );
+    TEST_ASSERT( JobSubQueue::FindQueueToConsume( subQueues, 1, 0 ) == &queue1 );
+
+    DeleteJobs( queue0 );
+    DeleteJobs( queue1 );
+}
+
+// DistributeCheapest
+//------------------------------------------------------------------------------
+void TestJobQueue::DistributeCheapest() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    JobQueue jq( 0, nullptr );
+
+    // Jobs become distributable in no particular order
+    const uint32_t costs[] = { 30, 10, 50, 20, 40 };
+    for ( const uint32_t cost : costs )
+    {
+        QueueDistributableJob( jq, CreateJob( ng, cost ) );
+    }
+    TEST_ASSERT( jq.GetNumDistributableJobsAvailable() == 5 );
+
+    // Normal workers take the most expensive jobs
+    Job * job = jq.GetDistributableJobToProcess( true, false );
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 50 ) );
+    TEST_ASSERT( job->GetDistributionState() == Job::DIST_BUILDING_REMOTELY );
+
+    // Slow workers take the cheapest
+    job = jq.GetDistributableJobToProcess( true, true );
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 10 ) );
+    TEST_ASSERT( job->GetDistributionState() == Job::DIST_BUILDING_REMOTELY );
+    job = jq.GetDistributableJobToProcess( true, true );
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 20 ) );
+
+    // Local consumption is unaffected
+    job = jq.GetDistributableJobToProcess( false, false );
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 40 ) );
+    TEST_ASSERT( job->GetDistributionState() == Job::DIST_BUILDING_LOCALLY );
+
+    TEST_ASSERT( jq.GetNumDistributableJobsAvailable() == 1 );
+    TEST_ASSERT( jq.m_DistributableJobs_InProgress.GetSize() == 4 );
+
+    DeleteDistributableJobs( jq );
+}
+
+// RaceMostOverdue
+//------------------------------------------------------------------------------
+void TestJobQueue::RaceMostOverdue() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    JobQueue jq( 0, nullptr );
+
+    for ( uint32_t i = 0; i < 5; ++i )
+    {
+        QueueDistributableJob( jq, CreateJob( ng, 100 ) );
+    }
+    Job * jobs[ 5 ];
+    for ( Job * & job : jobs )
+    {
+        job = jq.GetDistributableJobToProcess( true, false );
+        TEST_ASSERT( job );
+    }
+
+    // 0: no deadline (no stats for the worker yet)
+    // 1: overdue
+    // 2: most overdue
+    // 3: not yet due
+    // 4: no deadline (newest)
+    const int64_t now = Timer::GetNow();
+    const int64_t oneSecond = (int64_t)Timer::GetFrequency();
+    jobs[ 0 ]->SetRemoteTimes( now - ( 20 * oneSecond ), 0 );
+    jobs[ 1 ]->SetRemoteTimes( now - ( 20 * oneSecond ), now - ( 5 * oneSecond ) );
+    jobs[ 2 ]->SetRemoteTimes( now - ( 20 * oneSecond ), now - ( 10 * oneSecond ) );
+    jobs[ 3 ]->SetRemoteTimes( now - ( 20 * oneSecond ), now + ( 60 * oneSecond ) );
+    jobs[ 4 ]->SetRemoteTimes( now, 0 );
+
+    // Overdue jobs are raced, most overdue first
+    TEST_ASSERT( jq.GetDistributableJobToRace() == jobs[ 2 ] );
+    TEST_ASSERT( jobs[ 2 ]->GetDistributionState() == Job::DIST_RACING );
+    TEST_ASSERT( jq.GetDistributableJobToRace() == jobs[ 1 ] );
+    TEST_ASSERT( jobs[ 1 ]->GetDistributionState() == Job::DIST_RACING );
+
+    // With none overdue, the newest remote job is raced
+    TEST_ASSERT( jq.GetDistributableJobToRace() == jobs[ 4 ] );
+    TEST_ASSERT( jq.GetDistributableJobToRace() == jobs[ 3 ] );
+    TEST_ASSERT( jq.GetDistributableJobToRace() == jobs[ 0 ] );
+
+    // Nothing left to race
+    TEST_ASSERT( jq.GetDistributableJobToRace() == nullptr );
+
+    DeleteDistributableJobs( jq );
+}
+
+// CreateJob
+//------------------------------------------------------------------------------
+/*static*/ Job * TestJobQueue::CreateJob( NodeGraph & ng, uint32_t cost )
+{
+    AStackString<> name;
+    name.Format( "Job%u_%u.cpp", cost, (uint32_t)ng.GetNodeCount() );
+    Node * node = ng.CreateNode<FileNode>( name );
+    node->m_RecursiveCost = cost;
+    return FNEW( Job( node ) );
+}
+
+// QueueJob
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::QueueJob( JobSubQueue & subQueue, Job * job )
+{
+    Array< Job * > jobs;
+    jobs.Append( job );
+    subQueue.QueueJobs( jobs );
+}
+
+// DeleteJobs
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::DeleteJobs( JobSubQueue & subQueue )
+{
+    while ( Job * job = subQueue.RemoveJob() )
+    {
+        FDELETE job;
+    }
+}
+
+// QueueDistributableJob
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::QueueDistributableJob( JobQueue & jq, Job * job )
+{
+    // Mimic a job which has been preprocessed locally
+    job->GetNode()->m_State = Node::BUILDING;
+    ++jq.m_NumLocalJobsActive;
+    jq.QueueDistributableJob( job );
+}
+
+// DeleteDistributableJobs
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::DeleteDistributableJobs( JobQueue & jq )
+{
+    // JobQueue frees only jobs which are not in progress
+    for ( Job * job : jq.m_DistributableJobs_InProgress )
+    {
+        FDELETE job;
+    }
+    jq.m_DistributableJobs_InProgress.Clear();
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,215 @@
+// TestToolFileStore.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolFileStore.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Strings/AStackString.h"
+
+// TestToolFileStore
+//------------------------------------------------------------------------------
+class TestToolFileStore : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void StoreAndRetrieve() const;
+    void Missing() const;
+    void Trim() const;
+
+    // Helpers
+    void UseTestStore( const char * storePath ) const;
+    void AgeStoreFiles( const uint64_t * hashes, uint32_t numHashes ) const;
+    bool IsStored( uint64_t hash ) const;
+    void GetStoreFileName( uint64_t hash, AString & outFileName ) const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestToolFileStore )
+    REGISTER_TEST( StoreAndRetrieve )
+    REGISTER_TEST( Missing )
+    REGISTER_TEST( Trim )
+REGISTER_TESTS_END
+
+// StoreAndRetrieve
+//------------------------------------------------------------------------------
+void TestToolFileStore::StoreAndRetrieve() const
+{
+    const char * content = "TestToolFileStore::StoreAndRetrieve";
+    const uint32_t size = (uint32_t)AString::StrLen( content );
+    const uint64_t hash = xxHash3::Calc64( content, size );
+
+    UseTestStore( "../tmp/Test/ToolFileStore/StoreAndRetrieve/" );
+    EnsureDirExists( "../tmp/Test/ToolFileStore/toolchainA/" );
+    EnsureDirExists( "../tmp/Test/ToolFileStore/toolchainB/" );
+    const AStackString<> srcFile( "../tmp/Test/ToolFileStore/toolchainA/compiler.exe" );
+    const AStackString<> dstFile( "../tmp/Test/ToolFileStore/toolchainB/compiler.exe" );
+    FileIO::FileDelete( srcFile.Get() ); // Don't write through links made by a previous run
+    FileIO::FileDelete( dstFile.Get() );
+    MakeFile( srcFile.Get(), content );
+
+    // Once stored, the content can be placed elsewhere
+    ToolFileStore::Store( hash, srcFile );
+    TEST_ASSERT( ToolFileStore::Retrieve( hash, size, dstFile ) );
+    AString retrieved;
+    LoadFileContentsAsString( dstFile.Get(), retrieved );
+    TEST_ASSERT( retrieved == content );
+
+    // Stale files are replaced
+    FileIO::FileDelete( dstFile.Get() ); // Don't write through a link to the store
+    MakeFile( dstFile.Get(), "Stale" );
+    TEST_ASSERT( ToolFileStore::Retrieve( hash, size, dstFile ) );
+    LoadFileContentsAsString( dstFile.Get(), retrieved );
+    TEST_ASSERT( retrieved == content );
+
+    // The original is unaffected by removing other copies
+    ToolFileStore::Discard( hash );
+    FileIO::FileDelete( dstFile.Get() );
+    LoadFileContentsAsString( srcFile.Get(), retrieved );
+    TEST_ASSERT( retrieved == content );
+    TEST_ASSERT( ToolFileStore::Retrieve( hash, size, dstFile ) == false );
+
+    ToolFileStore::SetStorePathForTests( AString::GetEmpty() );
+}
+
+// Missing
+//------------------------------------------------------------------------------
+void TestToolFileStore::Missing() const
+{
+    const char * content = "TestToolFileStore::Missing";
+    const uint32_t size = (uint32_t)AString::StrLen( content );
+    const uint64_t hash = xxHash3::Calc64( content, size );
+
+    UseTestStore( "../tmp/Test/ToolFileStore/Missing/" );
+    const AStackString<> srcFile( "../tmp/Test/ToolFileStore/Missing.txt" );
+    const AStackString<> dstFile( "../tmp/Test/ToolFileStore/Missing.copy.txt" );
+    FileIO::FileDelete( srcFile.Get() ); // Don't write through links made by a previous run
+    MakeFile( srcFile.Get(), content );
+    ToolFileStore::Store( hash, srcFile );
+
+    // Content must match by size as well as hash
+    TEST_ASSERT( ToolFileStore::Retrieve( hash, size + 1, dstFile ) == false );
+    TEST_ASSERT( ToolFileStore::Retrieve( hash + 1, size, dstFile ) == false );
+    TEST_ASSERT( FileIO::FileExists( dstFile.Get() ) == false );
+
+    ToolFileStore::Discard( hash );
+    ToolFileStore::SetStorePathForTests( AString::GetEmpty() );
+}
+
+// Trim
+//------------------------------------------------------------------------------
+void TestToolFileStore::Trim() const
+{
+    UseTestStore( "../tmp/Test/ToolFileStore/Trim/" );
+    EnsureDirExists( "../tmp/Test/ToolFileStore/TrimFiles/" );
+
+    // Store some content
+    const uint32_t numFiles = 4;
+    uint64_t hashes[ numFiles ];
+    uint32_t sizes[ numFiles ];
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        AStackString<> content;
+        content.Format( "TestToolFileStore::Trim %u", i );
+        sizes[ i ] = content.GetLength();
+        hashes[ i ] = xxHash3::Calc64( content );
+
+        AStackString<> srcFile;
+        srcFile.Format( "../tmp/Test/ToolFileStore/TrimFiles/%u.txt", i );
+        FileIO::FileDelete( srcFile.Get() ); // Don't write through links made by a previous run
+        MakeFile( srcFile.Get(), content.Get() );
+        ToolFileStore::Store( hashes[ i ], srcFile );
+    }
+    AgeStoreFiles( hashes, numFiles );
+
+    // Retrieving the oldest content marks it as recently used
+    const AStackString<> dstFile( "../tmp/Test/ToolFileStore/TrimFiles/Retrieved.txt" );
+    TEST_ASSERT( ToolFileStore::Retrieve( hashes[ 0 ], sizes[ 0 ], dstFile ) );
+
+    // A store within its limit is untouched
+    const uint64_t totalSize = ( sizes[ 0 ] + sizes[ 1 ] + sizes[ 2 ] + sizes[ 3 ] );
+    ToolFileStore::Trim( totalSize );
+    for ( uint32_t i = 0; i < numFiles; ++i )
+    {
+        TEST_ASSERT( IsStored( hashes[ i ] ) );
+    }
+
+    // Least recently used content is removed first
+    ToolFileStore::Trim( totalSize - sizes[ 1 ] );
+    TEST_ASSERT( IsStored( hashes[ 0 ] ) );
+    TEST_ASSERT( IsStored( hashes[ 1 ] ) == false );
+    TEST_ASSERT( IsStored( hashes[ 2 ] ) );
+    TEST_ASSERT( IsStored( hashes[ 3 ] ) );
+
+    // Only as much as needed is removed
+    ToolFileStore::Trim( sizes[ 0 ] );
+    TEST_ASSERT( IsStored( hashes[ 0 ] ) );
+    TEST_ASSERT( IsStored( hashes[ 2 ] ) == false );
+    TEST_ASSERT( IsStored( hashes[ 3 ] ) == false );
+
+    ToolFileStore::SetStorePathForTests( AString::GetEmpty() );
+}
+
+// UseTestStore
+//------------------------------------------------------------------------------
+void TestToolFileStore::UseTestStore( const char * storePath ) const
+{
+    // Start empty, and keep the machine-wide store untouched
+    AStackString<> path;
+    TEST_ASSERT( FileIO::GetCurrentDir( path ) );
+    path += NATIVE_SLASH;
+    path += storePath;
+    NodeGraph::CleanPath( path );
+    Array< AString > files;
+    FileIO::GetFiles( path, AStackString<>( "*" ), false, &files );
+    for ( const AString & file : files )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+    EnsureDirExists( path );
+    ToolFileStore::SetStorePathForTests( path );
+}
+
+// AgeStoreFiles
+//------------------------------------------------------------------------------
+void TestToolFileStore::AgeStoreFiles( const uint64_t * hashes, uint32_t numHashes ) const
+{
+    // Earlier content is made to look less recently used
+    for ( uint32_t i = 0; i < numHashes; ++i )
+    {
+        AStackString<> storeFile;
+        GetStoreFileName( hashes[ i ], storeFile );
+        const uint64_t age = ( ( numHashes - i ) * 10000000ULL );
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( storeFile, FileIO::GetFileLastWriteTime( storeFile ) - age ) );
+    }
+}
+
+// IsStored
+//------------------------------------------------------------------------------
+bool TestToolFileStore::IsStored( uint64_t hash ) const
+{
+    // Check directly, as Retrieve would mark the content as used
+    AStackString<> storeFile;
+    GetStoreFileName( hash, storeFile );
+    return FileIO::FileExists( storeFile.Get() );
+}
+
+// GetStoreFileName
+//------------------------------------------------------------------------------
+void TestToolFileStore::GetStoreFileName( uint64_t hash, AString & outFileName ) const
+{
+    ToolFileStore::GetStorePath( outFileName );
+    outFileName.AppendFormat( "%016" PRIx64, hash );
+}
+
+//------------------------------------------------------------------------------
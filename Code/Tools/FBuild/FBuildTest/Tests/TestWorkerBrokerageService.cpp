@@ -0,0 +1,211 @@
+// TestWorkerBrokerageService.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageService.h"
+
+// Core
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// Defines
+//------------------------------------------------------------------------------
+// unique port for test in all configs so the tests can run in parallel
+#if defined( __WINDOWS__ )
+    #ifdef DEBUG
+        #define TEST_PORT uint16_t( 21945 ) // arbitrarily chosen
+    #else
+        #define TEST_PORT uint16_t( 22945 ) // arbitrarily chosen
+    #endif
+#else
+    #ifdef DEBUG
+        #define TEST_PORT uint16_t( 23945 ) // arbitrarily chosen
+    #else
+        #define TEST_PORT uint16_t( 24945 ) // arbitrarily chosen
+    #endif
+#endif
+#define TEST_TIMEOUT_MS ( 10 * 1000 )
+
+// TestWorkerBrokerageService
+//------------------------------------------------------------------------------
+class TestWorkerBrokerageService : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void ParseAddress() const;
+    void RankedList() const;
+    void ListUpdates() const;
+
+    static void SendStatus( WorkerBrokerageServiceConnection & worker,
+                            const char * address,
+                            bool available,
+                            uint32_t numCPUs,
+                            uint32_t cpuUsagePercent,
+                            uint32_t freeMemoryMiB );
+    static void WaitForNumWorkers( const WorkerBrokerageService & service, size_t numWorkers );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkerBrokerageService )
+    REGISTER_TEST( ParseAddress )
+    REGISTER_TEST( RankedList )
+    REGISTER_TEST( ListUpdates )
+REGISTER_TESTS_END
+
+// ParseAddress
+//------------------------------------------------------------------------------
+void TestWorkerBrokerageService::ParseAddress() const
+{
+    AStackString<> host;
+    uint16_t port = 0;
+
+    // Default port
+    WorkerBrokerageService::ParseAddress( AStackString<>( "brokerage.local" ), host, port );
+    TEST_ASSERT( host == "brokerage.local" );
+    TEST_ASSERT( port == WorkerBrokerageService::DEFAULT_PORT );
+
+    // Explicit port
+    WorkerBrokerageService::ParseAddress( AStackString<>( "10.0.0.1:1234" ), host, port );
+    TEST_ASSERT( host == "10.0.0.1" );
+    TEST_ASSERT( port == 1234 );
+
+    // Invalid port
+    WorkerBrokerageService::ParseAddress( AStackString<>( "10.0.0.1:99999" ), host, port );
+    TEST_ASSERT( host == "10.0.0.1" );
+    TEST_ASSERT( port == WorkerBrokerageService::DEFAULT_PORT );
+}
+
+// RankedList
+//------------------------------------------------------------------------------
+void TestWorkerBrokerageService::RankedList() const
+{
+    WorkerBrokerageService service;
+    TEST_ASSERT( service.Start( TEST_PORT ) );
+
+    AStackString<> serviceAddress;
+    serviceAddress.Format( "127.0.0.1:%u", (uint32_t)TEST_PORT );
+
+    // Workers connect and report their state
+    WorkerBrokerageServiceConnection workers[ 4 ];
+    for ( WorkerBrokerageServiceConnection & worker : workers )
+    {
+        TEST_ASSERT( worker.ConnectToService( serviceAddress, TEST_TIMEOUT_MS ) );
+    }
+    SendStatus( workers[ 0 ], "10.0.0.1", true, 4, 50, 1000 );   // 2 spare CPUs
+    SendStatus( workers[ 1 ], "10.0.0.2", true, 8, 25, 1000 );   // 6 spare CPUs
+    SendStatus( workers[ 2 ], "10.0.0.3", false, 16, 0, 1000 );  // Not available
+    SendStatus( workers[ 3 ], "10.0.0.4", true, 8, 75, 2000 );   // 2 spare CPUs, more memory
+    WaitForNumWorkers( service, 4 );
+
+    // Client is sent the available workers, best first
+    WorkerBrokerageServiceConnection client;
+    TEST_ASSERT( client.ConnectToService( serviceAddress, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( client.Subscribe() );
+    Array< WorkerBrokerageInfo > list;
+    TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( list.GetSize() == 3 );
+    TEST_ASSERT( list[ 0 ].m_Address == "10.0.0.2" );
+    TEST_ASSERT( list[ 1 ].m_Address == "10.0.0.4" );
+    TEST_ASSERT( list[ 2 ].m_Address == "10.0.0.1" );
+    TEST_ASSERT( list[ 0 ].m_NumCPUs == 8 );
+    TEST_ASSERT( list[ 0 ].m_CPUUsagePercent == 25 );
+    TEST_ASSERT( list[ 1 ].m_FreeMemoryMiB == 2000 );
+}
+
+// ListUpdates
+//------------------------------------------------------------------------------
+void TestWorkerBrokerageService::ListUpdates() const
+{
+    WorkerBrokerageService service;
+    TEST_ASSERT( service.Start( TEST_PORT ) );
+
+    AStackString<> serviceAddress;
+    serviceAddress.Format( "127.0.0.1:%u", (uint32_t)TEST_PORT );
+
+    WorkerBrokerageServiceConnection workerA;
+    WorkerBrokerageServiceConnection workerB;
+    TEST_ASSERT( workerA.ConnectToService( serviceAddress, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( workerB.ConnectToService( serviceAddress, TEST_TIMEOUT_MS ) );
+    SendStatus( workerA, "10.0.0.1", true, 4, 0, 1000 );
+    SendStatus( workerB, "10.0.0.2", true, 4, 0, 1000 );
+    WaitForNumWorkers( service, 2 );
+
+    WorkerBrokerageServiceConnection client;
+    TEST_ASSERT( client.ConnectToService( serviceAddress, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( client.Subscribe() );
+    Array< WorkerBrokerageInfo > list;
+    TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( list.GetSize() == 2 );
+
+    // Changes in load are throttled, but are still sent
+    SendStatus( workerA, "10.0.0.1", true, 4, 50, 1000 );
+    SendStatus( workerA, "10.0.0.1", true, 4, 75, 1000 );
+    do
+    {
+        TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) );
+        TEST_ASSERT( list.GetSize() == 2 );
+        TEST_ASSERT( list[ 1 ].m_Address == "10.0.0.1" );
+    } while ( list[ 1 ].m_CPUUsagePercent != 75 );
+
+    // Worker becoming unavailable is pushed to subscribers
+    SendStatus( workerA, "10.0.0.1", false, 4, 0, 1000 );
+    TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( list.GetSize() == 1 );
+    TEST_ASSERT( list[ 0 ].m_Address == "10.0.0.2" );
+
+    // As is a worker disconnecting
+    workerB.ShutdownAllConnections();
+    TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) );
+    TEST_ASSERT( list.IsEmpty() );
+    WaitForNumWorkers( service, 1 );
+
+    // Service going away disconnects the client
+    service.ShutdownAllConnections();
+    const Timer t;
+    while ( client.IsConnected() )
+    {
+        TEST_ASSERT( t.GetElapsedMS() < (float)TEST_TIMEOUT_MS );
+        Thread::Sleep( 1 );
+    }
+    TEST_ASSERT( client.WaitForWorkerList( list, TEST_TIMEOUT_MS ) == false );
+}
+
+// SendStatus
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerBrokerageService::SendStatus( WorkerBrokerageServiceConnection & worker,
+                                                        const char * address,
+                                                        bool available,
+                                                        uint32_t numCPUs,
+                                                        uint32_t cpuUsagePercent,
+                                                        uint32_t freeMemoryMiB )
+{
+    // Workers connect via loopback in the test, so the reported address is used
+    WorkerBrokerageInfo info;
+    info.m_Address = address;
+    info.m_HostName = address;
+    info.m_Available = available;
+    info.m_NumCPUs = numCPUs;
+    info.m_CPUUsagePercent = cpuUsagePercent;
+    info.m_FreeMemoryMiB = freeMemoryMiB;
+    TEST_ASSERT( worker.SendStatus( info ) );
+}
+
+// WaitForNumWorkers
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerBrokerageService::WaitForNumWorkers( const WorkerBrokerageService & service, size_t numWorkers )
+{
+    const Timer t;
+    while ( service.GetNumWorkers() != numWorkers )
+    {
+        TEST_ASSERT( t.GetElapsedMS() < (float)TEST_TIMEOUT_MS );
+        Thread::Sleep( 1 );
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,278 @@
+// TestWorkerResultCache.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerResultCache.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Strings/AStackString.h"
+
+#include <memory.h>
+
+// TestWorkerResultCache
+//------------------------------------------------------------------------------
+class TestWorkerResultCache : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void StoreAndRetrieve() const;
+    void MissAndAbandon() const;
+    void Limits() const;
+    void Reload() const;
+    void Corrupt() const;
+
+    static void ClearCache( const AString & path );
+    void StoreHelper( WorkerResultCache & cache, const char * key, const AString & fileName, const char * content ) const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkerResultCache )
+    REGISTER_TEST( StoreAndRetrieve )
+    REGISTER_TEST( MissAndAbandon )
+    REGISTER_TEST( Limits )
+    REGISTER_TEST( Reload )
+    REGISTER_TEST( Corrupt )
+REGISTER_TESTS_END
+
+// StoreAndRetrieve
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::StoreAndRetrieve() const
+{
+    const AStackString<> cachePath( "../tmp/Test/WorkerResultCache/StoreAndRetrieve/Cache/" );
+    ClearCache( cachePath );
+    EnsureDirExists( "../tmp/Test/WorkerResultCache/StoreAndRetrieve/" );
+
+    WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+
+    // First job is a miss, and the caller builds it
+    StackArray< AString > fileNames;
+    fileNames.EmplaceBack( "../tmp/Test/WorkerResultCache/StoreAndRetrieve/file.obj" );
+    fileNames.EmplaceBack( "../tmp/Test/WorkerResultCache/StoreAndRetrieve/file.pdb" );
+    Array< AString > messages;
+    uint32_t buildTimeMS = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) == false );
+    MakeFile( fileNames[ 0 ].Get(), "Object" );
+    MakeFile( fileNames[ 1 ].Get(), "PDB" );
+    StackArray< AString > warnings;
+    warnings.EmplaceBack( "warning: something" );
+    cache.Store( AStackString<>( "KeyA" ), fileNames, warnings, 1234 );
+    TEST_ASSERT( cache.GetNumEntries() == 1 );
+    TEST_ASSERT( cache.GetMemoryUsed() > 0 );
+    TEST_ASSERT( cache.GetDiskUsed() == cache.GetMemoryUsed() );
+
+    // Duplicate is answered from the cache, with the original outputs
+    FileIO::FileDelete( fileNames[ 0 ].Get() );
+    FileIO::FileDelete( fileNames[ 1 ].Get() );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) );
+    AString contents;
+    LoadFileContentsAsString( fileNames[ 0 ].Get(), contents );
+    TEST_ASSERT( contents == "Object" );
+    LoadFileContentsAsString( fileNames[ 1 ].Get(), contents );
+    TEST_ASSERT( contents == "PDB" );
+    TEST_ASSERT( messages.GetSize() == 1 );
+    TEST_ASSERT( messages[ 0 ] == "warning: something" );
+    TEST_ASSERT( buildTimeMS == 1234 );
+}
+
+// MissAndAbandon
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::MissAndAbandon() const
+{
+    const AStackString<> cachePath( "../tmp/Test/WorkerResultCache/MissAndAbandon/Cache/" );
+    ClearCache( cachePath );
+    EnsureDirExists( "../tmp/Test/WorkerResultCache/MissAndAbandon/" );
+
+    WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+
+    StackArray< AString > fileNames;
+    fileNames.EmplaceBack( "../tmp/Test/WorkerResultCache/MissAndAbandon/file.obj" );
+    Array< AString > messages;
+    uint32_t buildTimeMS = 0;
+
+    // Failed builds are not kept, so the next duplicate must be built again
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) == false );
+    cache.Abandon( AStackString<>( "KeyA" ) );
+    TEST_ASSERT( cache.GetNumEntries() == 0 );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) == false );
+    cache.Abandon( AStackString<>( "KeyA" ) );
+
+    // Results which can't be read are not kept either
+    FileIO::FileDelete( fileNames[ 0 ].Get() );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyB" ), fileNames, messages, buildTimeMS ) == false );
+    cache.Store( AStackString<>( "KeyB" ), fileNames, messages, 100 );
+    TEST_ASSERT( cache.GetNumEntries() == 0 );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyB" ), fileNames, messages, buildTimeMS ) == false );
+    cache.Abandon( AStackString<>( "KeyB" ) );
+}
+
+// Limits
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::Limits() const
+{
+    const AStackString<> cachePath( "../tmp/Test/WorkerResultCache/Limits/Cache/" );
+    ClearCache( cachePath );
+    EnsureDirExists( "../tmp/Test/WorkerResultCache/Limits/" );
+    const AStackString<> fileName( "../tmp/Test/WorkerResultCache/Limits/file.obj" );
+
+    // Find the size of an entry
+    uint64_t entrySize = 0;
+    {
+        const AStackString<> sizePath( "../tmp/Test/WorkerResultCache/Limits/SizeCache/" );
+        ClearCache( sizePath );
+        WorkerResultCache cache( sizePath, 1024 * 1024, 1024 * 1024 );
+        StoreHelper( cache, "Key0", fileName, "Content0" );
+        entrySize = cache.GetDiskUsed();
+        TEST_ASSERT( entrySize > 0 );
+        ClearCache( sizePath );
+    }
+
+    // Space for 2 entries in memory and 3 on disk
+    WorkerResultCache cache( cachePath, ( entrySize * 2 ), ( entrySize * 3 ) );
+    StoreHelper( cache, "Key1", fileName, "Content1" );
+    StoreHelper( cache, "Key2", fileName, "Content2" );
+    TEST_ASSERT( cache.GetMemoryUsed() == ( entrySize * 2 ) );
+    StoreHelper( cache, "Key3", fileName, "Content3" );
+    TEST_ASSERT( cache.GetNumEntries() == 3 );
+    TEST_ASSERT( cache.GetMemoryUsed() == ( entrySize * 2 ) );
+    TEST_ASSERT( cache.GetDiskUsed() == ( entrySize * 3 ) );
+
+    // Results no longer in memory are read from disk
+    StackArray< AString > fileNames;
+    fileNames.Append( fileName );
+    Array< AString > messages;
+    uint32_t buildTimeMS = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "Key1" ), fileNames, messages, buildTimeMS ) );
+    AString contents;
+    LoadFileContentsAsString( fileName.Get(), contents );
+    TEST_ASSERT( contents == "Content1" );
+    TEST_ASSERT( cache.GetMemoryUsed() == ( entrySize * 2 ) );
+
+    // Least recently used result (Key2) is evicted entirely
+    StoreHelper( cache, "Key4", fileName, "Content4" );
+    TEST_ASSERT( cache.GetNumEntries() == 3 );
+    TEST_ASSERT( cache.GetDiskUsed() == ( entrySize * 3 ) );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "Key2" ), fileNames, messages, buildTimeMS ) == false );
+    cache.Abandon( AStackString<>( "Key2" ) );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "Key1" ), fileNames, messages, buildTimeMS ) );
+    LoadFileContentsAsString( fileName.Get(), contents );
+    TEST_ASSERT( contents == "Content1" );
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "Key3" ), fileNames, messages, buildTimeMS ) );
+    LoadFileContentsAsString( fileName.Get(), contents );
+    TEST_ASSERT( contents == "Content3" );
+}
+
+// Reload
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::Reload() const
+{
+    const AStackString<> cachePath( "../tmp/Test/WorkerResultCache/Reload/Cache/" );
+    ClearCache( cachePath );
+    EnsureDirExists( "../tmp/Test/WorkerResultCache/Reload/" );
+    const AStackString<> fileName( "../tmp/Test/WorkerResultCache/Reload/file.obj" );
+
+    uint64_t diskUsed = 0;
+    {
+        WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+        StoreHelper( cache, "KeyA", fileName, "ContentA" );
+        StoreHelper( cache, "KeyB", fileName, "ContentB" );
+        diskUsed = cache.GetDiskUsed();
+    }
+
+    // Results survive the worker restarting
+    {
+        WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+        TEST_ASSERT( cache.GetNumEntries() == 2 );
+        TEST_ASSERT( cache.GetMemoryUsed() == 0 );
+        TEST_ASSERT( cache.GetDiskUsed() == diskUsed );
+
+        StackArray< AString > fileNames;
+        fileNames.Append( fileName );
+        Array< AString > messages;
+        uint32_t buildTimeMS = 0;
+        TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) );
+        AString contents;
+        LoadFileContentsAsString( fileName.Get(), contents );
+        TEST_ASSERT( contents == "ContentA" );
+        TEST_ASSERT( cache.GetMemoryUsed() > 0 );
+    }
+
+    // Reduced limits are respected on restart
+    WorkerResultCache smallCache( cachePath, 0, ( diskUsed / 2 ) );
+    TEST_ASSERT( smallCache.GetNumEntries() == 1 );
+}
+
+// Corrupt
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::Corrupt() const
+{
+    const AStackString<> cachePath( "../tmp/Test/WorkerResultCache/Corrupt/Cache/" );
+    ClearCache( cachePath );
+    EnsureDirExists( "../tmp/Test/WorkerResultCache/Corrupt/" );
+    const AStackString<> fileName( "../tmp/Test/WorkerResultCache/Corrupt/file.obj" );
+
+    {
+        WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+        StoreHelper( cache, "KeyA", fileName, "ContentA" );
+    }
+
+    // Damage the entry on disk, keeping the size the same
+    AStackString<> entryFileName( cachePath );
+    entryFileName += "KeyA";
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( entryFileName.Get(), FileStream::READ_ONLY ) );
+        const uint64_t size = fs.GetFileSize();
+        fs.Close();
+        TEST_ASSERT( size > 8 );
+        AString damaged;
+        damaged.SetLength( (uint32_t)size );
+        memset( damaged.Get(), 'X', size );
+        MakeFile( entryFileName.Get(), damaged.Get() );
+    }
+
+    // Damaged entry is discarded and the job must be built
+    WorkerResultCache cache( cachePath, 1024 * 1024, 1024 * 1024 );
+    TEST_ASSERT( cache.GetNumEntries() == 1 );
+    StackArray< AString > fileNames;
+    fileNames.Append( fileName );
+    Array< AString > messages;
+    uint32_t buildTimeMS = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( "KeyA" ), fileNames, messages, buildTimeMS ) == false );
+    TEST_ASSERT( cache.GetNumEntries() == 0 );
+    TEST_ASSERT( FileIO::FileExists( entryFileName.Get() ) == false );
+    cache.Abandon( AStackString<>( "KeyA" ) );
+}
+
+// ClearCache
+//------------------------------------------------------------------------------
+/*static*/ void TestWorkerResultCache::ClearCache( const AString & path )
+{
+    Array< AString > files;
+    FileIO::GetFiles( path, AStackString<>( "*" ), false, &files );
+    for ( const AString & file : files )
+    {
+        TEST_ASSERT( FileIO::FileDelete( file.Get() ) );
+    }
+}
+
+// StoreHelper
+//------------------------------------------------------------------------------
+void TestWorkerResultCache::StoreHelper( WorkerResultCache & cache, const char * key, const AString & fileName, const char * content ) const
+{
+    StackArray< AString > fileNames;
+    fileNames.Append( fileName );
+    Array< AString > messages;
+    uint32_t buildTimeMS = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( key ), fileNames, messages, buildTimeMS ) == false );
+    MakeFile( fileName.Get(), content );
+    cache.Store( AStackString<>( key ), fileNames, messages, 100 );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+// TestWorkerStats.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Protocol/WorkerStats.h"
+
+// TestWorkerStats
+//------------------------------------------------------------------------------
+class TestWorkerStats : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void Unknown() const;
+    void Estimate() const;
+    void SpeedFactor() const;
+    void Reset() const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestWorkerStats )
+    REGISTER_TEST( Unknown )
+    REGISTER_TEST( Estimate )
+    REGISTER_TEST( SpeedFactor )
+    REGISTER_TEST( Reset )
+REGISTER_TESTS_END
+
+// Unknown
+//------------------------------------------------------------------------------
+void TestWorkerStats::Unknown() const
+{
+    // Nothing can be estimated before any jobs are returned
+    const WorkerStats stats;
+    TEST_ASSERT( stats.GetNumJobs() == 0 );
+    TEST_ASSERT( stats.EstimateRoundTripMS( 0 ) == 0 );
+    TEST_ASSERT( stats.EstimateRoundTripMS( 1000 ) == 0 );
+    TEST_ASSERT( stats.GetSpeedFactor() == 0.0f );
+}
+
+// Estimate
+//------------------------------------------------------------------------------
+void TestWorkerStats::Estimate() const
+{
+    WorkerStats stats;
+
+    // Jobs which have not been built before
+    stats.OnJobCompleted( 300, 200, 0 );
+    TEST_ASSERT( stats.GetNumJobs() == 1 );
+    TEST_ASSERT( stats.GetAvgOverheadMS() == 100 );
+    TEST_ASSERT( stats.EstimateRoundTripMS( 0 ) == 300 );
+
+    // Speed is unknown, so previous build time is used as-is
+    TEST_ASSERT( stats.EstimateRoundTripMS( 1000 ) == 1100 );
+
+    // Round trip shorter than build time (clock differences) has no overhead
+    stats.OnJobCompleted( 100, 200, 0 );
+    TEST_ASSERT( stats.GetAvgOverheadMS() == 75 );
+}
+
+// SpeedFactor
+//------------------------------------------------------------------------------
+void TestWorkerStats::SpeedFactor() const
+{
+    WorkerStats stats;
+
+    // Not trusted until there are enough samples
+    stats.OnJobCompleted( 2000, 2000, 1000 );
+    stats.OnJobCompleted( 2000, 2000, 1000 );
+    TEST_ASSERT( stats.GetSpeedFactor() == 0.0f );
+
+    // Jobs too short to compare are ignored
+    stats.OnJobCompleted( 5, 5, 1 );
+    TEST_ASSERT( stats.GetSpeedFactor() == 0.0f );
+
+    // Worker takes twice as long as previous builds
+    stats.OnJobCompleted( 2000, 2000, 1000 );
+    TEST_ASSERT( stats.GetSpeedFactor() == 2.0f );
+    TEST_ASSERT( stats.EstimateRoundTripMS( 500 ) == 1000 );
+
+    // Recent jobs are favored
+    for ( size_t i = 0; i < 20; ++i )
+    {
+        stats.OnJobCompleted( 500, 500, 1000 );
+    }
+    TEST_ASSERT( stats.GetSpeedFactor() < 0.51f );
+}
+
+// Reset
+//------------------------------------------------------------------------------
+void TestWorkerStats::Reset() const
+{
+    WorkerStats stats;
+    for ( size_t i = 0; i < 5; ++i )
+    {
+        stats.OnJobCompleted( 2000, 1000, 1000 );
+    }
+    TEST_ASSERT( stats.GetSpeedFactor() == 1.0f );
+
+    stats.Reset();
+    TEST_ASSERT( stats.GetNumJobs() == 0 );
+    TEST_ASSERT( stats.GetSpeedFactor() == 0.0f );
+    TEST_ASSERT( stats.EstimateRoundTripMS( 1000 ) == 0 );
+}
+
+//------------------------------------------------------------------------------
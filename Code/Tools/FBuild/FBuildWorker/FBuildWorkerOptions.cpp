@@ -7,6 +7,7 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageService.h"
 
 // Core
 #include "Core/Containers/Array.h"
@@ -31,8 +32,11 @@ FBuildWorkerOptions::FBuildWorkerOptions() :
     m_OverrideWorkMode( false ),
     m_WorkMode( WorkerSettings::WHEN_IDLE ),
     m_MinimumFreeMemoryMiB( 0 ),
+    m_UseTmpFS( false ),
     m_ConsoleMode( false ),
-    m_PeriodicRestart( false )
+    m_PeriodicRestart( false ),
+    m_BrokerageService( false ),
+    m_BrokerageServicePort( WorkerBrokerageService::DEFAULT_PORT )
 {
     #ifdef __LINUX__
         m_ConsoleMode = true; // Only console mode supported on Linux
@@ -113,11 +117,34 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             m_OverrideWorkMode = true;
             continue;
         }
+        else if ( token == "-brokerageservice" )
+        {
+            m_BrokerageService = true;
+            continue;
+        }
+        else if ( token.BeginsWith( "-brokerageservice=" ) )
+        {
+            uint32_t port( 0 );
+            if ( ( AString::ScanS( token.Get() + 18, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+            {
+                m_BrokerageService = true;
+                m_BrokerageServicePort = (uint16_t)port;
+                continue;
+            }
+            // problem... fall through
+        }
         else if ( token == "-periodicrestart" )
         {
             m_PeriodicRestart = true;
             continue;
         }
+        #if defined( __LINUX__ )
+            else if ( token == "-tmpfs" )
+            {
+                m_UseTmpFS = true;
+                continue;
+            }
+        #endif
         #if defined( __WINDOWS__ )
             else if ( token.BeginsWith( "-minfreememory=" ) )
             {
@@ -161,6 +188,9 @@ void FBuildWorkerOptions::ShowUsageError()
                        "\n"
                        "Command Line Options:\n"
                        "---------------------------------------------------------------------------\n"
+                       " -brokerageservice[=<port>]\n"
+                       "        Run the worker brokerage service instead of a worker.\n"
+                       "        Workers and clients find it via FASTBUILD_BROKERAGE_SERVICE.\n"
                        " -console\n"
                        "        (Windows/OSX) Operate from console instead of GUI.\n"
                        " -cpus=<n|-n|n%>   Set number of CPUs to use:\n"
@@ -181,6 +211,8 @@ void FBuildWorkerOptions::ShowUsageError()
                        "        (Windows) Don't spawn a sub-process worker copy.\n"
                        " -periodicrestart\n"
                        "        Worker will restart every 4 hours.\n"
+                       " -tmpfs\n"
+                       "        (Linux) Keep files for jobs in /dev/shm when there is space.\n"
                        "---------------------------------------------------------------------------\n"
                        ;
 
@@ -35,6 +35,7 @@ public:
     bool m_OverrideWorkMode;
     WorkerSettings::Mode m_WorkMode;
     uint32_t m_MinimumFreeMemoryMiB; // Minimum OS free memory including virtual memory to let worker do its work
+    bool m_UseTmpFS;                 // Keep files for jobs in /dev/shm (Linux)
 
     // Console mode
     bool m_ConsoleMode;
@@ -42,6 +43,10 @@ public:
     // Other
     bool m_PeriodicRestart;
 
+    // Brokerage service (run instead of a worker)
+    bool m_BrokerageService;
+    uint16_t m_BrokerageServicePort;
+
 private:
     void ShowUsageError();
 };
@@ -8,12 +8,17 @@
 #include "Tools/FBuild/FBuildWorker/FBuildWorkerOptions.h"
 #include "Tools/FBuild/FBuildWorker/Worker/Worker.h"
 
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerageService.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThread.h"
+
 // Core
 #include "Core/Env/Assert.h"
 #include "Core/Env/Env.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/Mem/MemTracker.h"
+#include "Core/Network/NetworkStartupHelper.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/SystemMutex.h"
 #include "Core/Process/Thread.h"
@@ -33,6 +38,7 @@ SystemMutex g_OneProcessMutex( "Global\\FBuildWorker" );
 // Functions
 //------------------------------------------------------------------------------
 int Main( const AString & args );
+int RunBrokerageService( uint16_t port );
 #if defined( __WINDOWS__ )
     int LaunchSubProcess( const AString & args );
 #endif
@@ -88,6 +94,12 @@ int Main( const AString & args )
         return -3;
     }
 
+    // the brokerage service is independent of any worker on this machine
+    if ( options.m_BrokerageService )
+    {
+        return RunBrokerageService( options.m_BrokerageServicePort );
+    }
+
     // only allow 1 worker per system
     const Timer t;
     while ( g_OneProcessMutex.TryLock() == false )
@@ -123,6 +135,9 @@ int Main( const AString & args )
         // TODO:LINUX SetPriorityClass equivalent
     #endif
 
+    // must be set before the worker creates its job queue
+    WorkerThread::SetMemoryBackedTempDirEnabled( options.m_UseTmpFS );
+
     // start the worker and wait for it to be closed
     int ret;
     {
@@ -145,6 +160,27 @@ int Main( const AString & args )
     return ret;
 }
 
+// RunBrokerageService
+//------------------------------------------------------------------------------
+int RunBrokerageService( uint16_t port )
+{
+    NetworkStartupHelper networkStartupHelper;
+
+    WorkerBrokerageService service;
+    if ( service.Start( port ) == false )
+    {
+        printf( "Failed to start brokerage service on port %u\n", (uint32_t)port );
+        return -4;
+    }
+    printf( "FBuildWorker brokerage service listening on port %u\n", (uint32_t)port );
+
+    // run until killed
+    for ( ;; )
+    {
+        Thread::Sleep( 1000 );
+    }
+}
+
 // LaunchSubProcess
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ )
@@ -27,6 +27,7 @@ public:
     // query status
     inline bool IsIdle() const { return m_IsIdle; }
     inline float IsIdleFloat() const { return m_IsIdleFloat; }
+    inline float GetCPUUsageTotal() const { return m_CPUUsageTotal; }
 
 private:
     // struct to track processes with
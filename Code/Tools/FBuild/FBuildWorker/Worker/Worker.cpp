@@ -26,6 +26,7 @@
 #include "Core/Env/ErrorFormat.h"
 #include "Core/Env/Types.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Network/NetworkStartupHelper.h"
 #include "Core/Process/Process.h"
 #include "Core/Process/Thread.h"
@@ -37,6 +38,9 @@
 #if defined( __WINDOWS__ )
     #include <Psapi.h>
 #endif
+#if defined( __LINUX__ )
+    #include <unistd.h>
+#endif
 #include <stdio.h>
 
 // CONSTRUCTOR
@@ -51,6 +55,7 @@ Worker::Worker( const AString & args, bool consoleMode, bool periodicRestart )
     , m_LastWriteTime( 0 )
     , m_WantToQuit( false )
     , m_RestartNeeded( false )
+    , m_FreeMemoryMiB( 0 )
     #if defined( __WINDOWS__ )
         , m_LastDiskSpaceResult( -1 )
         , m_LastMemoryCheckResult( -1 )
@@ -288,6 +293,7 @@ bool Worker::HasEnoughMemory()
 
             // Calculate the free memory in MiB.
             const uint64_t freeMemSize = ( limitMemSize - currentMemSize ) / MEGABYTE;
+            m_FreeMemoryMiB = (uint32_t)Math::Min< uint64_t >( freeMemSize, 0xFFFFFFFF );
 
             // Check if the free memory is high enough
             const WorkerSettings & ws = WorkerSettings::Get();
@@ -301,8 +307,17 @@ bool Worker::HasEnoughMemory()
         // The machine doesn't have enough memory or query failed. Exclude this machine from worker pool.
         m_LastMemoryCheckResult = 0;
         return false;
+    #elif defined( __LINUX__ )
+        // Track free memory for the brokerage service
+        const int64_t freePages = sysconf( _SC_AVPHYS_PAGES );
+        const int64_t pageSize = sysconf( _SC_PAGESIZE );
+        if ( ( freePages > 0 ) && ( pageSize > 0 ) )
+        {
+            m_FreeMemoryMiB = (uint32_t)Math::Min< uint64_t >( (uint64_t)freePages * (uint64_t)pageSize / MEGABYTE, 0xFFFFFFFF );
+        }
+        return true; // TODO:LINUX Implement
     #else
-        return true; // TODO:LINUX TODO:OSX Implement
+        return true; // TODO:OSX Implement
     #endif
 }
 
@@ -362,6 +377,7 @@ void Worker::UpdateAvailability()
 
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
+    m_WorkerBrokerage.SetLoad( numCPUsToUse, (uint32_t)m_IdleDetection.GetCPUUsageTotal(), m_FreeMemoryMiB );
     m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0 );
 }
 
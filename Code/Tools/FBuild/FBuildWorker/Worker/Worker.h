@@ -65,6 +65,7 @@ private:
     Timer               m_PeriodicRestartTimer;
     Timer               m_UIUpdateTimer;
     FileStream          m_TargetIncludeFolderLock;
+    uint32_t            m_FreeMemoryMiB;            // Reported to the brokerage service. 0 if unknown.
     #if defined( __WINDOWS__ )
         Timer               m_TimerLastDiskSpaceCheck;
         int32_t             m_LastDiskSpaceResult;      // -1 : No check done yet. 0=Not enough space right now. 1=OK for now.